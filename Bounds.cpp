@@ -0,0 +1,419 @@
+#include "Bounds.h"
+
+#include <float.h>
+#include <math.h>
+#include <random>
+
+using namespace DirectX;
+
+// Rotation sweeps for the eigenvectors of the covariance matrix
+// (Jacobi converges in well under this for 3x3 matrices)
+#define BOUNDS_JACOBI_SWEEPS 16
+
+// --------------------------------------------------------
+// Eigenvectors of a symmetric 3x3 matrix (Jacobi rotations).
+// The vectors end up in the columns of "vectors"
+// --------------------------------------------------------
+static void ComputeEigenvectors(double m[3][3], double vectors[3][3])
+{
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++)
+			vectors[i][j] = (i == j) ? 1.0 : 0.0;
+
+	for (int sweep = 0; sweep < BOUNDS_JACOBI_SWEEPS; sweep++)
+	{
+		// Done once the off-diagonal part has vanished
+		double offDiagonal = fabs(m[0][1]) + fabs(m[0][2]) + fabs(m[1][2]);
+		if (offDiagonal < 1e-12 * (fabs(m[0][0]) + fabs(m[1][1]) + fabs(m[2][2])) || offDiagonal == 0.0)
+			return;
+
+		for (int p = 0; p < 2; p++)
+		{
+			for (int q = p + 1; q < 3; q++)
+			{
+				if (m[p][q] == 0.0)
+					continue;
+
+				// Rotate in the pq plane to zero out m[p][q]
+				double theta = (m[q][q] - m[p][p]) / (2.0 * m[p][q]);
+				double t = (theta >= 0.0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+				double c = 1.0 / sqrt(t * t + 1.0);
+				double s = t * c;
+
+				for (int k = 0; k < 3; k++)
+				{
+					double mkp = m[k][p];
+					double mkq = m[k][q];
+					m[k][p] = c * mkp - s * mkq;
+					m[k][q] = s * mkp + c * mkq;
+				}
+				for (int k = 0; k < 3; k++)
+				{
+					double mpk = m[p][k];
+					double mqk = m[q][k];
+					m[p][k] = c * mpk - s * mqk;
+					m[q][k] = s * mpk + c * mqk;
+				}
+				for (int k = 0; k < 3; k++)
+				{
+					double vkp = vectors[k][p];
+					double vkq = vectors[k][q];
+					vectors[k][p] = c * vkp - s * vkq;
+					vectors[k][q] = s * vkp + c * vkq;
+				}
+			}
+		}
+	}
+}
+
+BoundsAABB BoundsBuilder::ComputeAABB(const Vertex* verts, size_t vertexCount)
+{
+	BoundsAABB box = {};
+	if (vertexCount == 0)
+		return box;
+
+	// Four independent min/max chains, so the loads and compares overlap
+	XMVECTOR boundsMin[4];
+	XMVECTOR boundsMax[4];
+	for (int k = 0; k < 4; k++)
+	{
+		boundsMin[k] = XMLoadFloat3(&verts[0].Position);
+		boundsMax[k] = boundsMin[k];
+	}
+
+	size_t v = 0;
+	for (; v + 4 <= vertexCount; v += 4)
+	{
+		for (int k = 0; k < 4; k++)
+		{
+			XMVECTOR pos = XMLoadFloat3(&verts[v + k].Position);
+			boundsMin[k] = XMVectorMin(boundsMin[k], pos);
+			boundsMax[k] = XMVectorMax(boundsMax[k], pos);
+		}
+	}
+	for (; v < vertexCount; v++)
+	{
+		XMVECTOR pos = XMLoadFloat3(&verts[v].Position);
+		boundsMin[0] = XMVectorMin(boundsMin[0], pos);
+		boundsMax[0] = XMVectorMax(boundsMax[0], pos);
+	}
+
+	XMVECTOR totalMin = XMVectorMin(XMVectorMin(boundsMin[0], boundsMin[1]), XMVectorMin(boundsMin[2], boundsMin[3]));
+	XMVECTOR totalMax = XMVectorMax(XMVectorMax(boundsMax[0], boundsMax[1]), XMVectorMax(boundsMax[2], boundsMax[3]));
+	XMStoreFloat3(&box.Center, (totalMin + totalMax) * 0.5f);
+	XMStoreFloat3(&box.Extents, (totalMax - totalMin) * 0.5f);
+	return box;
+}
+
+BoundsSphere BoundsBuilder::ComputeSphere(const Vertex* verts, size_t vertexCount)
+{
+	BoundsSphere sphere = {};
+	if (vertexCount == 0)
+		return sphere;
+
+	// The most distant pair among the extreme vertices on each axis
+	size_t minIndex[3] = { 0, 0, 0 };
+	size_t maxIndex[3] = { 0, 0, 0 };
+	for (size_t v = 1; v < vertexCount; v++)
+	{
+		const XMFLOAT3& p = verts[v].Position;
+		const float coords[3] = { p.x, p.y, p.z };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const XMFLOAT3& low = verts[minIndex[axis]].Position;
+			const XMFLOAT3& high = verts[maxIndex[axis]].Position;
+			if (coords[axis] < (&low.x)[axis]) minIndex[axis] = v;
+			if (coords[axis] > (&high.x)[axis]) maxIndex[axis] = v;
+		}
+	}
+
+	XMVECTOR a = XMLoadFloat3(&verts[minIndex[0]].Position);
+	XMVECTOR b = XMLoadFloat3(&verts[maxIndex[0]].Position);
+	float spanSq = XMVectorGetX(XMVector3LengthSq(b - a));
+	for (int axis = 1; axis < 3; axis++)
+	{
+		XMVECTOR low = XMLoadFloat3(&verts[minIndex[axis]].Position);
+		XMVECTOR high = XMLoadFloat3(&verts[maxIndex[axis]].Position);
+		float axisSpanSq = XMVectorGetX(XMVector3LengthSq(high - low));
+		if (axisSpanSq > spanSq)
+		{
+			a = low;
+			b = high;
+			spanSq = axisSpanSq;
+		}
+	}
+
+	// Grow the sphere just enough to take in each vertex outside it
+	XMVECTOR center = (a + b) * 0.5f;
+	float radius = sqrtf(spanSq) * 0.5f;
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		XMVECTOR pos = XMLoadFloat3(&verts[v].Position);
+		float distanceSq = XMVectorGetX(XMVector3LengthSq(pos - center));
+		if (distanceSq <= radius * radius)
+			continue;
+
+		float distance = sqrtf(distanceSq);
+		float newRadius = (radius + distance) * 0.5f;
+		center += (pos - center) * ((newRadius - radius) / distance);
+		radius = newRadius;
+	}
+
+	// The box's center sometimes does better (symmetric meshes)
+	BoundsAABB box = ComputeAABB(verts, vertexCount);
+	XMVECTOR boxCenter = XMLoadFloat3(&box.Center);
+	XMVECTOR farthestSq = XMVectorZero();
+	for (size_t v = 0; v < vertexCount; v++)
+		farthestSq = XMVectorMax(farthestSq, XMVector3LengthSq(XMLoadFloat3(&verts[v].Position) - boxCenter));
+
+	float boxRadius = sqrtf(XMVectorGetX(farthestSq));
+	if (boxRadius < radius)
+	{
+		center = boxCenter;
+		radius = boxRadius;
+	}
+
+	XMStoreFloat3(&sphere.Center, center);
+	sphere.Radius = radius;
+	return sphere;
+}
+
+BoundsOBB BoundsBuilder::ComputeOBB(const Vertex* verts, size_t vertexCount)
+{
+	BoundsAABB box = ComputeAABB(verts, vertexCount);
+
+	BoundsOBB obb = {};
+	obb.Center = box.Center;
+	obb.Extents = box.Extents;
+	obb.Orientation = XMFLOAT4(0, 0, 0, 1);
+	if (vertexCount < 3)
+		return obb;
+
+	// Covariance of the positions: squares in one vector, and
+	// the (xy, yz, zx) products in another
+	XMVECTOR sum = XMVectorZero();
+	XMVECTOR sumSquares = XMVectorZero();
+	XMVECTOR sumProducts = XMVectorZero();
+	XMVECTOR boxCenter = XMLoadFloat3(&box.Center);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		// Relative to the box's center, for precision
+		XMVECTOR pos = XMLoadFloat3(&verts[v].Position) - boxCenter;
+		sum += pos;
+		sumSquares += pos * pos;
+		sumProducts += pos * XMVectorSwizzle<1, 2, 0, 3>(pos);
+	}
+
+	XMFLOAT3 mean;
+	XMFLOAT3 squares;
+	XMFLOAT3 products;
+	float invCount = 1.0f / (float)vertexCount;
+	XMStoreFloat3(&mean, sum * invCount);
+	XMStoreFloat3(&squares, sumSquares * invCount);
+	XMStoreFloat3(&products, sumProducts * invCount);
+
+	double covariance[3][3];
+	covariance[0][0] = squares.x - (double)mean.x * mean.x;
+	covariance[1][1] = squares.y - (double)mean.y * mean.y;
+	covariance[2][2] = squares.z - (double)mean.z * mean.z;
+	covariance[0][1] = covariance[1][0] = products.x - (double)mean.x * mean.y;
+	covariance[1][2] = covariance[2][1] = products.y - (double)mean.y * mean.z;
+	covariance[0][2] = covariance[2][0] = products.z - (double)mean.z * mean.x;
+
+	double vectors[3][3];
+	ComputeEigenvectors(covariance, vectors);
+
+	// Rows of the rotation are the box's axes (right-handed)
+	XMVECTOR axis0 = XMVector3Normalize(XMVectorSet((float)vectors[0][0], (float)vectors[1][0], (float)vectors[2][0], 0));
+	XMVECTOR axis1 = XMVector3Normalize(XMVectorSet((float)vectors[0][1], (float)vectors[1][1], (float)vectors[2][1], 0));
+	XMVECTOR axis2 = XMVector3Normalize(XMVector3Cross(axis0, axis1));
+	axis1 = XMVector3Cross(axis2, axis0);
+	XMMATRIX rotation(axis0, axis1, axis2, XMVectorSet(0, 0, 0, 1));
+	XMMATRIX toLocal = XMMatrixTranspose(rotation);
+
+	XMVECTOR localMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR localMax = XMVectorReplicate(-FLT_MAX);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		XMVECTOR local = XMVector3TransformNormal(XMLoadFloat3(&verts[v].Position), toLocal);
+		localMin = XMVectorMin(localMin, local);
+		localMax = XMVectorMax(localMax, local);
+	}
+
+	// Only worth it if it's actually tighter than the AABB
+	XMFLOAT3 extents;
+	XMStoreFloat3(&extents, (localMax - localMin) * 0.5f);
+	float volume = extents.x * extents.y * extents.z;
+	float boxVolume = box.Extents.x * box.Extents.y * box.Extents.z;
+	if (volume >= boxVolume)
+		return obb;
+
+	XMStoreFloat3(&obb.Center, XMVector3TransformNormal((localMin + localMax) * 0.5f, rotation));
+	obb.Extents = extents;
+	XMStoreFloat4(&obb.Orientation, XMQuaternionNormalize(XMQuaternionRotationMatrix(rotation)));
+	return obb;
+}
+
+// --------------------------------------------------------
+// Transforms the box's center, and sizes the new box from
+// the absolute values of the matrix (Arvo, Graphics Gems)
+// --------------------------------------------------------
+BoundsAABB BoundsBuilder::TransformAABB(const BoundsAABB& box, FXMMATRIX world)
+{
+	XMVECTOR extents = XMLoadFloat3(&box.Extents);
+
+	BoundsAABB result;
+	XMStoreFloat3(&result.Center, XMVector3Transform(XMLoadFloat3(&box.Center), world));
+	XMStoreFloat3(&result.Extents,
+		XMVectorAbs(world.r[0]) * XMVectorSplatX(extents) +
+		XMVectorAbs(world.r[1]) * XMVectorSplatY(extents) +
+		XMVectorAbs(world.r[2]) * XMVectorSplatZ(extents));
+	return result;
+}
+
+BoundsAABB BoundsBuilder::TransformOBBToAABB(const BoundsOBB& box, FXMMATRIX world)
+{
+	// The box's own rotation, then the world matrix (minus its translation)
+	XMMATRIX axes = XMMatrixMultiply(XMMatrixRotationQuaternion(XMLoadFloat4(&box.Orientation)), world);
+	XMVECTOR extents = XMLoadFloat3(&box.Extents);
+
+	BoundsAABB result;
+	XMStoreFloat3(&result.Center, XMVector3Transform(XMLoadFloat3(&box.Center), world));
+	XMStoreFloat3(&result.Extents,
+		XMVectorAbs(axes.r[0]) * XMVectorSplatX(extents) +
+		XMVectorAbs(axes.r[1]) * XMVectorSplatY(extents) +
+		XMVectorAbs(axes.r[2]) * XMVectorSplatZ(extents));
+	return result;
+}
+
+BoundsSphere BoundsBuilder::TransformSphere(const BoundsSphere& sphere, FXMMATRIX world)
+{
+	// The radius grows by the matrix's largest singular value: the square
+	// root of the largest eigenvalue of the rows' Gram matrix.  Rather than
+	// solving for it, take the smaller of two upper bounds on that
+	// eigenvalue: the Gram matrix's largest absolute row sum (exact when
+	// the rows are orthogonal, as with rotation and scale alone), and its
+	// trace (the squared Frobenius norm, better when rows nearly line up).
+	// The largest row length on its own misses sheared matrices.
+	XMVECTOR r0 = world.r[0];
+	XMVECTOR r1 = world.r[1];
+	XMVECTOR r2 = world.r[2];
+	float g00 = XMVectorGetX(XMVector3Dot(r0, r0));
+	float g11 = XMVectorGetX(XMVector3Dot(r1, r1));
+	float g22 = XMVectorGetX(XMVector3Dot(r2, r2));
+	float g01 = fabsf(XMVectorGetX(XMVector3Dot(r0, r1)));
+	float g02 = fabsf(XMVectorGetX(XMVector3Dot(r0, r2)));
+	float g12 = fabsf(XMVectorGetX(XMVector3Dot(r1, r2)));
+	float rowSum = fmaxf(g00 + g01 + g02, fmaxf(g01 + g11 + g12, g02 + g12 + g22));
+	float scaleSq = fminf(rowSum, g00 + g11 + g22);
+
+	BoundsSphere result;
+	XMStoreFloat3(&result.Center, XMVector3Transform(XMLoadFloat3(&sphere.Center), world));
+	result.Radius = sphere.Radius * sqrtf(scaleSq);
+	return result;
+}
+
+// --------------------------------------------------------
+// Brings the vertices and their bounds into world space with
+// a handful of matrices (translation, rotation, non-uniform
+// scale, and scale after rotation, which shears) and counts
+// the vertices that end up outside any of the world bounds.
+// Allows a little rounding, relative to the size of the
+// transformed bounds.
+// --------------------------------------------------------
+unsigned int BoundsBuilder::CountOutsideWorldBounds(const Vertex* verts, size_t vertexCount, const BoundsAABB& box, const BoundsSphere& sphere, const BoundsOBB& obb)
+{
+	XMMATRIX tilt = XMMatrixRotationQuaternion(XMQuaternionRotationAxis(XMVectorSet(1, 2, 3, 0), 0.7f));
+	XMMATRIX worlds[] =
+	{
+		XMMatrixIdentity(),
+		XMMatrixScaling(3.0f, 0.5f, 1.5f) * tilt * XMMatrixTranslation(10.0f, -4.0f, 2.0f),
+		XMMatrixRotationQuaternion(XMQuaternionRotationAxis(XMVectorSet(0, 0, 1, 0), XM_PIDIV4)) * XMMatrixScaling(2.0f, 1.0f, 1.0f),
+		tilt * XMMatrixScaling(0.25f, 4.0f, 1.0f) * XMMatrixTranslation(-3.0f, 0.0f, 7.0f),
+	};
+
+	unsigned int outside = 0;
+	for (const XMMATRIX& world : worlds)
+	{
+		BoundsAABB worldBox = TransformAABB(box, world);
+		BoundsAABB worldOBB = TransformOBBToAABB(obb, world);
+		BoundsSphere worldSphere = TransformSphere(sphere, world);
+		float slack = worldSphere.Radius * 1e-4f + 1e-5f;
+
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			XMVECTOR p = XMVector3Transform(XMLoadFloat3(&verts[i].Position), world);
+			bool inBox = XMVector3LessOrEqual(
+				XMVectorAbs(p - XMLoadFloat3(&worldBox.Center)),
+				XMLoadFloat3(&worldBox.Extents) + XMVectorReplicate(slack));
+			bool inOBB = XMVector3LessOrEqual(
+				XMVectorAbs(p - XMLoadFloat3(&worldOBB.Center)),
+				XMLoadFloat3(&worldOBB.Extents) + XMVectorReplicate(slack));
+			float distance = XMVectorGetX(XMVector3Length(p - XMLoadFloat3(&worldSphere.Center)));
+			if (!inBox || !inOBB || distance > worldSphere.Radius + slack)
+				outside++;
+		}
+	}
+	return outside;
+}
+
+std::vector<BoundsTest> BoundsBuilder::RunSelfTest()
+{
+	struct TestCase
+	{
+		const char* Name;
+		std::vector<XMFLOAT3> Positions;
+	};
+	std::vector<TestCase> cases;
+
+	cases.push_back({ "single point", { XMFLOAT3(3, -2, 5) } });
+	cases.push_back({ "flat quad", { XMFLOAT3(0, 1, 0), XMFLOAT3(2, 1, 0), XMFLOAT3(0, 1, 3), XMFLOAT3(2, 1, 3) } });
+
+	// Along a diagonal, off every axis, with a little thickness
+	TestCase sliver = { "diagonal sliver", {} };
+	for (int i = 0; i <= 20; i++)
+		sliver.Positions.push_back(XMFLOAT3(i * 0.5f, i * 1.0f + (i % 2) * 0.01f, i * -0.5f));
+	cases.push_back(sliver);
+
+	// A rotated box's corners, far from the origin
+	TestCase box = { "far rotated box", {} };
+	XMMATRIX boxWorld =
+		XMMatrixScaling(4.0f, 1.0f, 0.5f) *
+		XMMatrixRotationQuaternion(XMQuaternionRotationAxis(XMVectorSet(1, 1, 0, 0), 0.6f)) *
+		XMMatrixTranslation(1000.0f, -500.0f, 250.0f);
+	for (int i = 0; i < 8; i++)
+	{
+		XMFLOAT3 corner;
+		XMStoreFloat3(&corner, XMVector3Transform(XMVectorSet(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f, 0), boxWorld));
+		box.Positions.push_back(corner);
+	}
+	cases.push_back(box);
+
+	// Stretched differently along each axis
+	TestCase cloud = { "scattered cloud", {} };
+	std::mt19937 random(1);
+	std::normal_distribution<float> spread(0.0f, 1.0f);
+	for (int i = 0; i < 1000; i++)
+		cloud.Positions.push_back(XMFLOAT3(spread(random) * 5.0f, spread(random) * 0.2f, spread(random)));
+	cases.push_back(cloud);
+
+	std::vector<BoundsTest> results;
+	for (const TestCase& c : cases)
+	{
+		std::vector<Vertex> verts(c.Positions.size(), Vertex{});
+		for (size_t i = 0; i < verts.size(); i++)
+			verts[i].Position = c.Positions[i];
+
+		BoundsTest result;
+		result.Name = c.Name;
+		result.VertexCount = (unsigned int)verts.size();
+		result.Outside = CountOutsideWorldBounds(
+			verts.data(),
+			verts.size(),
+			ComputeAABB(verts.data(), verts.size()),
+			ComputeSphere(verts.data(), verts.size()),
+			ComputeOBB(verts.data(), verts.size()));
+		results.push_back(result);
+	}
+	return results;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <stddef.h>
+#include <vector>
+
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Axis-aligned box, as a center and half-size per axis
+// --------------------------------------------------------
+struct BoundsAABB
+{
+	DirectX::XMFLOAT3 Center;
+	DirectX::XMFLOAT3 Extents;
+};
+
+// --------------------------------------------------------
+// Sphere
+// --------------------------------------------------------
+struct BoundsSphere
+{
+	DirectX::XMFLOAT3 Center;
+	float Radius;
+};
+
+// --------------------------------------------------------
+// Oriented box: the box (Center, Extents) in a space rotated
+// by Orientation, a unit quaternion
+// --------------------------------------------------------
+struct BoundsOBB
+{
+	DirectX::XMFLOAT3 Center;
+	DirectX::XMFLOAT3 Extents;
+	DirectX::XMFLOAT4 Orientation;
+};
+
+// --------------------------------------------------------
+// One fixed case of BoundsBuilder::RunSelfTest
+// --------------------------------------------------------
+struct BoundsTest
+{
+	const char* Name;
+	unsigned int VertexCount;
+	unsigned int Outside;		// From CountOutsideWorldBounds, so should be zero
+};
+
+// --------------------------------------------------------
+// Bounding volumes of a set of vertices, and bringing them
+// into world space.  Matrices are the usual row-vector ones
+// (position * world).
+// --------------------------------------------------------
+class BoundsBuilder
+{
+public:
+	static BoundsAABB ComputeAABB(const Vertex* verts, size_t vertexCount);
+
+	// Ritter's sphere (Graphics Gems, 1990): within a few percent of the
+	// smallest sphere, in two passes over the vertices
+	static BoundsSphere ComputeSphere(const Vertex* verts, size_t vertexCount);
+
+	// Aligned to the principal axes of the vertices.  Falls back to the
+	// AABB whenever that would be smaller
+	static BoundsOBB ComputeOBB(const Vertex* verts, size_t vertexCount);
+
+	// Conservative world space versions
+	static BoundsAABB TransformAABB(const BoundsAABB& box, DirectX::FXMMATRIX world);
+	static BoundsAABB TransformOBBToAABB(const BoundsOBB& box, DirectX::FXMMATRIX world);
+	static BoundsSphere TransformSphere(const BoundsSphere& sphere, DirectX::FXMMATRIX world);
+
+	// Vertices outside their transformed bounds under a few test matrices
+	// (including sheared ones); should always be zero
+	static unsigned int CountOutsideWorldBounds(const Vertex* verts, size_t vertexCount, const BoundsAABB& box, const BoundsSphere& sphere, const BoundsOBB& obb);
+
+	// Bounds fixed sets of points that are awkward to bound (a single
+	// point, flat, thin and far from the origin) and counts those
+	// outside their world bounds
+	static std::vector<BoundsTest> RunSelfTest();
+};
+
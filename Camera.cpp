@@ -57,10 +57,9 @@ void Camera::Update(float dt)
 // Creates a new view matrix based on current position and orientation
 void Camera::UpdateViewMatrix()
 {
-	// Rotate the standard "forward" matrix by our rotation
-	// This gives us our "look direction"
-	XMFLOAT3 rot = transform.GetPitchYawRoll();
-	XMVECTOR dir = XMVector3Rotate(XMVectorSet(0, 0, 1, 0), XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&rot)));
+	// The transform's forward axis is our "look direction"
+	XMFLOAT3 forward = transform.GetForward();
+	XMVECTOR dir = XMLoadFloat3(&forward);
 
 	XMFLOAT3 pos = transform.GetPosition();
 	XMMATRIX view = XMMatrixLookToLH(
@@ -82,6 +81,22 @@ void Camera::UpdateProjectionMatrix(float aspectRatio)
 	XMStoreFloat4x4(&projMatrix, P);
 }
 
+// --------------------------------------------------------
+// Undoes the projection's scaling to get the pixel's view
+// space direction, then takes that back out into the world
+// --------------------------------------------------------
+void Camera::GetPickRay(int mouseX, int mouseY, unsigned int screenWidth, unsigned int screenHeight, XMFLOAT3* origin, XMFLOAT3* direction)
+{
+	// Pixel center to -1 to 1, with y going up
+	float x = 2.0f * (mouseX + 0.5f) / screenWidth - 1.0f;
+	float y = 1.0f - 2.0f * (mouseY + 0.5f) / screenHeight;
+
+	XMVECTOR viewDirection = XMVectorSet(x / projMatrix._11, y / projMatrix._22, 1.0f, 0.0f);
+	XMMATRIX inverseView = XMMatrixInverse(0, XMLoadFloat4x4(&viewMatrix));
+	XMStoreFloat3(direction, XMVector3Normalize(XMVector3TransformNormal(viewDirection, inverseView)));
+	*origin = transform.GetPosition();
+}
+
 Transform* Camera::GetTransform()
 {
 	return &transform;
@@ -19,6 +19,15 @@ public:
 	DirectX::XMFLOAT4X4 GetView() { return viewMatrix; }
 	DirectX::XMFLOAT4X4 GetProjection() { return projMatrix; }
 
+	// World space ray from the camera through a pixel
+	void GetPickRay(
+		int mouseX,
+		int mouseY,
+		unsigned int screenWidth,
+		unsigned int screenHeight,
+		DirectX::XMFLOAT3* origin,
+		DirectX::XMFLOAT3* direction);
+
 	Transform* GetTransform();
 
 private:
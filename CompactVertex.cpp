@@ -0,0 +1,265 @@
+#include "CompactVertex.h"
+
+#include <DirectXPackedVector.h>
+#include <float.h>
+#include <math.h>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+// --------------------------------------------------------
+// Finds the box that the quantized positions will span
+// --------------------------------------------------------
+CompactVertexBounds CompactVertexCodec::ComputeBounds(const Vertex* verts, int numVerts)
+{
+	XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+	for (int i = 0; i < numVerts; i++)
+	{
+		XMVECTOR pos = XMLoadFloat3(&verts[i].Position);
+		boundsMin = XMVectorMin(boundsMin, pos);
+		boundsMax = XMVectorMax(boundsMax, pos);
+	}
+
+	if (numVerts == 0)
+		boundsMin = boundsMax = XMVectorZero();
+
+	CompactVertexBounds bounds;
+	XMStoreFloat3(&bounds.Offset, boundsMin);
+	XMStoreFloat3(&bounds.Scale, boundsMax - boundsMin);
+	return bounds;
+}
+
+CompactVertex CompactVertexCodec::Encode(const Vertex& v, const CompactVertexBounds& bounds, float handedness)
+{
+	CompactVertex c;
+
+	// Position relative to the bounds, in [0,1] on each axis.  Flat
+	// axes (zero extent) would divide by zero, so they just stay at 0
+	const float* pos = &v.Position.x;
+	const float* offset = &bounds.Offset.x;
+	const float* scale = &bounds.Scale.x;
+	for (int a = 0; a < 3; a++)
+	{
+		float t = scale[a] > 0.0f ? (pos[a] - offset[a]) / scale[a] : 0.0f;
+		t = fminf(fmaxf(t, 0.0f), 1.0f);
+		c.Position[a] = (unsigned short)(t * 65535.0f + 0.5f);
+	}
+	c.Position[3] = handedness < 0.0f ? 0 : 65535;
+
+	c.UV[0] = XMConvertFloatToHalf(v.UV.x);
+	c.UV[1] = XMConvertFloatToHalf(v.UV.y);
+
+	EncodeOctahedral(v.Normal, c.Normal);
+	EncodeOctahedral(v.Tangent, c.Tangent);
+	return c;
+}
+
+Vertex CompactVertexCodec::Decode(const CompactVertex& c, const CompactVertexBounds& bounds, float* handedness)
+{
+	Vertex v;
+	v.Position.x = bounds.Offset.x + c.Position[0] / 65535.0f * bounds.Scale.x;
+	v.Position.y = bounds.Offset.y + c.Position[1] / 65535.0f * bounds.Scale.y;
+	v.Position.z = bounds.Offset.z + c.Position[2] / 65535.0f * bounds.Scale.z;
+	if (handedness)
+		*handedness = c.Position[3] == 0 ? -1.0f : 1.0f;
+
+	v.UV.x = XMConvertHalfToFloat(c.UV[0]);
+	v.UV.y = XMConvertHalfToFloat(c.UV[1]);
+
+	v.Normal = DecodeOctahedral(c.Normal);
+	v.Tangent = DecodeOctahedral(c.Tangent);
+	return v;
+}
+
+// --------------------------------------------------------
+// Octahedral encoding of a unit vector: project onto the
+// octahedron |x|+|y|+|z| = 1, then fold the lower half
+// over the upper half so it fits in a square
+// --------------------------------------------------------
+void CompactVertexCodec::EncodeOctahedral(const XMFLOAT3& dir, short out[2])
+{
+	float sum = fabsf(dir.x) + fabsf(dir.y) + fabsf(dir.z);
+	if (sum == 0.0f)
+	{
+		out[0] = out[1] = 0;
+		return;
+	}
+
+	float x = dir.x / sum;
+	float y = dir.y / sum;
+	if (dir.z < 0.0f)
+	{
+		float foldX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldX;
+		y = foldY;
+	}
+
+	out[0] = (short)lroundf(fminf(fmaxf(x, -1.0f), 1.0f) * 32767.0f);
+	out[1] = (short)lroundf(fminf(fmaxf(y, -1.0f), 1.0f) * 32767.0f);
+}
+
+XMFLOAT3 CompactVertexCodec::DecodeOctahedral(const short in[2])
+{
+	// Same math as OctahedralDecode() in VertexShaderCompact.hlsl
+	float x = fmaxf(in[0] / 32767.0f, -1.0f);
+	float y = fmaxf(in[1] / 32767.0f, -1.0f);
+	float z = 1.0f - fabsf(x) - fabsf(y);
+
+	// Unfold the lower half
+	float t = fmaxf(-z, 0.0f);
+	x += x >= 0.0f ? -t : t;
+	y += y >= 0.0f ? -t : t;
+
+	XMFLOAT3 dir(x, y, z);
+	XMStoreFloat3(&dir, XMVector3Normalize(XMLoadFloat3(&dir)));
+	return dir;
+}
+
+// Angle between a direction and its decoded version, or zero
+// for directions too short to have one (like missing tangents)
+static float DirectionErrorDegrees(const XMFLOAT3& original, const XMFLOAT3& decoded)
+{
+	XMVECTOR a = XMLoadFloat3(&original);
+	if (XMVectorGetX(XMVector3LengthSq(a)) < 1e-12f)
+		return 0.0f;
+
+	float cosAngle = XMVectorGetX(XMVector3Dot(XMVector3Normalize(a), XMLoadFloat3(&decoded)));
+	return XMConvertToDegrees(acosf(fminf(fmaxf(cosAngle, -1.0f), 1.0f)));
+}
+
+// --------------------------------------------------------
+// Positions are allowed a little float rounding on top of
+// the half step, as decoding adds the offset back in
+// --------------------------------------------------------
+CompactVertexError CompactVertexCodec::MeasureError(const Vertex* verts, int numVerts)
+{
+	CompactVertexError error = {};
+	error.VertexCount = (unsigned int)numVerts;
+	error.WithinBounds = true;
+
+	CompactVertexBounds bounds = ComputeBounds(verts, numVerts);
+	for (int i = 0; i < numVerts; i++)
+	{
+		Vertex decoded = Decode(Encode(verts[i], bounds), bounds);
+
+		const float* pos = &verts[i].Position.x;
+		const float* decodedPos = &decoded.Position.x;
+		const float* offset = &bounds.Offset.x;
+		const float* scale = &bounds.Scale.x;
+		for (int a = 0; a < 3; a++)
+		{
+			float diff = fabsf(decodedPos[a] - pos[a]);
+			float step = scale[a] / 65535.0f;
+			float rounding = 4.0f * FLT_EPSILON * (fabsf(offset[a]) + scale[a]);
+			if (step > 0.0f)
+				error.PositionSteps = fmaxf(error.PositionSteps, diff / step);
+			if (diff > COMPACT_POSITION_MAX_STEPS * step + rounding)
+				error.WithinBounds = false;
+		}
+
+		error.NormalDegrees = fmaxf(error.NormalDegrees, DirectionErrorDegrees(verts[i].Normal, decoded.Normal));
+		error.TangentDegrees = fmaxf(error.TangentDegrees, DirectionErrorDegrees(verts[i].Tangent, decoded.Tangent));
+
+		// Below the smallest normal half, the step stops shrinking
+		const float* uv = &verts[i].UV.x;
+		const float* decodedUV = &decoded.UV.x;
+		for (int a = 0; a < 2; a++)
+		{
+			float magnitude = fmaxf(fabsf(uv[a]), 1.0f / 16384.0f);
+			error.UVRelative = fmaxf(error.UVRelative, fabsf(decodedUV[a] - uv[a]) / magnitude);
+		}
+	}
+
+	if (error.NormalDegrees > COMPACT_DIRECTION_MAX_DEGREES ||
+		error.TangentDegrees > COMPACT_DIRECTION_MAX_DEGREES ||
+		error.UVRelative > COMPACT_UV_MAX_RELATIVE)
+		error.WithinBounds = false;
+
+	return error;
+}
+
+// A test vertex, with its directions normalized
+static Vertex MakeTestVertex(XMFLOAT3 position, XMFLOAT2 uv, XMFLOAT3 normal, XMFLOAT3 tangent)
+{
+	Vertex v;
+	v.Position = position;
+	v.UV = uv;
+	XMStoreFloat3(&v.Normal, XMVector3Normalize(XMLoadFloat3(&normal)));
+	XMStoreFloat3(&v.Tangent, XMVector3Normalize(XMLoadFloat3(&tangent)));
+	return v;
+}
+
+// --------------------------------------------------------
+// Each case is a handful of vertices sharing bounds, so
+// positions are also checked far from the origin and
+// along a flat (zero extent) axis
+// --------------------------------------------------------
+std::vector<CompactVertexTest> CompactVertexCodec::RunSelfTest()
+{
+	struct TestCase
+	{
+		const char* Name;
+		bool ExpectWithinBounds;
+		std::vector<Vertex> Verts;
+	};
+	std::vector<TestCase> cases;
+
+	// Straight along each axis, where the octahedron has its corners
+	cases.push_back({ "poles", true, {
+		MakeTestVertex(XMFLOAT3(0, 0, 0), XMFLOAT2(0, 0), XMFLOAT3( 1, 0, 0), XMFLOAT3(0, 0, 1)),
+		MakeTestVertex(XMFLOAT3(1, 0, 0), XMFLOAT2(1, 0), XMFLOAT3(-1, 0, 0), XMFLOAT3(0, 0, -1)),
+		MakeTestVertex(XMFLOAT3(0, 1, 0), XMFLOAT2(0, 1), XMFLOAT3(0,  1, 0), XMFLOAT3(1, 0, 0)),
+		MakeTestVertex(XMFLOAT3(0, 0, 1), XMFLOAT2(1, 1), XMFLOAT3(0, -1, 0), XMFLOAT3(-1, 0, 0)),
+		MakeTestVertex(XMFLOAT3(1, 1, 0), XMFLOAT2(0.5f, 0), XMFLOAT3(0, 0,  1), XMFLOAT3(0, 1, 0)),
+		MakeTestVertex(XMFLOAT3(1, 1, 1), XMFLOAT2(0, 0.5f), XMFLOAT3(0, 0, -1), XMFLOAT3(0, -1, 0)),
+	} });
+
+	// The lower half, folded over the upper: along the fold lines, at
+	// the equator where the fold starts and right by the -Z pole
+	cases.push_back({ "folds", true, {
+		MakeTestVertex(XMFLOAT3(0, 0, 0), XMFLOAT2(0, 0), XMFLOAT3( 1,  0, -1), XMFLOAT3( 0,  1, -1)),
+		MakeTestVertex(XMFLOAT3(1, 0, 0), XMFLOAT2(1, 0), XMFLOAT3(-1,  0, -1), XMFLOAT3( 0, -1, -1)),
+		MakeTestVertex(XMFLOAT3(0, 1, 0), XMFLOAT2(0, 1), XMFLOAT3( 1,  1, -1), XMFLOAT3(-1, -1, -1)),
+		MakeTestVertex(XMFLOAT3(0, 0, 1), XMFLOAT2(1, 1), XMFLOAT3( 1, -1, -1), XMFLOAT3(-1,  1, -1)),
+		MakeTestVertex(XMFLOAT3(1, 1, 0), XMFLOAT2(0, 0), XMFLOAT3( 1,  1,  0), XMFLOAT3(-1,  1, 0)),
+		MakeTestVertex(XMFLOAT3(1, 0, 1), XMFLOAT2(0, 0), XMFLOAT3( 1, -1, -1e-6f), XMFLOAT3(-1, -1, 1e-6f)),
+		MakeTestVertex(XMFLOAT3(0, 1, 1), XMFLOAT2(0, 0), XMFLOAT3(1e-4f, 1e-4f, -1), XMFLOAT3(-1e-4f, 1e-4f, -1)),
+		MakeTestVertex(XMFLOAT3(1, 1, 1), XMFLOAT2(0, 0), XMFLOAT3(0.3f, -0.7f, -0.1f), XMFLOAT3(-0.7f, -0.3f, -0.9f)),
+	} });
+
+	// Below the smallest normal half (2^-14), down to the smallest
+	// subnormal (2^-24) and under it.  Far from the origin and flat in Y
+	cases.push_back({ "subnormal uvs", true, {
+		MakeTestVertex(XMFLOAT3(10000, 5, 10000), XMFLOAT2(5.9604645e-8f, -5.9604645e-8f), XMFLOAT3(0, 1, 0), XMFLOAT3(1, 0, 0)),
+		MakeTestVertex(XMFLOAT3(10001, 5, 10000), XMFLOAT2(1e-7f, 2e-8f), XMFLOAT3(0, 1, 0), XMFLOAT3(1, 0, 0)),
+		MakeTestVertex(XMFLOAT3(10000, 5, 10001), XMFLOAT2(3.1e-6f, -4.2e-5f), XMFLOAT3(0, 1, 0), XMFLOAT3(1, 0, 0)),
+		MakeTestVertex(XMFLOAT3(10001, 5, 10001), XMFLOAT2(6.09e-5f, 6.1035156e-5f), XMFLOAT3(0, 1, 0), XMFLOAT3(1, 0, 0)),
+	} });
+
+	// Heavily tiled, up to the largest half
+	cases.push_back({ "large uvs", true, {
+		MakeTestVertex(XMFLOAT3(-1, -1, -1), XMFLOAT2(1024.3f, -4096.7f), XMFLOAT3(0, 0, 1), XMFLOAT3(1, 0, 0)),
+		MakeTestVertex(XMFLOAT3(1, 1, 1), XMFLOAT2(65504.0f, -65504.0f), XMFLOAT3(0, 0, 1), XMFLOAT3(1, 0, 0)),
+		MakeTestVertex(XMFLOAT3(0, 0, 0), XMFLOAT2(30000.5f, 0.1f), XMFLOAT3(0, 0, 1), XMFLOAT3(1, 0, 0)),
+	} });
+
+	// Past the largest half, which becomes infinity
+	cases.push_back({ "uv overflow", false, {
+		MakeTestVertex(XMFLOAT3(0, 0, 0), XMFLOAT2(0.5f, 0.5f), XMFLOAT3(0, 0, 1), XMFLOAT3(1, 0, 0)),
+		MakeTestVertex(XMFLOAT3(1, 1, 1), XMFLOAT2(70000.0f, -1e6f), XMFLOAT3(0, 0, 1), XMFLOAT3(1, 0, 0)),
+	} });
+
+	std::vector<CompactVertexTest> results;
+	for (const TestCase& c : cases)
+	{
+		CompactVertexTest result;
+		result.Name = c.Name;
+		result.Error = MeasureError(c.Verts.data(), (int)c.Verts.size());
+		result.ExpectWithinBounds = c.ExpectWithinBounds;
+		result.Passed = result.Error.WithinBounds == c.ExpectWithinBounds;
+		results.push_back(result);
+	}
+	return results;
+}
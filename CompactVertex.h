@@ -0,0 +1,88 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "Vertex.h"
+
+// Round trip limits checked by MeasureError (see below)
+#define COMPACT_POSITION_MAX_STEPS		0.5f
+#define COMPACT_DIRECTION_MAX_DEGREES	0.04f
+#define COMPACT_UV_MAX_RELATIVE			(1.0f / 2048.0f)
+
+// --------------------------------------------------------
+// A packed alternative to Vertex: 20 bytes instead of 44
+//
+// Must match the input layout in Mesh and the input
+// struct in VertexShaderCompact.hlsl
+// --------------------------------------------------------
+struct CompactVertex
+{
+	unsigned short Position[4];	// XYZ: unorm16 within the mesh's bounds, W: tangent handedness (0 = -1, 65535 = +1)
+	unsigned short UV[2];		// Half floats, so tiled UVs outside [0,1] survive
+	short Normal[2];			// Octahedral, snorm16
+	short Tangent[2];			// Octahedral, snorm16
+};
+
+// --------------------------------------------------------
+// How a mesh's quantized positions map back to object
+// space: position = Offset + (quantized / 65535) * Scale
+// --------------------------------------------------------
+struct CompactVertexBounds
+{
+	DirectX::XMFLOAT3 Offset;
+	DirectX::XMFLOAT3 Scale;
+};
+
+// --------------------------------------------------------
+// Largest round trip errors over a set of vertices
+// --------------------------------------------------------
+struct CompactVertexError
+{
+	unsigned int VertexCount;
+	float PositionSteps;	// On any axis, in quantization steps (Scale / 65535)
+	float NormalDegrees;
+	float TangentDegrees;
+	float UVRelative;		// Relative to the UV's own magnitude
+	bool WithinBounds;		// All within the limits above (plus float rounding)
+};
+
+// --------------------------------------------------------
+// One fixed case of CompactVertexCodec::RunSelfTest
+// --------------------------------------------------------
+struct CompactVertexTest
+{
+	const char* Name;
+	CompactVertexError Error;
+	bool ExpectWithinBounds;	// False for vertices packing can't survive
+	bool Passed;				// MeasureError agreed with the expectation
+};
+
+// --------------------------------------------------------
+// Conversion between Vertex and CompactVertex
+//
+// Worst-case errors after a round trip:
+//  - Position: half of one step (Scale / 131070) per axis
+//  - Normal and tangent: under 0.04 degrees
+//  - UV: half float precision (11 significant bits)
+// --------------------------------------------------------
+class CompactVertexCodec
+{
+public:
+	static CompactVertexBounds ComputeBounds(const Vertex* verts, int numVerts);
+
+	static CompactVertex Encode(const Vertex& v, const CompactVertexBounds& bounds, float handedness = 1.0f);
+	static Vertex Decode(const CompactVertex& v, const CompactVertexBounds& bounds, float* handedness = 0);
+
+	static void EncodeOctahedral(const DirectX::XMFLOAT3& dir, short out[2]);
+	static DirectX::XMFLOAT3 DecodeOctahedral(const short in[2]);
+
+	// Encodes and decodes every vertex, checking the errors above
+	static CompactVertexError MeasureError(const Vertex* verts, int numVerts);
+
+	// Measures fixed vertices at the edges of the encoding: directions
+	// at the poles and on the octahedral folds, subnormal and large
+	// UVs, and UVs past the half float range (which must fail)
+	static std::vector<CompactVertexTest> RunSelfTest();
+};
+
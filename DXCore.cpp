@@ -4,6 +4,7 @@
 #include "imgui.h"
 
 #include <WindowsX.h>
+#include <math.h>
 #include <sstream>
 
 // Define the static instance variable so our OS-level 
@@ -60,6 +61,14 @@ DXCore::DXCore(
 	this->startTime = 0;
 	this->totalTime = 0;
 
+	// Simulate once per frame until asked otherwise
+	this->fixedTimestep = 0.0f;
+	this->maxCatchUpSteps = DXCORE_MAX_CATCH_UP_STEPS;
+	this->stepTimeOwed = 0.0;
+	this->simulationTime = 0.0;
+	this->interpolationAlpha = 1.0f;
+	this->stepsThisFrame = 0;
+
 	// Query performance counter for accurate timing information
 	__int64 perfFreq;
 	QueryPerformanceFrequency((LARGE_INTEGER*)&perfFreq);
@@ -403,6 +412,7 @@ HRESULT DXCore::Run()
 			Input::GetInstance().Update();
 
 			// The game loop
+			UpdateSimulation();
 			Update(deltaTime, totalTime);
 			Draw(deltaTime, totalTime);
 
@@ -451,6 +461,63 @@ void DXCore::UpdateTimer()
 }
 
 
+// --------------------------------------------------------
+// Does nothing unless overridden
+// --------------------------------------------------------
+void DXCore::FixedUpdate(float stepTime, float totalTime)
+{
+}
+
+
+// --------------------------------------------------------
+// Sets the length of each simulation step in seconds (0
+// for one step per frame, however long the frame took) and
+// how many steps can run in a single frame
+// --------------------------------------------------------
+void DXCore::SetFixedTimestep(float stepTime, unsigned int maxSteps)
+{
+	fixedTimestep = stepTime > 0.0f ? stepTime : 0.0f;
+	maxCatchUpSteps = maxSteps > 0 ? maxSteps : 1;
+	stepTimeOwed = 0.0;
+	simulationTime = totalTime;
+}
+
+
+// --------------------------------------------------------
+// Runs as many fixed steps as fit in the time that has
+// passed, carrying the remainder over to the next frame,
+// so the simulation runs at the same rate (and gives the
+// same results) however fast frames are drawn
+// --------------------------------------------------------
+void DXCore::UpdateSimulation()
+{
+	if (fixedTimestep <= 0.0f)
+	{
+		FixedUpdate(deltaTime, totalTime);
+		stepsThisFrame = 1;
+		interpolationAlpha = 1.0f;
+		return;
+	}
+
+	stepTimeOwed += deltaTime;
+	stepsThisFrame = 0;
+	while (stepTimeOwed >= fixedTimestep && stepsThisFrame < maxCatchUpSteps)
+	{
+		simulationTime += fixedTimestep;
+		FixedUpdate(fixedTimestep, (float)simulationTime);
+		stepTimeOwed -= fixedTimestep;
+		stepsThisFrame++;
+	}
+
+	// Too far behind: let the simulation fall behind the clock
+	// rather than take on more steps every frame
+	if (stepTimeOwed >= fixedTimestep)
+		stepTimeOwed = fmod(stepTimeOwed, (double)fixedTimestep);
+
+	interpolationAlpha = (float)(stepTimeOwed / fixedTimestep);
+}
+
+
 // --------------------------------------------------------
 // Updates the window's title bar with several stats once
 // per second, including:
@@ -9,6 +9,11 @@
 // instead of in Visual Studio settings if we want
 #pragma comment(lib, "d3d11.lib")
 
+// With a fixed timestep, the most steps run in one frame before the
+// simulation gives up catching up (so one slow frame can't make the
+// next one slower still)
+#define DXCORE_MAX_CATCH_UP_STEPS 5
+
 class DXCore
 {
 public:
@@ -44,6 +49,19 @@ public:
 	virtual void Update(float deltaTime, float totalTime) = 0;
 	virtual void Draw(float deltaTime, float totalTime) = 0;
 
+	// Simulation, called before Update() either in steps of exactly the
+	// fixed timestep or (with no fixed timestep) once with the frame's time
+	virtual void FixedUpdate(float stepTime, float totalTime);
+
+	// 0 turns the fixed timestep off
+	void SetFixedTimestep(float stepTime, unsigned int maxSteps = DXCORE_MAX_CATCH_UP_STEPS);
+	float GetFixedTimestep() { return fixedTimestep; }
+
+	// How far this frame is between the last step and the next (1
+	// without a fixed timestep), for drawing between the two
+	float GetInterpolationAlpha() { return interpolationAlpha; }
+	unsigned int GetStepsThisFrame() { return stepsThisFrame; }
+
 protected:
 	HINSTANCE	hInstance;		// The handle to the application
 	HWND		hWnd;			// The handle to the window itself
@@ -91,7 +109,16 @@ private:
 	int fpsFrameCount;
 	float fpsTimeElapsed;
 
+	// Fixed timestep
+	float fixedTimestep;
+	unsigned int maxCatchUpSteps;
+	double stepTimeOwed;		// Time not yet simulated
+	double simulationTime;		// Total time simulated
+	float interpolationAlpha;
+	unsigned int stepsThisFrame;
+
 	void UpdateTimer();			// Updates the timer for this frame
+	void UpdateSimulation();	// Runs this frame's simulation steps
 	void UpdateTitleBarStats();	// Puts debug info in the title bar
 };
 
@@ -0,0 +1,781 @@
+#include "DynamicBVH.h"
+
+#include <algorithm>
+#include <chrono>
+#include <float.h>
+#include <math.h>
+#include <random>
+
+using namespace DirectX;
+
+// Component a (0, 1 or 2) of a vector
+static inline float Axis(const XMFLOAT3& v, int a)
+{
+	return (&v.x)[a];
+}
+
+// Half the surface area, which is all the heuristics need
+static inline float Area(const XMFLOAT3& min, const XMFLOAT3& max)
+{
+	float x = max.x - min.x;
+	float y = max.y - min.y;
+	float z = max.z - min.z;
+	return x * y + y * z + z * x;
+}
+
+static inline float UnionArea(const XMFLOAT3& minA, const XMFLOAT3& maxA, const XMFLOAT3& minB, const XMFLOAT3& maxB)
+{
+	XMFLOAT3 min(fminf(minA.x, minB.x), fminf(minA.y, minB.y), fminf(minA.z, minB.z));
+	XMFLOAT3 max(fmaxf(maxA.x, maxB.x), fmaxf(maxA.y, maxB.y), fmaxf(maxA.z, maxB.z));
+	return Area(min, max);
+}
+
+static inline void Grow(XMFLOAT3& min, XMFLOAT3& max, const XMFLOAT3& otherMin, const XMFLOAT3& otherMax)
+{
+	min = XMFLOAT3(fminf(min.x, otherMin.x), fminf(min.y, otherMin.y), fminf(min.z, otherMin.z));
+	max = XMFLOAT3(fmaxf(max.x, otherMax.x), fmaxf(max.y, otherMax.y), fmaxf(max.z, otherMax.z));
+}
+
+// Frustum::IntersectsAABB, but also telling apart boxes entirely
+// inside: -1 outside, 1 inside, 0 crossing a plane
+static int ClassifyBox(const Frustum& frustum, const XMFLOAT3& min, const XMFLOAT3& max)
+{
+	float cx = (min.x + max.x) * 0.5f, cy = (min.y + max.y) * 0.5f, cz = (min.z + max.z) * 0.5f;
+	float ex = (max.x - min.x) * 0.5f, ey = (max.y - min.y) * 0.5f, ez = (max.z - min.z) * 0.5f;
+
+	int result = 1;
+	for (int p = 0; p < 6; p++)
+	{
+		const XMFLOAT4& plane = frustum.Planes[p];
+		float distance = plane.x * cx + plane.y * cy + plane.z * cz + plane.w;
+		float reach = fabsf(plane.x) * ex + fabsf(plane.y) * ey + fabsf(plane.z) * ez;
+		if (distance < -reach)
+			return -1;
+		if (distance < reach)
+			result = 0;
+	}
+	return result;
+}
+
+static inline bool LeafInFrustum(const Frustum& frustum, const XMFLOAT3& min, const XMFLOAT3& max)
+{
+	XMVECTOR boxMin = XMLoadFloat3(&min);
+	XMVECTOR boxMax = XMLoadFloat3(&max);
+	return frustum.IntersectsAABB((boxMin + boxMax) * 0.5f, (boxMax - boxMin) * 0.5f);
+}
+
+static inline bool SphereTouchesBox(const XMFLOAT3& center, float radiusSquared, const XMFLOAT3& min, const XMFLOAT3& max)
+{
+	// Distance to the closest point of the box
+	float x = center.x - fminf(fmaxf(center.x, min.x), max.x);
+	float y = center.y - fminf(fmaxf(center.y, min.y), max.y);
+	float z = center.z - fminf(fmaxf(center.z, min.z), max.z);
+	return x * x + y * y + z * z <= radiusSquared;
+}
+
+// --------------------------------------------------------
+// Slab test.  Axes the ray runs parallel to give NaNs when
+// the origin is right on the slab, which fminf and fmaxf
+// ignore, so those count as inside.  distance is where the
+// ray enters the box (0 if it starts inside).
+// --------------------------------------------------------
+static inline bool RayHitsBox(
+	const XMFLOAT3& origin,
+	const XMFLOAT3& inverseDirection,
+	const XMFLOAT3& min,
+	const XMFLOAT3& max,
+	float maxDistance,
+	float* distance)
+{
+	float tNear = 0.0f;
+	float tFar = maxDistance;
+	for (int a = 0; a < 3; a++)
+	{
+		float t1 = (Axis(min, a) - Axis(origin, a)) * Axis(inverseDirection, a);
+		float t2 = (Axis(max, a) - Axis(origin, a)) * Axis(inverseDirection, a);
+		tNear = fmaxf(tNear, fminf(t1, t2));
+		tFar = fminf(tFar, fmaxf(t1, t2));
+	}
+	*distance = tNear;
+	return tNear <= tFar;
+}
+
+DynamicBVH::DynamicBVH()
+{
+	root = BVH_NULL_NODE;
+	freeNode = BVH_NULL_NODE;
+	leafCount = 0;
+}
+
+int DynamicBVH::Insert(const BoundsAABB& box, unsigned int userData)
+{
+	int leaf = AllocateNode();
+	BVHNode& node = nodes[leaf];
+	node.TightMin = XMFLOAT3(box.Center.x - box.Extents.x, box.Center.y - box.Extents.y, box.Center.z - box.Extents.z);
+	node.TightMax = XMFLOAT3(box.Center.x + box.Extents.x, box.Center.y + box.Extents.y, box.Center.z + box.Extents.z);
+	node.Min = XMFLOAT3(node.TightMin.x - BVH_FAT_MARGIN, node.TightMin.y - BVH_FAT_MARGIN, node.TightMin.z - BVH_FAT_MARGIN);
+	node.Max = XMFLOAT3(node.TightMax.x + BVH_FAT_MARGIN, node.TightMax.y + BVH_FAT_MARGIN, node.TightMax.z + BVH_FAT_MARGIN);
+	node.UserData = userData;
+
+	InsertLeaf(leaf);
+	leafCount++;
+	return leaf;
+}
+
+void DynamicBVH::Remove(int leaf)
+{
+	if (leaf < 0 || leaf >= (int)nodes.size() || nodes[leaf].Height != 0)
+		return;
+
+	RemoveLeaf(leaf);
+	FreeNode(leaf);
+	leafCount--;
+}
+
+bool DynamicBVH::Move(int leaf, const BoundsAABB& box)
+{
+	if (leaf < 0 || leaf >= (int)nodes.size() || nodes[leaf].Height != 0)
+		return false;
+
+	BVHNode& node = nodes[leaf];
+	node.TightMin = XMFLOAT3(box.Center.x - box.Extents.x, box.Center.y - box.Extents.y, box.Center.z - box.Extents.z);
+	node.TightMax = XMFLOAT3(box.Center.x + box.Extents.x, box.Center.y + box.Extents.y, box.Center.z + box.Extents.z);
+
+	// Still inside the fat box, so nothing above it changes
+	if (node.TightMin.x >= node.Min.x && node.TightMin.y >= node.Min.y && node.TightMin.z >= node.Min.z &&
+		node.TightMax.x <= node.Max.x && node.TightMax.y <= node.Max.y && node.TightMax.z <= node.Max.z)
+		return false;
+
+	RemoveLeaf(leaf);
+	node.Min = XMFLOAT3(node.TightMin.x - BVH_FAT_MARGIN, node.TightMin.y - BVH_FAT_MARGIN, node.TightMin.z - BVH_FAT_MARGIN);
+	node.Max = XMFLOAT3(node.TightMax.x + BVH_FAT_MARGIN, node.TightMax.y + BVH_FAT_MARGIN, node.TightMax.z + BVH_FAT_MARGIN);
+	InsertLeaf(leaf);
+	return true;
+}
+
+// --------------------------------------------------------
+// Throws away every internal node and builds them again
+// top down.  Leaves keep their indices.
+// --------------------------------------------------------
+void DynamicBVH::Rebuild()
+{
+	std::vector<int> leaves;
+	leaves.reserve(leafCount);
+	for (int i = 0; i < (int)nodes.size(); i++)
+	{
+		if (nodes[i].Height == 0)
+			leaves.push_back(i);
+		else if (nodes[i].Height > 0)
+			FreeNode(i);
+	}
+
+	root = leaves.empty() ? BVH_NULL_NODE : BuildRange(leaves.data(), (int)leaves.size(), BVH_NULL_NODE);
+}
+
+void DynamicBVH::Clear()
+{
+	nodes.clear();
+	root = BVH_NULL_NODE;
+	freeNode = BVH_NULL_NODE;
+	leafCount = 0;
+}
+
+void DynamicBVH::QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& results)
+{
+	results.clear();
+	if (root == BVH_NULL_NODE)
+		return;
+
+	// Nodes entirely inside are marked by pushing them negated (less one,
+	// since 0 is a node), and their leaves are taken without any tests
+	stack.clear();
+	stack.push_back(root);
+	while (!stack.empty())
+	{
+		int entry = stack.back();
+		stack.pop_back();
+
+		if (entry < 0)
+		{
+			const BVHNode& node = nodes[-entry - 1];
+			if (node.Left == BVH_NULL_NODE)
+				results.push_back(node.UserData);
+			else
+			{
+				stack.push_back(-node.Left - 1);
+				stack.push_back(-node.Right - 1);
+			}
+			continue;
+		}
+
+		const BVHNode& node = nodes[entry];
+		if (node.Left == BVH_NULL_NODE)
+		{
+			// The same test brute force would use
+			if (LeafInFrustum(frustum, node.TightMin, node.TightMax))
+				results.push_back(node.UserData);
+			continue;
+		}
+
+		int side = ClassifyBox(frustum, node.Min, node.Max);
+		if (side < 0)
+			continue;
+		if (side > 0)
+		{
+			stack.push_back(-entry - 1);
+			continue;
+		}
+		stack.push_back(node.Left);
+		stack.push_back(node.Right);
+	}
+}
+
+void DynamicBVH::QuerySphere(XMFLOAT3 center, float radius, std::vector<unsigned int>& results)
+{
+	results.clear();
+	if (root == BVH_NULL_NODE)
+		return;
+
+	float radiusSquared = radius * radius;
+	stack.clear();
+	stack.push_back(root);
+	while (!stack.empty())
+	{
+		const BVHNode& node = nodes[stack.back()];
+		stack.pop_back();
+
+		if (node.Left == BVH_NULL_NODE)
+		{
+			if (SphereTouchesBox(center, radiusSquared, node.TightMin, node.TightMax))
+				results.push_back(node.UserData);
+		}
+		else if (SphereTouchesBox(center, radiusSquared, node.Min, node.Max))
+		{
+			stack.push_back(node.Left);
+			stack.push_back(node.Right);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Visits the nearer child first, and skips anything that
+// starts further away than the closest hit so far
+// --------------------------------------------------------
+bool DynamicBVH::RayCast(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, unsigned int* userData, float* distance)
+{
+	if (root == BVH_NULL_NODE)
+		return false;
+
+	XMFLOAT3 inverse(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+	float closest = maxDistance;
+	bool hit = false;
+
+	float t;
+	if (!RayHitsBox(origin, inverse, nodes[root].Min, nodes[root].Max, closest, &t))
+		return false;
+
+	stack.clear();
+	stack.push_back(root);
+	while (!stack.empty())
+	{
+		const BVHNode& node = nodes[stack.back()];
+		stack.pop_back();
+
+		if (node.Left == BVH_NULL_NODE)
+		{
+			if (RayHitsBox(origin, inverse, node.TightMin, node.TightMax, closest, &t) &&
+				(!hit || t < closest))
+			{
+				closest = t;
+				*userData = node.UserData;
+				hit = true;
+			}
+			continue;
+		}
+
+		float tLeft, tRight;
+		bool left = RayHitsBox(origin, inverse, nodes[node.Left].Min, nodes[node.Left].Max, closest, &tLeft);
+		bool right = RayHitsBox(origin, inverse, nodes[node.Right].Min, nodes[node.Right].Max, closest, &tRight);
+		if (left && right)
+		{
+			// Far one goes on first, so it comes off last
+			stack.push_back(tLeft <= tRight ? node.Right : node.Left);
+			stack.push_back(tLeft <= tRight ? node.Left : node.Right);
+		}
+		else if (left)
+			stack.push_back(node.Left);
+		else if (right)
+			stack.push_back(node.Right);
+	}
+
+	if (hit)
+		*distance = closest;
+	return hit;
+}
+
+int DynamicBVH::AllocateNode()
+{
+	int index;
+	if (freeNode != BVH_NULL_NODE)
+	{
+		index = freeNode;
+		freeNode = nodes[index].Parent;
+	}
+	else
+	{
+		index = (int)nodes.size();
+		nodes.emplace_back();
+	}
+
+	BVHNode& node = nodes[index];
+	node.Parent = BVH_NULL_NODE;
+	node.Left = BVH_NULL_NODE;
+	node.Right = BVH_NULL_NODE;
+	node.Height = 0;
+	node.UserData = 0;
+	return index;
+}
+
+void DynamicBVH::FreeNode(int node)
+{
+	nodes[node].Parent = freeNode;
+	nodes[node].Height = -1;
+	freeNode = node;
+}
+
+// --------------------------------------------------------
+// Walks down to the sibling that would cost the least
+// area (counting what the ancestors have to grow by) and
+// puts a new parent above the two of them.
+// See Catto, "Dynamic Bounding Volume Hierarchies" (GDC 2019).
+// --------------------------------------------------------
+void DynamicBVH::InsertLeaf(int leaf)
+{
+	if (root == BVH_NULL_NODE)
+	{
+		root = leaf;
+		nodes[leaf].Parent = BVH_NULL_NODE;
+		return;
+	}
+
+	XMFLOAT3 leafMin = nodes[leaf].Min;
+	XMFLOAT3 leafMax = nodes[leaf].Max;
+
+	int index = root;
+	while (!IsLeaf(index))
+	{
+		const BVHNode& node = nodes[index];
+		float area = Area(node.Min, node.Max);
+		float combinedArea = UnionArea(node.Min, node.Max, leafMin, leafMax);
+
+		// A new parent here, or growing this node to go further down
+		float cost = 2.0f * combinedArea;
+		float inheritance = 2.0f * (combinedArea - area);
+
+		float childCost[2];
+		int children[2] = { node.Left, node.Right };
+		for (int c = 0; c < 2; c++)
+		{
+			const BVHNode& child = nodes[children[c]];
+			float grown = UnionArea(child.Min, child.Max, leafMin, leafMax);
+			childCost[c] = (child.Left == BVH_NULL_NODE ? grown : grown - Area(child.Min, child.Max)) + inheritance;
+		}
+
+		if (cost < childCost[0] && cost < childCost[1])
+			break;
+		index = childCost[0] < childCost[1] ? children[0] : children[1];
+	}
+
+	// Could move nodes, so nothing is held across it
+	int sibling = index;
+	int oldParent = nodes[sibling].Parent;
+	int newParent = AllocateNode();
+
+	BVHNode& parent = nodes[newParent];
+	parent.Parent = oldParent;
+	parent.Left = sibling;
+	parent.Right = leaf;
+	parent.Min = nodes[sibling].Min;
+	parent.Max = nodes[sibling].Max;
+	Grow(parent.Min, parent.Max, leafMin, leafMax);
+	parent.Height = nodes[sibling].Height + 1;
+	nodes[sibling].Parent = newParent;
+	nodes[leaf].Parent = newParent;
+
+	if (oldParent == BVH_NULL_NODE)
+		root = newParent;
+	else if (nodes[oldParent].Left == sibling)
+		nodes[oldParent].Left = newParent;
+	else
+		nodes[oldParent].Right = newParent;
+
+	Refit(newParent);
+}
+
+void DynamicBVH::RemoveLeaf(int leaf)
+{
+	if (leaf == root)
+	{
+		root = BVH_NULL_NODE;
+		return;
+	}
+
+	// The sibling takes the parent's place
+	int parent = nodes[leaf].Parent;
+	int grandparent = nodes[parent].Parent;
+	int sibling = nodes[parent].Left == leaf ? nodes[parent].Right : nodes[parent].Left;
+
+	nodes[sibling].Parent = grandparent;
+	FreeNode(parent);
+	if (grandparent == BVH_NULL_NODE)
+	{
+		root = sibling;
+		return;
+	}
+
+	if (nodes[grandparent].Left == parent)
+		nodes[grandparent].Left = sibling;
+	else
+		nodes[grandparent].Right = sibling;
+	Refit(grandparent);
+}
+
+// --------------------------------------------------------
+// Fixes boxes and heights from node up to the root,
+// rotating each node on the way
+// --------------------------------------------------------
+void DynamicBVH::Refit(int node)
+{
+	while (node != BVH_NULL_NODE)
+	{
+		FitToChildren(node);
+		Rotate(node);
+		node = nodes[node].Parent;
+	}
+}
+
+// --------------------------------------------------------
+// Tries swapping each child with each of the other child's
+// children, and makes whichever swap shrinks the node that
+// changes the most (the node itself keeps the same leaves,
+// so its own box doesn't change)
+// --------------------------------------------------------
+void DynamicBVH::Rotate(int node)
+{
+	int b = nodes[node].Left;
+	int c = nodes[node].Right;
+
+	float bestGain = 0.0f;
+	int moveUp = BVH_NULL_NODE;		// Grandchild that becomes a child
+	int moveDown = BVH_NULL_NODE;	// Child that takes its place
+
+	for (int side = 0; side < 2; side++)
+	{
+		int stay = side == 0 ? b : c;
+		int other = side == 0 ? c : b;
+		if (IsLeaf(other))
+			continue;
+
+		// stay swaps with one of other's children, leaving other
+		// around stay and the remaining grandchild
+		const BVHNode& o = nodes[other];
+		float area = Area(o.Min, o.Max);
+		int grandchildren[2] = { o.Left, o.Right };
+		for (int g = 0; g < 2; g++)
+		{
+			const BVHNode& kept = nodes[grandchildren[1 - g]];
+			float gain = area - UnionArea(nodes[stay].Min, nodes[stay].Max, kept.Min, kept.Max);
+			if (gain > bestGain)
+			{
+				bestGain = gain;
+				moveUp = grandchildren[g];
+				moveDown = stay;
+			}
+		}
+	}
+
+	if (moveUp == BVH_NULL_NODE)
+		return;
+
+	int middle = nodes[moveUp].Parent;
+	if (nodes[node].Left == moveDown)
+		nodes[node].Left = moveUp;
+	else
+		nodes[node].Right = moveUp;
+	if (nodes[middle].Left == moveUp)
+		nodes[middle].Left = moveDown;
+	else
+		nodes[middle].Right = moveDown;
+	nodes[moveUp].Parent = node;
+	nodes[moveDown].Parent = middle;
+
+	FitToChildren(middle);
+	FitToChildren(node);
+}
+
+void DynamicBVH::FitToChildren(int node)
+{
+	BVHNode& n = nodes[node];
+	const BVHNode& left = nodes[n.Left];
+	const BVHNode& right = nodes[n.Right];
+	n.Min = left.Min;
+	n.Max = left.Max;
+	Grow(n.Min, n.Max, right.Min, right.Max);
+	n.Height = 1 + std::max(left.Height, right.Height);
+}
+
+// --------------------------------------------------------
+// Splits the leaves along the axis their centers spread
+// furthest over, at whichever bin boundary gives the least
+// area times leaves on the two sides, then builds each side.
+// Returns the new subtree's root.
+// --------------------------------------------------------
+int DynamicBVH::BuildRange(int* leaves, int count, int parent)
+{
+	if (count == 1)
+	{
+		nodes[leaves[0]].Parent = parent;
+		return leaves[0];
+	}
+
+	XMFLOAT3 centerMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 centerMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (int i = 0; i < count; i++)
+	{
+		const BVHNode& leaf = nodes[leaves[i]];
+		XMFLOAT3 center((leaf.Min.x + leaf.Max.x) * 0.5f, (leaf.Min.y + leaf.Max.y) * 0.5f, (leaf.Min.z + leaf.Max.z) * 0.5f);
+		Grow(centerMin, centerMax, center, center);
+	}
+
+	int axis = 0;
+	for (int a = 1; a < 3; a++)
+	{
+		if (Axis(centerMax, a) - Axis(centerMin, a) > Axis(centerMax, axis) - Axis(centerMin, axis))
+			axis = a;
+	}
+	float start = Axis(centerMin, axis);
+	float extent = Axis(centerMax, axis) - start;
+
+	int mid = count / 2;
+	if (extent > 0.0f)
+	{
+		struct Bin
+		{
+			XMFLOAT3 Min;
+			XMFLOAT3 Max;
+			int Count;
+		};
+		Bin bins[BVH_SAH_BINS];
+		for (int b = 0; b < BVH_SAH_BINS; b++)
+			bins[b] = { XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX), XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX), 0 };
+
+		float scale = BVH_SAH_BINS / extent;
+		auto binOf = [&](int leaf)
+		{
+			const BVHNode& n = nodes[leaf];
+			float center = (Axis(n.Min, axis) + Axis(n.Max, axis)) * 0.5f;
+			return std::min(BVH_SAH_BINS - 1, (int)((center - start) * scale));
+		};
+		for (int i = 0; i < count; i++)
+		{
+			Bin& bin = bins[binOf(leaves[i])];
+			Grow(bin.Min, bin.Max, nodes[leaves[i]].Min, nodes[leaves[i]].Max);
+			bin.Count++;
+		}
+
+		// Cost of everything right of each boundary, then sweep from the left
+		float rightCost[BVH_SAH_BINS];
+		XMFLOAT3 min(FLT_MAX, FLT_MAX, FLT_MAX), max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		int below = 0;
+		for (int b = BVH_SAH_BINS - 1; b > 0; b--)
+		{
+			if (bins[b].Count > 0)
+				Grow(min, max, bins[b].Min, bins[b].Max);
+			below += bins[b].Count;
+			rightCost[b] = below > 0 ? Area(min, max) * below : 0.0f;
+		}
+
+		float bestCost = FLT_MAX;
+		int bestBin = -1;
+		min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		below = 0;
+		for (int b = 0; b < BVH_SAH_BINS - 1; b++)
+		{
+			if (bins[b].Count > 0)
+				Grow(min, max, bins[b].Min, bins[b].Max);
+			below += bins[b].Count;
+			if (below == 0 || below == count)
+				continue;
+			float cost = Area(min, max) * below + rightCost[b + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestBin = b;
+			}
+		}
+
+		if (bestBin >= 0)
+			mid = (int)(std::partition(leaves, leaves + count, [&](int leaf) { return binOf(leaf) <= bestBin; }) - leaves);
+	}
+
+	// All the centers in one place: any split is as good as another
+	if (mid == 0 || mid == count)
+		mid = count / 2;
+
+	int node = AllocateNode();
+	nodes[node].Parent = parent;
+	int left = BuildRange(leaves, mid, node);
+	int right = BuildRange(leaves + mid, count - mid, node);
+	nodes[node].Left = left;
+	nodes[node].Right = right;
+	FitToChildren(node);
+	return node;
+}
+
+// --------------------------------------------------------
+// Scatters boxes through a cube that grows with the count,
+// so each size is about as crowded, and times a run of
+// random queries of each kind through the tree and by
+// testing every box
+// --------------------------------------------------------
+std::vector<BVHBenchmark> DynamicBVH::RunBenchmark()
+{
+	const unsigned int sizes[] = { 10000, 100000, 1000000 };
+
+	std::vector<BVHBenchmark> results;
+	for (unsigned int objectCount : sizes)
+	{
+		std::mt19937 random(1);
+		float side = 10.0f * cbrtf((float)objectCount);
+		std::uniform_real_distribution<float> position(-side * 0.5f, side * 0.5f);
+		std::uniform_real_distribution<float> size(0.25f, 1.0f);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		BVHBenchmark result = {};
+		result.ObjectCount = objectCount;
+		result.Matches = true;
+
+		std::vector<BoundsAABB> boxes(objectCount);
+		for (unsigned int i = 0; i < objectCount; i++)
+		{
+			boxes[i].Center = XMFLOAT3(position(random), position(random), position(random));
+			boxes[i].Extents = XMFLOAT3(size(random), size(random), size(random));
+		}
+
+		DynamicBVH tree;
+		std::vector<int> leaves(objectCount);
+		auto startTime = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < objectCount; i++)
+			leaves[i] = tree.Insert(boxes[i], i);
+		auto endTime = std::chrono::high_resolution_clock::now();
+		result.InsertMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+		startTime = std::chrono::high_resolution_clock::now();
+		tree.Rebuild();
+		endTime = std::chrono::high_resolution_clock::now();
+		result.RebuildMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+		// Some move a little (inside their fat boxes), some a long way
+		startTime = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < objectCount; i += 100)
+		{
+			float distance = (i / 100) % 2 ? 0.05f : 5.0f;
+			boxes[i].Center.x += unit(random) * distance;
+			boxes[i].Center.y += unit(random) * distance;
+			boxes[i].Center.z += unit(random) * distance;
+			tree.Move(leaves[i], boxes[i]);
+		}
+		endTime = std::chrono::high_resolution_clock::now();
+		result.MoveMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+		std::vector<unsigned int> found;
+		std::vector<unsigned int> expected;
+		for (int q = 0; q < BVH_BENCHMARK_QUERIES; q++)
+		{
+			XMFLOAT3 origin(position(random), position(random), position(random));
+			XMFLOAT3 direction(unit(random), unit(random), unit(random));
+			XMStoreFloat3(&direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+
+			// A camera looking along the ray
+			XMMATRIX view = XMMatrixLookToLH(XMLoadFloat3(&origin), XMLoadFloat3(&direction), XMVectorSet(0, 1, 0, 0));
+			XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 100.0f);
+			Frustum frustum;
+			frustum.Extract(view * projection);
+
+			startTime = std::chrono::high_resolution_clock::now();
+			tree.QueryFrustum(frustum, found);
+			endTime = std::chrono::high_resolution_clock::now();
+			result.FrustumMs += std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+			startTime = std::chrono::high_resolution_clock::now();
+			expected.clear();
+			for (unsigned int i = 0; i < objectCount; i++)
+			{
+				const XMFLOAT3& c = boxes[i].Center;
+				const XMFLOAT3& e = boxes[i].Extents;
+				if (LeafInFrustum(frustum, XMFLOAT3(c.x - e.x, c.y - e.y, c.z - e.z), XMFLOAT3(c.x + e.x, c.y + e.y, c.z + e.z)))
+					expected.push_back(i);
+			}
+			endTime = std::chrono::high_resolution_clock::now();
+			result.BruteFrustumMs += std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+			std::sort(found.begin(), found.end());
+			result.Matches &= found == expected;
+
+			// Ray
+			unsigned int hitIndex = 0;
+			float hitDistance = 0.0f;
+			startTime = std::chrono::high_resolution_clock::now();
+			bool hit = tree.RayCast(origin, direction, side, &hitIndex, &hitDistance);
+			endTime = std::chrono::high_resolution_clock::now();
+			result.RayMs += std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+			startTime = std::chrono::high_resolution_clock::now();
+			XMFLOAT3 inverse(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+			bool bruteHit = false;
+			float bruteDistance = side;
+			for (unsigned int i = 0; i < objectCount; i++)
+			{
+				const XMFLOAT3& c = boxes[i].Center;
+				const XMFLOAT3& e = boxes[i].Extents;
+				float t;
+				if (RayHitsBox(origin, inverse, XMFLOAT3(c.x - e.x, c.y - e.y, c.z - e.z), XMFLOAT3(c.x + e.x, c.y + e.y, c.z + e.z), bruteDistance, &t) &&
+					(!bruteHit || t < bruteDistance))
+				{
+					bruteDistance = t;
+					bruteHit = true;
+				}
+			}
+			endTime = std::chrono::high_resolution_clock::now();
+			result.BruteRayMs += std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+			result.Matches &= hit == bruteHit && (!hit || hitDistance == bruteDistance);
+
+			// Sphere, about the size of a light's range
+			float radius = 10.0f;
+			startTime = std::chrono::high_resolution_clock::now();
+			tree.QuerySphere(origin, radius, found);
+			endTime = std::chrono::high_resolution_clock::now();
+			result.SphereMs += std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+			startTime = std::chrono::high_resolution_clock::now();
+			expected.clear();
+			for (unsigned int i = 0; i < objectCount; i++)
+			{
+				const XMFLOAT3& c = boxes[i].Center;
+				const XMFLOAT3& e = boxes[i].Extents;
+				if (SphereTouchesBox(origin, radius * radius, XMFLOAT3(c.x - e.x, c.y - e.y, c.z - e.z), XMFLOAT3(c.x + e.x, c.y + e.y, c.z + e.z)))
+					expected.push_back(i);
+			}
+			endTime = std::chrono::high_resolution_clock::now();
+			result.BruteSphereMs += std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+			std::sort(found.begin(), found.end());
+			result.Matches &= found == expected;
+		}
+
+		results.push_back(result);
+	}
+	return results;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "Bounds.h"
+#include "Frustum.h"
+
+// Marks a missing node: no parent, no child, the end of the free list
+#define BVH_NULL_NODE			-1
+
+// Leaves are stored this much bigger on every side, so objects can
+// move a little without touching the tree
+#define BVH_FAT_MARGIN			0.1f
+
+// Split positions tried along the chosen axis in a SAH rebuild
+#define BVH_SAH_BINS			16
+
+// Queries of each kind timed by the benchmark, at each size
+#define BVH_BENCHMARK_QUERIES	100
+
+// --------------------------------------------------------
+// One node of a DynamicBVH.  Leaves hold the box they were
+// given as well as the fattened one the tree is built from.
+// --------------------------------------------------------
+struct BVHNode
+{
+	DirectX::XMFLOAT3 Min;
+	DirectX::XMFLOAT3 Max;
+	DirectX::XMFLOAT3 TightMin;		// Leaves only
+	DirectX::XMFLOAT3 TightMax;
+	int Parent;						// Or the next free node
+	int Left;						// BVH_NULL_NODE for leaves
+	int Right;
+	int Height;						// 0 for leaves, -1 for free nodes
+	unsigned int UserData;
+};
+
+// --------------------------------------------------------
+// Timings of DynamicBVH::RunBenchmark at one scene size
+// --------------------------------------------------------
+struct BVHBenchmark
+{
+	unsigned int ObjectCount;
+	double InsertMs;				// Inserting every object one at a time
+	double RebuildMs;				// A SAH rebuild of the same objects
+	double MoveMs;					// Moving 1% of them
+	double FrustumMs;				// Each kind of query, all of them through
+	double BruteFrustumMs;			// the tree, then testing every object
+	double RayMs;
+	double BruteRayMs;
+	double SphereMs;
+	double BruteSphereMs;
+	bool Matches;					// Every query agreed with brute force
+};
+
+// --------------------------------------------------------
+// A bounding volume hierarchy over boxes that move.  New
+// leaves go wherever they add the least surface area, and
+// a moved leaf is only reinserted once it leaves its fat
+// box.  On the way back up from either, each node swaps a
+// child with a grandchild if that shrinks it, which keeps
+// the tree from degrading as things move around.
+// Rebuild() starts over from a binned surface area
+// heuristic split, for after large changes.
+//
+// Queries share a stack, so only one can run at a time.
+// --------------------------------------------------------
+class DynamicBVH
+{
+public:
+	DynamicBVH();
+
+	// Leaf indices stay the same until the leaf is removed
+	int Insert(const BoundsAABB& box, unsigned int userData);
+	void Remove(int leaf);
+
+	// Returns whether the leaf had to be reinserted
+	bool Move(int leaf, const BoundsAABB& box);
+
+	void Rebuild();
+	void Clear();
+
+	unsigned int GetLeafCount() { return leafCount; }
+	int GetHeight() { return root == BVH_NULL_NODE ? 0 : nodes[root].Height; }
+
+	// Fill results with the user data of every leaf whose box (as given,
+	// not fattened) touches the frustum or sphere, in no particular order
+	void QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& results);
+	void QuerySphere(DirectX::XMFLOAT3 center, float radius, std::vector<unsigned int>& results);
+
+	// Finds the closest leaf box the ray hits within maxDistance
+	bool RayCast(
+		DirectX::XMFLOAT3 origin,
+		DirectX::XMFLOAT3 direction,
+		float maxDistance,
+		unsigned int* userData,
+		float* distance);
+
+	// Times building, moving and querying trees of 10k, 100k and 1M
+	// objects, checking every query against testing each object
+	static std::vector<BVHBenchmark> RunBenchmark();
+
+private:
+	std::vector<BVHNode> nodes;
+	int root;
+	int freeNode;
+	unsigned int leafCount;
+	std::vector<int> stack;
+
+	int AllocateNode();
+	void FreeNode(int node);
+	bool IsLeaf(int node) { return nodes[node].Left == BVH_NULL_NODE; }
+
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+	void Refit(int node);
+	void Rotate(int node);
+	void FitToChildren(int node);
+	int BuildRange(int* leaves, int count, int parent);
+};
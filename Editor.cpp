@@ -0,0 +1,359 @@
+#include "Editor.h"
+#include <stdio.h>
+#include <string.h>
+#include "imgui.h"
+
+using namespace DirectX;
+
+Editor::Editor(std::vector<Light>& lights, DynamicBVH& entityTree) :
+	lights(lights),
+	entityTree(entityTree)
+{
+	selectedEntity = -1;
+	selectedLight = -1;
+	revealEntity = false;
+	undoCount = 0;
+	transactionDepth = 0;
+	itemTransaction = false;
+}
+
+void Editor::Draw(const std::vector<GameEntity*>& entities)
+{
+	ImGui::Begin("Elements");
+
+	// History
+	ImGui::BeginDisabled(!CanUndo());
+	if (ImGui::Button("Undo")) Undo();
+	ImGui::EndDisabled();
+	ImGui::SameLine();
+	ImGui::BeginDisabled(!CanRedo());
+	if (ImGui::Button("Redo")) Redo();
+	ImGui::EndDisabled();
+	ImGui::SameLine();
+	ImGui::Text("%u / %u", (unsigned int)undoCount, (unsigned int)history.size());
+
+	if (revealEntity)
+		ImGui::SetNextItemOpen(true);
+	if (ImGui::CollapsingHeader("Entities"))
+	{
+		DrawEntityList(entities);
+		if (selectedEntity >= 0 && selectedEntity < (int)entities.size())
+			DrawEntityInfo(entities[selectedEntity]);
+	}
+	if (ImGui::CollapsingHeader("Lights"))
+	{
+		DrawLightList();
+		if (selectedLight >= 0 && selectedLight < (int)lights.size())
+			DrawLightInfo(selectedLight);
+	}
+	ImGui::End();
+	revealEntity = false;
+
+	// The widget being edited has been let go (or hidden)
+	if (itemTransaction && !ImGui::IsAnyItemActive())
+	{
+		itemTransaction = false;
+		EndTransaction();
+	}
+}
+
+void Editor::SelectEntity(int index)
+{
+	selectedEntity = index;
+	revealEntity = true;
+}
+
+void Editor::BeginTransaction()
+{
+	transactionDepth++;
+}
+
+void Editor::RecordTransform(TransformHandle handle)
+{
+	if (transactionDepth == 0 || !TransformSystem::GetInstance().IsValid(handle))
+		return;
+
+	// The first snapshot is the one from before any changes
+	for (auto& c : pending.Changes)
+		if (c.Transform == handle)
+			return;
+
+	EditorChange change = {};
+	change.Transform = handle;
+	change.LightIndex = -1;
+	change.TransformBefore = GetTransformState(handle);
+	pending.Changes.push_back(change);
+}
+
+void Editor::RecordLight(int index)
+{
+	if (transactionDepth == 0 || index < 0 || index >= (int)lights.size())
+		return;
+
+	for (auto& c : pending.Changes)
+		if (c.Transform == TRANSFORM_NO_NODE && c.LightIndex == index)
+			return;
+
+	EditorChange change = {};
+	change.Transform = TRANSFORM_NO_NODE;
+	change.LightIndex = index;
+	change.LightBefore = lights[index];
+	pending.Changes.push_back(change);
+}
+
+// --------------------------------------------------------
+// Closes the outermost transaction, keeping the objects
+// that actually ended up different.  A new transaction
+// replaces anything that had been undone.
+// --------------------------------------------------------
+void Editor::EndTransaction()
+{
+	if (transactionDepth == 0 || --transactionDepth > 0)
+		return;
+
+	EditorTransaction transaction;
+	for (auto& c : pending.Changes)
+	{
+		if (c.Transform != TRANSFORM_NO_NODE)
+		{
+			if (!TransformSystem::GetInstance().IsValid(c.Transform))
+				continue;
+			c.TransformAfter = GetTransformState(c.Transform);
+			if (memcmp(&c.TransformBefore, &c.TransformAfter, sizeof(EditorTransformState)) == 0)
+				continue;
+		}
+		else
+		{
+			if (c.LightIndex >= (int)lights.size())
+				continue;
+			c.LightAfter = lights[c.LightIndex];
+			if (memcmp(&c.LightBefore, &c.LightAfter, sizeof(Light)) == 0)
+				continue;
+		}
+		transaction.Changes.push_back(c);
+	}
+	pending.Changes.clear();
+
+	if (transaction.Changes.empty())
+		return;
+
+	history.resize(undoCount);
+	history.push_back(transaction);
+	if (history.size() > EDITOR_MAX_TRANSACTIONS)
+		history.erase(history.begin());
+	undoCount = history.size();
+}
+
+void Editor::Undo()
+{
+	// Not in the middle of an edit
+	if (transactionDepth > 0 || !CanUndo())
+		return;
+
+	undoCount--;
+	Apply(history[undoCount], false);
+}
+
+void Editor::Redo()
+{
+	if (transactionDepth > 0 || !CanRedo())
+		return;
+
+	Apply(history[undoCount], true);
+	undoCount++;
+}
+
+// --------------------------------------------------------
+// Only the rows in view are submitted, so the list costs
+// the same for any number of entities
+// --------------------------------------------------------
+void Editor::DrawEntityList(const std::vector<GameEntity*>& entities)
+{
+	ImGui::BeginChild("EntityList", ImVec2(0, EDITOR_LIST_HEIGHT), true);
+
+	// The selected row may not be submitted, so scroll by row height
+	if (revealEntity && selectedEntity >= 0)
+		ImGui::SetScrollY(selectedEntity * ImGui::GetTextLineHeightWithSpacing() - EDITOR_LIST_HEIGHT * 0.5f);
+
+	ImGuiListClipper clipper;
+	clipper.Begin((int)entities.size());
+	while (clipper.Step())
+	{
+		for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+		{
+			char label[32];
+			snprintf(label, sizeof(label), "Entity %d", i);
+			if (ImGui::Selectable(label, i == selectedEntity))
+				selectedEntity = i;
+		}
+	}
+	ImGui::EndChild();
+}
+
+void Editor::DrawEntityInfo(GameEntity* ge)
+{
+	Transform* transform = ge->GetTransform();
+	TransformHandle handle = transform->GetHandle();
+
+	// Widget IDs only have to be unique within the entity
+	ImGui::PushID(selectedEntity);
+	ImGui::Text("Entity %d", selectedEntity);
+
+	// Position
+	ImGui::Text("Position: ");
+	XMFLOAT3 position = transform->GetPosition();
+	if (TrackItem(ImGui::SliderFloat3("##Position", &position.x, -10.0f, 10.0f), handle, -1))
+		transform->SetPosition(position.x, position.y, position.z);
+
+	// Rotation
+	ImGui::Text("Rotation: ");
+	XMFLOAT3 rotation = transform->GetPitchYawRoll();
+	if (TrackItem(ImGui::SliderFloat3("##Rotation", &rotation.x, -6.28f, 6.28f), handle, -1))
+		transform->SetRotation(rotation.x, rotation.y, rotation.z);
+
+	// Scale
+	ImGui::Text("Scale: ");
+	XMFLOAT3 scale = transform->GetScale();
+	if (TrackItem(ImGui::SliderFloat3("##Scale", &scale.x, 0.1f, 5.0f), handle, -1))
+		transform->SetScale(scale.x, scale.y, scale.z);
+
+	// Level of detail (a view setting, so not undone)
+	int lodCount = (int)ge->GetMesh()->GetLodCount();
+	if (lodCount > 1)
+	{
+		ImGui::Text("LOD: ");
+		int lod = (int)ge->GetLOD();
+		if (ImGui::SliderInt("##LOD", &lod, 0, lodCount - 1))
+			ge->SetLOD((unsigned int)lod);
+		ImGui::Text("Triangles: %u", ge->GetMesh()->GetLod(ge->GetLOD()).IndexCount / 3);
+	}
+
+	// Children
+	unsigned int childCount = transform->GetChildCount();
+	ImGui::Text(childCount == 1 ? "%u child" : "%u children", childCount);
+
+	ImGui::PopID();
+}
+
+void Editor::DrawLightList()
+{
+	static const char* typeNames[] = { "Directional", "Point", "Spot" };
+
+	ImGui::BeginChild("LightList", ImVec2(0, EDITOR_LIST_HEIGHT), true);
+	ImGuiListClipper clipper;
+	clipper.Begin((int)lights.size());
+	while (clipper.Step())
+	{
+		for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+		{
+			int type = lights[i].Type;
+			char label[48];
+			snprintf(label, sizeof(label), "Light %d (%s)", i, type >= 0 && type <= LIGHT_TYPE_SPOT ? typeNames[type] : "?");
+			if (ImGui::Selectable(label, i == selectedLight))
+				selectedLight = i;
+		}
+	}
+	ImGui::EndChild();
+}
+
+void Editor::DrawLightInfo(int index)
+{
+	Light light = lights[index];
+
+	ImGui::PushID(index);
+	ImGui::Text("Light %d", index);
+
+	// Light Color
+	if (TrackItem(ImGui::ColorEdit3("##Color", &light.Color.x), TRANSFORM_NO_NODE, index))
+		lights[index].Color = light.Color;
+
+	// Direction
+	if (light.Type == LIGHT_TYPE_DIRECTIONAL || light.Type == LIGHT_TYPE_SPOT)
+	{
+		ImGui::Text("Direction: ");
+		if (TrackItem(ImGui::SliderFloat3("##Direction", &light.Direction.x, -1.0f, 1.0f), TRANSFORM_NO_NODE, index))
+			lights[index].Direction = light.Direction;
+	}
+
+	// Position
+	if (light.Type == LIGHT_TYPE_POINT || light.Type == LIGHT_TYPE_SPOT)
+	{
+		ImGui::Text("Position: ");
+		if (TrackItem(ImGui::SliderFloat3("##Position", &light.Position.x, -10.0f, 10.0f), TRANSFORM_NO_NODE, index))
+			lights[index].Position = light.Position;
+	}
+
+	// Range
+	if (light.Type == LIGHT_TYPE_POINT)
+	{
+		ImGui::Text("Range: ");
+		if (TrackItem(ImGui::SliderFloat("##Range", &light.Range, 5.0f, 10.0f), TRANSFORM_NO_NODE, index))
+			lights[index].Range = light.Range;
+
+		entityTree.QuerySphere(light.Position, light.Range, entitiesInRange);
+		ImGui::Text("Entities in range: %u", (unsigned int)entitiesInRange.size());
+	}
+
+	// Intensity
+	ImGui::Text("Intensity: ");
+	if (TrackItem(ImGui::SliderFloat("##Intensity", &light.Intensity, 0.1f, 3.0f), TRANSFORM_NO_NODE, index))
+		lights[index].Intensity = light.Intensity;
+
+	ImGui::PopID();
+}
+
+// --------------------------------------------------------
+// Call straight after a widget, before its value is used.
+// Grabbing the widget (or editing it some other way) opens
+// a transaction with the object as it was, and that stays
+// open until the widget is let go, so a whole drag is one
+// undo.  Returns whether the widget was edited.
+// --------------------------------------------------------
+bool Editor::TrackItem(bool edited, TransformHandle transform, int lightIndex)
+{
+	if (!ImGui::IsItemActivated() && !edited)
+		return false;
+
+	if (!itemTransaction)
+	{
+		BeginTransaction();
+		itemTransaction = true;
+	}
+
+	if (transform != TRANSFORM_NO_NODE)
+		RecordTransform(transform);
+	else
+		RecordLight(lightIndex);
+	return edited;
+}
+
+void Editor::Apply(const EditorTransaction& transaction, bool after)
+{
+	for (auto& c : transaction.Changes)
+	{
+		// Destroyed transforms are skipped by the system
+		if (c.Transform != TRANSFORM_NO_NODE)
+			SetTransformState(c.Transform, after ? c.TransformAfter : c.TransformBefore);
+		else if (c.LightIndex < (int)lights.size())
+			lights[c.LightIndex] = after ? c.LightAfter : c.LightBefore;
+	}
+}
+
+EditorTransformState Editor::GetTransformState(TransformHandle handle)
+{
+	TransformSystem& ts = TransformSystem::GetInstance();
+
+	EditorTransformState state;
+	state.Position = ts.GetPosition(handle);
+	state.Rotation = ts.GetRotation(handle);
+	state.Scale = ts.GetScale(handle);
+	return state;
+}
+
+void Editor::SetTransformState(TransformHandle handle, const EditorTransformState& state)
+{
+	TransformSystem& ts = TransformSystem::GetInstance();
+	ts.SetPosition(handle, state.Position.x, state.Position.y, state.Position.z);
+	ts.SetRotation(handle, state.Rotation);
+	ts.SetScale(handle, state.Scale.x, state.Scale.y, state.Scale.z);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "DynamicBVH.h"
+#include "GameEntity.h"
+#include "Lights.h"
+#include "TransformSystem.h"
+
+// How many transactions can be undone (the oldest are dropped)
+#define EDITOR_MAX_TRANSACTIONS		256
+
+// Height of the scrolling entity and light lists
+#define EDITOR_LIST_HEIGHT			200.0f
+
+// Everything the editor can change about a transform
+struct EditorTransformState
+{
+	DirectX::XMFLOAT3 Position;
+	DirectX::XMFLOAT4 Rotation;
+	DirectX::XMFLOAT3 Scale;
+};
+
+// One object's state either side of a transaction - a transform
+// (by handle, so it's skipped once destroyed) or a light
+struct EditorChange
+{
+	TransformHandle Transform;	// TRANSFORM_NO_NODE for a light
+	int LightIndex;
+	EditorTransformState TransformBefore;
+	EditorTransformState TransformAfter;
+	Light LightBefore;
+	Light LightAfter;
+};
+
+// Undone and redone as a whole: one slider drag, one
+// round of random lights, etc.
+struct EditorTransaction
+{
+	std::vector<EditorChange> Changes;
+};
+
+// --------------------------------------------------------
+// The entity and light panels.  A value is only written
+// back when its widget reports an edit, so showing things
+// doesn't mark them as changed, and each edit is kept as a
+// transaction that can be undone.  The lists only submit
+// their visible rows, and the details are shown for just
+// the selected entity and light, so the panels cost about
+// the same however many there are.  The entity tree (with
+// entity indices as user data) answers which entities a
+// point light reaches.
+// --------------------------------------------------------
+class Editor
+{
+public:
+	Editor(std::vector<Light>& lights, DynamicBVH& entityTree);
+
+	void Draw(const std::vector<GameEntity*>& entities);
+
+	// Selects and scrolls to the entity, e.g. after picking it
+	void SelectEntity(int index);
+
+	// Objects are snapshotted as they're recorded; whichever of them
+	// differ at the end make up the transaction.  These nest, and
+	// only the outermost End keeps anything.
+	void BeginTransaction();
+	void RecordTransform(TransformHandle handle);
+	void RecordLight(int index);
+	void EndTransaction();
+
+	void Undo();
+	void Redo();
+	bool CanUndo() { return undoCount > 0; }
+	bool CanRedo() { return undoCount < history.size(); }
+
+private:
+	std::vector<Light>& lights;
+	DynamicBVH& entityTree;
+	std::vector<unsigned int> entitiesInRange;
+	int selectedEntity;
+	int selectedLight;
+	bool revealEntity;
+
+	// Transactions before undoCount can be undone, the rest redone
+	std::vector<EditorTransaction> history;
+	size_t undoCount;
+
+	// The transaction being built, and whether it's for a widget
+	// (which ends once the widget is let go)
+	EditorTransaction pending;
+	unsigned int transactionDepth;
+	bool itemTransaction;
+
+	void DrawEntityList(const std::vector<GameEntity*>& entities);
+	void DrawEntityInfo(GameEntity* ge);
+	void DrawLightList();
+	void DrawLightInfo(int index);
+
+	bool TrackItem(bool edited, TransformHandle transform, int lightIndex);
+	void Apply(const EditorTransaction& transaction, bool after);
+
+	EditorTransformState GetTransformState(TransformHandle handle);
+	void SetTransformState(TransformHandle handle, const EditorTransformState& state);
+};
@@ -0,0 +1,50 @@
+#include "Frustum.h"
+
+using namespace DirectX;
+
+void Frustum::Extract(FXMMATRIX viewProjection)
+{
+	// Rows of the transpose are the columns of the original (Gribb & Hartmann),
+	// with D3D's clip space depth running from 0 to w
+	XMMATRIX columns = XMMatrixTranspose(viewProjection);
+	XMVECTOR planes[6] =
+	{
+		columns.r[3] + columns.r[0],	// Left
+		columns.r[3] - columns.r[0],	// Right
+		columns.r[3] + columns.r[1],	// Bottom
+		columns.r[3] - columns.r[1],	// Top
+		columns.r[2],					// Near
+		columns.r[3] - columns.r[2],	// Far
+	};
+
+	// Normalize so distances to the planes are real distances
+	for (int i = 0; i < 6; i++)
+		XMStoreFloat4(&Planes[i], XMPlaneNormalize(planes[i]));
+}
+
+bool Frustum::IntersectsSphere(FXMVECTOR center, float radius) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		float distance = XMVectorGetX(XMPlaneDotCoord(XMLoadFloat4(&Planes[i]), center));
+		if (distance < -radius)
+			return false;
+	}
+
+	return true;
+}
+
+bool Frustum::IntersectsAABB(FXMVECTOR center, FXMVECTOR extents) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		// How far the box reaches towards the plane
+		XMVECTOR plane = XMLoadFloat4(&Planes[i]);
+		float distance = XMVectorGetX(XMPlaneDotCoord(plane, center));
+		float reach = XMVectorGetX(XMVector3Dot(XMVectorAbs(plane), extents));
+		if (distance < -reach)
+			return false;
+	}
+
+	return true;
+}
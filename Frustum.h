@@ -0,0 +1,25 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+// --------------------------------------------------------
+// The six planes of a view frustum, each stored as
+// (normal, distance) with the normal pointing inwards
+// --------------------------------------------------------
+struct Frustum
+{
+	DirectX::XMFLOAT4 Planes[6];	// Left, right, bottom, top, near, far
+
+	// Extracts the planes from a (row-vector) view-projection matrix.
+	// The planes end up in whatever space the matrix transforms from,
+	// so world * view * projection gives object space planes
+	void Extract(DirectX::FXMMATRIX viewProjection);
+
+	// Conservative: spheres touching the frustum count as inside
+	bool IntersectsSphere(DirectX::FXMVECTOR center, float radius) const;
+
+	// Conservative in the same way, and for boxes that straddle the
+	// corner of two planes while being outside the frustum
+	bool IntersectsAABB(DirectX::FXMVECTOR center, DirectX::FXMVECTOR extents) const;
+};
+
@@ -0,0 +1,179 @@
+#include "FrustumCuller.h"
+
+#include <chrono>
+#include <random>
+#include <stdint.h>
+
+using namespace DirectX;
+
+// Loads four consecutive floats of a component array
+static inline XMVECTOR LoadFour(const std::vector<float>& data, size_t index)
+{
+	return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&data[index]));
+}
+
+FrustumCuller::FrustumCuller()
+{
+	count = 0;
+	stats = {};
+}
+
+void FrustumCuller::Resize(size_t count)
+{
+	this->count = count;
+
+	// Padding is a sphere no plane can reach
+	size_t padded = (count + 3) & ~(size_t)3;
+	centerX.resize(padded, 0.0f);
+	centerY.resize(padded, 0.0f);
+	centerZ.resize(padded, 0.0f);
+	radius.resize(padded, -1e30f);
+	boxCenterX.resize(padded, 0.0f);
+	boxCenterY.resize(padded, 0.0f);
+	boxCenterZ.resize(padded, 0.0f);
+	extentX.resize(padded, 0.0f);
+	extentY.resize(padded, 0.0f);
+	extentZ.resize(padded, 0.0f);
+	for (size_t i = count; i < padded; i++)
+		radius[i] = -1e30f;
+}
+
+void FrustumCuller::SetBounds(size_t index, const BoundsSphere& sphere, const BoundsAABB& box)
+{
+	centerX[index] = sphere.Center.x;
+	centerY[index] = sphere.Center.y;
+	centerZ[index] = sphere.Center.z;
+	radius[index] = sphere.Radius;
+	boxCenterX[index] = box.Center.x;
+	boxCenterY[index] = box.Center.y;
+	boxCenterZ[index] = box.Center.z;
+	extentX[index] = box.Extents.x;
+	extentY[index] = box.Extents.y;
+	extentZ[index] = box.Extents.z;
+}
+
+// --------------------------------------------------------
+// Each plane's components are splatted once, then every
+// group of four objects is tested against all six planes
+// (stopping early once all four are outside one)
+// --------------------------------------------------------
+void FrustumCuller::Cull(const Frustum& frustum, std::vector<unsigned int>& visible)
+{
+	visible.clear();
+	visible.reserve(count);
+
+	XMVECTOR planeX[6];
+	XMVECTOR planeY[6];
+	XMVECTOR planeZ[6];
+	XMVECTOR planeW[6];
+	for (int p = 0; p < 6; p++)
+	{
+		planeX[p] = XMVectorReplicate(frustum.Planes[p].x);
+		planeY[p] = XMVectorReplicate(frustum.Planes[p].y);
+		planeZ[p] = XMVectorReplicate(frustum.Planes[p].z);
+		planeW[p] = XMVectorReplicate(frustum.Planes[p].w);
+	}
+
+	const XMVECTOR none = XMVectorZero();
+	for (size_t i = 0; i < count; i += 4)
+	{
+		XMVECTOR cx = LoadFour(centerX, i);
+		XMVECTOR cy = LoadFour(centerY, i);
+		XMVECTOR cz = LoadFour(centerZ, i);
+		XMVECTOR negativeRadius = XMVectorNegate(LoadFour(radius, i));
+		XMVECTOR bx = LoadFour(boxCenterX, i);
+		XMVECTOR by = LoadFour(boxCenterY, i);
+		XMVECTOR bz = LoadFour(boxCenterZ, i);
+		XMVECTOR ex = LoadFour(extentX, i);
+		XMVECTOR ey = LoadFour(extentY, i);
+		XMVECTOR ez = LoadFour(extentZ, i);
+
+		XMVECTOR inside = XMVectorTrueInt();
+		for (int p = 0; p < 6; p++)
+		{
+			// Same sums, in the same order, as Frustum's own tests
+			XMVECTOR sphereDistance = cx * planeX[p] + cy * planeY[p] + cz * planeZ[p] + planeW[p];
+			XMVECTOR boxDistance = bx * planeX[p] + by * planeY[p] + bz * planeZ[p] + planeW[p];
+			XMVECTOR reach = ex * XMVectorAbs(planeX[p]) + ey * XMVectorAbs(planeY[p]) + ez * XMVectorAbs(planeZ[p]);
+			inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(sphereDistance, negativeRadius));
+			inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(boxDistance, XMVectorNegate(reach)));
+			if (XMVector4EqualInt(inside, none))
+				break;
+		}
+
+		uint32_t mask[4];
+		XMStoreInt4(mask, inside);
+		for (size_t k = 0; k < 4; k++)
+		{
+			if (mask[k])
+				visible.push_back((unsigned int)(i + k));
+		}
+	}
+
+	stats.ObjectsTested = (unsigned int)count;
+	stats.ObjectsVisible = (unsigned int)visible.size();
+}
+
+// --------------------------------------------------------
+// Scatters objects through a cube around a camera at the
+// origin looking down +Z, so most of them are culled
+// --------------------------------------------------------
+FrustumCullBenchmark FrustumCuller::RunBenchmark(unsigned int objectCount)
+{
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> size(0.25f, 2.0f);
+
+	FrustumCuller culler;
+	culler.Resize(objectCount);
+	std::vector<BoundsSphere> spheres(objectCount);
+	std::vector<BoundsAABB> boxes(objectCount);
+	for (unsigned int i = 0; i < objectCount; i++)
+	{
+		boxes[i].Center = XMFLOAT3(position(random), position(random), position(random));
+		boxes[i].Extents = XMFLOAT3(size(random), size(random), size(random));
+		spheres[i].Center = boxes[i].Center;
+		spheres[i].Radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&boxes[i].Extents))) * 0.9f;
+		culler.SetBounds(i, spheres[i], boxes[i]);
+	}
+
+	XMMATRIX view = XMMatrixLookToLH(XMVectorZero(), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 300.0f);
+	Frustum frustum;
+	frustum.Extract(view * projection);
+
+	FrustumCullBenchmark result = {};
+	result.ObjectCount = objectCount;
+
+	std::vector<unsigned int> visible;
+	auto startTime = std::chrono::high_resolution_clock::now();
+	culler.Cull(frustum, visible);
+	auto endTime = std::chrono::high_resolution_clock::now();
+	result.BatchedMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+	result.VisibleCount = (unsigned int)visible.size();
+
+	std::vector<unsigned char> perObject(objectCount);
+	startTime = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < objectCount; i++)
+	{
+		perObject[i] =
+			frustum.IntersectsSphere(XMLoadFloat3(&spheres[i].Center), spheres[i].Radius) &&
+			frustum.IntersectsAABB(XMLoadFloat3(&boxes[i].Center), XMLoadFloat3(&boxes[i].Extents));
+	}
+	endTime = std::chrono::high_resolution_clock::now();
+	result.PerObjectMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+	// Take the batched visible list away from the per object results
+	// (anything left over either way is a difference)
+	for (unsigned int index : visible)
+	{
+		if (perObject[index])
+			perObject[index] = 0;
+		else
+			result.Differences++;
+	}
+	for (unsigned int i = 0; i < objectCount; i++)
+		result.Differences += perObject[i];
+
+	return result;
+}
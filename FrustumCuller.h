@@ -0,0 +1,76 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "Bounds.h"
+#include "Frustum.h"
+
+// Objects in the scene RunBenchmark() makes up
+#define FRUSTUM_CULL_BENCHMARK_OBJECTS	1000000
+
+// --------------------------------------------------------
+// Results of the last FrustumCuller::Cull()
+// --------------------------------------------------------
+struct FrustumCullStats
+{
+	unsigned int ObjectsTested;
+	unsigned int ObjectsVisible;
+};
+
+// --------------------------------------------------------
+// Timings of one run of FrustumCuller::RunBenchmark
+// --------------------------------------------------------
+struct FrustumCullBenchmark
+{
+	unsigned int ObjectCount;
+	unsigned int VisibleCount;
+	double BatchedMs;			// Cull(), four objects at a time
+	double PerObjectMs;			// Frustum's tests on each object in turn
+	unsigned int Differences;	// Objects the two disagreed on (rounding, right at a plane)
+};
+
+// --------------------------------------------------------
+// World space bounds for a list of objects, each kept as a
+// sphere and a box, one array per component so the frustum
+// test can go four objects at a time.  An object is visible
+// if both its sphere and its box touch the frustum (they're
+// both conservative, and each catches objects the other
+// misses).
+//
+// Only depends on DirectXMath, so it can be benchmarked
+// without a window or a device.
+// --------------------------------------------------------
+class FrustumCuller
+{
+public:
+	FrustumCuller();
+
+	void Resize(size_t count);
+	size_t GetCount() { return count; }
+	void SetBounds(size_t index, const BoundsSphere& sphere, const BoundsAABB& box);
+
+	// Replaces visible with the indices of the visible objects, in order
+	void Cull(const Frustum& frustum, std::vector<unsigned int>& visible);
+	FrustumCullStats GetStats() { return stats; }
+
+	// Culls a made up scene of the given size, against checking each
+	// object with Frustum's own tests
+	static FrustumCullBenchmark RunBenchmark(unsigned int objectCount = FRUSTUM_CULL_BENCHMARK_OBJECTS);
+
+private:
+	size_t count;
+	FrustumCullStats stats;
+
+	// Padded to a multiple of 4 with objects that are never visible
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> radius;
+	std::vector<float> boxCenterX;
+	std::vector<float> boxCenterY;
+	std::vector<float> boxCenterZ;
+	std::vector<float> extentX;
+	std::vector<float> extentY;
+	std::vector<float> extentZ;
+};
@@ -45,6 +45,11 @@ Game::Game(HINSTANCE hInstance)
 		true)				// Show extra stats (fps) in title bar?
 {
 	camera = 0;
+	transformBenchmark = {};
+	transformBulkBenchmark = {};
+	cullBenchmark = {};
+	occlusionBenchmark = {};
+	SetFixedTimestep(GAME_FIXED_TIMESTEP);
 
 	// Seed random
 	srand((unsigned int)time(0));
@@ -81,6 +86,7 @@ Game::~Game()
 	for (auto& e : entities) delete e;
 
 	// Delete any one-off objects
+	delete editor;
 	delete renderer;
 	delete sky;
 	delete camera;
@@ -89,6 +95,7 @@ Game::~Game()
 
 	// Delete singletons
 	delete& Input::GetInstance();
+	delete& TransformSystem::GetInstance();
 }
 
 // --------------------------------------------------------
@@ -111,6 +118,10 @@ void Game::Init()
 	// Set up lights initially
 	lightCount = 64;
 	GenerateLights();
+	sceneEntityCount = entities.size();
+	stressScene = false;
+	BuildEntityTree();
+	editor = new Editor(lights, entityTree);
 
 	// Make our camera
 	camera = new Camera(
@@ -145,7 +156,28 @@ void Game::LoadAssetsAndCreateEntities()
 	SimpleVertexShader* skyVS = LoadShader(SimpleVertexShader, L"SkyVS.cso");
 	SimplePixelShader* skyPS  = LoadShader(SimplePixelShader, L"SkyPS.cso");
 
+	// The compact vertex shader reads packed formats, which can't
+	// be inferred through reflection, so it gets an explicit layout
+	Microsoft::WRL::ComPtr<ID3DBlob> compactVSBlob;
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> compactLayout;
+	unsigned int compactElementCount = 0;
+	const D3D11_INPUT_ELEMENT_DESC* compactElements = Mesh::GetCompactInputLayout(&compactElementCount);
+	D3DReadFileToBlob(GetFullPathTo_Wide(L"VertexShaderCompact.cso").c_str(), compactVSBlob.GetAddressOf());
+	device->CreateInputLayout(
+		compactElements,
+		compactElementCount,
+		compactVSBlob->GetBufferPointer(),
+		compactVSBlob->GetBufferSize(),
+		compactLayout.GetAddressOf());
+	SimpleVertexShader* vertexShaderCompact = new SimpleVertexShader(
+		device.Get(),
+		context.Get(),
+		GetFullPathTo_Wide(L"VertexShaderCompact.cso").c_str(),
+		compactLayout,
+		true);
+
 	shaders.push_back(vertexShader);
+	shaders.push_back(vertexShaderCompact);
 	shaders.push_back(pixelShader);
 	shaders.push_back(pixelShaderPBR);
 	shaders.push_back(solidColorPS);
@@ -157,7 +189,7 @@ void Game::LoadAssetsAndCreateEntities()
 	arial = new SpriteFont(device.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/arial.spritefont").c_str());
 
 	// Make the meshes
-	Mesh* sphereMesh = new Mesh(GetFullPathTo("../../Assets/Models/sphere.obj").c_str(), device);
+	Mesh* sphereMesh = new Mesh(GetFullPathTo("../../Assets/Models/sphere.obj").c_str(), device, 0.0f, MESH_VERTEX_FORMAT_COMPACT);
 	Mesh* helixMesh = new Mesh(GetFullPathTo("../../Assets/Models/helix.obj").c_str(), device);
 	Mesh* cubeMesh = new Mesh(GetFullPathTo("../../Assets/Models/cube.obj").c_str(), device);
 	Mesh* coneMesh = new Mesh(GetFullPathTo("../../Assets/Models/cone.obj").c_str(), device);
@@ -167,6 +199,10 @@ void Game::LoadAssetsAndCreateEntities()
 	meshes.push_back(cubeMesh);
 	meshes.push_back(coneMesh);
 
+	// Compare the vertex formats across all of the meshes
+	// (the cube stays in the full format, as SkyVS expects)
+	Mesh::ReportVertexMemory(meshes);
+
 	
 	// Declare the textures we'll need
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobbleA,  cobbleN,  cobbleR,  cobbleM;
@@ -292,6 +328,10 @@ void Game::LoadAssetsAndCreateEntities()
 	materials.push_back(roughMatPBR);
 	materials.push_back(woodMatPBR);
 
+	// Any material may be used with a compact mesh
+	for (auto m : materials)
+		m->SetCompactVS(vertexShaderCompact);
+
 
 
 	// === Create the PBR entities =====================================
@@ -328,6 +368,16 @@ void Game::LoadAssetsAndCreateEntities()
 	entities.push_back(roughSphere);
 	entities.push_back(woodSphere);
 
+	// Spheres hide what's behind them with the cube just inside them
+	// (a little under 1/sqrt(3) of the way out, as the mesh's flat
+	// faces cut inside the true sphere)
+	BoundsAABB sphereOccluder = sphereMesh->GetAABB();
+	sphereOccluder.Extents.x *= 0.55f;
+	sphereOccluder.Extents.y *= 0.55f;
+	sphereOccluder.Extents.z *= 0.55f;
+	for (auto ge : entities)
+		ge->SetOccluder(sphereOccluder);
+
 	// Set starting positions =====
 	// PBR entities
 	cobSpherePBR->GetTransform()->SetPosition(-6, 2, 0);
@@ -388,7 +438,7 @@ void Game::LoadAssetsAndCreateEntities()
 	//  we won't need to directly delete them as 
 	//  the original pointers will be cleaned up)
 	lightMesh = sphereMesh;
-	lightVS = vertexShader;
+	lightVS = sphereMesh->GetVertexFormat() == MESH_VERTEX_FORMAT_COMPACT ? vertexShaderCompact : vertexShader;
 	lightPS = solidColorPS;
 
 	// Create the renderer
@@ -478,6 +528,7 @@ void Game::OnResize()
 // --------------------------------------------------------
 void Game::Update(float deltaTime, float totalTime)
 {
+	TransformSystem::GetInstance().BeginFrame();
 	GUISetup(deltaTime);
 
 	// Update the camera
@@ -486,7 +537,125 @@ void Game::Update(float deltaTime, float totalTime)
 	// Check individual input
 	Input& input = Input::GetInstance();
 	if (input.KeyDown(VK_ESCAPE)) Quit();
-	if (input.KeyPress(VK_TAB)) GenerateLights();
+	if (input.KeyPress(VK_TAB))
+	{
+		// New lights can be undone like any other edit
+		editor->BeginTransaction();
+		for (int i = 0; i < (int)lights.size(); i++)
+			editor->RecordLight(i);
+		GenerateLights();
+		editor->EndTransaction();
+	}
+	if (input.KeyDown(VK_CONTROL) && input.KeyPress('Z')) editor->Undo();
+	if (input.KeyDown(VK_CONTROL) && input.KeyPress('Y')) editor->Redo();
+
+	// Right click selects the entity under the cursor (as of last
+	// frame, which is what's on screen)
+	if (input.MouseRightPress())
+	{
+		XMFLOAT3 origin, direction;
+		camera->GetPickRay(input.GetMouseX(), input.GetMouseY(), width, height, &origin, &direction);
+		unsigned int picked;
+		float distance;
+		if (entityTree.RayCast(origin, direction, GAME_PICK_DISTANCE, &picked, &distance))
+			editor->SelectEntity((int)picked);
+	}
+
+	CreateGUI();
+
+	// Everything has moved for this frame, so bring all the
+	// world matrices up to date at once (part way between the
+	// last two simulation steps)
+	TransformSystem::GetInstance().SetInterpolation(GetInterpolationAlpha());
+	TransformSystem::GetInstance().UpdateWorldMatrices();
+	UpdateEntityTree();
+}
+
+// --------------------------------------------------------
+// Puts every entity's world box in the tree, with its index
+// as the user data, and builds it in one go
+// --------------------------------------------------------
+void Game::BuildEntityTree()
+{
+	entityTree.Clear();
+	entityLeaves.clear();
+	entityTreeVersions.clear();
+	for (size_t i = 0; i < entities.size(); i++)
+	{
+		entityLeaves.push_back(entityTree.Insert(entities[i]->GetWorldAABB(), (unsigned int)i));
+		entityTreeVersions.push_back(entities[i]->GetTransform()->GetWorldVersion());
+	}
+	entityTree.Rebuild();
+}
+
+// --------------------------------------------------------
+// Adds (or removes) the stress scene's entities, each one a
+// copy of one of the scene's own.  With only a handful of
+// meshes and materials between them, they're mostly drawn
+// as a few large instanced draws.
+// --------------------------------------------------------
+void Game::SetStressScene(bool enabled)
+{
+	for (size_t i = sceneEntityCount; i < entities.size(); i++)
+		delete entities[i];
+	entities.resize(sceneEntityCount);
+
+	if (enabled && sceneEntityCount > 0)
+	{
+		for (unsigned int i = 0; i < GAME_STRESS_ENTITIES; i++)
+		{
+			GameEntity* source = entities[i % sceneEntityCount];
+			GameEntity* ge = new GameEntity(source->GetMesh(), source->GetMaterial());
+			if (source->HasOccluder())
+				ge->SetOccluder(source->GetOccluder());
+
+			unsigned int column = i % GAME_STRESS_COLUMNS;
+			unsigned int row = (i / GAME_STRESS_COLUMNS) % GAME_STRESS_ROWS;
+			unsigned int layer = i / (GAME_STRESS_COLUMNS * GAME_STRESS_ROWS);
+			ge->GetTransform()->SetPosition(
+				(column - GAME_STRESS_COLUMNS * 0.5f) * GAME_STRESS_SPACING,
+				(row - GAME_STRESS_ROWS * 0.5f) * GAME_STRESS_SPACING,
+				10.0f + layer * GAME_STRESS_SPACING);
+			entities.push_back(ge);
+		}
+	}
+
+	stressScene = enabled;
+	BuildEntityTree();
+}
+
+// --------------------------------------------------------
+// Moves the leaves of entities whose world matrices have
+// changed since the last update
+// --------------------------------------------------------
+void Game::UpdateEntityTree()
+{
+	for (size_t i = 0; i < entities.size(); i++)
+	{
+		unsigned int version = entities[i]->GetTransform()->GetWorldVersion();
+		if (version == entityTreeVersions[i])
+			continue;
+
+		entityTreeVersions[i] = version;
+		entityTree.Move(entityLeaves[i], entities[i]->GetWorldAABB());
+	}
+}
+
+// --------------------------------------------------------
+// Simulation - entity movement and animation, at a fixed
+// rate (see GAME_FIXED_TIMESTEP)
+// --------------------------------------------------------
+void Game::FixedUpdate(float stepTime, float totalTime)
+{
+	// Blended in over the frames until the next step
+	TransformSystem::GetInstance().BeginStep();
+
+	// Entities that move the same way are gathered up and
+	// moved with one bulk call
+	Transform* yawing[2];
+	Transform* rolling[1];
+	size_t yawingCount = 0;
+	size_t rollingCount = 0;
 
 	for (int e = 0; e < entities.size(); e++) {
 		switch (e)
@@ -495,11 +664,11 @@ void Game::Update(float deltaTime, float totalTime)
 		// with their child (the adjacent entity)
 		case 0:
 		case 6:
-			entities[e]->GetTransform()->Rotate(0.0f, sinf(deltaTime), 0.0f);
+			yawing[yawingCount++] = entities[e]->GetTransform();
 			break;
 		// The center PBR entity rotates with its 2 adjacent children entities
 		case 3:
-			entities[e]->GetTransform()->Rotate(0.0f, 0.0f, sinf(deltaTime));
+			rolling[rollingCount++] = entities[e]->GetTransform();
 			break;
 		// Each entity on the bottom row moves back and forth down and to the right
 		// Moving its child (the entity to the right) along with it
@@ -517,7 +686,10 @@ void Game::Update(float deltaTime, float totalTime)
 		}
 	}
 
-	CreateGUI();
+	Transform::Rotate(yawing, yawingCount, 0.0f, sinf(stepTime), 0.0f);
+	Transform::Rotate(rolling, rollingCount, 0.0f, 0.0f, sinf(stepTime));
+
+	TransformSystem::GetInstance().EndStep();
 }
 
 // --------------------------------------------------------
@@ -576,191 +748,146 @@ void Game::CreateGUI()
 	ImGui::Text("Aspect Ratio: %f", aspectRatio);
 	ImGui::Text("Number of Entities: %i", entities.size());
 	ImGui::Text("Number of Lights: %i", lightCount);
-	ImGui::End();
-
-	// Entities Window
-	ImGui::Begin("Elements");
-	int geIndex = 0;
-	if (ImGui::CollapsingHeader("Entities")) {
-		for (auto ge : entities) {
-			DisplayEntityInfo(ge, geIndex);
-			geIndex++;
-		}
-	}
-	if (ImGui::CollapsingHeader("Lights")) {
-		for (int i = 0; i < lightCount; i++) {
-			DisplayLightInfo(i);
-		}
-	}
-	ImGui::End();
-}
 
-void Game::DisplayEntityInfo(GameEntity* ge, int index)
-{
-	std::string iStr = std::to_string(index); 
-	std::string node = "Entity " + iStr; 
-	if (ImGui::TreeNode(node.c_str())) {
-		// Game Entity Position, Rotation, and Scale structure
-		// 
-		// "Header" name (Position, Rotation, or Scale)
-		// Get the current values from the ge
-		// Create the slider ID that is ge specific
-		// Create a float[4] for the slider using the current ge values
-		// Create the slider
-		// Set the new values of the ge
-		//
-
-		// Position
-		ImGui::Text("Position: ");
-		XMFLOAT3 gePos = ge->GetTransform()->GetPosition();
-		std::string gePosSliderName = "##GE" + iStr + "Pos";
-		float gePosSliderValues[4] = { gePos.x, gePos.y, gePos.z, 0.44f };
-		ImGui::SliderFloat3(gePosSliderName.c_str(), gePosSliderValues, -10.0f, 10.0f);
-		ge->GetTransform()->SetPosition(gePosSliderValues[0], gePosSliderValues[1], gePosSliderValues[2]);
-
-		// Rotation
-		ImGui::Text("Rotation: ");
-		XMFLOAT3 geRot = ge->GetTransform()->GetPitchYawRoll();
-		std::string geRotSliderName = "##GE" + iStr + "Rot";
-		float geRotSliderValues[4] = { geRot.x, geRot.y, geRot.z, 0.44f };
-		ImGui::SliderFloat3(geRotSliderName.c_str(), geRotSliderValues, -6.28, 6.28);
-		ge->GetTransform()->SetRotation(geRotSliderValues[0], geRotSliderValues[1], geRotSliderValues[2]);
-
-		// Scale
-		ImGui::Text("Scale: ");
-		XMFLOAT3 geScale = ge->GetTransform()->GetScale();
-		std::string geScaleSliderName = "##GE" + iStr + "Scale";
-		float geScaleSliderValues[4] = { geScale.x, geScale.y, geScale.z, 0.44f };
-		ImGui::SliderFloat3(geScaleSliderName.c_str(), geScaleSliderValues, 0.1, 5.0f);
-		ge->GetTransform()->SetScale(geScaleSliderValues[0], geScaleSliderValues[1], geScaleSliderValues[2]);
-		
-		// Children
-		std::string childCount = std::to_string(ge->GetTransform()->GetChildCount());
-		std::string childCountNode = childCount;
-		if(ge->GetTransform()->GetChildCount() != 1)
-			childCountNode += " children";
-		else
-			childCountNode += " child";
-		ImGui::Text(childCountNode.c_str());
-		ImGui::TreePop();
+	// Entity culling results from the last frame
+	bool frustumCulling = renderer->GetFrustumCulling();
+	if (ImGui::Checkbox("Frustum Culling", &frustumCulling))
+		renderer->SetFrustumCulling(frustumCulling);
+	FrustumCullStats frustumStats = renderer->GetFrustumCullStats();
+	ImGui::Text("Entities Drawn: %u / %u (%u culled)",
+		frustumStats.ObjectsVisible,
+		frustumStats.ObjectsTested,
+		frustumStats.ObjectsTested - frustumStats.ObjectsVisible);
+	if (ImGui::Button("Run Culling Benchmark"))
+		cullBenchmark = FrustumCuller::RunBenchmark();
+	if (cullBenchmark.ObjectCount > 0)
+	{
+		ImGui::Text("%u objects (%u visible): %.2f ms batched, %.2f ms one at a time",
+			cullBenchmark.ObjectCount,
+			cullBenchmark.VisibleCount,
+			cullBenchmark.BatchedMs,
+			cullBenchmark.PerObjectMs);
+		ImGui::Text("Differences: %u", cullBenchmark.Differences);
 	}
-}
 
-void Game::DisplayLightInfo(int index)
-{
-	std::string iStr = std::to_string(index);
-	std::string node = "Light " + iStr;
-	if (ImGui::TreeNode(node.c_str())) {
-		// Zero'd variables to (possibly) be used later in the switch statement
-		XMFLOAT3 lightDir = XMFLOAT3();
-		XMFLOAT3 lightPos = XMFLOAT3();
-		XMFLOAT3 newDir = XMFLOAT3();
-		XMFLOAT3 newPos = XMFLOAT3();
-		float range = 0.0f;
-
-		// Slider names & base values for position and direction
-		std::string lightDirSliderName = "##Light" + iStr + "Dir";
-		std::string lightPosSliderName = "##Light" + iStr + "Pos";
-		float lightDirSliderValues[4] = { 0.0f, 0.0f, 0.0f, 0.44f };
-		float lightPosSliderValues[4] = { 0.0f, 0.0f, 0.0f, 0.44f };
-		// Slider name & bounds for range
-		std::string lightRangeSliderName = "##Light" + iStr + "Range";
-		float f_five = 5.0f;
-		float f_ten = 10.0f;
-
-		// Light Color
-		XMFLOAT3 color = lights[index].Color;
-		std::string lightColorSliderName = "##Light" + iStr + "Color";
-		ImGui::ColorEdit4(lightColorSliderName.c_str(), &color.x);
-		lights[index].Color = color;
-
-		// Light Type
-		int lightType = lights[index].Type;
-
-		switch (lightType)
-		{
-		// Light Position or Direction or both structure
-		// 
-		// "Header" name (Position or Direction)
-		// Get the current values from the light
-		// Set new values for the float[4] for the slider using the light's (pos/dir) values
-		// Create the slider
-		// Set the values of the light
-		//
-		case 0:
-			ImGui::Text("Type: Directional");
-
-			// Direction
-			ImGui::Text("Direction: ");
-			lightDir = lights[index].Direction;
-			lightDirSliderValues[0] = lightDir.x;
-			lightDirSliderValues[1] = lightDir.y;
-			lightDirSliderValues[2] = lightDir.z;
-			ImGui::SliderFloat3(lightDirSliderName.c_str(), lightDirSliderValues, -1.0f, 1.0f);
-			newDir = XMFLOAT3(lightDirSliderValues[0], lightDirSliderValues[1], lightDirSliderValues[2]);
-			lights[index].Direction = newDir;
+	// Entity tree (its benchmark is in the headless driver)
+	ImGui::Text("Entity Tree: %u leaves, height %d", entityTree.GetLeafCount(), entityTree.GetHeight());
 
-			break;
-		case 1:
-			ImGui::Text("Type: Point");
-
-			// Position
-			ImGui::Text("Position: ");
-			lightPos = lights[index].Position;
-			lightPosSliderValues[0] = lightPos.x;
-			lightPosSliderValues[1] = lightPos.y;
-			lightPosSliderValues[2] = lightPos.z;
-			ImGui::SliderFloat3(lightPosSliderName.c_str(), lightPosSliderValues, -10.0f, 10.0f);
-			newPos = XMFLOAT3(lightPosSliderValues[0], lightPosSliderValues[1], lightPosSliderValues[2]);
-			lights[index].Position = newPos;
-
-			// Range
-			ImGui::Text("Range: ");
-			range = lights[index].Range;
-
-			// Slider creation
-			ImGui::SliderScalar(lightRangeSliderName.c_str(), ImGuiDataType_Float, &range, &f_five, &f_ten);
-			lights[index].Range = range;
-
-			break;
-		case 2:
-			ImGui::Text("Type: Spot");
-
-			// Direction
-			ImGui::Text("Direction: ");
-			lightDir = lights[index].Direction;
-			lightDirSliderValues[0] = lightDir.x;
-			lightDirSliderValues[1] = lightDir.y;
-			lightDirSliderValues[2] = lightDir.z;
-			ImGui::SliderFloat3(lightDirSliderName.c_str(), lightDirSliderValues, -1.0f, 1.0f);
-			newDir = XMFLOAT3(lightDirSliderValues[0], lightDirSliderValues[1], lightDirSliderValues[2]);
-			lights[index].Direction = newDir;
-
-			// Position
-			ImGui::Text("Position: ");
-			lightPos = lights[index].Position;
-			lightPosSliderValues[0] = lightPos.x;
-			lightPosSliderValues[1] = lightPos.y;
-			lightPosSliderValues[2] = lightPos.z;
-			ImGui::SliderFloat3(lightPosSliderName.c_str(), lightPosSliderValues, -10.0f, 10.0f);
-			newPos = XMFLOAT3(lightPosSliderValues[0], lightPosSliderValues[1], lightPosSliderValues[2]);
-			lights[index].Position = newPos;
-			break;
-		}
-		
-		// Intensity
-		ImGui::Text("Intensity: ");
-		float intensity = lights[index].Intensity;
-
-		// Slider Name & Bounds
-		std::string lightIntensitySliderName = "##Light" + iStr + "Intensity";
-		float f_tenth = 0.1f;
-		float f_three = 3.0f;
+	// Occlusion culling results from the last frame
+	bool occlusionCulling = renderer->GetOcclusionCulling();
+	if (ImGui::Checkbox("Occlusion Culling", &occlusionCulling))
+		renderer->SetOcclusionCulling(occlusionCulling);
+	if (occlusionCulling)
+	{
+		OcclusionStats occlusionStats = renderer->GetOcclusionStats();
+		ImGui::Text("Occluded: %u / %u (%u occluders, %u triangles)",
+			occlusionStats.ObjectsOccluded,
+			occlusionStats.ObjectsTested,
+			occlusionStats.OccludersDrawn,
+			occlusionStats.TrianglesDrawn);
+		if (ImGui::Button("Save Occlusion Depth"))
+			renderer->SaveOcclusionDepth("OcclusionDepth.pgm");
+	}
+	if (ImGui::Button("Run Occlusion Benchmark"))
+		occlusionBenchmark = OcclusionCuller::RunBenchmark();
+	if (occlusionBenchmark.Frames > 0)
+	{
+		ImGui::Text("%u frames, %u objects, %u occluders a frame",
+			occlusionBenchmark.Frames,
+			occlusionBenchmark.ObjectCount,
+			occlusionBenchmark.OccluderCount);
+		ImGui::Text("Per frame: %.3f ms drawing (%.1f M triangles/s), %.3f ms hierarchy, %.3f ms testing",
+			occlusionBenchmark.RasterizeMs,
+			occlusionBenchmark.TrianglesPerSecond / 1000000.0,
+			occlusionBenchmark.HierarchyMs,
+			occlusionBenchmark.TestMs);
+		ImGui::Text("Occluded: %.1f%% of objects in view (%u differences)",
+			occlusionBenchmark.CullRate * 100.0,
+			occlusionBenchmark.Differences);
+	}
 
-		// Slider creation
-		ImGui::SliderScalar(lightIntensitySliderName.c_str(), ImGuiDataType_Float, &intensity, &f_tenth, &f_three);
-		lights[index].Intensity = intensity;
+	// Meshlet culling results from the last frame
+	bool meshletCulling = Mesh::GetMeshletCulling();
+	if (ImGui::Checkbox("Meshlet Culling", &meshletCulling))
+		Mesh::SetMeshletCulling(meshletCulling);
+	MeshletCullStats cullStats = Mesh::GetCullStats();
+	ImGui::Text("Meshlets Culled: %u / %u", cullStats.MeshletsCulled, cullStats.MeshletsTested);
+	ImGui::Text("Triangles Culled: %u / %u", cullStats.TrianglesCulled, cullStats.TrianglesTested);
+
+	// State changes from the last frame drawn sorted and unsorted
+	bool stress = stressScene;
+	if (ImGui::Checkbox("Stress Scene", &stress))
+		SetStressScene(stress);
+	bool sortedDraws = renderer->GetSortedDraws();
+	if (ImGui::Checkbox("Sorted Draws", &sortedDraws))
+		renderer->SetSortedDraws(sortedDraws);
+	bool instancing = renderer->GetInstancing();
+	if (ImGui::Checkbox("Instancing", &instancing))
+		renderer->SetInstancing(instancing);
+	RenderStateStats drawStats[3] = { renderer->GetSortedDrawStats(), renderer->GetUnsortedDrawStats(), renderer->GetLightDrawStats() };
+	const char* drawNames[3] = { "Sorted", "Unsorted", "Lights" };
+	for (int i = 0; i < 3; i++)
+	{
+		ImGui::Text("%s: %u draws (%u instances), %u shader binds, %u SRV binds, %u sampler binds, %u buffer uploads",
+			drawNames[i],
+			drawStats[i].Draws,
+			drawStats[i].Instances,
+			drawStats[i].ShaderBinds,
+			drawStats[i].SRVBinds,
+			drawStats[i].SamplerBinds,
+			drawStats[i].CBufferUploads);
+	}
 
-		ImGui::TreePop();
+	// Batched world matrices against the old per-transform path
+	TransformStats transformStats = TransformSystem::GetInstance().GetFrameStats();
+	bool fixedTimestep = GetFixedTimestep() > 0.0f;
+	if (ImGui::Checkbox("Fixed Timestep", &fixedTimestep))
+		SetFixedTimestep(fixedTimestep ? GAME_FIXED_TIMESTEP : 0.0f);
+	ImGui::Text("Simulation Steps: %u (%.2f of the way to the next)", GetStepsThisFrame(), GetInterpolationAlpha());
+	ImGui::Text("Transforms: %u", TransformSystem::GetInstance().GetCount());
+	ImGui::Text("World Matrices Computed: %u (%u more than once)",
+		transformStats.WorldMatricesComputed,
+		transformStats.ComputedMoreThanOnce);
+	ObjectUploadStats uploadStats = renderer->GetObjectUploadStats();
+	ImGui::Text("Matrix Upload: %u bytes (%u objects in %u spans)",
+		uploadStats.BytesUploaded,
+		uploadStats.ObjectsUploaded,
+		uploadStats.SpansUploaded);
+	if (ImGui::Button("Run Transform Benchmark"))
+		transformBenchmark = TransformSystem::RunBenchmark();
+	if (transformBenchmark.NodeCount > 0)
+	{
+		ImGui::Text("%u nodes: %.2f ms batched, %.2f ms walking up through parents",
+			transformBenchmark.NodeCount,
+			transformBenchmark.BatchedMs,
+			transformBenchmark.ParentWalkMs);
+		ImGui::Text("First %u nodes: %.2f ms through the original Transform class",
+			transformBenchmark.OriginalNodeCount,
+			transformBenchmark.OriginalMs);
+		ImGui::Text("Largest difference: %g", transformBenchmark.MaxDifference);
+	}
+	if (ImGui::Button("Run Thread Scaling Benchmark"))
+		transformScaling = TransformSystem::RunScalingBenchmark();
+	for (auto& s : transformScaling)
+	{
+		ImGui::Text("%u threads: %.3f ms%s",
+			s.ThreadCount,
+			s.Ms,
+			s.MatchesOneThread ? "" : " (differs from 1 thread!)");
 	}
+	if (ImGui::Button("Run Bulk Edit Benchmark"))
+		transformBulkBenchmark = TransformSystem::RunBulkBenchmark();
+	if (transformBulkBenchmark.NodeCount > 0)
+	{
+		ImGui::Text("%u nodes, per node / bulk / bulk on %u threads:",
+			transformBulkBenchmark.NodeCount,
+			transformBulkBenchmark.ThreadCount);
+		for (auto& e : transformBulkBenchmark.Edits)
+			ImGui::Text("%s: %.2f / %.2f / %.2f ms", e.Name, e.PerNodeMs, e.BulkMs, e.ThreadedMs);
+		ImGui::Text("Largest difference: %g", transformBulkBenchmark.MaxDifference);
+	}
+	ImGui::End();
+
+	// Entities and lights
+	editor->Draw(entities);
 }
\ No newline at end of file
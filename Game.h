@@ -14,6 +14,22 @@
 #include "Lights.h"
 #include "Sky.h"
 #include "Renderer.h"
+#include "Editor.h"
+#include "DynamicBVH.h"
+
+// Length of each simulation step (entities move at this rate however
+// fast frames are drawn, and are drawn part way between steps)
+#define GAME_FIXED_TIMESTEP (1.0f / 60.0f)
+
+// Furthest away an entity can be picked with the mouse (the far plane)
+#define GAME_PICK_DISTANCE 100.0f
+
+// The stress scene: copies of the scene's entities, in layers
+// of rows and columns behind it
+#define GAME_STRESS_ENTITIES 50000
+#define GAME_STRESS_COLUMNS 100
+#define GAME_STRESS_ROWS 50
+#define GAME_STRESS_SPACING 2.5f
 
 class Game 
 	: public DXCore
@@ -28,6 +44,7 @@ public:
 	void Init();
 	void OnResize();
 	void Update(float deltaTime, float totalTime);
+	void FixedUpdate(float stepTime, float totalTime);
 	void Draw(float deltaTime, float totalTime);
 
 private:
@@ -47,6 +64,26 @@ private:
 	std::vector<ISimpleShader*> shaders;
 	Camera* camera;
 	Renderer* renderer;
+	Editor* editor;
+
+	// Entities past the scene's own are the stress scene's
+	size_t sceneEntityCount;
+	bool stressScene;
+
+	// Entity bounds, for picking and range queries.  Leaves are moved
+	// when their entity's world version changes.
+	DynamicBVH entityTree;
+	std::vector<int> entityLeaves;
+	std::vector<unsigned int> entityTreeVersions;
+
+	// Last runs of the transform benchmarks (from the stats window)
+	TransformBenchmark transformBenchmark;
+	std::vector<TransformScaling> transformScaling;
+	TransformBulkBenchmark transformBulkBenchmark;
+
+	// Last run of the culling benchmark
+	FrustumCullBenchmark cullBenchmark;
+	OcclusionBenchmark occlusionBenchmark;
 
 	// Lights
 	std::vector<Light> lights;
@@ -71,12 +108,13 @@ private:
 
 	// General helpers for setup and drawing
 	void GenerateLights();
+	void BuildEntityTree();
+	void UpdateEntityTree();
+	void SetStressScene(bool enabled);
 
 	// Initialization helper method
 	void LoadAssetsAndCreateEntities();
 	void GUISetup(float deltaTime);
 	void CreateGUI();
-	void DisplayEntityInfo(GameEntity* ge, int index);
-	void DisplayLightInfo(int index);
 };
 
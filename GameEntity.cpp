@@ -7,18 +7,85 @@ GameEntity::GameEntity(Mesh* mesh, Material* material)
 	// Save the data
 	this->mesh = mesh;
 	this->material = material;
+	this->lod = 0;
+	this->boundsValid = false;
+	this->occluder = {};
+	this->hasOccluder = false;
 }
 
 Mesh* GameEntity::GetMesh() { return mesh; }
 Material* GameEntity::GetMaterial() { return material; }
 Transform* GameEntity::GetTransform() { return &transform; }
 
+void GameEntity::SetLOD(unsigned int lod)
+{
+	// Levels the mesh doesn't have are clamped when drawing
+	this->lod = lod;
+}
+
+unsigned int GameEntity::GetLOD() { return lod; }
+
+void GameEntity::SetOccluder(const BoundsAABB& box)
+{
+	occluder = box;
+	hasOccluder = true;
+}
+
+bool GameEntity::HasOccluder() { return hasOccluder; }
+const BoundsAABB& GameEntity::GetOccluder() { return occluder; }
+
+const BoundsAABB& GameEntity::GetWorldAABB()
+{
+	UpdateWorldBounds();
+	return worldAABB;
+}
+
+const BoundsSphere& GameEntity::GetWorldSphere()
+{
+	UpdateWorldBounds();
+	return worldSphere;
+}
+
+void GameEntity::UpdateWorldBounds()
+{
+	// Nothing to do if the transform hasn't moved
+	unsigned int version = transform.GetWorldVersion();
+	if (boundsValid && version == boundsVersion)
+		return;
+
+	boundsVersion = version;
+	boundsValid = true;
+	XMFLOAT4X4 world = transform.GetWorldMatrix();
+	XMMATRIX worldMat = XMLoadFloat4x4(&world);
+
+	// Both boxes contain the mesh, so their overlap does too
+	BoundsAABB fromAABB = BoundsBuilder::TransformAABB(mesh->GetAABB(), worldMat);
+	BoundsAABB fromOBB = BoundsBuilder::TransformOBBToAABB(mesh->GetOBB(), worldMat);
+	XMVECTOR centerA = XMLoadFloat3(&fromAABB.Center);
+	XMVECTOR extentsA = XMLoadFloat3(&fromAABB.Extents);
+	XMVECTOR centerB = XMLoadFloat3(&fromOBB.Center);
+	XMVECTOR extentsB = XMLoadFloat3(&fromOBB.Extents);
+	XMVECTOR boundsMin = XMVectorMax(centerA - extentsA, centerB - extentsB);
+	XMVECTOR boundsMax = XMVectorMin(centerA + extentsA, centerB + extentsB);
+	XMStoreFloat3(&worldAABB.Center, (boundsMin + boundsMax) * 0.5f);
+	XMStoreFloat3(&worldAABB.Extents, (boundsMax - boundsMin) * 0.5f);
+
+	worldSphere = BoundsBuilder::TransformSphere(mesh->GetSphere(), worldMat);
+}
+
 
-void GameEntity::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, Camera* camera)
+void GameEntity::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, Camera* camera, RenderStateStats* stats)
 {
 	// Tell the material to prepare for a draw
-	material->PrepareMaterial(&transform, camera);
+	// (the caller has bound the instance stream at this entity's slot)
+	material->PrepareMaterial(camera, mesh, stats);
 
-	// Draw the mesh
-	mesh->SetBuffersAndDraw(context);
+	// Draw whatever parts of the mesh the camera can see, which can
+	// take a draw per run of visible meshlets (or none at all)
+	unsigned int draws = mesh->SetBuffersAndDrawVisible(context, transform.GetWorldMatrix(), camera->GetView(), camera->GetProjection(), lod);
+	if (stats)
+	{
+		stats->Draws += draws;
+		stats->Instances++;
+	}
 }
@@ -17,12 +17,39 @@ public:
 	Material* GetMaterial();
 	Transform* GetTransform();
 
-	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, Camera* camera);
+	// Which of the mesh's levels of detail to draw (0 is the full mesh)
+	void SetLOD(unsigned int lod);
+	unsigned int GetLOD();
+
+	// The mesh's bounds in world space, recomputed only when
+	// the transform has changed since the last call
+	const BoundsAABB& GetWorldAABB();
+	const BoundsSphere& GetWorldSphere();
+
+	// An object space box inside the mesh, which can hide other
+	// entities when drawn into the occlusion buffer
+	void SetOccluder(const BoundsAABB& box);
+	bool HasOccluder();
+	const BoundsAABB& GetOccluder();
+
+	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, Camera* camera, RenderStateStats* stats = 0);
 
 private:
 
 	Mesh* mesh;
 	Material* material;
 	Transform transform;
+	unsigned int lod;
+
+	// World space bounds, and the world version they were made from
+	unsigned int boundsVersion;
+	BoundsAABB worldAABB;
+	BoundsSphere worldSphere;
+	bool boundsValid;
+
+	BoundsAABB occluder;
+	bool hasOccluder;
+
+	void UpdateWorldBounds();
 };
 
@@ -0,0 +1,372 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "Bounds.h"
+#include "CompactVertex.h"
+#include "DynamicBVH.h"
+#include "FrustumCuller.h"
+#include "MeshBaker.h"
+#include "Meshlet.h"
+#include "MeshTangents.h"
+#include "ObjLoader.h"
+#include "OcclusionCuller.h"
+
+// --------------------------------------------------------
+// Console entry point for the parts of the engine that need
+// no window or device: asset processing, culling and the
+// like, so they can be benchmarked and checked headless.
+//
+// Built by DX11Headless.vcxproj on Windows.  Everything it
+// compiles is plain C++17 plus DirectXMath, so on Linux it
+// builds with the header-only DirectXMath (and its sal.h):
+//  g++ -std=c++17 -O2 -pthread -I<DirectXMath>/Inc -I<sal.h dir>
+//      <the .cpp files in DX11Headless.vcxproj> -o headless
+//
+// Each mode prints its results and returns non-zero if any
+// of its checks failed.
+// --------------------------------------------------------
+
+// Bytes in a megabyte, for sizes given on the command line
+#define HEADLESS_MEGABYTE (1024ull * 1024ull)
+
+// --------------------------------------------------------
+// "-objgen file.obj megabytes": writes a synthetic OBJ file
+// --------------------------------------------------------
+static int RunObjGen(int argc, char* argv[])
+{
+	if (argc < 4)
+		return 1;
+
+	unsigned long long bytes = strtoull(argv[3], 0, 10) * HEADLESS_MEGABYTE;
+	if (!ObjLoader::WriteSynthetic(argv[2], bytes))
+	{
+		printf("%s: couldn't be written\n", argv[2]);
+		return 1;
+	}
+	printf("%s: written\n", argv[2]);
+	return 0;
+}
+
+// --------------------------------------------------------
+// "-objbench a.obj b.obj ...": times the OBJ parser against
+// the original loop and checks they agree
+// --------------------------------------------------------
+static int RunObjBench(int argc, char* argv[])
+{
+	int failures = 0;
+	for (int i = 2; i < argc; i++)
+	{
+		ObjBenchmark b = ObjLoader::RunBenchmark(argv[i]);
+		printf("%s: %zu bytes, %zu triangles: %.1f ms reference, %.1f ms on 1 thread, %.1f ms on %u threads, %s\n",
+			argv[i],
+			b.FileBytes,
+			b.Triangles,
+			b.ReferenceMs,
+			b.SingleThreadMs,
+			b.ParseMs,
+			b.ThreadCount,
+			b.Identical ? "identical" : "DIFFERENT");
+		if (b.FileBytes == 0 || !b.Identical)
+			failures++;
+	}
+	return failures;
+}
+
+// --------------------------------------------------------
+// "-tangentbench": times the tangent calculation against
+// the original loop and checks they agree
+// --------------------------------------------------------
+static int RunTangentBench(int argc, char* argv[])
+{
+	TangentBenchmark b = MeshTangents::RunBenchmark();
+	printf("%u triangles: %.1f ms reference, %.1f ms on 1 thread, %.1f ms on %u threads, largest difference %g, %s\n",
+		b.TriangleCount,
+		b.ReferenceMs,
+		b.SingleThreadMs,
+		b.ParallelMs,
+		b.ThreadCount,
+		b.MaxDifference,
+		b.Matches ? "matches" : "DIFFERENT");
+	return b.Matches ? 0 : 1;
+}
+
+// --------------------------------------------------------
+// "-bake a.obj b.obj ...": bakes each OBJ file to a .meshbin
+// --------------------------------------------------------
+static int RunBake(int argc, char* argv[])
+{
+	int failures = 0;
+	for (int i = 2; i < argc; i++)
+	{
+		bool baked = MeshBaker::Bake(argv[i]);
+		printf("%s: %s\n", argv[i], baked ? "baked" : "FAILED");
+		if (!baked)
+			failures++;
+	}
+	return failures;
+}
+
+// --------------------------------------------------------
+// "-loadbench a.obj b.obj ...": times loading each mesh from
+// its OBJ file and from its .meshbin, cold and warm
+// --------------------------------------------------------
+static int RunLoadBench(int argc, char* argv[])
+{
+	int failures = 0;
+	for (int i = 2; i < argc; i++)
+	{
+		MeshLoadBenchmark b = MeshBaker::RunLoadBenchmark(argv[i]);
+		printf("%s: OBJ (%llu bytes) %.2f ms cold, %.2f ms warm; .meshbin (%llu bytes) %.2f ms cold, %.2f ms warm, %s\n",
+			argv[i],
+			b.SourceBytes,
+			b.ObjColdMs,
+			b.ObjWarmMs,
+			b.BakedBytes,
+			b.BakedColdMs,
+			b.BakedWarmMs,
+			b.Identical ? "identical" : "DIFFERENT");
+		if (b.SourceBytes == 0 || !b.Identical)
+			failures++;
+	}
+	return failures;
+}
+
+// --------------------------------------------------------
+// "-cullbench [objects]": culls a synthetic scene, four
+// objects at a time and one at a time, and checks they agree
+// --------------------------------------------------------
+static int RunCullBench(int argc, char* argv[])
+{
+	unsigned int objectCount = argc > 2 ? (unsigned int)strtoul(argv[2], 0, 10) : FRUSTUM_CULL_BENCHMARK_OBJECTS;
+	FrustumCullBenchmark b = FrustumCuller::RunBenchmark(objectCount);
+	printf("%u objects: %u visible, %u culled: %.2f ms batched, %.2f ms one at a time, %u differences\n",
+		b.ObjectCount,
+		b.VisibleCount,
+		b.ObjectCount - b.VisibleCount,
+		b.BatchedMs,
+		b.PerObjectMs,
+		b.Differences);
+	return b.Differences == 0 ? 0 : 1;
+}
+
+// --------------------------------------------------------
+// "-bvhbench": times building, moving and querying entity
+// trees of 10k, 100k and 1M objects, checking every query
+// against brute force
+// --------------------------------------------------------
+static int RunBVHBench(int argc, char* argv[])
+{
+	int failures = 0;
+	for (const BVHBenchmark& b : DynamicBVH::RunBenchmark())
+	{
+		printf("%u objects: %.1f ms inserting, %.1f ms rebuilding, %.2f ms moving 1%%\n",
+			b.ObjectCount,
+			b.InsertMs,
+			b.RebuildMs,
+			b.MoveMs);
+		printf("  Frustum: %.2f ms (%.2f ms brute force)\n", b.FrustumMs, b.BruteFrustumMs);
+		printf("  Ray: %.2f ms (%.2f ms brute force)\n", b.RayMs, b.BruteRayMs);
+		printf("  Sphere: %.2f ms (%.2f ms brute force)\n", b.SphereMs, b.BruteSphereMs);
+		printf("  Results %s\n", b.Matches ? "match" : "DIFFER");
+		if (!b.Matches)
+			failures++;
+	}
+	return failures;
+}
+
+// --------------------------------------------------------
+// "-meshletbench a.obj ...": times building each mesh's
+// meshlets and how much culling them removes along each
+// camera path
+// --------------------------------------------------------
+static int RunMeshletBench(int argc, char* argv[])
+{
+	const char* pathNames[MESHLET_PATH_COUNT] = { "orbit", "close", "flyby" };
+
+	int failures = 0;
+	for (int i = 2; i < argc; i++)
+	{
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		std::vector<Meshlet> meshlets;
+		std::vector<MeshLod> lods;
+		unsigned long long sourceHash = 0;
+		unsigned long long sourceSize = 0;
+		if (!MeshBaker::LoadObj(argv[i], 0.0f, verts, indices, meshlets, lods, sourceHash, sourceSize))
+		{
+			printf("%s: couldn't be loaded\n", argv[i]);
+			failures++;
+			continue;
+		}
+
+		// Just the full detail mesh, not its levels of detail
+		size_t indexCount = lods.empty() ? indices.size() : lods[0].IndexCount;
+		MeshletBenchmark b = MeshletBuilder::RunBenchmark(verts.data(), verts.size(), indices.data(), indexCount);
+		printf("%s: %u triangles, %u meshlets: %.2f ms to build\n",
+			argv[i],
+			b.TriangleCount,
+			b.MeshletCount,
+			b.BuildMs);
+		for (int path = 0; path < MESHLET_PATH_COUNT; path++)
+			printf("  %-5s: %.1f%% of triangles culled, %.3f ms\n", pathNames[path], b.TrianglesCulled[path] * 100.0f, b.CullMs[path]);
+	}
+	return failures;
+}
+
+// --------------------------------------------------------
+// "-occlusionbench": flies the occlusion benchmark's path,
+// checking hierarchical tests against full resolution ones
+// --------------------------------------------------------
+static int RunOcclusionBench(int argc, char* argv[])
+{
+	OcclusionBenchmark b = OcclusionCuller::RunBenchmark();
+	printf("%u frames, %u objects, %u occluders: %.0f triangles/s, %.3f ms rasterize, %.3f ms hierarchy, %.3f ms test, %.1f%% culled, %u differences\n",
+		b.Frames,
+		b.ObjectCount,
+		b.OccluderCount,
+		b.TrianglesPerSecond,
+		b.RasterizeMs,
+		b.HierarchyMs,
+		b.TestMs,
+		b.CullRate * 100.0,
+		b.Differences);
+	return b.Differences == 0 ? 0 : 1;
+}
+
+// --------------------------------------------------------
+// "-occlusioncheck [directory]" compares the occlusion depth
+// buffer at fixed poses against the reference images, and
+// "-occlusionsave [directory]" writes new ones
+// --------------------------------------------------------
+static int RunOcclusionCheck(int argc, char* argv[], bool save)
+{
+	const char* directory = argc > 2 ? argv[2] : "Assets/Reference";
+	int failures = 0;
+	for (const OcclusionReference& r : OcclusionCuller::CheckReferenceImages(directory, save))
+	{
+		if (save)
+			printf("%s/occlusion_%u.pgm: %s\n", directory, r.Frame, r.Found ? "saved" : "FAILED");
+		else if (!r.Found)
+			printf("%s/occlusion_%u.pgm: MISSING\n", directory, r.Frame);
+		else
+			printf("%s/occlusion_%u.pgm: %u pixels different, %s\n", directory, r.Frame, r.PixelsDifferent, r.Matches ? "matches" : "MISMATCH");
+		if (save ? !r.Found : !r.Matches)
+			failures++;
+	}
+	return failures;
+}
+
+// --------------------------------------------------------
+// "-selftest [a.obj b.obj ...]": checks the compact vertex
+// encoding and bounding volumes against fixed cases, then
+// against each mesh
+// --------------------------------------------------------
+static void PrintCompactVertexError(const char* name, const CompactVertexError& e, const char* verdict)
+{
+	printf("%s: %u vertices, compact round trip within %.3f steps, %.4f / %.4f degrees, %g of the UV, %s\n",
+		name,
+		e.VertexCount,
+		e.PositionSteps,
+		e.NormalDegrees,
+		e.TangentDegrees,
+		e.UVRelative,
+		verdict);
+}
+
+static int RunSelfTest(int argc, char* argv[])
+{
+	int failures = 0;
+	for (const CompactVertexTest& t : CompactVertexCodec::RunSelfTest())
+	{
+		const char* verdict = t.Error.WithinBounds ? "within bounds" : "out of bounds";
+		char line[64];
+		snprintf(line, sizeof(line), "%s (%s)", verdict, t.Passed ? "as expected" : "UNEXPECTED");
+		PrintCompactVertexError(t.Name, t.Error, line);
+		if (!t.Passed)
+			failures++;
+	}
+
+	for (const BoundsTest& t : BoundsBuilder::RunSelfTest())
+	{
+		printf("%s: %u vertices outside their world bounds\n", t.Name, t.Outside);
+		if (t.Outside > 0)
+			failures++;
+	}
+
+	for (int i = 2; i < argc; i++)
+	{
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		std::vector<Meshlet> meshlets;
+		std::vector<MeshLod> lods;
+		unsigned long long sourceHash = 0;
+		unsigned long long sourceSize = 0;
+		if (!MeshBaker::LoadObj(argv[i], 0.0f, verts, indices, meshlets, lods, sourceHash, sourceSize))
+		{
+			printf("%s: couldn't be loaded\n", argv[i]);
+			failures++;
+			continue;
+		}
+
+		CompactVertexError e = CompactVertexCodec::MeasureError(verts.data(), (int)verts.size());
+		PrintCompactVertexError(argv[i], e, e.WithinBounds ? "within bounds" : "OUT OF BOUNDS");
+		if (!e.WithinBounds)
+			failures++;
+
+		unsigned int outside = BoundsBuilder::CountOutsideWorldBounds(
+			verts.data(),
+			verts.size(),
+			BoundsBuilder::ComputeAABB(verts.data(), verts.size()),
+			BoundsBuilder::ComputeSphere(verts.data(), verts.size()),
+			BoundsBuilder::ComputeOBB(verts.data(), verts.size()));
+		printf("%s: %u vertices outside their world bounds\n", argv[i], outside);
+		if (outside > 0)
+			failures++;
+	}
+	return failures;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && strcmp(argv[1], "-objgen") == 0)
+		return RunObjGen(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "-objbench") == 0)
+		return RunObjBench(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "-tangentbench") == 0)
+		return RunTangentBench(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "-bake") == 0)
+		return RunBake(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "-loadbench") == 0)
+		return RunLoadBench(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "-cullbench") == 0)
+		return RunCullBench(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "-selftest") == 0)
+		return RunSelfTest(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "-bvhbench") == 0)
+		return RunBVHBench(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "-meshletbench") == 0)
+		return RunMeshletBench(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "-occlusionbench") == 0)
+		return RunOcclusionBench(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "-occlusioncheck") == 0)
+		return RunOcclusionCheck(argc, argv, false);
+	if (argc > 1 && strcmp(argv[1], "-occlusionsave") == 0)
+		return RunOcclusionCheck(argc, argv, true);
+
+	printf("Usage:\n");
+	printf("  -objgen file.obj megabytes   Writes a synthetic OBJ file\n");
+	printf("  -objbench a.obj b.obj ...    Times the OBJ parser against the original loop\n");
+	printf("  -tangentbench                Times tangent generation against the original loop\n");
+	printf("  -bake a.obj b.obj ...        Bakes each OBJ file to a .meshbin\n");
+	printf("  -loadbench a.obj b.obj ...   Times OBJ against .meshbin loads, cold and warm\n");
+	printf("  -cullbench [objects]         Frustum culls a synthetic scene (1M objects by default)\n");
+	printf("  -selftest [a.obj ...]        Checks compact vertices and bounds on fixed cases, then on each mesh\n");
+	printf("  -bvhbench                    Times entity trees of 10k, 100k and 1M objects against brute force\n");
+	printf("  -meshletbench a.obj ...      Times meshlet building and culling along camera paths\n");
+	printf("  -occlusionbench              Occlusion culls along a fixed camera path\n");
+	printf("  -occlusioncheck [directory]  Compares occlusion depth against reference images (Assets/Reference)\n");
+	printf("  -occlusionsave [directory]   Writes new occlusion reference images\n");
+	return 1;
+}
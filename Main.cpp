@@ -3,7 +3,25 @@
 #define SIMPLE_SHADER_REPORT_WARNINGS
 
 #include <Windows.h>
+#include <string.h>
+#include <stdio.h>
 #include "Game.h"
+#include "MeshBaker.h"
+
+// --------------------------------------------------------
+// A Windows (non-console) application has nowhere for printf
+// to go, so command line modes borrow the console they were
+// started from, if there is one
+// --------------------------------------------------------
+static void AttachParentConsole()
+{
+	if (!AttachConsole(ATTACH_PARENT_PROCESS))
+		return;
+
+	FILE* stream;
+	freopen_s(&stream, "CONOUT$", "w", stdout);
+	freopen_s(&stream, "CONOUT$", "w", stderr);
+}
 
 // --------------------------------------------------------
 // Entry point for a graphical (non-console) Windows application
@@ -21,6 +39,21 @@ int WINAPI WinMain(
 	_CrtSetDbgFlag( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF );
 #endif
 
+	// Bake mode: "DX11Starter.exe -bake a.obj b.obj ..." converts each
+	// OBJ file to a .meshbin next to it and exits without a window.
+	// Benchmarks and other headless modes live in DX11Headless
+	if (__argc > 1 && strcmp(__argv[1], "-bake") == 0)
+	{
+		AttachParentConsole();
+		int failures = 0;
+		for (int i = 2; i < __argc; i++)
+		{
+			if (!MeshBaker::Bake(__argv[i]))
+				failures++;
+		}
+		return failures;
+	}
+
 	// Create the Game object using
 	// the app handle we got from WinMain
 	Game dxGame(hInstance);
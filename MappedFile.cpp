@@ -0,0 +1,91 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const char* path)
+{
+	valid = false;
+	data = 0;
+	size = 0;
+	fileHandle = 0;
+	mappingHandle = 0;
+	fileDescriptor = -1;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(
+		path,
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		0,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		0);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	fileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize))
+		return;
+	size = (size_t)fileSize.QuadPart;
+
+	// Empty files can't be mapped, but they're still valid files
+	if (size == 0)
+	{
+		valid = true;
+		return;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (mapping == 0)
+		return;
+	mappingHandle = mapping;
+
+	data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	valid = (data != 0);
+#else
+	fileDescriptor = open(path, O_RDONLY);
+	if (fileDescriptor < 0)
+		return;
+
+	struct stat info;
+	if (fstat(fileDescriptor, &info) != 0)
+		return;
+	size = (size_t)info.st_size;
+
+	// Empty files can't be mapped, but they're still valid files
+	if (size == 0)
+	{
+		valid = true;
+		return;
+	}
+
+	void* view = mmap(0, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (view == MAP_FAILED)
+		return;
+
+	// We'll be reading front to back
+	madvise(view, size, MADV_SEQUENTIAL);
+	data = (const char*)view;
+	valid = true;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mappingHandle) CloseHandle((HANDLE)mappingHandle);
+	if (fileHandle) CloseHandle((HANDLE)fileHandle);
+#else
+	if (data) munmap((void*)data, size);
+	if (fileDescriptor >= 0) close(fileDescriptor);
+#endif
+}
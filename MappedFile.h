@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+
+// --------------------------------------------------------
+// A read-only, memory-mapped view of an entire file
+//
+// The OS pages the file in on demand, so large assets can
+// be parsed in place without copying them into a buffer.
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile(const char* path);
+	~MappedFile();
+
+	// Mapped views own OS handles, so they can't be copied
+	MappedFile(MappedFile const&) = delete;
+	void operator=(MappedFile const&) = delete;
+
+	bool IsValid() { return valid; }
+	const char* GetData() { return data; }
+	size_t GetSize() { return size; }
+
+private:
+	bool valid;
+	const char* data;
+	size_t size;
+
+	// Platform handles (a HANDLE pair on Windows, a descriptor elsewhere)
+	void* fileHandle;
+	void* mappingHandle;
+	int fileDescriptor;
+};
+
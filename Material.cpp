@@ -14,6 +14,7 @@ Material::Material(
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> clampSampler)
 {
 	this->vs = vs;
+	this->compactVS = 0;
 	this->ps = ps;
 	this->color = color;
 	this->shininess = shininess;
@@ -39,6 +40,7 @@ Material::Material(
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler)
 {
 	this->vs = vs;
+	this->compactVS = 0;
 	this->ps = ps;
 	this->color = color;
 	this->shininess = shininess;
@@ -55,32 +57,78 @@ Material::~Material()
 {
 }
 
-void Material::PrepareMaterial(Transform* transform, Camera* cam)
+void Material::PrepareMaterial(Camera* cam, Mesh* mesh, RenderStateStats* stats)
 {
+	SimpleVertexShader* vs = GetVSFor(mesh);
+
 	// Turn shaders on
 	vs->SetShader();
 	ps->SetShader();
+	if (stats)
+		stats->ShaderBinds += 2;
 
 	// Set vertex shader data
-	vs->SetMatrix4x4("world", transform->GetWorldMatrix());
-	vs->SetMatrix4x4("worldInverseTranspose", transform->GetWorldInverseTransposeMatrix());
+	// (the object comes from the renderer's instance stream)
 	vs->SetMatrix4x4("view", cam->GetView());
 	vs->SetMatrix4x4("projection", cam->GetProjection());
 	vs->SetFloat2("uvScale", uvScale);
+	if (mesh)
+	{
+		vs->SetFloat3("positionOffset", mesh->GetPositionOffset());
+		vs->SetFloat3("positionScale", mesh->GetPositionScale());
+	}
 	vs->CopyAllBufferData();
+	if (stats)
+		stats->CBufferUploads += vs->GetBufferCount();
+
+	BindTextures(stats);
+}
 
+// Compact meshes need a vertex shader that can unpack them
+SimpleVertexShader* Material::GetVSFor(Mesh* mesh)
+{
+	if (mesh && mesh->GetVertexFormat() == MESH_VERTEX_FORMAT_COMPACT && compactVS)
+		return compactVS;
+	return vs;
+}
+
+void Material::BindMaterial(SimpleVertexShader* vs, RenderStateStats* stats)
+{
+	vs->SetFloat2("uvScale", uvScale);
+	vs->CopyBufferData("perMaterial");
+	if (stats)
+		stats->CBufferUploads++;
+
+	BindTextures(stats);
+}
+
+// --------------------------------------------------------
+// The pixel shader's side of the material.  Only counts
+// the resources the shader actually has.
+// --------------------------------------------------------
+void Material::BindTextures(RenderStateStats* stats)
+{
 	// Set pixel shader data
 	ps->SetFloat4("Color", color); 
 	ps->SetFloat("Shininess", shininess);
 	ps->CopyBufferData("perMaterial");
 
 	// Set SRVs
-	ps->SetShaderResourceView("AlbedoTexture", albedoSRV);
-	ps->SetShaderResourceView("NormalTexture", normalSRV);
-	ps->SetShaderResourceView("RoughnessTexture", roughnessSRV);
-	ps->SetShaderResourceView("MetalTexture", metalSRV);
+	unsigned int srvs = 0;
+	srvs += ps->SetShaderResourceView("AlbedoTexture", albedoSRV);
+	srvs += ps->SetShaderResourceView("NormalTexture", normalSRV);
+	srvs += ps->SetShaderResourceView("RoughnessTexture", roughnessSRV);
+	srvs += ps->SetShaderResourceView("MetalTexture", metalSRV);
 
 	// Set sampler
-	ps->SetSamplerState("BasicSampler", sampler);
-	ps->SetSamplerState("ClampSampler", clampSampler);
+	unsigned int samplers = 0;
+	samplers += ps->SetSamplerState("BasicSampler", sampler);
+	samplers += ps->SetSamplerState("ClampSampler", clampSampler);
+
+	if (stats)
+	{
+		stats->CBufferUploads++;
+		stats->SRVBinds += srvs;
+		stats->SamplerBinds += samplers;
+	}
 }
@@ -7,6 +7,8 @@
 #include "SimpleShader.h"
 #include "Camera.h"
 #include "Lights.h"
+#include "Mesh.h"
+#include "RenderQueue.h"
 
 class Material
 {
@@ -36,16 +38,27 @@ public:
 		Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler);
 	~Material();
 
-	void PrepareMaterial(Transform* transform, Camera* cam);
+	// The mesh decides which vertex shader is used, as
+	// compact meshes need the compact vertex shader.
+	// Binds and uploads are added to stats, if given.
+	void PrepareMaterial(Camera* cam, Mesh* mesh = 0, RenderStateStats* stats = 0);
+	SimpleVertexShader* GetVSFor(Mesh* mesh);
+
+	// Just this material's part of PrepareMaterial, for a draw loop
+	// that sets the shaders and the rest itself
+	void BindMaterial(SimpleVertexShader* vs, RenderStateStats* stats = 0);
 
 	SimpleVertexShader* GetVS() { return vs; }
+	SimpleVertexShader* GetCompactVS() { return compactVS; }
 	SimplePixelShader* GetPS() { return ps; }
 
 	void SetVS(SimpleVertexShader* vs) { this->vs = vs; }
+	void SetCompactVS(SimpleVertexShader* compactVS) { this->compactVS = compactVS; }
 	void SetPS(SimplePixelShader* ps) { this->ps = ps; }
 
 private:
 	SimpleVertexShader* vs;
+	SimpleVertexShader* compactVS;
 	SimplePixelShader* ps;
 
 	DirectX::XMFLOAT2 uvScale;
@@ -58,5 +71,7 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> metalSRV;
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler;
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> clampSampler;
+
+	void BindTextures(RenderStateStats* stats);
 };
 
@@ -1,192 +1,105 @@
 #include "Mesh.h"
 #include <DirectXMath.h>
 #include <vector>
-#include <fstream>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "MeshBaker.h"
+#include "MeshBin.h"
+#include "MeshTangents.h"
 
 using namespace DirectX;
 
-Mesh::Mesh(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device)
+// --------------------------------------------------------
+// Copies the indices at the narrowest width that fits
+// --------------------------------------------------------
+void MeshIndexData::Pack(const unsigned int* indices, unsigned int count, unsigned int vertexCount)
 {
-	CreateBuffers(vertArray, numVerts, indexArray, numIndices, device);
+	Format = ChooseFormat(vertexCount);
+	Count = count;
+	MeshBaker::PackIndices(indices, count, GetStride(), Bytes);
 }
 
-Mesh::Mesh(const char* objFile, Microsoft::WRL::ComPtr<ID3D11Device> device)
+DXGI_FORMAT MeshIndexData::ChooseFormat(unsigned int vertexCount)
 {
-	// File input object
-	std::ifstream obj(objFile);
+	return FormatFromStride(MeshBaker::GetIndexStride(vertexCount));
+}
 
-	// Check for successful open
-	if (!obj.is_open())
-		return;
+DXGI_FORMAT MeshIndexData::FormatFromStride(unsigned int stride)
+{
+	return stride == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+}
 
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;     // Positions from the file
-	std::vector<XMFLOAT3> normals;       // Normals from the file
-	std::vector<XMFLOAT2> uvs;           // UVs from the file
-	std::vector<Vertex> verts;           // Verts we're assembling
-	std::vector<UINT> indices;           // Indices of these verts
-	unsigned int vertCounter = 0;        // Count of vertices/indices
-	char chars[100];                     // String for line reading
-
-	// Still have data left?
-	while (obj.good())
-	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
 
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
-		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
-		}
-		else if (chars[0] == 'v')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
-		}
-		else if (chars[0] == 'f')
-		{
-			// Read the face indices into an array
-			// NOTE: This assumes the given obj file contains
-			//  vertex positions, uv coordinates AND normals.
-			//  If the model is missing any of these, this 
-			//  code will not handle the file correctly!
-			unsigned int i[12];
-			int facesRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.Position = positions[i[0] - 1];
-			v1.UV = uvs[i[1] - 1];
-			v1.Normal = normals[i[2] - 1];
-
-			Vertex v2;
-			v2.Position = positions[i[3] - 1];
-			v2.UV = uvs[i[4] - 1];
-			v2.Normal = normals[i[5] - 1];
-
-			Vertex v3;
-			v3.Position = positions[i[6] - 1];
-			v3.UV = uvs[i[7] - 1];
-			v3.Normal = normals[i[8] - 1];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.UV.y = 1.0f - v1.UV.y;
-			v2.UV.y = 1.0f - v2.UV.y;
-			v3.UV.y = 1.0f - v3.UV.y;
-
-			// Flip Z (LH vs. RH)
-			v1.Position.z *= -1.0f;
-			v2.Position.z *= -1.0f;
-			v3.Position.z *= -1.0f;
-
-			// Flip normal Z
-			v1.Normal.z *= -1.0f;
-			v2.Normal.z *= -1.0f;
-			v3.Normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-
-			// Add three more indices
-			indices.push_back(vertCounter); vertCounter += 1;
-			indices.push_back(vertCounter); vertCounter += 1;
-			indices.push_back(vertCounter); vertCounter += 1;
-
-			// Was there a 4th face?
-			if (facesRead == 12)
-			{
-				// Make the last vertex
-				Vertex v4;
-				v4.Position = positions[i[9] - 1];
-				v4.UV = uvs[i[10] - 1];
-				v4.Normal = normals[i[11] - 1];
-
-				// Flip the UV, Z pos and normal
-				v4.UV.y = 1.0f - v4.UV.y;
-				v4.Position.z *= -1.0f;
-				v4.Normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-
-				// Add three more indices
-				indices.push_back(vertCounter); vertCounter += 1;
-				indices.push_back(vertCounter); vertCounter += 1;
-				indices.push_back(vertCounter); vertCounter += 1;
-			}
-		}
-	}
+bool Mesh::meshletCulling = true;
+MeshletCullStats Mesh::cullStats = {};
 
-	// Close the file and create the actual buffers
-	obj.close();
 
+Mesh::Mesh(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device, int vertexFormat)
+{
+	this->vertexFormat = vertexFormat;
 
-	// - At this point, "verts" is a vector of Vertex structs, and can be used
-	//    directly to create a vertex buffer:  &verts[0] is the address of the first vert
-	//
-	// - The vector "indices" is similar. It's a vector of unsigned ints and
-	//    can be used directly for the index buffer: &indices[0] is the address of the first int
-	//
-	// - "vertCounter" is BOTH the number of vertices and the number of indices
-	// - Yes, the indices are a bit redundant here (one per vertex).  Could you skip using
-	//    an index buffer in this case?  Sure!  Though, if your mesh class assumes you have
-	//    one, you'll need to write some extra code to handle cases when you don't.
+	// Always calculate the tangents before copying to buffer
+	MeshTangents::Calculate(vertArray, numVerts, indexArray, numIndices);
+	MeshletBuilder::Build(vertArray, numVerts, indexArray, numIndices, meshlets);
+	lods.push_back({ 0, (unsigned int)numIndices, 0.0f });
 
-	CreateBuffers(&verts[0], vertCounter, &indices[0], vertCounter, device);
+	MeshIndexData packed;
+	packed.Pack(indexArray, numIndices, numVerts);
+	CreateBuffers(vertArray, numVerts, packed.Bytes.data(), packed.Format, numIndices, device);
+}
 
+Mesh::Mesh(const char* objFile, Microsoft::WRL::ComPtr<ID3D11Device> device, float weldEpsilon, int vertexFormat)
+{
+	this->vertexFormat = vertexFormat;
+	numIndices = 0;
+	numVerts = 0;
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	compactBounds = {};
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	// Is there a baked version of this mesh, made from this exact
+	// source?  If so, its arrays are already final and can go straight
+	// from the mapped file to the GPU without any intermediate copies
+	std::string bakedFile = MeshBin::GetBakedPath(objFile);
+	{
+		MappedFile baked(bakedFile.c_str());
+		const MeshBinHeader* header = 0;
+		const Vertex* bakedVerts = 0;
+		const void* bakedIndices = 0;
+		const Meshlet* bakedMeshlets = 0;
+		const MeshLod* bakedLods = 0;
+		if (MeshBin::Read(baked, weldEpsilon, &header, &bakedVerts, &bakedIndices, &bakedMeshlets, &bakedLods) &&
+			header->IndexCount > 0 &&
+			header->LodCount > 0 &&
+			MeshBin::MatchesSource(header, objFile))
+		{
+			meshlets.assign(bakedMeshlets, bakedMeshlets + header->MeshletCount);
+			lods.assign(bakedLods, bakedLods + header->LodCount);
+
+			// Indices were baked at their final width too
+			DXGI_FORMAT format = MeshIndexData::FormatFromStride(header->IndexStride);
+			CreateBuffers(bakedVerts, header->VertexCount, bakedIndices, format, header->IndexCount, device);
+			ReportLoadTime(objFile, ".meshbin", startTime);
+			return;
+		}
+	}
+
+	// No luck, so load from the source and bake it for next time
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	unsigned long long sourceHash = 0;
+	unsigned long long sourceSize = 0;
+	if (!MeshBaker::LoadObj(objFile, weldEpsilon, verts, indices, meshlets, lods, sourceHash, sourceSize))
+		return;
 
+	MeshIndexData packed;
+	packed.Pack(&indices[0], (unsigned int)indices.size(), (unsigned int)verts.size());
+	CreateBuffers(&verts[0], (int)verts.size(), packed.Bytes.data(), packed.Format, packed.Count, device);
+	ReportLoadTime(objFile, ".obj", startTime);
+
+	MeshBin::Write(bakedFile.c_str(), &verts[0], (unsigned int)verts.size(), packed.Bytes.data(), packed.GetStride(), packed.Count, meshlets.data(), (unsigned int)meshlets.size(), lods.data(), (unsigned int)lods.size(), weldEpsilon, sourceHash, sourceSize);
 }
 
 
@@ -196,28 +109,59 @@ Mesh::~Mesh(void)
 }
 
 
-void Mesh::CreateBuffers(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device)
+// --------------------------------------------------------
+// Prints how long a mesh took to load, and from where
+// --------------------------------------------------------
+void Mesh::ReportLoadTime(const char* objFile, const char* source, std::chrono::high_resolution_clock::time_point startTime)
 {
-	// Always calculate the tangents before copying to buffer
-	CalculateTangents(vertArray, numVerts, indexArray, numIndices);
+#if defined(DEBUG) || defined(_DEBUG)
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+	printf("Mesh %s: loaded from %s in %.3f ms\n", objFile, source, elapsed.count());
+#endif
+}
+
+
 
 
+// --------------------------------------------------------
+// Creates the GPU buffers directly from the given arrays,
+// which must already be final (tangents included).  The
+// index array must already be in the given format, and the
+// vertices are packed here if this is a compact mesh.
+// Bounding volumes come from the full precision vertices.
+// --------------------------------------------------------
+void Mesh::CreateBuffers(const Vertex* vertArray, int numVerts, const void* indexArray, DXGI_FORMAT indexFormat, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device)
+{
+	const void* vertexData = vertArray;
+	std::vector<CompactVertex> compactVerts;
+	compactBounds = CompactVertexCodec::ComputeBounds(vertArray, numVerts);
+	aabb = BoundsBuilder::ComputeAABB(vertArray, numVerts);
+	sphere = BoundsBuilder::ComputeSphere(vertArray, numVerts);
+	obb = BoundsBuilder::ComputeOBB(vertArray, numVerts);
+	if (vertexFormat == MESH_VERTEX_FORMAT_COMPACT)
+	{
+		compactVerts.resize(numVerts);
+		for (int i = 0; i < numVerts; i++)
+			compactVerts[i] = CompactVertexCodec::Encode(vertArray[i], compactBounds);
+		vertexData = compactVerts.data();
+	}
+
 	// Create the vertex buffer
 	D3D11_BUFFER_DESC vbd;
 	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = sizeof(Vertex) * numVerts; // Number of vertices
+	vbd.ByteWidth = GetVertexStride() * numVerts; // Number of vertices
 	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	vbd.CPUAccessFlags = 0;
 	vbd.MiscFlags = 0;
 	vbd.StructureByteStride = 0;
 	D3D11_SUBRESOURCE_DATA initialVertexData;
-	initialVertexData.pSysMem = vertArray;
+	initialVertexData.pSysMem = vertexData;
 	device->CreateBuffer(&vbd, &initialVertexData, vb.GetAddressOf());
 
 	// Create the index buffer
 	D3D11_BUFFER_DESC ibd;
 	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(unsigned int) * numIndices; // Number of indices
+	ibd.ByteWidth = (indexFormat == DXGI_FORMAT_R16_UINT ? 2 : 4) * numIndices; // Number of indices
 	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
 	ibd.CPUAccessFlags = 0;
 	ibd.MiscFlags = 0;
@@ -226,98 +170,180 @@ void Mesh::CreateBuffers(Vertex* vertArray, int numVerts, unsigned int* indexArr
 	initialIndexData.pSysMem = indexArray;
 	device->CreateBuffer(&ibd, &initialIndexData, ib.GetAddressOf());
 
-	// Save the indices
+	// Save the counts
+	this->indexFormat = indexFormat;
 	this->numIndices = numIndices;
+	this->numVerts = numVerts;
+
+#if defined(DEBUG) || defined(_DEBUG)
+	printf("Mesh: %d %d-bit indices (%d bytes)\n", numIndices, GetIndexSize() * 8, GetIndexSize() * numIndices);
+#endif
+}
+
+
+void Mesh::SetBuffersAndDraw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, unsigned int lod)
+{
+	if (lods.empty())
+		return;
+	lod = lod < lods.size() ? lod : (unsigned int)lods.size() - 1;
+
+	// Set buffers in the input assembler
+	UINT stride = GetVertexStride();
+	UINT offset = 0;
+	context->IASetVertexBuffers(0, 1, vb.GetAddressOf(), &stride, &offset);
+	context->IASetIndexBuffer(ib.Get(), indexFormat, 0);
+
+	// Draw this mesh
+	context->DrawIndexed(lods[lod].IndexCount, lods[lod].FirstIndex, 0);
+}
+
+void Mesh::SetBuffersAndDrawInstanced(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, unsigned int instanceCount, unsigned int lod)
+{
+	if (lods.empty() || instanceCount == 0)
+		return;
+	lod = lod < lods.size() ? lod : (unsigned int)lods.size() - 1;
+
+	// Set buffers in the input assembler
+	// (the instance stream is already in slot 1)
+	UINT stride = GetVertexStride();
+	UINT offset = 0;
+	context->IASetVertexBuffers(0, 1, vb.GetAddressOf(), &stride, &offset);
+	context->IASetIndexBuffer(ib.Get(), indexFormat, 0);
+
+	// Draw every instance of this mesh
+	context->DrawIndexedInstanced(lods[lod].IndexCount, instanceCount, lods[lod].FirstIndex, 0, 0);
 }
 
 
-// Calculates the tangents of the vertices in a mesh
-// Code originally adapted from: http://www.terathon.com/code/tangent.html
-// Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
-//  - See listing 7.4 in section 7.5 (page 9 of the PDF)
-void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+// --------------------------------------------------------
+// Describes CompactVertex to the input assembler.  The
+// formats do the unpacking, apart from the octahedral
+// normals and the position bounds (see VertexShaderCompact)
+// --------------------------------------------------------
+const D3D11_INPUT_ELEMENT_DESC* Mesh::GetCompactInputLayout(unsigned int* elementCount)
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
+	static const D3D11_INPUT_ELEMENT_DESC layout[] =
 	{
-		verts[i].Tangent = XMFLOAT3(0, 0, 0);
-	}
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "SLOT_PER_INSTANCE", 0, DXGI_FORMAT_R32_UINT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	};
+
+	*elementCount = sizeof(layout) / sizeof(layout[0]);
+	return layout;
+}
 
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numIndices;)
+
+// --------------------------------------------------------
+// Compares the vertex memory each mesh uses (or would use)
+// in the full and compact formats
+// --------------------------------------------------------
+void Mesh::ReportVertexMemory(const std::vector<Mesh*>& meshes)
+{
+#if defined(DEBUG) || defined(_DEBUG)
+	size_t totalFull = 0;
+	size_t totalCompact = 0;
+	size_t totalActual = 0;
+	for (size_t i = 0; i < meshes.size(); i++)
 	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->Position.x - v1->Position.x;
-		float y1 = v2->Position.y - v1->Position.y;
-		float z1 = v2->Position.z - v1->Position.z;
-
-		float x2 = v3->Position.x - v1->Position.x;
-		float y2 = v3->Position.y - v1->Position.y;
-		float z2 = v3->Position.z - v1->Position.z;
-
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->UV.x - v1->UV.x;
-		float t1 = v2->UV.y - v1->UV.y;
-
-		float s2 = v3->UV.x - v1->UV.x;
-		float t2 = v3->UV.y - v1->UV.y;
-
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-		
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-
-		// Adjust tangents of each vert of the triangle
-		v1->Tangent.x += tx; 
-		v1->Tangent.y += ty; 
-		v1->Tangent.z += tz;
-
-		v2->Tangent.x += tx; 
-		v2->Tangent.y += ty; 
-		v2->Tangent.z += tz;
-
-		v3->Tangent.x += tx; 
-		v3->Tangent.y += ty; 
-		v3->Tangent.z += tz;
+		Mesh* mesh = meshes[i];
+		size_t full = sizeof(Vertex) * mesh->numVerts;
+		size_t compact = sizeof(CompactVertex) * mesh->numVerts;
+		size_t actual = (size_t)mesh->GetVertexStride() * mesh->numVerts;
+		printf("Mesh %zu: %d vertices, %zu bytes full, %zu bytes compact (using %s)\n",
+			i,
+			mesh->numVerts,
+			full,
+			compact,
+			mesh->vertexFormat == MESH_VERTEX_FORMAT_COMPACT ? "compact" : "full");
+
+		totalFull += full;
+		totalCompact += compact;
+		totalActual += actual;
 	}
 
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
+	printf("Vertex memory: %zu bytes full, %zu bytes compact, %zu bytes in use\n",
+		totalFull,
+		totalCompact,
+		totalActual);
+#endif
+}
+
+
+// --------------------------------------------------------
+// Culls the meshlets in object space, where the frustum
+// comes straight out of world * view * projection
+// --------------------------------------------------------
+unsigned int Mesh::SetBuffersAndDrawVisible(
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	const XMFLOAT4X4& world,
+	const XMFLOAT4X4& view,
+	const XMFLOAT4X4& projection,
+	unsigned int lod)
+{
+	if (!meshletCulling || meshlets.empty() || lod > 0)
 	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
-
-		// Use Gram-Schmidt orthogonalize
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
-		
-		// Store the tangent
-		XMStoreFloat3(&verts[i].Tangent, tangent);
+		SetBuffersAndDraw(context, lod);
+		return 1;
 	}
-}
 
+	XMMATRIX worldMat = XMLoadFloat4x4(&world);
+	XMMATRIX worldView = worldMat * XMLoadFloat4x4(&view);
 
+	Frustum frustum;
+	frustum.Extract(worldView * XMLoadFloat4x4(&projection));
 
+	// The camera is at the origin of view space
+	XMVECTOR cameraPosition = XMVector3Transform(XMVectorZero(), XMMatrixInverse(0, worldView));
+
+	// Normal cones are only valid under uniform scaling
+	float scaleX = XMVectorGetX(XMVector3LengthSq(worldMat.r[0]));
+	float scaleY = XMVectorGetX(XMVector3LengthSq(worldMat.r[1]));
+	float scaleZ = XMVectorGetX(XMVector3LengthSq(worldMat.r[2]));
+	float scaleTolerance = 0.001f * fmaxf(scaleX, fmaxf(scaleY, scaleZ));
+	bool backfaceCulling =
+		fabsf(scaleX - scaleY) <= scaleTolerance &&
+		fabsf(scaleX - scaleZ) <= scaleTolerance;
 
-void Mesh::SetBuffersAndDraw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
-{
 	// Set buffers in the input assembler
-	UINT stride = sizeof(Vertex);
+	UINT stride = GetVertexStride();
 	UINT offset = 0;
 	context->IASetVertexBuffers(0, 1, vb.GetAddressOf(), &stride, &offset);
-	context->IASetIndexBuffer(ib.Get(), DXGI_FORMAT_R32_UINT, 0);
+	context->IASetIndexBuffer(ib.Get(), indexFormat, 0);
 
-	// Draw this mesh
-	context->DrawIndexed(this->numIndices, 0, 0);
+	// Draw each run of visible meshlets (which are adjacent in the index buffer)
+	unsigned int runStart = 0;
+	unsigned int runCount = 0;
+	unsigned int draws = 0;
+	for (const Meshlet& m : meshlets)
+	{
+		cullStats.MeshletsTested++;
+		cullStats.TrianglesTested += m.TriangleCount;
+
+		if (MeshletBuilder::IsVisible(m, frustum, cameraPosition, backfaceCulling))
+		{
+			if (runCount == 0)
+				runStart = m.FirstIndex;
+			runCount += m.TriangleCount * 3;
+			continue;
+		}
+
+		cullStats.MeshletsCulled++;
+		cullStats.TrianglesCulled += m.TriangleCount;
+		if (runCount > 0)
+		{
+			context->DrawIndexed(runCount, runStart, 0);
+			draws++;
+		}
+		runCount = 0;
+	}
+
+	if (runCount > 0)
+	{
+		context->DrawIndexed(runCount, runStart, 0);
+		draws++;
+	}
+	return draws;
 }
@@ -2,30 +2,120 @@
 
 #include <d3d11.h>
 #include <wrl/client.h>
+#include <vector>
+#include <chrono>
 
 #include "Vertex.h"
+#include "Bounds.h"
+#include "CompactVertex.h"
+#include "Meshlet.h"
+#include "MeshSimplifier.h"
 
+// Vertex layouts a mesh's GPU buffer can use
+#define MESH_VERTEX_FORMAT_FULL		0	// Vertex (44 bytes), for VertexShader.hlsl
+#define MESH_VERTEX_FORMAT_COMPACT	1	// CompactVertex (20 bytes), for VertexShaderCompact.hlsl
+
+// --------------------------------------------------------
+// Index data stored at the narrowest width that can still
+// address every vertex of its mesh: 16 bits when the mesh
+// has fewer than 65,536 vertices, 32 bits otherwise
+// --------------------------------------------------------
+struct MeshIndexData
+{
+	DXGI_FORMAT Format;
+	unsigned int Count;
+	std::vector<unsigned char> Bytes;
+
+	void Pack(const unsigned int* indices, unsigned int count, unsigned int vertexCount);
+	unsigned int GetStride() const { return Format == DXGI_FORMAT_R16_UINT ? 2 : 4; }
+
+	static DXGI_FORMAT ChooseFormat(unsigned int vertexCount);
+	static DXGI_FORMAT FormatFromStride(unsigned int stride);
+};
 
 class Mesh
 {
 public:
-	Mesh(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device);
-	Mesh(const char* objFile, Microsoft::WRL::ComPtr<ID3D11Device> device);
+	Mesh(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device, int vertexFormat = MESH_VERTEX_FORMAT_FULL);
+	Mesh(const char* objFile, Microsoft::WRL::ComPtr<ID3D11Device> device, float weldEpsilon = 0.0f, int vertexFormat = MESH_VERTEX_FORMAT_FULL);
 	~Mesh(void);
 
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer() { return vb; }
-	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer() { return ib; }
-	int GetIndexCount() { return numIndices; }
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer(DXGI_FORMAT* format = 0) { if (format) *format = indexFormat; return ib; }
+	DXGI_FORMAT GetIndexFormat() { return indexFormat; }
+	unsigned int GetIndexSize() { return indexFormat == DXGI_FORMAT_R16_UINT ? 2 : 4; }
+	int GetIndexCount() { return numIndices; }	// All levels of detail
+
+	// Levels of detail, from the full mesh (0) down
+	unsigned int GetLodCount() { return (unsigned int)lods.size(); }
+	const MeshLod& GetLod(unsigned int lod) { return lods[lod]; }
+
+	int GetVertexFormat() { return vertexFormat; }
+	unsigned int GetVertexStride() { return vertexFormat == MESH_VERTEX_FORMAT_COMPACT ? sizeof(CompactVertex) : sizeof(Vertex); }
+	int GetVertexCount() { return numVerts; }
+
+	// Object space bounding volumes, computed when the mesh is created
+	const BoundsAABB& GetAABB() { return aabb; }
+	const BoundsSphere& GetSphere() { return sphere; }
+	const BoundsOBB& GetOBB() { return obb; }
+
+	// Decoding constants for compact meshes' positions
+	DirectX::XMFLOAT3 GetPositionOffset() { return compactBounds.Offset; }
+	DirectX::XMFLOAT3 GetPositionScale() { return compactBounds.Scale; }
 
-	void SetBuffersAndDraw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	// Input layout matching CompactVertex, plus the per instance slot
+	static const D3D11_INPUT_ELEMENT_DESC* GetCompactInputLayout(unsigned int* elementCount);
+
+	// Prints the vertex memory of each mesh in both formats
+	static void ReportVertexMemory(const std::vector<Mesh*>& meshes);
+
+	// Levels past the last one draw the last one
+	void SetBuffersAndDraw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, unsigned int lod = 0);
+
+	// Draws the mesh once for each instance in the stream bound to
+	// input slot 1.  No meshlet culling, as instances are placed
+	// by the vertex shader.
+	void SetBuffersAndDrawInstanced(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, unsigned int instanceCount, unsigned int lod = 0);
+
+	// Culls the meshlets against the camera, then draws the visible ones
+	// (merging neighbors into a single draw).  Falls back to a plain draw
+	// when meshlet culling is turned off, or for simplified levels (the
+	// meshlets only cover the full mesh).  Returns the draws issued
+	unsigned int SetBuffersAndDrawVisible(
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		const DirectX::XMFLOAT4X4& world,
+		const DirectX::XMFLOAT4X4& view,
+		const DirectX::XMFLOAT4X4& projection,
+		unsigned int lod = 0);
+
+	const std::vector<Meshlet>& GetMeshlets() { return meshlets; }
+
+	// Meshlet culling for all meshes, and what it culled since the last reset
+	static void SetMeshletCulling(bool enabled) { meshletCulling = enabled; }
+	static bool GetMeshletCulling() { return meshletCulling; }
+	static MeshletCullStats GetCullStats() { return cullStats; }
+	static void ResetCullStats() { cullStats = {}; }
 
 private:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> vb;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> ib;
+	DXGI_FORMAT indexFormat;
 	int numIndices;
+	int numVerts;
+	int vertexFormat;
+	CompactVertexBounds compactBounds;
+	BoundsAABB aabb;
+	BoundsSphere sphere;
+	BoundsOBB obb;
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshLod> lods;
+
+	static bool meshletCulling;
+	static MeshletCullStats cullStats;
+
+	void CreateBuffers(const Vertex* vertArray, int numVerts, const void* indexArray, DXGI_FORMAT indexFormat, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device);
 
-	void CreateBuffers(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device);
-	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+	static void ReportLoadTime(const char* objFile, const char* source, std::chrono::high_resolution_clock::time_point startTime);
 
 };
 
@@ -0,0 +1,415 @@
+#include "MeshBaker.h"
+
+#include <DirectXMath.h>
+#include <chrono>
+#include <unordered_map>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+
+#include "ObjLoader.h"
+#include "MeshBin.h"
+#include "MeshOptimizer.h"
+#include "MeshTangents.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Hashing and comparison for welding identical OBJ corners
+// --------------------------------------------------------
+struct ObjCornerHash
+{
+	size_t operator()(const ObjCorner& c) const
+	{
+		size_t h = (size_t)(unsigned int)c.Position * 73856093u;
+		h ^= (size_t)(unsigned int)c.UV * 19349663u;
+		h ^= (size_t)(unsigned int)c.Normal * 83492791u;
+		return h;
+	}
+
+	bool operator()(const ObjCorner& a, const ObjCorner& b) const
+	{
+		return a.Position == b.Position && a.UV == b.UV && a.Normal == b.Normal;
+	}
+};
+
+// --------------------------------------------------------
+// A position snapped to an epsilon-sized grid, for finding
+// vertices that are close but not bit-identical
+// --------------------------------------------------------
+struct WeldCell
+{
+	long long X, Y, Z;
+};
+
+struct WeldCellHash
+{
+	size_t operator()(const WeldCell& c) const
+	{
+		unsigned long long h = (unsigned long long)c.X * 73856093ull;
+		h ^= (unsigned long long)c.Y * 19349663ull;
+		h ^= (unsigned long long)c.Z * 83492791ull;
+		return (size_t)(h ^ (h >> 32));
+	}
+
+	bool operator()(const WeldCell& a, const WeldCell& b) const
+	{
+		return a.X == b.X && a.Y == b.Y && a.Z == b.Z;
+	}
+};
+
+// Cells are clamped to this (2^62), leaving room for their neighbors
+#define WELD_CELL_LIMIT 4611686018427387904.0
+
+// The cell along one axis.  Huge positions (or tiny epsilons) are
+// clamped rather than overflowing the conversion, and NaN goes to the
+// lowest cell; a clamped cell just holds more vertices to compare
+static long long GetWeldCell(float position, double invEpsilon)
+{
+	double cell = floor(position * invEpsilon);
+	if (!(cell > -WELD_CELL_LIMIT))
+		return (long long)-WELD_CELL_LIMIT;
+	if (cell > WELD_CELL_LIMIT)
+		return (long long)WELD_CELL_LIMIT;
+	return (long long)cell;
+}
+
+// Whether every attribute of b is within epsilon of a's
+static bool WithinWeldDistance(const Vertex& a, const Vertex& b, float epsilonSq)
+{
+	XMVECTOR position = XMLoadFloat3(&a.Position) - XMLoadFloat3(&b.Position);
+	XMVECTOR uv = XMLoadFloat2(&a.UV) - XMLoadFloat2(&b.UV);
+	XMVECTOR normal = XMLoadFloat3(&a.Normal) - XMLoadFloat3(&b.Normal);
+	return
+		XMVectorGetX(XMVector3LengthSq(position)) <= epsilonSq &&
+		XMVectorGetX(XMVector2LengthSq(uv)) <= epsilonSq &&
+		XMVectorGetX(XMVector3LengthSq(normal)) <= epsilonSq;
+}
+
+// --------------------------------------------------------
+// Index widths: 16 bits when every index fits, 32 otherwise
+// --------------------------------------------------------
+unsigned int MeshBaker::GetIndexStride(unsigned int vertexCount)
+{
+	return vertexCount < 65536 ? 2 : 4;
+}
+
+void MeshBaker::PackIndices(const unsigned int* indices, unsigned int count, unsigned int stride, std::vector<unsigned char>& bytes)
+{
+	bytes.resize((size_t)count * stride);
+	if (stride == 2)
+	{
+		unsigned short* narrow = (unsigned short*)bytes.data();
+		for (unsigned int i = 0; i < count; i++)
+			narrow[i] = (unsigned short)indices[i];
+	}
+	else if (count > 0)
+	{
+		memcpy(bytes.data(), indices, (size_t)count * sizeof(unsigned int));
+	}
+}
+
+// --------------------------------------------------------
+// Loads, welds and bakes an OBJ file to its .meshbin without
+// needing a device, so assets can be baked ahead of time
+// --------------------------------------------------------
+bool MeshBaker::Bake(const char* objFile, float weldEpsilon)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshLod> lods;
+	unsigned long long sourceHash = 0;
+	unsigned long long sourceSize = 0;
+	if (!LoadObj(objFile, weldEpsilon, verts, indices, meshlets, lods, sourceHash, sourceSize))
+		return false;
+
+	unsigned int indexStride = GetIndexStride((unsigned int)verts.size());
+	std::vector<unsigned char> packed;
+	PackIndices(&indices[0], (unsigned int)indices.size(), indexStride, packed);
+
+	std::string bakedFile = MeshBin::GetBakedPath(objFile);
+	return MeshBin::Write(bakedFile.c_str(), &verts[0], (unsigned int)verts.size(), packed.data(), indexStride, (unsigned int)indices.size(), meshlets.data(), (unsigned int)meshlets.size(), lods.data(), (unsigned int)lods.size(), weldEpsilon, sourceHash, sourceSize);
+}
+
+
+// --------------------------------------------------------
+// Parses an OBJ file into final (welded, tangent-space)
+// vertex and index arrays.  Returns false if the file can't
+// be read or contains no triangles.
+// --------------------------------------------------------
+bool MeshBaker::LoadObj(
+	const char* objFile,
+	float weldEpsilon,
+	std::vector<Vertex>& verts,
+	std::vector<unsigned int>& indices,
+	std::vector<Meshlet>& meshlets,
+	std::vector<MeshLod>& lods,
+	unsigned long long& sourceHash,
+	unsigned long long& sourceSize)
+{
+	// Map the file once, for both hashing and parsing
+	MappedFile file(objFile);
+	if (!file.IsValid())
+		return false;
+
+	sourceSize = file.GetSize();
+	sourceHash = MeshBin::Hash(file.GetData(), file.GetSize());
+
+	// Parse the whole file (multi-threaded).  Positions, normals
+	// and UVs come back already converted to DirectX conventions
+	ObjData obj;
+	if (!ObjLoader::Parse(file.GetData(), file.GetSize(), obj))
+		return false;
+
+	// Nothing to draw?
+	if (obj.Corners.empty())
+		return false;
+
+	// - Weld the corners: every unique (position, uv, normal) triple
+	//    becomes a single vertex, shared through the index buffer
+	// - Missing attributes are simply left zeroed
+	verts.clear();
+	indices.resize(obj.Corners.size());
+	std::unordered_map<ObjCorner, unsigned int, ObjCornerHash, ObjCornerHash> uniqueCorners;
+	uniqueCorners.reserve(obj.Corners.size());
+	for (size_t i = 0; i < obj.Corners.size(); i++)
+	{
+		const ObjCorner& c = obj.Corners[i];
+
+		// Seen this exact corner before?
+		auto inserted = uniqueCorners.insert({ c, (unsigned int)verts.size() });
+		if (inserted.second)
+		{
+			Vertex v = {};
+			if (c.Position != -1) v.Position = obj.Positions[c.Position];
+			if (c.UV != -1) v.UV = obj.UVs[c.UV];
+			if (c.Normal != -1) v.Normal = obj.Normals[c.Normal];
+			verts.push_back(v);
+		}
+
+		indices[i] = inserted.first->second;
+	}
+
+	// Optionally merge vertices whose attributes are merely close
+	if (weldEpsilon > 0.0f)
+		WeldNearDuplicates(verts, indices, weldEpsilon);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	// Report how much the welding saved (one vertex per corner without it)
+	size_t cornerCount = obj.Corners.size();
+	printf("Mesh %s: %zu -> %zu vertices (%zu bytes saved)\n",
+		objFile,
+		cornerCount,
+		verts.size(),
+		(cornerCount - verts.size()) * sizeof(Vertex));
+#endif
+
+	// Welding can (in epsilon mode) remove every triangle
+	if (indices.empty())
+		return false;
+
+	// Reorder the triangles for the post-transform cache and then
+	// for overdraw.  Meshlets are grown starting from that order (and
+	// regroup it), and then the vertices are reordered for fetching
+	VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(&indices[0], indices.size(), verts.size());
+	std::vector<unsigned int> clusters;
+	MeshOptimizer::OptimizeVertexCache(&indices[0], indices.size(), verts.size(), MESH_OPTIMIZER_CACHE_SIZE, &clusters);
+	MeshOptimizer::OptimizeOverdraw(&indices[0], indices.size(), &verts[0], verts.size(), clusters);
+	MeshletBuilder::Build(&verts[0], verts.size(), &indices[0], indices.size(), meshlets);
+	verts.resize(MeshOptimizer::OptimizeVertexFetch(&verts[0], &indices[0], indices.size(), verts.size()));
+	VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(&indices[0], indices.size(), verts.size());
+
+#if defined(DEBUG) || defined(_DEBUG)
+	printf("Mesh %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+		objFile,
+		before.ACMR,
+		after.ACMR,
+		before.ATVR,
+		after.ATVR);
+#endif
+
+	MeshTangents::Calculate(&verts[0], (int)verts.size(), &indices[0], (int)indices.size());
+
+	// Simplified levels of detail go after the full mesh's indices,
+	// using the same (now final) vertices
+	MeshSimplifier::BuildLods(&verts[0], verts.size(), indices, lods);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	float radius = MeshSimplifier::GetRadius(&verts[0], verts.size());
+	for (size_t l = 0; l < lods.size(); l++)
+	{
+		printf("Mesh %s: LOD %zu: %u triangles, Hausdorff error %f (%.2f%% of radius)\n",
+			objFile,
+			l,
+			lods[l].IndexCount / 3,
+			lods[l].Error,
+			radius > 0.0f ? 100.0f * lods[l].Error / radius : 0.0f);
+	}
+#endif
+
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Merges each vertex into the first kept vertex whose
+// position, uv and normal are each within epsilon of its
+// own, then drops any triangles that collapsed as a result.
+// Kept vertices are filed by epsilon-sized position cell,
+// so anything close enough is in one of the 27 cells
+// around a vertex's own, wherever the cell edges fall.
+// --------------------------------------------------------
+void MeshBaker::WeldNearDuplicates(std::vector<Vertex>& verts, std::vector<unsigned int>& indices, float epsilon)
+{
+	std::vector<Vertex> welded;
+	std::vector<unsigned int> remap(verts.size());
+	std::unordered_map<WeldCell, std::vector<unsigned int>, WeldCellHash, WeldCellHash> cells;
+	cells.reserve(verts.size());
+
+	double invEpsilon = 1.0 / epsilon;
+	float epsilonSq = epsilon * epsilon;
+	for (size_t i = 0; i < verts.size(); i++)
+	{
+		const Vertex& v = verts[i];
+		WeldCell cell = {
+			GetWeldCell(v.Position.x, invEpsilon),
+			GetWeldCell(v.Position.y, invEpsilon),
+			GetWeldCell(v.Position.z, invEpsilon) };
+
+		// Closest is no better than first here; either is within epsilon
+		unsigned int match = UINT_MAX;
+		for (int n = 0; n < 27 && match == UINT_MAX; n++)
+		{
+			WeldCell neighbor = { cell.X + n % 3 - 1, cell.Y + n / 3 % 3 - 1, cell.Z + n / 9 - 1 };
+			auto found = cells.find(neighbor);
+			if (found == cells.end())
+				continue;
+			for (unsigned int w : found->second)
+			{
+				if (WithinWeldDistance(welded[w], v, epsilonSq))
+				{
+					match = w;
+					break;
+				}
+			}
+		}
+
+		if (match == UINT_MAX)
+		{
+			match = (unsigned int)welded.size();
+			welded.push_back(v);
+			cells[cell].push_back(match);
+		}
+
+		remap[i] = match;
+	}
+
+	// Rebuild the indices, skipping triangles that are now degenerate
+	size_t kept = 0;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		unsigned int i0 = remap[indices[i]];
+		unsigned int i1 = remap[indices[i + 1]];
+		unsigned int i2 = remap[indices[i + 2]];
+		if (i0 == i1 || i1 == i2 || i2 == i0)
+			continue;
+
+		indices[kept++] = i0;
+		indices[kept++] = i1;
+		indices[kept++] = i2;
+	}
+	indices.resize(kept);
+
+	verts.swap(welded);
+}
+
+// --------------------------------------------------------
+// Times loading a mesh from its OBJ file and from its baked
+// file.  The first load of each is "cold" (the OS may still
+// have the file cached from before, but nothing in this
+// process has touched it), and the best of the rest is
+// "warm".  The baked loads map, validate (including hashing
+// the source) and copy the arrays out, standing in for the
+// copy CreateBuffers hands the driver.
+// --------------------------------------------------------
+MeshLoadBenchmark MeshBaker::RunLoadBenchmark(const char* objFile, unsigned int runs)
+{
+	MeshLoadBenchmark result = {};
+	if (runs < 2)
+		runs = 2;
+
+	// Load from the OBJ, then bake what came out of it
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshLod> lods;
+	unsigned long long sourceHash = 0;
+	unsigned long long sourceSize = 0;
+	for (unsigned int r = 0; r < runs; r++)
+	{
+		auto startTime = std::chrono::high_resolution_clock::now();
+		if (!LoadObj(objFile, 0.0f, verts, indices, meshlets, lods, sourceHash, sourceSize))
+			return result;
+		auto endTime = std::chrono::high_resolution_clock::now();
+		double ms = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+		if (r == 0)
+			result.ObjColdMs = ms;
+		else if (r == 1 || ms < result.ObjWarmMs)
+			result.ObjWarmMs = ms;
+	}
+	result.SourceBytes = sourceSize;
+
+	unsigned int indexStride = GetIndexStride((unsigned int)verts.size());
+	std::vector<unsigned char> packed;
+	PackIndices(&indices[0], (unsigned int)indices.size(), indexStride, packed);
+
+	std::string bakedFile = MeshBin::GetBakedPath(objFile);
+	if (!MeshBin::Write(bakedFile.c_str(), &verts[0], (unsigned int)verts.size(), packed.data(), indexStride, (unsigned int)indices.size(), meshlets.data(), (unsigned int)meshlets.size(), lods.data(), (unsigned int)lods.size(), 0.0f, sourceHash, sourceSize))
+		return result;
+
+	// Load the baked file back, and check it holds the same arrays
+	std::vector<unsigned char> uploaded;
+	result.Identical = true;
+	for (unsigned int r = 0; r < runs; r++)
+	{
+		auto startTime = std::chrono::high_resolution_clock::now();
+		MappedFile baked(bakedFile.c_str());
+		const MeshBinHeader* header = 0;
+		const Vertex* bakedVerts = 0;
+		const void* bakedIndices = 0;
+		const Meshlet* bakedMeshlets = 0;
+		const MeshLod* bakedLods = 0;
+		if (!MeshBin::Read(baked, 0.0f, &header, &bakedVerts, &bakedIndices, &bakedMeshlets, &bakedLods) ||
+			!MeshBin::MatchesSource(header, objFile))
+		{
+			result.Identical = false;
+			return result;
+		}
+		size_t vertexBytes = (size_t)header->VertexCount * sizeof(Vertex);
+		size_t indexBytes = (size_t)header->IndexCount * header->IndexStride;
+		uploaded.resize(vertexBytes + indexBytes);
+		memcpy(uploaded.data(), bakedVerts, vertexBytes);
+		memcpy(uploaded.data() + vertexBytes, bakedIndices, indexBytes);
+		auto endTime = std::chrono::high_resolution_clock::now();
+		double ms = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+		if (r == 0)
+			result.BakedColdMs = ms;
+		else if (r == 1 || ms < result.BakedWarmMs)
+			result.BakedWarmMs = ms;
+
+		result.BakedBytes = baked.GetSize();
+		result.Identical = result.Identical &&
+			header->VertexCount == verts.size() &&
+			header->IndexCount == indices.size() &&
+			header->MeshletCount == meshlets.size() &&
+			header->LodCount == lods.size() &&
+			memcmp(bakedVerts, verts.data(), vertexBytes) == 0 &&
+			memcmp(bakedIndices, packed.data(), indexBytes) == 0 &&
+			memcmp(bakedMeshlets, meshlets.data(), meshlets.size() * sizeof(Meshlet)) == 0 &&
+			memcmp(bakedLods, lods.data(), lods.size() * sizeof(MeshLod)) == 0;
+	}
+
+	return result;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+
+#include "Vertex.h"
+#include "Meshlet.h"
+#include "MeshSimplifier.h"
+
+// Loads of each kind MeshBaker::RunLoadBenchmark times by default
+#define MESH_LOAD_BENCHMARK_RUNS 5
+
+// --------------------------------------------------------
+// Timings of one run of MeshBaker::RunLoadBenchmark.  Cold
+// is the first load of each kind, warm the best of the rest.
+// --------------------------------------------------------
+struct MeshLoadBenchmark
+{
+	unsigned long long SourceBytes;	// Zero if the OBJ couldn't be loaded
+	unsigned long long BakedBytes;
+	double ObjColdMs;
+	double ObjWarmMs;
+	double BakedColdMs;
+	double BakedWarmMs;
+	bool Identical;					// The baked file gave back exactly what was baked
+};
+
+// --------------------------------------------------------
+// Turns OBJ files into final, GPU-ready arrays (welded,
+// optimized, with tangents, meshlets and levels of detail)
+// and bakes them to .meshbin files.  Needs no device, so
+// meshes can be baked and load times measured headless.
+// --------------------------------------------------------
+class MeshBaker
+{
+public:
+	// Parses an OBJ file into final vertex and index arrays.  Returns
+	// false if the file can't be read or contains no triangles
+	static bool LoadObj(
+		const char* objFile,
+		float weldEpsilon,
+		std::vector<Vertex>& verts,
+		std::vector<unsigned int>& indices,
+		std::vector<Meshlet>& meshlets,
+		std::vector<MeshLod>& lods,
+		unsigned long long& sourceHash,
+		unsigned long long& sourceSize);
+
+	// Loads an OBJ file and bakes it to a .meshbin next to it
+	static bool Bake(const char* objFile, float weldEpsilon = 0.0f);
+
+	// Indices are stored at the narrowest width (2 or 4 bytes) that
+	// can address every vertex
+	static unsigned int GetIndexStride(unsigned int vertexCount);
+	static void PackIndices(const unsigned int* indices, unsigned int count, unsigned int stride, std::vector<unsigned char>& bytes);
+
+	// Times loading from the OBJ against loading from the baked file
+	// (which it bakes first), cold and warm
+	static MeshLoadBenchmark RunLoadBenchmark(const char* objFile, unsigned int runs = MESH_LOAD_BENCHMARK_RUNS);
+
+private:
+	static void WeldNearDuplicates(std::vector<Vertex>& verts, std::vector<unsigned int>& indices, float epsilon);
+};
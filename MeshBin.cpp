@@ -0,0 +1,116 @@
+#include "MeshBin.h"
+
+#include <filesystem>
+#include <fstream>
+
+using namespace DirectX;
+
+std::string MeshBin::GetBakedPath(const char* sourceFile)
+{
+	std::filesystem::path path(sourceFile);
+	path.replace_extension(".meshbin");
+	return path.string();
+}
+
+bool MeshBin::MatchesSource(const MeshBinHeader* header, const char* sourceFile)
+{
+	MappedFile source(sourceFile);
+	if (!source.IsValid() || source.GetSize() != header->SourceSize)
+		return false;
+
+	return Hash(source.GetData(), source.GetSize()) == header->SourceHash;
+}
+
+bool MeshBin::Read(
+	MappedFile& file,
+	float weldEpsilon,
+	const MeshBinHeader** header,
+	const Vertex** verts,
+	const void** indices,
+	const Meshlet** meshlets,
+	const MeshLod** lods)
+{
+	if (!file.IsValid() || file.GetSize() < sizeof(MeshBinHeader))
+		return false;
+
+	// Is this a file we understand, baked with the same settings?
+	const MeshBinHeader* h = (const MeshBinHeader*)file.GetData();
+	if (h->Magic != MESHBIN_MAGIC ||
+		h->Version != MESHBIN_VERSION ||
+		h->VertexStride != sizeof(Vertex) ||
+		(h->IndexStride != 2 && h->IndexStride != 4) ||
+		h->WeldEpsilon != weldEpsilon)
+		return false;
+
+	// Make sure the file isn't truncated (or padded)
+	unsigned long long vertexBytes = (unsigned long long)h->VertexCount * h->VertexStride;
+	unsigned long long indexBytes = (unsigned long long)h->IndexCount * h->IndexStride;
+	unsigned long long meshletOffset = sizeof(MeshBinHeader) + vertexBytes + indexBytes + GetIndexPadding(indexBytes);
+	unsigned long long lodOffset = meshletOffset + (unsigned long long)h->MeshletCount * sizeof(Meshlet);
+	unsigned long long expectedSize = lodOffset + (unsigned long long)h->LodCount * sizeof(MeshLod);
+	if (file.GetSize() != expectedSize)
+		return false;
+
+	// Point directly into the mapped memory
+	*header = h;
+	*verts = (const Vertex*)(file.GetData() + sizeof(MeshBinHeader));
+	*indices = (const void*)(file.GetData() + sizeof(MeshBinHeader) + vertexBytes);
+	*meshlets = (const Meshlet*)(file.GetData() + meshletOffset);
+	*lods = (const MeshLod*)(file.GetData() + lodOffset);
+	return true;
+}
+
+bool MeshBin::Write(
+	const char* bakedFile,
+	const Vertex* verts,
+	unsigned int numVerts,
+	const void* indices,
+	unsigned int indexStride,
+	unsigned int numIndices,
+	const Meshlet* meshlets,
+	unsigned int numMeshlets,
+	const MeshLod* lods,
+	unsigned int numLods,
+	float weldEpsilon,
+	unsigned long long sourceHash,
+	unsigned long long sourceSize)
+{
+	MeshBinHeader header = {};
+	header.Magic = MESHBIN_MAGIC;
+	header.Version = MESHBIN_VERSION;
+	header.VertexCount = numVerts;
+	header.IndexCount = numIndices;
+	header.VertexStride = sizeof(Vertex);
+	header.IndexStride = indexStride;
+	header.MeshletCount = numMeshlets;
+	header.LodCount = numLods;
+	header.WeldEpsilon = weldEpsilon;
+	header.SourceHash = sourceHash;
+	header.SourceSize = sourceSize;
+
+	std::ofstream out(bakedFile, std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return false;
+
+	out.write((const char*)&header, sizeof(MeshBinHeader));
+	out.write((const char*)verts, (std::streamsize)sizeof(Vertex) * numVerts);
+	out.write((const char*)indices, (std::streamsize)indexStride * numIndices);
+
+	const char padding[4] = {};
+	out.write(padding, (std::streamsize)GetIndexPadding((unsigned long long)indexStride * numIndices));
+	out.write((const char*)meshlets, (std::streamsize)sizeof(Meshlet) * numMeshlets);
+	out.write((const char*)lods, (std::streamsize)sizeof(MeshLod) * numLods);
+	return out.good();
+}
+
+unsigned long long MeshBin::Hash(const char* data, size_t size)
+{
+	// 64-bit FNV-1a
+	unsigned long long hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <string>
+
+#include "Vertex.h"
+#include "Meshlet.h"
+#include "MeshSimplifier.h"
+#include "MappedFile.h"
+
+// "MBIN" in little-endian byte order
+#define MESHBIN_MAGIC	0x4E49424D
+#define MESHBIN_VERSION	8
+
+// --------------------------------------------------------
+// Header at the start of every baked mesh (.meshbin) file.
+// The vertex array immediately follows the header, and the
+// index array immediately follows the vertices.  Indices
+// are stored at their final GPU width (2 or 4 bytes), and
+// padded to a multiple of 4 bytes before the meshlets.
+// The levels of detail (ranges of the indices) come last.
+// --------------------------------------------------------
+struct MeshBinHeader
+{
+	unsigned int Magic;
+	unsigned int Version;
+	unsigned int VertexCount;
+	unsigned int IndexCount;
+	unsigned int VertexStride;
+	unsigned int IndexStride;
+	float WeldEpsilon;			// Settings the mesh was baked with
+	unsigned int MeshletCount;
+	unsigned int LodCount;
+	unsigned int Reserved;
+	unsigned long long SourceHash;	// FNV-1a hash of the source file's bytes
+	unsigned long long SourceSize;
+};
+
+// --------------------------------------------------------
+// Reading and writing of baked meshes: the final vertex
+// and index arrays, ready to be handed straight to the GPU
+// --------------------------------------------------------
+class MeshBin
+{
+public:
+	// "Models/sphere.obj" is baked to "Models/sphere.meshbin"
+	static std::string GetBakedPath(const char* sourceFile);
+
+	// Was the baked file made from this exact source?  Compares sizes,
+	// then (only if they match) hashes.  Timestamps aren't trusted, as
+	// checkouts and copies can leave a changed source looking older
+	static bool MatchesSource(const MeshBinHeader* header, const char* sourceFile);
+
+	// Validates a mapped .meshbin and points into its arrays (no copies)
+	static bool Read(
+		MappedFile& file,
+		float weldEpsilon,
+		const MeshBinHeader** header,
+		const Vertex** verts,
+		const void** indices,
+		const Meshlet** meshlets,
+		const MeshLod** lods);
+
+	static bool Write(
+		const char* bakedFile,
+		const Vertex* verts,
+		unsigned int numVerts,
+		const void* indices,
+		unsigned int indexStride,
+		unsigned int numIndices,
+		const Meshlet* meshlets,
+		unsigned int numMeshlets,
+		const MeshLod* lods,
+		unsigned int numLods,
+		float weldEpsilon,
+		unsigned long long sourceHash,
+		unsigned long long sourceSize);
+
+	static unsigned long long Hash(const char* data, size_t size);
+
+private:
+	static unsigned long long GetIndexPadding(unsigned long long indexBytes) { return (4 - indexBytes % 4) % 4; }
+};
+
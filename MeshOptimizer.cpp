@@ -0,0 +1,310 @@
+#include "MeshOptimizer.h"
+
+#include <DirectXMath.h>
+#include <algorithm>
+
+using namespace DirectX;
+
+// Marks vertices that haven't been seen yet
+#define MESH_OPTIMIZER_INVALID 0xFFFFFFFF
+
+void MeshOptimizer::OptimizeVertexCache(
+	unsigned int* indices,
+	size_t indexCount,
+	size_t vertexCount,
+	unsigned int cacheSize,
+	std::vector<unsigned int>* clusters)
+{
+	size_t triCount = indexCount / 3;
+	if (clusters) clusters->clear();
+	if (triCount == 0 || vertexCount == 0)
+		return;
+
+	// Number of not-yet-emitted triangles using each vertex
+	std::vector<unsigned int> live(vertexCount, 0);
+	for (size_t i = 0; i < triCount * 3; i++)
+		live[indices[i]]++;
+
+	// Vertex -> triangle adjacency, stored contiguously
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + live[v];
+
+	std::vector<unsigned int> adjacency(triCount * 3);
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < triCount * 3; i++)
+		adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+	// Tipsify state
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	std::vector<char> emitted(triCount, 0);
+	std::vector<unsigned int> deadEnd;
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> output;
+	deadEnd.reserve(triCount * 3);
+	output.reserve(triCount * 3);
+
+	unsigned int timestamp = cacheSize + 1;
+	size_t cursor = 0;
+	bool newCluster = true;
+	long long current = 0;
+
+	while (current >= 0)
+	{
+		// Emit every remaining triangle around the current vertex
+		candidates.clear();
+		for (unsigned int a = offsets[(size_t)current]; a < offsets[(size_t)current + 1]; a++)
+		{
+			unsigned int t = adjacency[a];
+			if (emitted[t])
+				continue;
+
+			if (newCluster && clusters)
+				clusters->push_back((unsigned int)(output.size() / 3));
+			newCluster = false;
+
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int v = indices[t * 3 + k];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+
+				// Not in the cache any more?  Then it is now
+				if (timestamp - cacheTime[v] > cacheSize)
+					cacheTime[v] = timestamp++;
+			}
+
+			emitted[t] = 1;
+		}
+
+		// Pick the candidate that will still be in the cache once
+		// all of its triangles are emitted, preferring the oldest
+		long long best = -1;
+		long long bestPriority = -1;
+		for (unsigned int v : candidates)
+		{
+			if (live[v] == 0)
+				continue;
+
+			long long priority = 0;
+			if (timestamp - cacheTime[v] + 2 * live[v] <= cacheSize)
+				priority = timestamp - cacheTime[v];
+
+			if (priority > bestPriority)
+			{
+				best = v;
+				bestPriority = priority;
+			}
+		}
+
+		// Dead end: back up through recently used vertices,
+		// and failing that, scan for any vertex with work left
+		if (best == -1)
+		{
+			newCluster = true;
+
+			while (!deadEnd.empty())
+			{
+				unsigned int v = deadEnd.back();
+				deadEnd.pop_back();
+				if (live[v] > 0)
+				{
+					best = v;
+					break;
+				}
+			}
+
+			while (best == -1 && cursor < vertexCount)
+			{
+				if (live[cursor] > 0)
+					best = (long long)cursor;
+				cursor++;
+			}
+		}
+
+		current = best;
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(
+	unsigned int* indices,
+	size_t indexCount,
+	const Vertex* verts,
+	size_t vertexCount,
+	const std::vector<unsigned int>& clusters,
+	unsigned int cacheSize,
+	float threshold)
+{
+	size_t triCount = indexCount / 3;
+	if (triCount == 0 || clusters.empty())
+		return;
+
+	// Split the hard clusters wherever the cache efficiency is already
+	// close to that of the whole mesh, giving more freedom to sort
+	float acmr = AnalyzeVertexCache(indices, indexCount, vertexCount, cacheSize).ACMR;
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	std::vector<unsigned int> splits;
+	unsigned int time = cacheSize + 1;
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		unsigned int start = clusters[c];
+		unsigned int end = (c + 1 < clusters.size()) ? clusters[c + 1] : (unsigned int)triCount;
+
+		// A fresh cache for each (sub-)cluster: jumping the clock
+		// ahead by a full cache size evicts everything at once
+		time += cacheSize + 1;
+		unsigned int misses = 0;
+		unsigned int subStart = start;
+		splits.push_back(start);
+
+		for (unsigned int t = start; t < end; t++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int v = indices[t * 3 + k];
+				if (time - cacheTime[v] > cacheSize)
+				{
+					cacheTime[v] = time++;
+					misses++;
+				}
+			}
+
+			unsigned int subTris = t - subStart + 1;
+			if (t + 1 < end && misses <= threshold * acmr * subTris)
+			{
+				splits.push_back(t + 1);
+				subStart = t + 1;
+				misses = 0;
+				time += cacheSize + 1;
+			}
+		}
+	}
+
+	// Area-weighted centroid and normal of every cluster (and of the mesh)
+	size_t clusterCount = splits.size();
+	std::vector<XMFLOAT3> centroids(clusterCount);
+	std::vector<XMFLOAT3> normals(clusterCount);
+	XMVECTOR meshCentroid = XMVectorZero();
+	float meshArea = 0.0f;
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		unsigned int start = splits[c];
+		unsigned int end = (c + 1 < clusterCount) ? splits[c + 1] : (unsigned int)triCount;
+
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+		for (unsigned int t = start; t < end; t++)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&verts[indices[t * 3 + 0]].Position);
+			XMVECTOR p1 = XMLoadFloat3(&verts[indices[t * 3 + 1]].Position);
+			XMVECTOR p2 = XMLoadFloat3(&verts[indices[t * 3 + 2]].Position);
+
+			// Length of the cross product is twice the area, and
+			// (with clockwise winding) it points out of the front face
+			XMVECTOR cross = XMVector3Cross(p1 - p0, p2 - p0);
+			float triArea = XMVectorGetX(XMVector3Length(cross)) * 0.5f;
+
+			centroid += (p0 + p1 + p2) * (triArea / 3.0f);
+			normal += cross;
+			area += triArea;
+		}
+
+		meshCentroid += centroid;
+		meshArea += area;
+
+		if (area > 0.0f)
+			centroid /= area;
+		XMStoreFloat3(&centroids[c], centroid);
+		XMStoreFloat3(&normals[c], XMVector3Normalize(normal));
+	}
+
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	// Clusters facing away from the center are likely occluders,
+	// so they are drawn first
+	std::vector<float> sortKeys(clusterCount);
+	std::vector<unsigned int> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		XMVECTOR toCluster = XMLoadFloat3(&centroids[c]) - meshCentroid;
+		sortKeys[c] = XMVectorGetX(XMVector3Dot(toCluster, XMLoadFloat3(&normals[c])));
+		order[c] = (unsigned int)c;
+	}
+
+	std::stable_sort(order.begin(), order.end(),
+		[&](unsigned int a, unsigned int b) { return sortKeys[a] > sortKeys[b]; });
+
+	// Rebuild the index buffer in the new cluster order
+	std::vector<unsigned int> output;
+	output.reserve(triCount * 3);
+	for (unsigned int c : order)
+	{
+		unsigned int start = splits[c];
+		unsigned int end = (c + 1 < clusterCount) ? splits[c + 1] : (unsigned int)triCount;
+		output.insert(output.end(), indices + start * 3, indices + end * 3);
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(
+	Vertex* verts,
+	unsigned int* indices,
+	size_t indexCount,
+	size_t vertexCount)
+{
+	// Number the vertices in the order they're first referenced
+	std::vector<unsigned int> remap(vertexCount, MESH_OPTIMIZER_INVALID);
+	std::vector<Vertex> reordered;
+	reordered.reserve(vertexCount);
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int v = indices[i];
+		if (remap[v] == MESH_OPTIMIZER_INVALID)
+		{
+			remap[v] = (unsigned int)reordered.size();
+			reordered.push_back(verts[v]);
+		}
+
+		indices[i] = remap[v];
+	}
+
+	std::copy(reordered.begin(), reordered.end(), verts);
+	return reordered.size();
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(
+	const unsigned int* indices,
+	size_t indexCount,
+	size_t vertexCount,
+	unsigned int cacheSize)
+{
+	VertexCacheStats stats = {};
+
+	// A vertex is in the FIFO if fewer than cacheSize
+	// misses have happened since it was inserted
+	std::vector<unsigned int> insertedAt(vertexCount, MESH_OPTIMIZER_INVALID);
+	unsigned int uniqueVertices = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int v = indices[i];
+		if (insertedAt[v] == MESH_OPTIMIZER_INVALID)
+			uniqueVertices++;
+		else if (stats.Misses - insertedAt[v] < cacheSize)
+			continue;
+
+		insertedAt[v] = stats.Misses;
+		stats.Misses++;
+	}
+
+	size_t triCount = indexCount / 3;
+	stats.ACMR = triCount ? (float)stats.Misses / triCount : 0.0f;
+	stats.ATVR = uniqueVertices ? (float)stats.Misses / uniqueVertices : 0.0f;
+	return stats;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+#include "Vertex.h"
+
+// Post-transform cache size assumed when optimizing and
+// analyzing meshes (a conservative guess for modern GPUs)
+#define MESH_OPTIMIZER_CACHE_SIZE 16
+
+// --------------------------------------------------------
+// Results of running an index buffer through a simulated
+// FIFO post-transform vertex cache
+// --------------------------------------------------------
+struct VertexCacheStats
+{
+	unsigned int Misses;	// Vertex shader invocations
+	float ACMR;				// Average cache miss ratio: misses per triangle
+	float ATVR;				// Average transform to vertex ratio: misses per unique vertex
+};
+
+// --------------------------------------------------------
+// CPU-side mesh optimization passes, run before the GPU
+// buffers are created.  All of these are pure C++, so the
+// results can be checked on a machine without a GPU.
+// --------------------------------------------------------
+class MeshOptimizer
+{
+public:
+	// Reorders triangles for vertex cache locality (Tipsify, Sander et al. 2007).
+	// Optionally returns the index of the first triangle of each cluster
+	// (runs of triangles emitted without a cache-flushing jump)
+	static void OptimizeVertexCache(
+		unsigned int* indices,
+		size_t indexCount,
+		size_t vertexCount,
+		unsigned int cacheSize = MESH_OPTIMIZER_CACHE_SIZE,
+		std::vector<unsigned int>* clusters = 0);
+
+	// Reorders the clusters of an already cache-optimized mesh so that
+	// outward-facing ones are drawn first, reducing overdraw.  Clusters
+	// are first split further wherever that costs less than the given
+	// fraction of extra cache misses
+	static void OptimizeOverdraw(
+		unsigned int* indices,
+		size_t indexCount,
+		const Vertex* verts,
+		size_t vertexCount,
+		const std::vector<unsigned int>& clusters,
+		unsigned int cacheSize = MESH_OPTIMIZER_CACHE_SIZE,
+		float threshold = 1.05f);
+
+	// Reorders the vertices into the order the index buffer first uses
+	// them, and drops any that are never used.  Returns the new count
+	static size_t OptimizeVertexFetch(
+		Vertex* verts,
+		unsigned int* indices,
+		size_t indexCount,
+		size_t vertexCount);
+
+	// Simulates a FIFO post-transform cache of the given size
+	static VertexCacheStats AnalyzeVertexCache(
+		const unsigned int* indices,
+		size_t indexCount,
+		size_t vertexCount,
+		unsigned int cacheSize = MESH_OPTIMIZER_CACHE_SIZE);
+};
+
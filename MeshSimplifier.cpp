@@ -0,0 +1,888 @@
+#include "MeshSimplifier.h"
+
+#include <DirectXMath.h>
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <unordered_map>
+
+#include "MeshOptimizer.h"
+
+using namespace DirectX;
+
+// What each position may do when its edges are collapsed
+#define MESH_SIMPLIFIER_MANIFOLD	0	// Inside a smooth patch: can collapse onto any neighbor
+#define MESH_SIMPLIFIER_LINE		1	// On a seam or border: can only slide along it
+#define MESH_SIMPLIFIER_LOCKED		2	// Where lines meet or end, or non-manifold: never moves
+
+// Marks the end of a list of vertices
+#define MESH_SIMPLIFIER_NONE 0xFFFFFFFF
+
+// Collapses may not turn any triangle further than this (cosine),
+// which rules out flipped triangles and most slivers
+#define MESH_SIMPLIFIER_MIN_NORMAL_DOT 0.2f
+
+// Consecutive triangles are checked together (against one
+// bounding sphere) when measuring Hausdorff distances
+#define MESH_SIMPLIFIER_GROUP_SIZE 32
+
+// Triangles sampled per direction before subsampling kicks in
+#define MESH_SIMPLIFIER_MAX_SAMPLED_TRIANGLES 16384
+
+// --------------------------------------------------------
+// Hashing for finding vertices at identical positions
+// --------------------------------------------------------
+struct SimplifierPositionHash
+{
+	size_t operator()(const XMFLOAT3& p) const
+	{
+		unsigned int bits[3];
+		memcpy(bits, &p, sizeof(bits));
+		return (size_t)bits[0] * 73856093u ^ (size_t)bits[1] * 19349663u ^ (size_t)bits[2] * 83492791u;
+	}
+
+	bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+};
+
+// --------------------------------------------------------
+// Symmetric error quadric: the sum of squared distances to
+// a set of planes (Garland & Heckbert's Q matrix), weighted
+// by the area each plane stands for
+// --------------------------------------------------------
+struct SimplifierQuadric
+{
+	double A00, A01, A02, A11, A12, A22;
+	double B0, B1, B2;
+	double C;
+	double Weight;
+
+	void AddPlane(FXMVECTOR plane, double w)
+	{
+		XMFLOAT4 p;
+		XMStoreFloat4(&p, plane);
+		double nx = p.x, ny = p.y, nz = p.z, d = p.w;
+		A00 += w * nx * nx; A01 += w * nx * ny; A02 += w * nx * nz;
+		A11 += w * ny * ny; A12 += w * ny * nz; A22 += w * nz * nz;
+		B0 += w * nx * d; B1 += w * ny * d; B2 += w * nz * d;
+		C += w * d * d;
+		Weight += w;
+	}
+
+	void Add(const SimplifierQuadric& q)
+	{
+		A00 += q.A00; A01 += q.A01; A02 += q.A02;
+		A11 += q.A11; A12 += q.A12; A22 += q.A22;
+		B0 += q.B0; B1 += q.B1; B2 += q.B2;
+		C += q.C;
+		Weight += q.Weight;
+	}
+
+	// Weighted mean of the squared distances from the point to the planes
+	double Evaluate(const XMFLOAT3& p) const
+	{
+		if (Weight <= 0.0)
+			return 0.0;
+
+		double x = p.x, y = p.y, z = p.z;
+		double sum =
+			A00 * x * x + A11 * y * y + A22 * z * z +
+			2.0 * (A01 * x * y + A02 * x * z + A12 * y * z) +
+			2.0 * (B0 * x + B1 * y + B2 * z) +
+			C;
+		return sum / Weight;
+	}
+};
+
+// --------------------------------------------------------
+// How an edge (between two positions) is used: by how many
+// triangles, and whether their attributes agree across it
+// --------------------------------------------------------
+struct SimplifierEdge
+{
+	unsigned int Uses;
+	unsigned int WedgeA;	// Wedge at the lower position, in the first triangle
+	unsigned int WedgeB;	// Wedge at the higher position
+	bool Seam;
+
+	// Seams and borders are the lines the simplifier has to keep
+	bool IsLine() const { return Seam || Uses != 2; }
+};
+
+// --------------------------------------------------------
+// A triangle's positions, rotated to a canonical order
+// --------------------------------------------------------
+struct SimplifierTriangleKey
+{
+	unsigned int A, B, C;
+	unsigned int Triangle;
+
+	bool operator<(const SimplifierTriangleKey& other) const
+	{
+		if (A != other.A) return A < other.A;
+		if (B != other.B) return B < other.B;
+		if (C != other.C) return C < other.C;
+		return Triangle < other.Triangle;
+	}
+};
+
+// --------------------------------------------------------
+// Moving one vertex onto a neighbor, and what it would cost
+// --------------------------------------------------------
+struct SimplifierCollapse
+{
+	float Error;
+	unsigned int From;
+	unsigned int To;
+};
+
+// --------------------------------------------------------
+// State shared by the passes of a single Simplify() call
+// --------------------------------------------------------
+struct SimplifierMesh
+{
+	const Vertex* Verts;
+	unsigned int* Indices;
+	size_t IndexCount;
+
+	std::vector<unsigned int> PositionId;
+	std::vector<unsigned int> Wedge;		// First vertex at the same position with the same UV and normal
+
+	// Rebuilt for every pass
+	std::unordered_map<unsigned long long, SimplifierEdge> Edges;
+	std::vector<char> Kind;
+	std::vector<unsigned int> Offsets;		// Position -> triangle adjacency
+	std::vector<unsigned int> Adjacency;
+
+	static unsigned long long EdgeKey(unsigned int a, unsigned int b)
+	{
+		return ((unsigned long long)std::min(a, b) << 32) | std::max(a, b);
+	}
+
+	// Next corner of the same triangle
+	unsigned int NextCorner(size_t i) const { return Indices[i - i % 3 + (i + 1) % 3]; }
+};
+
+// --------------------------------------------------------
+// Finds the seams and borders of the current triangles, and
+// from them what each position is allowed to do
+// --------------------------------------------------------
+static void ClassifyPositions(SimplifierMesh& mesh, size_t positionCount)
+{
+	mesh.Edges.clear();
+	for (size_t i = 0; i < mesh.IndexCount; i++)
+	{
+		unsigned int va = mesh.Indices[i];
+		unsigned int vb = mesh.NextCorner(i);
+		unsigned int a = mesh.PositionId[va];
+		unsigned int b = mesh.PositionId[vb];
+		if (a == b)
+			continue;
+
+		unsigned int wedgeLow = mesh.Wedge[a < b ? va : vb];
+		unsigned int wedgeHigh = mesh.Wedge[a < b ? vb : va];
+		auto inserted = mesh.Edges.insert({ SimplifierMesh::EdgeKey(a, b), { 0, wedgeLow, wedgeHigh, false } });
+		SimplifierEdge& edge = inserted.first->second;
+		edge.Uses++;
+		if (edge.WedgeA != wedgeLow || edge.WedgeB != wedgeHigh)
+			edge.Seam = true;
+	}
+
+	// Positions inside a smooth patch have no lines through them, and
+	// positions partway along a line have exactly two line edges
+	std::vector<unsigned int> lineEdges(positionCount, 0);
+	mesh.Kind.assign(positionCount, MESH_SIMPLIFIER_MANIFOLD);
+	for (auto& e : mesh.Edges)
+	{
+		unsigned int a = (unsigned int)(e.first >> 32);
+		unsigned int b = (unsigned int)(e.first & 0xFFFFFFFF);
+		if (e.second.Uses > 2)
+		{
+			mesh.Kind[a] = MESH_SIMPLIFIER_LOCKED;
+			mesh.Kind[b] = MESH_SIMPLIFIER_LOCKED;
+		}
+		if (e.second.IsLine())
+		{
+			lineEdges[a]++;
+			lineEdges[b]++;
+		}
+	}
+
+	for (size_t p = 0; p < positionCount; p++)
+	{
+		if (mesh.Kind[p] == MESH_SIMPLIFIER_LOCKED)
+			continue;
+		if (lineEdges[p] == 2)
+			mesh.Kind[p] = MESH_SIMPLIFIER_LINE;
+		else if (lineEdges[p] != 0)
+			mesh.Kind[p] = MESH_SIMPLIFIER_LOCKED;
+	}
+
+	// Position -> triangle adjacency
+	mesh.Offsets.assign(positionCount + 1, 0);
+	for (size_t i = 0; i < mesh.IndexCount; i++)
+		mesh.Offsets[mesh.PositionId[mesh.Indices[i]] + 1]++;
+	for (size_t p = 0; p < positionCount; p++)
+		mesh.Offsets[p + 1] += mesh.Offsets[p];
+
+	mesh.Adjacency.resize(mesh.IndexCount);
+	std::vector<unsigned int> fill(mesh.Offsets.begin(), mesh.Offsets.end() - 1);
+	for (size_t i = 0; i < mesh.IndexCount; i++)
+		mesh.Adjacency[fill[mesh.PositionId[mesh.Indices[i]]]++] = (unsigned int)(i / 3);
+}
+
+// --------------------------------------------------------
+// Can the collapse happen without tearing or folding the
+// surface?  If so, fills in which vertex each corner at
+// the collapsing position becomes: the vertex across the
+// collapsing edge with the same attributes (its wedge)
+// --------------------------------------------------------
+static bool CanCollapse(
+	const SimplifierCollapse& collapse,
+	const SimplifierMesh& mesh,
+	std::vector<unsigned int>& fromNeighbors,
+	std::vector<unsigned int>& toNeighbors,
+	std::vector<std::pair<unsigned int, unsigned int>>& wedgeTargets)
+{
+	const std::vector<unsigned int>& positionId = mesh.PositionId;
+	unsigned int from = positionId[collapse.From];
+	unsigned int to = positionId[collapse.To];
+
+	// Link condition: the two ends may only have the corners of
+	// the triangles along the edge in common, or the collapse
+	// would pinch the surface into something non-manifold.
+	// Along the way, pair up the wedges on either end
+	unsigned int sharedTriangles = 0;
+	fromNeighbors.clear();
+	wedgeTargets.clear();
+	for (unsigned int a = mesh.Offsets[from]; a < mesh.Offsets[from + 1]; a++)
+	{
+		const unsigned int* tri = mesh.Indices + mesh.Adjacency[a] * 3;
+		unsigned int fromCorner = 0;
+		unsigned int toCorner = 0;
+		bool shared = false;
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int p = positionId[tri[k]];
+			if (p == to)
+			{
+				shared = true;
+				toCorner = tri[k];
+			}
+			if (p == from)
+				fromCorner = tri[k];
+			else
+				fromNeighbors.push_back(p);
+		}
+
+		if (shared)
+		{
+			sharedTriangles++;
+			wedgeTargets.push_back({ mesh.Wedge[fromCorner], toCorner });
+		}
+	}
+
+	toNeighbors.clear();
+	for (unsigned int a = mesh.Offsets[to]; a < mesh.Offsets[to + 1]; a++)
+	{
+		const unsigned int* tri = mesh.Indices + mesh.Adjacency[a] * 3;
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int p = positionId[tri[k]];
+			if (p != to)
+				toNeighbors.push_back(p);
+		}
+	}
+
+	std::sort(fromNeighbors.begin(), fromNeighbors.end());
+	fromNeighbors.erase(std::unique(fromNeighbors.begin(), fromNeighbors.end()), fromNeighbors.end());
+	std::sort(toNeighbors.begin(), toNeighbors.end());
+	toNeighbors.erase(std::unique(toNeighbors.begin(), toNeighbors.end()), toNeighbors.end());
+
+	size_t common = 0;
+	for (size_t i = 0, j = 0; i < fromNeighbors.size() && j < toNeighbors.size();)
+	{
+		if (fromNeighbors[i] < toNeighbors[j]) i++;
+		else if (fromNeighbors[i] > toNeighbors[j]) j++;
+		else { common++; i++; j++; }
+	}
+
+	if (sharedTriangles == 0 || common != sharedTriangles)
+		return false;
+
+	// Every wedge at the collapsing end needs a partner on the other
+	// end (and only one), or its attributes would bleed across a seam
+	for (size_t i = 0; i < wedgeTargets.size(); i++)
+		for (size_t j = i + 1; j < wedgeTargets.size(); j++)
+			if (wedgeTargets[i].first == wedgeTargets[j].first &&
+				mesh.Wedge[wedgeTargets[i].second] != mesh.Wedge[wedgeTargets[j].second])
+				return false;
+
+	// No triangle that survives may flip over (or get too thin)
+	XMVECTOR target = XMLoadFloat3(&mesh.Verts[collapse.To].Position);
+	for (unsigned int a = mesh.Offsets[from]; a < mesh.Offsets[from + 1]; a++)
+	{
+		const unsigned int* tri = mesh.Indices + mesh.Adjacency[a] * 3;
+		XMVECTOR before[3];
+		XMVECTOR after[3];
+		bool shared = false;
+		bool paired = false;
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int p = positionId[tri[k]];
+			shared |= (p == to);
+			before[k] = XMLoadFloat3(&mesh.Verts[tri[k]].Position);
+			after[k] = (p == from) ? target : before[k];
+
+			if (p == from)
+				for (auto& w : wedgeTargets)
+					paired |= (w.first == mesh.Wedge[tri[k]]);
+		}
+
+		if (!paired)
+			return false;
+		if (shared)
+			continue;
+
+		XMVECTOR normalBefore = XMVector3Cross(before[1] - before[0], before[2] - before[0]);
+		XMVECTOR normalAfter = XMVector3Cross(after[1] - after[0], after[2] - after[0]);
+		float lengths = XMVectorGetX(XMVector3Length(normalBefore)) * XMVectorGetX(XMVector3Length(normalAfter));
+		if (XMVectorGetX(XMVector3Dot(normalBefore, normalAfter)) <= MESH_SIMPLIFIER_MIN_NORMAL_DOT * lengths)
+			return false;
+	}
+
+	return true;
+}
+
+size_t MeshSimplifier::Simplify(
+	const Vertex* verts,
+	size_t vertexCount,
+	unsigned int* indices,
+	size_t indexCount,
+	size_t targetIndexCount,
+	float maxError,
+	float* resultError)
+{
+	if (resultError) *resultError = 0.0f;
+
+	SimplifierMesh mesh;
+	mesh.Verts = verts;
+	mesh.Indices = indices;
+	mesh.IndexCount = (indexCount / 3) * 3;
+	if (mesh.IndexCount == 0 || vertexCount == 0)
+		return mesh.IndexCount;
+
+	// Triangles are connected through shared positions, so the
+	// copies of a vertex along a seam stay together
+	mesh.PositionId.resize(vertexCount);
+	std::vector<unsigned int> firstCopy;
+	std::unordered_map<XMFLOAT3, unsigned int, SimplifierPositionHash, SimplifierPositionHash> uniquePositions;
+	uniquePositions.reserve(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		auto inserted = uniquePositions.insert({ verts[v].Position, (unsigned int)firstCopy.size() });
+		if (inserted.second)
+			firstCopy.push_back((unsigned int)v);
+		mesh.PositionId[v] = inserted.first->second;
+	}
+	size_t positionCount = firstCopy.size();
+
+	// Copies with the same UV and normal are the same wedge, even if
+	// they weren't welded (so they don't count as a seam)
+	std::vector<unsigned int> nextCopy(vertexCount, MESH_SIMPLIFIER_NONE);
+	std::vector<unsigned int> lastCopy(firstCopy);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		unsigned int p = mesh.PositionId[v];
+		if (lastCopy[p] != v)
+		{
+			nextCopy[lastCopy[p]] = (unsigned int)v;
+			lastCopy[p] = (unsigned int)v;
+		}
+	}
+
+	mesh.Wedge.resize(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		mesh.Wedge[v] = (unsigned int)v;
+		for (unsigned int c = firstCopy[mesh.PositionId[v]]; c != v; c = nextCopy[c])
+		{
+			if (verts[c].UV.x == verts[v].UV.x && verts[c].UV.y == verts[v].UV.y &&
+				verts[c].Normal.x == verts[v].Normal.x && verts[c].Normal.y == verts[v].Normal.y && verts[c].Normal.z == verts[v].Normal.z)
+			{
+				mesh.Wedge[v] = c;
+				break;
+			}
+		}
+	}
+
+	// Triangles that exactly overlap another (same corners, same winding)
+	// can't be seen, but would make every edge they touch non-manifold
+	std::vector<SimplifierTriangleKey> keys(mesh.IndexCount / 3);
+	for (size_t t = 0; t < keys.size(); t++)
+	{
+		unsigned int p[3];
+		for (int k = 0; k < 3; k++)
+			p[k] = mesh.PositionId[indices[t * 3 + k]];
+
+		// Rotate the lowest position first, keeping the winding
+		int first = (p[0] <= p[1] && p[0] <= p[2]) ? 0 : (p[1] <= p[2] ? 1 : 2);
+		keys[t] = { p[first], p[(first + 1) % 3], p[(first + 2) % 3], (unsigned int)t };
+	}
+	std::sort(keys.begin(), keys.end());
+
+	std::vector<char> duplicate(keys.size(), 0);
+	for (size_t k = 1; k < keys.size(); k++)
+		if (keys[k].A == keys[k - 1].A && keys[k].B == keys[k - 1].B && keys[k].C == keys[k - 1].C)
+			duplicate[keys[k].Triangle] = 1;
+
+	size_t unique = 0;
+	for (size_t t = 0; t < keys.size(); t++)
+	{
+		if (duplicate[t])
+			continue;
+		for (int k = 0; k < 3; k++)
+			indices[unique * 3 + k] = indices[t * 3 + k];
+		unique++;
+	}
+	mesh.IndexCount = unique * 3;
+
+	// Every position starts with the planes of the triangles around it.
+	// Seams and borders also get planes through them, perpendicular to
+	// the surface, which keep the lines themselves from wandering
+	ClassifyPositions(mesh, positionCount);
+	std::vector<SimplifierQuadric> quadrics(positionCount, SimplifierQuadric{});
+	for (size_t i = 0; i < mesh.IndexCount; i += 3)
+	{
+		XMVECTOR p[3];
+		for (int k = 0; k < 3; k++)
+			p[k] = XMLoadFloat3(&verts[indices[i + k]].Position);
+
+		XMVECTOR normal = XMVector3Cross(p[1] - p[0], p[2] - p[0]);
+		float area = XMVectorGetX(XMVector3Length(normal)) * 0.5f;
+		if (area <= 0.0f)
+			continue;
+		normal = XMVector3Normalize(normal);
+
+		XMVECTOR plane = XMPlaneFromPointNormal(p[0], normal);
+		for (int k = 0; k < 3; k++)
+			quadrics[mesh.PositionId[indices[i + k]]].AddPlane(plane, area);
+
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int a = mesh.PositionId[indices[i + k]];
+			unsigned int b = mesh.PositionId[indices[i + (k + 1) % 3]];
+			auto edge = mesh.Edges.find(SimplifierMesh::EdgeKey(a, b));
+			if (edge == mesh.Edges.end() || !edge->second.IsLine())
+				continue;
+
+			// Weighted by the edge's length squared, comparable to an area
+			XMVECTOR edgeNormal = XMVector3Cross(p[(k + 1) % 3] - p[k], normal);
+			float lengthSq = XMVectorGetX(XMVector3LengthSq(edgeNormal));
+			if (lengthSq <= 0.0f)
+				continue;
+
+			XMVECTOR edgePlane = XMPlaneFromPointNormal(p[k], XMVector3Normalize(edgeNormal));
+			quadrics[a].AddPlane(edgePlane, lengthSq);
+			quadrics[b].AddPlane(edgePlane, lengthSq);
+		}
+	}
+
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<char> touched;
+	std::vector<SimplifierCollapse> collapses;
+	std::vector<unsigned int> fromNeighbors;
+	std::vector<unsigned int> toNeighbors;
+	std::vector<std::pair<unsigned int, unsigned int>> wedgeTargets;
+	float errorUsed = 0.0f;
+
+	// Each pass collapses the cheapest edges whose neighborhoods don't
+	// overlap, then finds the seams and rebuilds the adjacency again
+	for (bool first = true; mesh.IndexCount > targetIndexCount; first = false)
+	{
+		if (!first)
+			ClassifyPositions(mesh, positionCount);
+
+		// Every edge can collapse either way, as long as the end that
+		// moves isn't locked (and a seam only slides along itself).
+		// The error is measured at the end that stays
+		collapses.clear();
+		for (size_t i = 0; i < mesh.IndexCount; i++)
+		{
+			unsigned int ends[2] = { indices[i], mesh.NextCorner(i) };
+			unsigned int a = mesh.PositionId[ends[0]];
+			unsigned int b = mesh.PositionId[ends[1]];
+			if (a == b)
+				continue;
+
+			bool line = mesh.Edges[SimplifierMesh::EdgeKey(a, b)].IsLine();
+			for (int e = 0; e < 2; e++)
+			{
+				unsigned int from = mesh.PositionId[ends[e]];
+				unsigned int to = mesh.PositionId[ends[1 - e]];
+				char kind = mesh.Kind[from];
+				if (kind == MESH_SIMPLIFIER_LOCKED || (kind == MESH_SIMPLIFIER_LINE && !line))
+					continue;
+
+				SimplifierQuadric q = quadrics[from];
+				q.Add(quadrics[to]);
+				double error = q.Evaluate(verts[ends[1 - e]].Position);
+				collapses.push_back({ (float)sqrt(std::max(error, 0.0)), ends[e], ends[1 - e] });
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(),
+			[](const SimplifierCollapse& a, const SimplifierCollapse& b) { return a.Error < b.Error; });
+
+		// Cheapest first, skipping anything next to an earlier collapse
+		// (its adjacency would be out of date until the next pass)
+		touched.assign(positionCount, 0);
+		for (size_t v = 0; v < vertexCount; v++)
+			remap[v] = (unsigned int)v;
+
+		size_t trianglesToRemove = (mesh.IndexCount - targetIndexCount + 2) / 3;
+		size_t trianglesRemoved = 0;
+		for (const SimplifierCollapse& c : collapses)
+		{
+			if (c.Error > maxError || trianglesRemoved >= trianglesToRemove)
+				break;
+
+			unsigned int from = mesh.PositionId[c.From];
+			unsigned int to = mesh.PositionId[c.To];
+			if (touched[from] || touched[to])
+				continue;
+
+			if (!CanCollapse(c, mesh, fromNeighbors, toNeighbors, wedgeTargets))
+				continue;
+
+			quadrics[to].Add(quadrics[from]);
+			errorUsed = std::max(errorUsed, c.Error);
+
+			for (unsigned int a = mesh.Offsets[from]; a < mesh.Offsets[from + 1]; a++)
+			{
+				const unsigned int* tri = indices + mesh.Adjacency[a] * 3;
+				bool shared = false;
+				for (int k = 0; k < 3; k++)
+				{
+					unsigned int p = mesh.PositionId[tri[k]];
+					shared |= (p == to);
+					touched[p] = 1;
+
+					if (p == from)
+						for (auto& w : wedgeTargets)
+							if (w.first == mesh.Wedge[tri[k]])
+								remap[tri[k]] = w.second;
+				}
+				if (shared)
+					trianglesRemoved++;
+			}
+		}
+
+		// Nothing left that's cheap enough (or allowed)?
+		if (trianglesRemoved == 0)
+			break;
+
+		// Apply the collapses, dropping the triangles that vanished
+		size_t kept = 0;
+		for (size_t i = 0; i < mesh.IndexCount; i += 3)
+		{
+			unsigned int a = remap[indices[i + 0]];
+			unsigned int b = remap[indices[i + 1]];
+			unsigned int c = remap[indices[i + 2]];
+			unsigned int pa = mesh.PositionId[a];
+			unsigned int pb = mesh.PositionId[b];
+			unsigned int pc = mesh.PositionId[c];
+			if (pa == pb || pb == pc || pa == pc)
+				continue;
+
+			indices[kept++] = a;
+			indices[kept++] = b;
+			indices[kept++] = c;
+		}
+		mesh.IndexCount = kept;
+	}
+
+	if (resultError) *resultError = errorUsed;
+	return mesh.IndexCount;
+}
+
+void MeshSimplifier::BuildLods(
+	const Vertex* verts,
+	size_t vertexCount,
+	std::vector<unsigned int>& indices,
+	std::vector<MeshLod>& lods,
+	unsigned int maxLevels,
+	float reduction,
+	float baseError)
+{
+	lods.clear();
+	size_t fullCount = indices.size();
+	lods.push_back({ 0, (unsigned int)fullCount, 0.0f });
+
+	float radius = GetRadius(verts, vertexCount);
+	float maxError = baseError * radius;
+	size_t previousCount = fullCount;
+	std::vector<unsigned int> level;
+	for (unsigned int l = 1; l < maxLevels; l++, maxError *= 2.0f)
+	{
+		// Always start from the full mesh, so the errors don't compound.
+		// The quadric error only roughly follows the real distance, so
+		// it's tightened until the measured distance is within the limit
+		size_t target = (size_t)(previousCount / 3 * reduction) * 3;
+		float quadricLimit = maxError;
+		size_t count = 0;
+		float error = 0.0f;
+		bool fits = false;
+		unsigned int attempt = 0;
+		for (; attempt <= MESH_LOD_RETRIES && !fits; attempt++, quadricLimit *= MESH_LOD_RETRY_SCALE)
+		{
+			level.assign(indices.begin(), indices.begin() + fullCount);
+			count = Simplify(verts, vertexCount, level.data(), fullCount, target, quadricLimit);
+			if (count == 0 || count > previousCount * MESH_LOD_MIN_REDUCTION)
+				break;
+
+			error = MeasureHausdorff(verts, indices.data(), fullCount, level.data(), count);
+			fits = error <= maxError;
+		}
+
+		// Too little simplification left even at the full limit (tighter
+		// ones would only give less), so there's nothing more to build
+		if (!fits && attempt == 0)
+			break;
+
+		// Too far off (or too little left) at every tighter limit; the
+		// next level's limit is twice as loose
+		if (!fits)
+			continue;
+
+		MeshOptimizer::OptimizeVertexCache(level.data(), count, vertexCount);
+		lods.push_back({ (unsigned int)indices.size(), (unsigned int)count, error });
+		indices.insert(indices.end(), level.begin(), level.begin() + count);
+		previousCount = count;
+	}
+}
+
+float MeshSimplifier::GetRadius(const Vertex* verts, size_t vertexCount)
+{
+	if (vertexCount == 0)
+		return 0.0f;
+
+	XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		XMVECTOR pos = XMLoadFloat3(&verts[v].Position);
+		boundsMin = XMVectorMin(boundsMin, pos);
+		boundsMax = XMVectorMax(boundsMax, pos);
+	}
+	return XMVectorGetX(XMVector3Length(boundsMax - boundsMin)) * 0.5f;
+}
+
+// --------------------------------------------------------
+// Squared distance from a point to the closest point on a
+// triangle (Ericson, Real-Time Collision Detection 5.1.5)
+// --------------------------------------------------------
+static float DistanceToTriangleSq(FXMVECTOR p, FXMVECTOR a, FXMVECTOR b, GXMVECTOR c)
+{
+	XMVECTOR ab = b - a;
+	XMVECTOR ac = c - a;
+	XMVECTOR ap = p - a;
+	float d1 = XMVectorGetX(XMVector3Dot(ab, ap));
+	float d2 = XMVectorGetX(XMVector3Dot(ac, ap));
+	if (d1 <= 0.0f && d2 <= 0.0f)
+		return XMVectorGetX(XMVector3LengthSq(ap));
+
+	XMVECTOR bp = p - b;
+	float d3 = XMVectorGetX(XMVector3Dot(ab, bp));
+	float d4 = XMVectorGetX(XMVector3Dot(ac, bp));
+	if (d3 >= 0.0f && d4 <= d3)
+		return XMVectorGetX(XMVector3LengthSq(bp));
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		return XMVectorGetX(XMVector3LengthSq(ap - ab * (d1 / (d1 - d3))));
+
+	XMVECTOR cp = p - c;
+	float d5 = XMVectorGetX(XMVector3Dot(ab, cp));
+	float d6 = XMVectorGetX(XMVector3Dot(ac, cp));
+	if (d6 >= 0.0f && d5 <= d6)
+		return XMVectorGetX(XMVector3LengthSq(cp));
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		return XMVectorGetX(XMVector3LengthSq(ap - ac * (d2 / (d2 - d6))));
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+		return XMVectorGetX(XMVector3LengthSq(bp - (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+
+	float denom = 1.0f / (va + vb + vc);
+	return XMVectorGetX(XMVector3LengthSq(ap - ab * (vb * denom) - ac * (vc * denom)));
+}
+
+// --------------------------------------------------------
+// Bounding sphere of a run of consecutive triangles
+// --------------------------------------------------------
+struct SimplifierTriangleGroup
+{
+	XMFLOAT3 Center;
+	float Radius;
+	size_t FirstIndex;
+	size_t IndexCount;
+};
+
+// --------------------------------------------------------
+// Interleaves the bits of three 10-bit cell coordinates
+// --------------------------------------------------------
+static unsigned int GetMortonCode(unsigned int x, unsigned int y, unsigned int z)
+{
+	unsigned int code = 0;
+	for (unsigned int bit = 0; bit < 10; bit++)
+	{
+		code |= ((x >> bit) & 1) << (bit * 3 + 0);
+		code |= ((y >> bit) & 1) << (bit * 3 + 1);
+		code |= ((z >> bit) & 1) << (bit * 3 + 2);
+	}
+	return code;
+}
+
+// --------------------------------------------------------
+// Furthest any sample of surface A is from surface B
+// --------------------------------------------------------
+static float MeasureDirectedDistance(
+	const Vertex* verts,
+	const unsigned int* indicesA,
+	size_t indexCountA,
+	const unsigned int* indicesB,
+	size_t indexCountB)
+{
+	// Sort B's triangles along a Morton curve through their centers,
+	// so runs of them make compact groups
+	size_t triCountB = indexCountB / 3;
+	XMVECTOR boundsMinB = XMVectorReplicate(FLT_MAX);
+	XMVECTOR boundsMaxB = XMVectorReplicate(-FLT_MAX);
+	for (size_t i = 0; i < triCountB * 3; i++)
+	{
+		XMVECTOR pos = XMLoadFloat3(&verts[indicesB[i]].Position);
+		boundsMinB = XMVectorMin(boundsMinB, pos);
+		boundsMaxB = XMVectorMax(boundsMaxB, pos);
+	}
+	XMVECTOR cellScale = XMVectorReplicate(1023.0f) / XMVectorMax(boundsMaxB - boundsMinB, XMVectorReplicate(FLT_MIN));
+
+	std::vector<std::pair<unsigned int, unsigned int>> order(triCountB);
+	for (size_t t = 0; t < triCountB; t++)
+	{
+		XMVECTOR center =
+			(XMLoadFloat3(&verts[indicesB[t * 3 + 0]].Position) +
+			XMLoadFloat3(&verts[indicesB[t * 3 + 1]].Position) +
+			XMLoadFloat3(&verts[indicesB[t * 3 + 2]].Position)) / 3.0f;
+		XMFLOAT3 cell;
+		XMStoreFloat3(&cell, (center - boundsMinB) * cellScale);
+		order[t] = { GetMortonCode((unsigned int)cell.x, (unsigned int)cell.y, (unsigned int)cell.z), (unsigned int)t };
+	}
+	std::sort(order.begin(), order.end());
+
+	std::vector<unsigned int> sortedB(triCountB * 3);
+	for (size_t t = 0; t < triCountB; t++)
+		for (int k = 0; k < 3; k++)
+			sortedB[t * 3 + k] = indicesB[order[t].second * 3 + k];
+
+	std::vector<SimplifierTriangleGroup> groups;
+	for (size_t first = 0; first < sortedB.size(); first += MESH_SIMPLIFIER_GROUP_SIZE * 3)
+	{
+		size_t count = std::min((size_t)MESH_SIMPLIFIER_GROUP_SIZE * 3, sortedB.size() - first);
+		XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+		for (size_t i = first; i < first + count; i++)
+		{
+			XMVECTOR pos = XMLoadFloat3(&verts[sortedB[i]].Position);
+			boundsMin = XMVectorMin(boundsMin, pos);
+			boundsMax = XMVectorMax(boundsMax, pos);
+		}
+
+		XMVECTOR center = (boundsMin + boundsMax) * 0.5f;
+		float radiusSq = 0.0f;
+		for (size_t i = first; i < first + count; i++)
+			radiusSq = std::max(radiusSq, XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&verts[sortedB[i]].Position) - center)));
+
+		SimplifierTriangleGroup group;
+		XMStoreFloat3(&group.Center, center);
+		group.Radius = sqrtf(radiusSq);
+		group.FirstIndex = first;
+		group.IndexCount = count;
+		groups.push_back(group);
+	}
+	if (groups.empty())
+		return 0.0f;
+
+	size_t triCountA = indexCountA / 3;
+	size_t stride = std::max((size_t)1, triCountA / MESH_SIMPLIFIER_MAX_SAMPLED_TRIANGLES);
+
+	float worstSq = 0.0f;
+	std::vector<std::pair<float, unsigned int>> nearest;
+	nearest.reserve(groups.size());
+	for (size_t t = 0; t < triCountA; t += stride)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&verts[indicesA[t * 3 + 0]].Position);
+		XMVECTOR p1 = XMLoadFloat3(&verts[indicesA[t * 3 + 1]].Position);
+		XMVECTOR p2 = XMLoadFloat3(&verts[indicesA[t * 3 + 2]].Position);
+
+		// Each corner is shared by several triangles, so one per
+		// triangle is enough to end up sampling all of them
+		XMVECTOR samples[5] =
+		{
+			p0,
+			(p0 + p1) * 0.5f, (p1 + p2) * 0.5f, (p2 + p0) * 0.5f,
+			(p0 + p1 + p2) / 3.0f,
+		};
+
+		for (int s = 0; s < 5; s++)
+		{
+			// Nearest groups first, until the rest can't get any closer
+			nearest.clear();
+			for (size_t g = 0; g < groups.size(); g++)
+			{
+				float lower = XMVectorGetX(XMVector3Length(samples[s] - XMLoadFloat3(&groups[g].Center))) - groups[g].Radius;
+				nearest.push_back({ std::max(lower, 0.0f), (unsigned int)g });
+			}
+			std::sort(nearest.begin(), nearest.end());
+
+			float bestSq = FLT_MAX;
+			for (size_t n = 0; n < nearest.size(); n++)
+			{
+				if (nearest[n].first * nearest[n].first >= bestSq)
+					break;
+
+				const SimplifierTriangleGroup& group = groups[nearest[n].second];
+				for (size_t i = group.FirstIndex; i < group.FirstIndex + group.IndexCount; i += 3)
+				{
+					float distanceSq = DistanceToTriangleSq(
+						samples[s],
+						XMLoadFloat3(&verts[sortedB[i + 0]].Position),
+						XMLoadFloat3(&verts[sortedB[i + 1]].Position),
+						XMLoadFloat3(&verts[sortedB[i + 2]].Position));
+					bestSq = std::min(bestSq, distanceSq);
+				}
+			}
+
+			worstSq = std::max(worstSq, bestSq);
+		}
+	}
+
+	return sqrtf(worstSq);
+}
+
+float MeshSimplifier::MeasureHausdorff(
+	const Vertex* verts,
+	const unsigned int* indicesA,
+	size_t indexCountA,
+	const unsigned int* indicesB,
+	size_t indexCountB)
+{
+	return std::max(
+		MeasureDirectedDistance(verts, indicesA, indexCountA, indicesB, indexCountB),
+		MeasureDirectedDistance(verts, indicesB, indexCountB, indicesA, indexCountA));
+}
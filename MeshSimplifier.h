@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+#include "Vertex.h"
+
+// Most levels of detail a mesh gets, including the full one
+#define MESH_LOD_MAX_LEVELS 5
+
+// Each level aims for this fraction of the previous level's
+// triangles, and is dropped if it can't get below 90% of them
+#define MESH_LOD_REDUCTION		0.5f
+#define MESH_LOD_MIN_REDUCTION	0.9f
+
+// Error allowed for the first simplified level, as a fraction
+// of the mesh's radius (doubled for each level after that)
+#define MESH_LOD_BASE_ERROR 0.01f
+
+// A level whose measured (Hausdorff) error is over its limit is
+// simplified again with the quadric limit scaled down, up to this
+// many times, and skipped if it still doesn't fit
+#define MESH_LOD_RETRIES		4
+#define MESH_LOD_RETRY_SCALE	0.5f
+
+// --------------------------------------------------------
+// One level of detail: a range of the mesh's index buffer.
+// All levels share the mesh's vertex buffer.
+// --------------------------------------------------------
+struct MeshLod
+{
+	unsigned int FirstIndex;
+	unsigned int IndexCount;
+	float Error;				// Hausdorff distance from the full mesh, in object space units
+};
+
+// --------------------------------------------------------
+// Quadric error metric simplification (Garland & Heckbert
+// 1997) by collapsing edges onto existing vertices, so the
+// simplified index buffers can keep using the original
+// vertex buffer.  Pure C++, like MeshOptimizer.
+// --------------------------------------------------------
+class MeshSimplifier
+{
+public:
+	// Collapses edges, cheapest first, until the index count reaches the
+	// target or the next collapse's error would exceed maxError.  The
+	// error is the square root of the vertex's accumulated quadric (its
+	// summed squared distances to the original planes around it), in
+	// object space units.  It isn't a bound on how far the surface moves:
+	// the measured Hausdorff distance can be about twice as large.
+	// Vertices on UV/normal seams and open borders only slide along
+	// them, and vertices where seams meet or end never move.
+	// The indices are rewritten in place; returns the new index count
+	static size_t Simplify(
+		const Vertex* verts,
+		size_t vertexCount,
+		unsigned int* indices,
+		size_t indexCount,
+		size_t targetIndexCount,
+		float maxError,
+		float* resultError = 0);
+
+	// Appends simplified levels after the full mesh (the whole index
+	// buffer on input), each simplified from the full mesh.  Every
+	// level is measured against the full mesh and kept only if its
+	// Hausdorff distance is within its error limit
+	static void BuildLods(
+		const Vertex* verts,
+		size_t vertexCount,
+		std::vector<unsigned int>& indices,
+		std::vector<MeshLod>& lods,
+		unsigned int maxLevels = MESH_LOD_MAX_LEVELS,
+		float reduction = MESH_LOD_REDUCTION,
+		float baseError = MESH_LOD_BASE_ERROR);
+
+	// Symmetric Hausdorff distance between two surfaces made of the same
+	// vertices, sampled at the corners, edge midpoints and centers of
+	// their triangles (every few triangles for large meshes)
+	static float MeasureHausdorff(
+		const Vertex* verts,
+		const unsigned int* indicesA,
+		size_t indexCountA,
+		const unsigned int* indicesB,
+		size_t indexCountB);
+
+	// Half the diagonal of the vertices' bounding box
+	static float GetRadius(const Vertex* verts, size_t vertexCount);
+};
+
@@ -0,0 +1,327 @@
+#include "MeshTangents.h"
+
+#include <DirectXMath.h>
+#include <chrono>
+#include <math.h>
+#include <stddef.h>
+#include <thread>
+
+using namespace DirectX;
+
+// Vertex::UV directly follows Vertex::Position, so a single
+// four-float load of the position also picks up the u coordinate
+static_assert(offsetof(Vertex, UV) == offsetof(Vertex, Position) + sizeof(XMFLOAT3), "Tangent loads expect UV right after Position");
+
+// --------------------------------------------------------
+// One thread's share of the tangent calculation: a range of
+// triangles, accumulated into that thread's own buffer so
+// no two threads ever write to the same memory
+// --------------------------------------------------------
+struct TangentJob
+{
+	const Vertex* Verts;
+	const unsigned int* Indices;
+	size_t FirstTriangle;
+	size_t EndTriangle;
+	XMFLOAT4A* Accumulated;
+};
+
+// Triangles whose UVs (nearly) don't span an area have no
+// meaningful tangent, so they contribute nothing
+#define TANGENT_MIN_UV_AREA 1e-20f
+
+// Fewer triangles than this per thread aren't worth a thread
+#define TANGENT_MIN_TRIANGLES_PER_THREAD 65536
+
+static void AccumulateTangents(TangentJob* job)
+{
+	const Vertex* verts = job->Verts;
+	XMFLOAT4A* acc = job->Accumulated;
+
+	for (size_t t = job->FirstTriangle; t < job->EndTriangle; t++)
+	{
+		unsigned int i0 = job->Indices[t * 3];
+		unsigned int i1 = job->Indices[t * 3 + 1];
+		unsigned int i2 = job->Indices[t * 3 + 2];
+
+		// Both edges at once: xyz in position space, w in u
+		XMVECTOR p0 = XMLoadFloat4((const XMFLOAT4*)&verts[i0].Position);
+		XMVECTOR e1 = XMLoadFloat4((const XMFLOAT4*)&verts[i1].Position) - p0;
+		XMVECTOR e2 = XMLoadFloat4((const XMFLOAT4*)&verts[i2].Position) - p0;
+		float s1 = XMVectorGetW(e1);
+		float s2 = XMVectorGetW(e2);
+		float t1 = verts[i1].UV.y - verts[i0].UV.y;
+		float t2 = verts[i2].UV.y - verts[i0].UV.y;
+
+		// Skip degenerate uvs, where r would be inf or NaN
+		float det = s1 * t2 - s2 * t1;
+		if (fabsf(det) <= TANGENT_MIN_UV_AREA)
+			continue;
+		float r = 1.0f / det;
+
+		// (w ends up as garbage, and is ignored)
+		XMVECTOR tangent = (e1 * (t2 * r)) - (e2 * (t1 * r));
+
+		XMStoreFloat4A(&acc[i0], XMLoadFloat4A(&acc[i0]) + tangent);
+		XMStoreFloat4A(&acc[i1], XMLoadFloat4A(&acc[i1]) + tangent);
+		XMStoreFloat4A(&acc[i2], XMLoadFloat4A(&acc[i2]) + tangent);
+	}
+}
+
+// --------------------------------------------------------
+// Sums every thread's accumulated tangents for a range of
+// vertices, then makes them orthogonal to the normals
+// --------------------------------------------------------
+static void FinishTangents(Vertex* verts, size_t firstVert, size_t endVert, const std::vector<std::vector<XMFLOAT4A>>* accumulated)
+{
+	for (size_t v = firstVert; v < endVert; v++)
+	{
+		XMVECTOR tangent = XMVectorZero();
+		for (const std::vector<XMFLOAT4A>& acc : *accumulated)
+			tangent += XMLoadFloat4A(&acc[v]);
+
+		// Use Gram-Schmidt orthogonalize
+		XMVECTOR normal = XMLoadFloat3(&verts[v].Normal);
+		tangent = XMVector3Normalize(
+			tangent - normal * XMVector3Dot(normal, tangent));
+
+		// Nothing left (only degenerate uvs, or a tangent parallel to
+		// the normal)?  Any direction perpendicular to the normal will do
+		if (XMVector3Equal(tangent, XMVectorZero()))
+		{
+			XMVECTOR axis = fabsf(verts[v].Normal.x) < 0.9f ? XMVectorSet(1, 0, 0, 0) : XMVectorSet(0, 1, 0, 0);
+			tangent = XMVector3Normalize(XMVector3Cross(normal, axis));
+		}
+
+		// Store the tangent
+		XMStoreFloat3(&verts[v].Tangent, tangent);
+	}
+}
+
+// --------------------------------------------------------
+// Each triangle's edges are handled as whole SIMD vectors,
+// and large meshes are split across threads that each sum
+// into their own buffer, so no atomics are needed
+// --------------------------------------------------------
+unsigned int MeshTangents::Calculate(Vertex* verts, int numVerts, unsigned int* indices, int numIndices, unsigned int threadCount)
+{
+	if (numVerts <= 0)
+		return 0;
+
+	// How many threads?  Small meshes stay on this thread alone
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	if (threadCount == 0)
+		threadCount = 1;
+
+	size_t triCount = numIndices / 3;
+	size_t jobCount = triCount / TANGENT_MIN_TRIANGLES_PER_THREAD;
+	if (jobCount > threadCount) jobCount = threadCount;
+	if (jobCount < 1) jobCount = 1;
+
+	// Every job gets its own zeroed accumulation buffer
+	std::vector<std::vector<XMFLOAT4A>> accumulated(jobCount, std::vector<XMFLOAT4A>(numVerts, XMFLOAT4A(0, 0, 0, 0)));
+	std::vector<TangentJob> jobs(jobCount);
+	for (size_t j = 0; j < jobCount; j++)
+	{
+		jobs[j].Verts = verts;
+		jobs[j].Indices = indices;
+		jobs[j].FirstTriangle = triCount * j / jobCount;
+		jobs[j].EndTriangle = triCount * (j + 1) / jobCount;
+		jobs[j].Accumulated = accumulated[j].data();
+	}
+
+	// Accumulate, using this thread for the first job
+	std::vector<std::thread> workers;
+	for (size_t j = 1; j < jobCount; j++)
+		workers.push_back(std::thread(AccumulateTangents, &jobs[j]));
+	AccumulateTangents(&jobs[0]);
+	for (auto& w : workers)
+		w.join();
+	workers.clear();
+
+	// Reduce and orthogonalize, with each thread owning a range of vertices
+	for (size_t j = 1; j < jobCount; j++)
+		workers.push_back(std::thread(FinishTangents, verts, (size_t)numVerts * j / jobCount, (size_t)numVerts * (j + 1) / jobCount, &accumulated));
+	FinishTangents(verts, 0, (size_t)numVerts / jobCount, &accumulated);
+	for (auto& w : workers)
+		w.join();
+
+	return (unsigned int)jobCount;
+}
+
+// --------------------------------------------------------
+// The scalar loop Calculate() replaced, unchanged apart from
+// its name
+// Code originally adapted from: http://www.terathon.com/code/tangent.html
+// Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
+//  - See listing 7.4 in section 7.5 (page 9 of the PDF)
+// --------------------------------------------------------
+void MeshTangents::CalculateReference(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+{
+	// Reset tangents
+	for (int i = 0; i < numVerts; i++)
+	{
+		verts[i].Tangent = XMFLOAT3(0, 0, 0);
+	}
+
+	// Calculate tangents one whole triangle at a time
+	for (int i = 0; i < numIndices;)
+	{
+		// Grab indices and vertices of first triangle
+		unsigned int i1 = indices[i++];
+		unsigned int i2 = indices[i++];
+		unsigned int i3 = indices[i++];
+		Vertex* v1 = &verts[i1];
+		Vertex* v2 = &verts[i2];
+		Vertex* v3 = &verts[i3];
+
+		// Calculate vectors relative to triangle positions
+		float x1 = v2->Position.x - v1->Position.x;
+		float y1 = v2->Position.y - v1->Position.y;
+		float z1 = v2->Position.z - v1->Position.z;
+
+		float x2 = v3->Position.x - v1->Position.x;
+		float y2 = v3->Position.y - v1->Position.y;
+		float z2 = v3->Position.z - v1->Position.z;
+
+		// Do the same for vectors relative to triangle uv's
+		float s1 = v2->UV.x - v1->UV.x;
+		float t1 = v2->UV.y - v1->UV.y;
+
+		float s2 = v3->UV.x - v1->UV.x;
+		float t2 = v3->UV.y - v1->UV.y;
+
+		// Create vectors for tangent calculation
+		float r = 1.0f / (s1 * t2 - s2 * t1);
+
+		float tx = (t2 * x1 - t1 * x2) * r;
+		float ty = (t2 * y1 - t1 * y2) * r;
+		float tz = (t2 * z1 - t1 * z2) * r;
+
+		// Adjust tangents of each vert of the triangle
+		v1->Tangent.x += tx;
+		v1->Tangent.y += ty;
+		v1->Tangent.z += tz;
+
+		v2->Tangent.x += tx;
+		v2->Tangent.y += ty;
+		v2->Tangent.z += tz;
+
+		v3->Tangent.x += tx;
+		v3->Tangent.y += ty;
+		v3->Tangent.z += tz;
+	}
+
+	// Ensure all of the tangents are orthogonal to the normals
+	for (int i = 0; i < numVerts; i++)
+	{
+		// Grab the two vectors
+		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
+		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
+
+		// Use Gram-Schmidt orthogonalize
+		tangent = XMVector3Normalize(
+			tangent - normal * XMVector3Dot(normal, tangent));
+
+		// Store the tangent
+		XMStoreFloat3(&verts[i].Tangent, tangent);
+	}
+}
+
+// Largest difference between any component of two sets of tangents
+// (NaN if either has one)
+static float LargestDifference(const std::vector<Vertex>& a, const std::vector<Vertex>& b)
+{
+	float largest = 0.0f;
+	for (size_t v = 0; v < a.size(); v++)
+	{
+		XMVECTOR difference = XMVectorAbs(XMLoadFloat3(&a[v].Tangent) - XMLoadFloat3(&b[v].Tangent));
+		float component = XMVectorGetX(XMVectorMax(difference, XMVectorMax(XMVectorSplatY(difference), XMVectorSplatZ(difference))));
+		if (!(component <= largest))
+			largest = component;
+	}
+	return largest;
+}
+
+// --------------------------------------------------------
+// Builds a wavy grid of (at least) the given number of
+// triangles, then calculates its tangents with the reference
+// loop, and with Calculate() on one thread and on all of
+// them.  The grid has no degenerate uvs (where the reference
+// gives NaNs), so only rounding should differ.
+// --------------------------------------------------------
+TangentBenchmark MeshTangents::RunBenchmark(unsigned int triangleCount)
+{
+	// Square grid, with two triangles per cell
+	unsigned int cells = 1;
+	while (2 * cells * cells < triangleCount)
+		cells++;
+	unsigned int side = cells + 1;
+
+	std::vector<Vertex> verts(side * side);
+	for (unsigned int z = 0; z < side; z++)
+	{
+		for (unsigned int x = 0; x < side; x++)
+		{
+			// Height field, with its normal from the partial derivatives
+			float fx = (float)x;
+			float fz = (float)z;
+			float height = sinf(fx * 0.1f) * cosf(fz * 0.13f) * 2.0f;
+			float dx = cosf(fx * 0.1f) * cosf(fz * 0.13f) * 0.2f;
+			float dz = -sinf(fx * 0.1f) * sinf(fz * 0.13f) * 0.26f;
+
+			// UVs that don't line up with the grid, so tangents vary
+			Vertex& v = verts[z * side + x];
+			v.Position = XMFLOAT3(fx, height, fz);
+			XMStoreFloat3(&v.Normal, XMVector3Normalize(XMVectorSet(-dx, 1.0f, -dz, 0.0f)));
+			v.UV = XMFLOAT2(fx * 0.05f + sinf(fz * 0.7f) * 0.01f, fz * 0.05f + fx * 0.01f);
+			v.Tangent = XMFLOAT3(0, 0, 0);
+		}
+	}
+
+	std::vector<unsigned int> indices;
+	indices.reserve(cells * cells * 6);
+	for (unsigned int z = 0; z < cells; z++)
+	{
+		for (unsigned int x = 0; x < cells; x++)
+		{
+			unsigned int i = z * side + x;
+			indices.push_back(i);
+			indices.push_back(i + side);
+			indices.push_back(i + 1);
+			indices.push_back(i + 1);
+			indices.push_back(i + side);
+			indices.push_back(i + side + 1);
+		}
+	}
+
+	TangentBenchmark result = {};
+	result.TriangleCount = (unsigned int)(indices.size() / 3);
+
+	std::vector<Vertex> reference = verts;
+	auto startTime = std::chrono::high_resolution_clock::now();
+	CalculateReference(reference.data(), (int)reference.size(), indices.data(), (int)indices.size());
+	auto endTime = std::chrono::high_resolution_clock::now();
+	result.ReferenceMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+	std::vector<Vertex> calculated = verts;
+	startTime = std::chrono::high_resolution_clock::now();
+	Calculate(calculated.data(), (int)calculated.size(), indices.data(), (int)indices.size(), 1);
+	endTime = std::chrono::high_resolution_clock::now();
+	result.SingleThreadMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+	result.MaxDifference = LargestDifference(reference, calculated);
+
+	calculated = verts;
+	startTime = std::chrono::high_resolution_clock::now();
+	result.ThreadCount = Calculate(calculated.data(), (int)calculated.size(), indices.data(), (int)indices.size());
+	endTime = std::chrono::high_resolution_clock::now();
+	result.ParallelMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+	float difference = LargestDifference(reference, calculated);
+	if (!(difference <= result.MaxDifference))
+		result.MaxDifference = difference;
+	result.Matches = result.MaxDifference <= TANGENT_BENCHMARK_TOLERANCE;
+
+	return result;
+}
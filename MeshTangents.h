@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+
+#include "Vertex.h"
+
+// Triangles in MeshTangents::RunBenchmark's grid, and how far apart
+// (per component) the reference and new tangents may end up
+#define TANGENT_BENCHMARK_TRIANGLES	2000000
+#define TANGENT_BENCHMARK_TOLERANCE	1e-4f
+
+// --------------------------------------------------------
+// Timings of one run of MeshTangents::RunBenchmark
+// --------------------------------------------------------
+struct TangentBenchmark
+{
+	unsigned int TriangleCount;
+	unsigned int ThreadCount;	// Threads the threaded run actually used
+	double ReferenceMs;			// The original scalar loop
+	double SingleThreadMs;		// Calculate() on one thread
+	double ParallelMs;			// Calculate() on ThreadCount threads
+	float MaxDifference;		// Largest tangent component difference from the reference (NaN never matches)
+	bool Matches;
+};
+
+// --------------------------------------------------------
+// Per-vertex tangents from positions, uvs and normals.
+// Pure C++, like MeshOptimizer, so it runs headless.
+// --------------------------------------------------------
+class MeshTangents
+{
+public:
+	// A thread count of zero uses every hardware thread (small meshes
+	// only ever use one).  Returns how many threads did the work
+	static unsigned int Calculate(Vertex* verts, int numVerts, unsigned int* indices, int numIndices, unsigned int threadCount = 0);
+
+	// The scalar loop Calculate() replaced, kept to check against.
+	// Degenerate uvs give it NaN tangents
+	static void CalculateReference(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+
+	// Times the reference against Calculate() on one thread and on all
+	// of them for a generated grid, and checks that they agree
+	static TangentBenchmark RunBenchmark(unsigned int triangleCount = TANGENT_BENCHMARK_TRIANGLES);
+};
@@ -0,0 +1,404 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <chrono>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <unordered_map>
+
+using namespace DirectX;
+
+// Marks vertices that aren't in the current meshlet
+#define MESHLET_NOT_PRESENT 0xFFFFFFFF
+
+// Normal cones wider than this (minimum dot with the axis)
+// would almost never cull, so they're disabled outright
+#define MESHLET_MIN_CONE_DOT 0.1f
+
+// How much a triangle's normal straying from the meshlet's
+// average counts against it, relative to each new vertex
+#define MESHLET_CONE_WEIGHT 1.0f
+
+// --------------------------------------------------------
+// Hashing for finding vertices at identical positions
+// --------------------------------------------------------
+struct MeshletPositionHash
+{
+	size_t operator()(const XMFLOAT3& p) const
+	{
+		unsigned int bits[3];
+		memcpy(bits, &p, sizeof(bits));
+		return (size_t)bits[0] * 73856093u ^ (size_t)bits[1] * 19349663u ^ (size_t)bits[2] * 83492791u;
+	}
+
+	bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+};
+
+// --------------------------------------------------------
+// How many vertices a triangle would add to a meshlet
+// --------------------------------------------------------
+static unsigned int CountNewVertices(const unsigned int* tri, const unsigned int* lastMeshlet, unsigned int meshletIndex)
+{
+	unsigned int newVerts = 0;
+	for (int k = 0; k < 3; k++)
+	{
+		bool repeat = (k > 0 && tri[k] == tri[0]) || (k > 1 && tri[k] == tri[1]);
+		if (lastMeshlet[tri[k]] != meshletIndex && !repeat)
+			newVerts++;
+	}
+	return newVerts;
+}
+
+void MeshletBuilder::Build(
+	const Vertex* verts,
+	size_t vertexCount,
+	unsigned int* indices,
+	size_t indexCount,
+	std::vector<Meshlet>& meshlets,
+	unsigned int maxVertices,
+	unsigned int maxTriangles)
+{
+	meshlets.clear();
+	size_t triCount = indexCount / 3;
+	if (maxVertices < 3 || maxTriangles < 1 || triCount == 0)
+		return;
+
+	// Triangles are grown across shared positions rather than shared
+	// vertices, so seams (and unwelded meshes) don't stop the growth
+	std::vector<unsigned int> positionId(vertexCount);
+	std::unordered_map<XMFLOAT3, unsigned int, MeshletPositionHash, MeshletPositionHash> uniquePositions;
+	uniquePositions.reserve(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		positionId[v] = uniquePositions.insert({ verts[v].Position, (unsigned int)uniquePositions.size() }).first->second;
+	size_t positionCount = uniquePositions.size();
+
+	// Position -> triangle adjacency, stored contiguously
+	std::vector<unsigned int> offsets(positionCount + 1, 0);
+	for (size_t i = 0; i < triCount * 3; i++)
+		offsets[positionId[indices[i]] + 1]++;
+	for (size_t p = 0; p < positionCount; p++)
+		offsets[p + 1] += offsets[p];
+
+	std::vector<unsigned int> adjacency(triCount * 3);
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < triCount * 3; i++)
+		adjacency[fill[positionId[indices[i]]]++] = (unsigned int)(i / 3);
+
+	// Unit face normals, for keeping each meshlet's normal cone narrow
+	std::vector<XMFLOAT3> faceNormals(triCount);
+	for (size_t t = 0; t < triCount; t++)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&verts[indices[t * 3 + 0]].Position);
+		XMVECTOR p1 = XMLoadFloat3(&verts[indices[t * 3 + 1]].Position);
+		XMVECTOR p2 = XMLoadFloat3(&verts[indices[t * 3 + 2]].Position);
+		XMStoreFloat3(&faceNormals[t], XMVector3Normalize(XMVector3Cross(p1 - p0, p2 - p0)));
+	}
+
+	// Which meshlet each vertex was last added to
+	std::vector<unsigned int> lastMeshlet(vertexCount, MESHLET_NOT_PRESENT);
+	std::vector<char> emitted(triCount, 0);
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> candidateOf(triCount, MESHLET_NOT_PRESENT);
+	std::vector<unsigned int> output;
+	output.reserve(triCount * 3);
+
+	Meshlet current = {};
+	XMVECTOR normalSum = XMVectorZero();
+	size_t cursor = 0;
+	size_t emittedCount = 0;
+	while (emittedCount < triCount)
+	{
+		unsigned int meshletIndex = (unsigned int)meshlets.size();
+
+		// Best neighbor: fewest new vertices, then closest to the cone.
+		// Used candidates are dropped along the way, keeping the list short
+		long long best = -1;
+		float bestScore = FLT_MAX;
+		XMFLOAT3 axis;
+		XMStoreFloat3(&axis, XMVector3Normalize(normalSum));
+		size_t kept = 0;
+		for (size_t c = 0; c < candidates.size(); c++)
+		{
+			unsigned int t = candidates[c];
+			if (emitted[t])
+				continue;
+			candidates[kept++] = t;
+
+			unsigned int newVerts = CountNewVertices(indices + t * 3, lastMeshlet.data(), meshletIndex);
+			const XMFLOAT3& n = faceNormals[t];
+			float spread = 1.0f - (axis.x * n.x + axis.y * n.y + axis.z * n.z);
+			float score = newVerts + spread * MESHLET_CONE_WEIGHT;
+			if (score < bestScore)
+			{
+				best = t;
+				bestScore = score;
+			}
+		}
+		candidates.resize(kept);
+
+		// No neighbors left?  Continue from the next triangle in the
+		// existing order, which is already roughly spatially coherent
+		if (best == -1)
+		{
+			while (emitted[cursor])
+				cursor++;
+			best = (long long)cursor;
+		}
+
+		// Would it overflow the meshlet?  Then finish this one, and
+		// start the next one from this triangle
+		unsigned int tri = (unsigned int)best;
+		unsigned int newVerts = CountNewVertices(indices + tri * 3, lastMeshlet.data(), meshletIndex);
+		if (current.TriangleCount > 0 &&
+			(current.VertexCount + newVerts > maxVertices || current.TriangleCount + 1 > maxTriangles))
+		{
+			meshlets.push_back(current);
+			current = {};
+			current.FirstIndex = (unsigned int)output.size();
+			normalSum = XMVectorZero();
+			candidates.clear();
+
+			meshletIndex++;
+			newVerts = CountNewVertices(indices + tri * 3, lastMeshlet.data(), meshletIndex);
+		}
+
+		// Add it, and everything touching its corners becomes a candidate
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int v = indices[tri * 3 + k];
+			output.push_back(v);
+			lastMeshlet[v] = meshletIndex;
+
+			unsigned int p = positionId[v];
+			for (unsigned int a = offsets[p]; a < offsets[p + 1]; a++)
+			{
+				unsigned int t = adjacency[a];
+				if (!emitted[t] && candidateOf[t] != meshletIndex)
+				{
+					candidateOf[t] = meshletIndex;
+					candidates.push_back(t);
+				}
+			}
+		}
+
+		emitted[tri] = 1;
+		emittedCount++;
+		current.VertexCount += newVerts;
+		current.TriangleCount++;
+		normalSum += XMLoadFloat3(&faceNormals[tri]);
+	}
+
+	if (current.TriangleCount > 0)
+		meshlets.push_back(current);
+
+	// Meshlets are now contiguous in the index buffer
+	std::copy(output.begin(), output.end(), indices);
+	for (Meshlet& m : meshlets)
+		ComputeBounds(m, verts, indices);
+}
+
+// --------------------------------------------------------
+// Bounding sphere (around the box of the meshlet's vertices)
+// and normal cone of a meshlet
+// --------------------------------------------------------
+void MeshletBuilder::ComputeBounds(Meshlet& meshlet, const Vertex* verts, const unsigned int* indices)
+{
+	const unsigned int* first = indices + meshlet.FirstIndex;
+	unsigned int indexCount = meshlet.TriangleCount * 3;
+
+	XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+	for (unsigned int i = 0; i < indexCount; i++)
+	{
+		XMVECTOR pos = XMLoadFloat3(&verts[first[i]].Position);
+		boundsMin = XMVectorMin(boundsMin, pos);
+		boundsMax = XMVectorMax(boundsMax, pos);
+	}
+
+	XMVECTOR center = (boundsMin + boundsMax) * 0.5f;
+	float radiusSq = 0.0f;
+	for (unsigned int i = 0; i < indexCount; i++)
+	{
+		XMVECTOR pos = XMLoadFloat3(&verts[first[i]].Position);
+		radiusSq = fmaxf(radiusSq, XMVectorGetX(XMVector3LengthSq(pos - center)));
+	}
+
+	XMStoreFloat3(&meshlet.Center, center);
+	meshlet.Radius = sqrtf(radiusSq);
+
+	// Average the front face normals (clockwise winding), ignoring
+	// triangles too small to have a meaningful direction
+	std::vector<XMFLOAT3> normals;
+	normals.reserve(meshlet.TriangleCount);
+	XMVECTOR axis = XMVectorZero();
+	for (unsigned int i = 0; i < indexCount; i += 3)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&verts[first[i]].Position);
+		XMVECTOR p1 = XMLoadFloat3(&verts[first[i + 1]].Position);
+		XMVECTOR p2 = XMLoadFloat3(&verts[first[i + 2]].Position);
+		XMVECTOR normal = XMVector3Cross(p1 - p0, p2 - p0);
+		float length = XMVectorGetX(XMVector3Length(normal));
+		if (length <= FLT_MIN)
+			continue;
+
+		normal /= length;
+		axis += normal;
+
+		XMFLOAT3 n;
+		XMStoreFloat3(&n, normal);
+		normals.push_back(n);
+	}
+
+	// The cone must contain every normal, so its width is set by the worst one
+	float minDot = 1.0f;
+	float axisLength = XMVectorGetX(XMVector3Length(axis));
+	if (axisLength > FLT_MIN)
+	{
+		axis /= axisLength;
+		for (const XMFLOAT3& n : normals)
+			minDot = fminf(minDot, XMVectorGetX(XMVector3Dot(XMLoadFloat3(&n), axis)));
+	}
+
+	XMStoreFloat3(&meshlet.ConeAxis, axis);
+	if (normals.empty() || axisLength <= FLT_MIN || minDot <= MESHLET_MIN_CONE_DOT)
+		meshlet.ConeCutoff = 2.0f;
+	else
+		meshlet.ConeCutoff = sqrtf(1.0f - minDot * minDot);
+}
+
+bool MeshletBuilder::IsVisible(
+	const Meshlet& meshlet,
+	const Frustum& frustum,
+	FXMVECTOR cameraPosition,
+	bool backfaceCulling)
+{
+	XMVECTOR center = XMLoadFloat3(&meshlet.Center);
+	if (!frustum.IntersectsSphere(center, meshlet.Radius))
+		return false;
+
+	// Is the camera behind every triangle?  That's the case when the
+	// direction to the sphere is within (90 - cone angle) of the axis,
+	// padded by the radius since triangles are spread over the sphere
+	if (backfaceCulling && meshlet.ConeCutoff < 1.0f)
+	{
+		XMVECTOR toCenter = center - cameraPosition;
+		float along = XMVectorGetX(XMVector3Dot(toCenter, XMLoadFloat3(&meshlet.ConeAxis)));
+		float distance = XMVectorGetX(XMVector3Length(toCenter));
+		if (along >= meshlet.ConeCutoff * distance + meshlet.Radius)
+			return false;
+	}
+
+	return true;
+}
+
+MeshletCullStats MeshletBuilder::MeasureCulling(
+	const Vertex* verts,
+	size_t vertexCount,
+	const std::vector<Meshlet>& meshlets,
+	unsigned int path,
+	unsigned int viewCount)
+{
+	MeshletCullStats stats = {};
+	if (vertexCount == 0 || meshlets.empty())
+		return stats;
+
+	// Bounding sphere of the whole mesh
+	XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		XMVECTOR pos = XMLoadFloat3(&verts[i].Position);
+		boundsMin = XMVectorMin(boundsMin, pos);
+		boundsMax = XMVectorMax(boundsMax, pos);
+	}
+	XMVECTOR center = (boundsMin + boundsMax) * 0.5f;
+	float radius = fmaxf(XMVectorGetX(XMVector3Length(boundsMax - center)), 0.001f);
+
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, radius * 0.01f, radius * 10.0f);
+	for (unsigned int v = 0; v < viewCount; v++)
+	{
+		float angle = XM_2PI * v / viewCount;
+		XMVECTOR eye;
+		XMMATRIX view;
+		if (path == MESHLET_PATH_FLYBY)
+		{
+			// Along a line to one side of the mesh, looking straight
+			// ahead, so it slides across the screen and out of view
+			float along = (v + 0.5f) / viewCount * 4.0f - 2.0f;
+			eye = center + XMVectorSet(along, 0.25f, -1.5f, 0.0f) * radius;
+			view = XMMatrixLookToLH(eye, XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0));
+		}
+		else
+		{
+			// Orbit the mesh, bobbing up and down, always looking at
+			// the center.  Far enough out, its edges leave the screen;
+			// close in, most of it does
+			XMVECTOR offset = XMVectorSet(
+				cosf(angle),
+				0.5f * sinf(angle * 2.0f),
+				sinf(angle),
+				0.0f);
+			float distance = (path == MESHLET_PATH_CLOSE) ? 0.75f : 1.5f;
+			eye = center + XMVector3Normalize(offset) * (radius * distance);
+			view = XMMatrixLookAtLH(eye, center, XMVectorSet(0, 1, 0, 0));
+		}
+
+		Frustum frustum;
+		frustum.Extract(view * projection);
+		for (const Meshlet& m : meshlets)
+		{
+			stats.MeshletsTested++;
+			stats.TrianglesTested += m.TriangleCount;
+			if (!IsVisible(m, frustum, eye))
+			{
+				stats.MeshletsCulled++;
+				stats.TrianglesCulled += m.TriangleCount;
+			}
+		}
+	}
+
+	return stats;
+}
+
+MeshletBenchmark MeshletBuilder::RunBenchmark(
+	const Vertex* verts,
+	size_t vertexCount,
+	const unsigned int* indices,
+	size_t indexCount)
+{
+	MeshletBenchmark result = {};
+	result.TriangleCount = (unsigned int)(indexCount / 3);
+	if (vertexCount == 0 || indexCount == 0)
+		return result;
+
+	// Build reorders the indices, so each run starts from a fresh copy
+	std::vector<unsigned int> copy;
+	std::vector<Meshlet> meshlets;
+	for (unsigned int run = 0; run < MESHLET_BENCHMARK_RUNS; run++)
+	{
+		copy.assign(indices, indices + indexCount);
+		auto startTime = std::chrono::high_resolution_clock::now();
+		Build(verts, vertexCount, copy.data(), copy.size(), meshlets);
+		auto endTime = std::chrono::high_resolution_clock::now();
+
+		double ms = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+		if (run == 0 || ms < result.BuildMs)
+			result.BuildMs = ms;
+	}
+	result.MeshletCount = (unsigned int)meshlets.size();
+
+	for (unsigned int path = 0; path < MESHLET_PATH_COUNT; path++)
+	{
+		auto startTime = std::chrono::high_resolution_clock::now();
+		MeshletCullStats stats = MeasureCulling(verts, vertexCount, meshlets, path);
+		auto endTime = std::chrono::high_resolution_clock::now();
+
+		result.CullMs[path] = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+		result.TrianglesCulled[path] = stats.TrianglesTested ? (float)stats.TrianglesCulled / stats.TrianglesTested : 0.0f;
+	}
+	return result;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <stddef.h>
+#include <vector>
+
+#include "Vertex.h"
+#include "Frustum.h"
+
+// Default meshlet limits (matching common mesh shader limits)
+#define MESHLET_MAX_VERTICES	64
+#define MESHLET_MAX_TRIANGLES	124
+
+// Camera paths MeshletBuilder::MeasureCulling can take
+#define MESHLET_PATH_ORBIT		0	// Around the mesh, all of it in view
+#define MESHLET_PATH_CLOSE		1	// Around it close in, much of it off screen
+#define MESHLET_PATH_FLYBY		2	// Past it in a straight line, looking ahead
+#define MESHLET_PATH_COUNT		3
+
+// Builds MeshletBuilder::RunBenchmark times (keeping the best)
+#define MESHLET_BENCHMARK_RUNS	5
+
+// --------------------------------------------------------
+// A small cluster of triangles: a contiguous range of the
+// mesh's index buffer, plus what's needed to cull it
+// --------------------------------------------------------
+struct Meshlet
+{
+	unsigned int FirstIndex;
+	unsigned int TriangleCount;
+	unsigned int VertexCount;		// Unique vertices referenced
+
+	DirectX::XMFLOAT3 Center;		// Bounding sphere
+	float Radius;
+
+	DirectX::XMFLOAT3 ConeAxis;		// Average front face normal
+	float ConeCutoff;				// Sine of the normal cone's half angle (>= 1 never backface culls)
+};
+
+// --------------------------------------------------------
+// Counts of what culling has (or would have) removed
+// --------------------------------------------------------
+struct MeshletCullStats
+{
+	unsigned int MeshletsTested;
+	unsigned int MeshletsCulled;
+	unsigned int TrianglesTested;
+	unsigned int TrianglesCulled;
+};
+
+// --------------------------------------------------------
+// Results of MeshletBuilder::RunBenchmark
+// --------------------------------------------------------
+struct MeshletBenchmark
+{
+	unsigned int TriangleCount;
+	unsigned int MeshletCount;
+	double BuildMs;								// Best of MESHLET_BENCHMARK_RUNS
+	double CullMs[MESHLET_PATH_COUNT];			// Each whole path
+	float TrianglesCulled[MESHLET_PATH_COUNT];	// Fraction of those tested, along each path
+};
+
+// --------------------------------------------------------
+// Splits an index buffer into meshlets and culls them.
+// Pure C++, so it runs (and can be timed) without a GPU.
+// --------------------------------------------------------
+class MeshletBuilder
+{
+public:
+	// Regroups the triangles into meshlets that respect both limits,
+	// growing each across neighboring triangles with similar normals.
+	// The index buffer is reordered so each meshlet is one range
+	static void Build(
+		const Vertex* verts,
+		size_t vertexCount,
+		unsigned int* indices,
+		size_t indexCount,
+		std::vector<Meshlet>& meshlets,
+		unsigned int maxVertices = MESHLET_MAX_VERTICES,
+		unsigned int maxTriangles = MESHLET_MAX_TRIANGLES);
+
+	// Frustum and camera must be in the mesh's object space.  The backface
+	// (normal cone) test is only exact without non-uniform scaling
+	static bool IsVisible(
+		const Meshlet& meshlet,
+		const Frustum& frustum,
+		DirectX::FXMVECTOR cameraPosition,
+		bool backfaceCulling = true);
+
+	// Culls the meshlets from cameras along a fixed path (scaled to
+	// fit the mesh)
+	static MeshletCullStats MeasureCulling(
+		const Vertex* verts,
+		size_t vertexCount,
+		const std::vector<Meshlet>& meshlets,
+		unsigned int path = MESHLET_PATH_ORBIT,
+		unsigned int viewCount = 16);
+
+	// Times building meshlets from a copy of the indices, then culls
+	// them along each camera path
+	static MeshletBenchmark RunBenchmark(
+		const Vertex* verts,
+		size_t vertexCount,
+		const unsigned int* indices,
+		size_t indexCount);
+
+private:
+	static void ComputeBounds(Meshlet& meshlet, const Vertex* verts, const unsigned int* indices);
+};
+
@@ -0,0 +1,577 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <thread>
+
+// The reference loop used sscanf_s, which only MSVC has.  It only
+// reads numbers, so plain sscanf takes exactly the same arguments.
+#ifndef _MSC_VER
+#define sscanf_s sscanf
+#endif
+
+using namespace DirectX;
+
+// Chunks smaller than this aren't worth a thread
+#define OBJ_MIN_CHUNK_BYTES (1 << 20)
+
+// Flags marking which indices of a corner were negative (relative)
+// in the file, and still need the chunk's starting counts added
+#define OBJ_RELATIVE_POSITION	1
+#define OBJ_RELATIVE_UV			2
+#define OBJ_RELATIVE_NORMAL		4
+
+namespace
+{
+	// A corner as parsed from a single chunk, before merging
+	struct ChunkCorner
+	{
+		ObjCorner Corner;
+		unsigned char RelativeFlags;
+	};
+
+	// Everything found in a single chunk of the file
+	struct ObjChunk
+	{
+		const char* Start;
+		const char* End;
+
+		std::vector<XMFLOAT3> Positions;
+		std::vector<XMFLOAT2> UVs;
+		std::vector<XMFLOAT3> Normals;
+		std::vector<ChunkCorner> Corners;
+	};
+
+	const char* SkipSpaces(const char* p, const char* end)
+	{
+		while (p < end && (*p == ' ' || *p == '\t'))
+			p++;
+		return p;
+	}
+
+	// Locale-independent float parsing (sscanf respects the C locale)
+	bool ReadFloat(const char*& p, const char* end, float& value)
+	{
+		p = SkipSpaces(p, end);
+
+		// from_chars doesn't accept an explicit plus sign
+		if (p < end && *p == '+')
+			p++;
+
+		std::from_chars_result result = std::from_chars(p, end, value);
+		if (result.ec != std::errc())
+			return false;
+
+		p = result.ptr;
+		return true;
+	}
+
+	bool ReadInt(const char*& p, const char* end, int& value)
+	{
+		std::from_chars_result result = std::from_chars(p, end, value);
+		if (result.ec != std::errc())
+			return false;
+
+		p = result.ptr;
+		return true;
+	}
+
+	// Converts a 1-based (or negative, relative) OBJ index to zero-based.
+	// Relative indices are resolved against the chunk's own counts here
+	// and fixed up once the counts of earlier chunks are known.
+	int ResolveIndex(int raw, size_t localCount, unsigned char relativeFlag, unsigned char& flags)
+	{
+		if (raw > 0)
+			return raw - 1;
+
+		flags |= relativeFlag;
+		return (int)localCount + raw;
+	}
+
+	// Reads one "v", "v/vt", "v//vn" or "v/vt/vn" face corner
+	bool ReadCorner(const char*& p, const char* end, ObjChunk& chunk, ChunkCorner& corner)
+	{
+		corner.Corner.Position = -1;
+		corner.Corner.UV = -1;
+		corner.Corner.Normal = -1;
+		corner.RelativeFlags = 0;
+
+		int raw = 0;
+		if (!ReadInt(p, end, raw) || raw == 0)
+			return false;
+		corner.Corner.Position = ResolveIndex(raw, chunk.Positions.size(), OBJ_RELATIVE_POSITION, corner.RelativeFlags);
+
+		if (p < end && *p == '/')
+		{
+			p++;
+			if (p < end && *p != '/')
+			{
+				if (!ReadInt(p, end, raw) || raw == 0)
+					return false;
+				corner.Corner.UV = ResolveIndex(raw, chunk.UVs.size(), OBJ_RELATIVE_UV, corner.RelativeFlags);
+			}
+
+			if (p < end && *p == '/')
+			{
+				p++;
+				if (!ReadInt(p, end, raw) || raw == 0)
+					return false;
+				corner.Corner.Normal = ResolveIndex(raw, chunk.Normals.size(), OBJ_RELATIVE_NORMAL, corner.RelativeFlags);
+			}
+		}
+
+		return true;
+	}
+
+	void ParseFace(const char* p, const char* end, ObjChunk& chunk)
+	{
+		// Faces are usually triangles or quads, but fans of any size are handled
+		ChunkCorner first;
+		ChunkCorner previous;
+		int cornerCount = 0;
+
+		while (true)
+		{
+			p = SkipSpaces(p, end);
+			if (p >= end)
+				break;
+
+			ChunkCorner corner;
+			if (!ReadCorner(p, end, chunk, corner))
+				break;
+
+			if (cornerCount == 0)
+				first = corner;
+			else if (cornerCount >= 2)
+			{
+				// The model is most likely in a right-handed space,
+				// so flip the winding order of each triangle in the fan
+				chunk.Corners.push_back(first);
+				chunk.Corners.push_back(corner);
+				chunk.Corners.push_back(previous);
+			}
+
+			previous = corner;
+			cornerCount++;
+		}
+	}
+
+	void ParseLine(const char* p, const char* end, ObjChunk& chunk)
+	{
+		p = SkipSpaces(p, end);
+		if (end - p < 2)
+			return;
+
+		// The model is most likely in a right-handed space,
+		// especially if it came from Maya.  We want to convert
+		// to a left-handed space for DirectX, so we invert the Z
+		// of positions and normals.  UVs are flipped too, since
+		// DirectX defines (0,0) as the top left of the texture
+		if (p[0] == 'v' && p[1] == 'n')
+		{
+			XMFLOAT3 norm(0, 0, 0);
+			p += 2;
+			if (ReadFloat(p, end, norm.x) && ReadFloat(p, end, norm.y) && ReadFloat(p, end, norm.z))
+				norm.z *= -1.0f;
+			chunk.Normals.push_back(norm);
+		}
+		else if (p[0] == 'v' && p[1] == 't')
+		{
+			XMFLOAT2 uv(0, 0);
+			p += 2;
+			if (ReadFloat(p, end, uv.x) && ReadFloat(p, end, uv.y))
+				uv.y = 1.0f - uv.y;
+			chunk.UVs.push_back(uv);
+		}
+		else if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			XMFLOAT3 pos(0, 0, 0);
+			p += 1;
+			if (ReadFloat(p, end, pos.x) && ReadFloat(p, end, pos.y) && ReadFloat(p, end, pos.z))
+				pos.z *= -1.0f;
+			chunk.Positions.push_back(pos);
+		}
+		else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			ParseFace(p + 1, end, chunk);
+		}
+	}
+
+	void ParseChunk(ObjChunk* chunk)
+	{
+		const char* p = chunk->Start;
+		while (p < chunk->End)
+		{
+			// Find the end of this line, ignoring any carriage return
+			const char* lineEnd = p;
+			while (lineEnd < chunk->End && *lineEnd != '\n')
+				lineEnd++;
+
+			const char* contentEnd = lineEnd;
+			if (contentEnd > p && contentEnd[-1] == '\r')
+				contentEnd--;
+
+			ParseLine(p, contentEnd, *chunk);
+			p = lineEnd + 1;
+		}
+	}
+
+	int FixIndex(int index, bool relative, size_t base, size_t total)
+	{
+		// Missing attributes stay missing (relative indices
+		// can legitimately be -1 until the base is added)
+		if (index == -1 && !relative)
+			return -1;
+
+		if (relative)
+			index += (int)base;
+
+		// Out of range references are treated as missing
+		if (index < 0 || (size_t)index >= total)
+			return -1;
+
+		return index;
+	}
+
+	// Copies a single chunk's results into its slice of the final arrays
+	void MergeChunk(ObjChunk* chunk, ObjData* data, size_t posBase, size_t uvBase, size_t normBase, size_t cornerBase)
+	{
+		std::copy(chunk->Positions.begin(), chunk->Positions.end(), data->Positions.begin() + posBase);
+		std::copy(chunk->UVs.begin(), chunk->UVs.end(), data->UVs.begin() + uvBase);
+		std::copy(chunk->Normals.begin(), chunk->Normals.end(), data->Normals.begin() + normBase);
+
+		for (size_t i = 0; i < chunk->Corners.size(); i++)
+		{
+			const ChunkCorner& c = chunk->Corners[i];
+			ObjCorner& out = data->Corners[cornerBase + i];
+			out.Position = FixIndex(c.Corner.Position, (c.RelativeFlags & OBJ_RELATIVE_POSITION) != 0, posBase, data->Positions.size());
+			out.UV = FixIndex(c.Corner.UV, (c.RelativeFlags & OBJ_RELATIVE_UV) != 0, uvBase, data->UVs.size());
+			out.Normal = FixIndex(c.Corner.Normal, (c.RelativeFlags & OBJ_RELATIVE_NORMAL) != 0, normBase, data->Normals.size());
+		}
+	}
+}
+
+
+bool ObjLoader::Load(const char* objFile, ObjData& data, unsigned int threadCount)
+{
+	MappedFile file(objFile);
+	if (!file.IsValid())
+		return false;
+
+	return Parse(file.GetData(), file.GetSize(), data, threadCount);
+}
+
+bool ObjLoader::Parse(const char* text, size_t length, ObjData& data, unsigned int threadCount)
+{
+	data.Positions.clear();
+	data.UVs.clear();
+	data.Normals.clear();
+	data.Corners.clear();
+
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	if (threadCount == 0)
+		threadCount = 1;
+
+	// How many chunks?  Small files are parsed on this thread alone
+	size_t chunkCount = length / OBJ_MIN_CHUNK_BYTES;
+	if (chunkCount > threadCount) chunkCount = threadCount;
+	if (chunkCount < 1) chunkCount = 1;
+
+	// Split the text, moving each boundary forward to the next line start
+	std::vector<ObjChunk> chunks(chunkCount);
+	const char* end = text + length;
+	const char* start = text;
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		const char* split = (i == chunkCount - 1) ? end : text + length * (i + 1) / chunkCount;
+		if (split < start) split = start;
+		while (split > text && split < end && split[-1] != '\n')
+			split++;
+
+		chunks[i].Start = start;
+		chunks[i].End = split;
+		start = split;
+	}
+
+	// Parse every chunk, using this thread for the first one
+	std::vector<std::thread> workers;
+	for (size_t i = 1; i < chunkCount; i++)
+		workers.push_back(std::thread(ParseChunk, &chunks[i]));
+	ParseChunk(&chunks[0]);
+	for (auto& w : workers)
+		w.join();
+	workers.clear();
+
+	// Each chunk's data lands after everything from earlier chunks
+	std::vector<size_t> posBase(chunkCount), uvBase(chunkCount), normBase(chunkCount), cornerBase(chunkCount);
+	size_t posTotal = 0, uvTotal = 0, normTotal = 0, cornerTotal = 0;
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		posBase[i] = posTotal;		posTotal += chunks[i].Positions.size();
+		uvBase[i] = uvTotal;		uvTotal += chunks[i].UVs.size();
+		normBase[i] = normTotal;	normTotal += chunks[i].Normals.size();
+		cornerBase[i] = cornerTotal;	cornerTotal += chunks[i].Corners.size();
+	}
+
+	data.Positions.resize(posTotal);
+	data.UVs.resize(uvTotal);
+	data.Normals.resize(normTotal);
+	data.Corners.resize(cornerTotal);
+
+	// Merge in parallel; every chunk writes to its own slice
+	for (size_t i = 1; i < chunkCount; i++)
+		workers.push_back(std::thread(MergeChunk, &chunks[i], &data, posBase[i], uvBase[i], normBase[i], cornerBase[i]));
+	MergeChunk(&chunks[0], &data, posBase[0], uvBase[0], normBase[0], cornerBase[0]);
+	for (auto& w : workers)
+		w.join();
+
+	return true;
+}
+
+// Resolves a face index as Parse() does, out of range ones included
+static int ReferenceIndex(int raw, size_t count)
+{
+	int index = raw < 0 ? (int)count + raw : raw - 1;
+	return (index < 0 || (size_t)index >= count) ? -1 : index;
+}
+
+// --------------------------------------------------------
+// One line at a time, as the original loader read them
+// --------------------------------------------------------
+bool ObjLoader::ParseReference(const char* text, size_t length, ObjData& data)
+{
+	data.Positions.clear();
+	data.UVs.clear();
+	data.Normals.clear();
+	data.Corners.clear();
+
+	std::string line;
+	const char* end = text + length;
+	const char* p = text;
+	while (p < end)
+	{
+		const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+		if (lineEnd == 0)
+			lineEnd = end;
+		line.assign(p, lineEnd);
+		p = lineEnd + 1;
+
+		const char* chars = line.c_str();
+		if (chars[0] == 'v' && chars[1] == 'n')
+		{
+			XMFLOAT3 norm(0, 0, 0);
+			sscanf_s(chars, "vn %f %f %f", &norm.x, &norm.y, &norm.z);
+			norm.z *= -1.0f;
+			data.Normals.push_back(norm);
+		}
+		else if (chars[0] == 'v' && chars[1] == 't')
+		{
+			XMFLOAT2 uv(0, 0);
+			sscanf_s(chars, "vt %f %f", &uv.x, &uv.y);
+			uv.y = 1.0f - uv.y;
+			data.UVs.push_back(uv);
+		}
+		else if (chars[0] == 'v')
+		{
+			XMFLOAT3 pos(0, 0, 0);
+			sscanf_s(chars, "v %f %f %f", &pos.x, &pos.y, &pos.z);
+			pos.z *= -1.0f;
+			data.Positions.push_back(pos);
+		}
+		else if (chars[0] == 'f')
+		{
+			int i[12];
+			int facesRead = sscanf_s(
+				chars,
+				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
+				&i[0], &i[1], &i[2],
+				&i[3], &i[4], &i[5],
+				&i[6], &i[7], &i[8],
+				&i[9], &i[10], &i[11]);
+			if (facesRead < 9)
+				continue;
+
+			// 1-based in the file, or relative to the end when negative
+			ObjCorner c[4];
+			for (int k = 0; k < facesRead / 3; k++)
+			{
+				c[k].Position = ReferenceIndex(i[k * 3], data.Positions.size());
+				c[k].UV = ReferenceIndex(i[k * 3 + 1], data.UVs.size());
+				c[k].Normal = ReferenceIndex(i[k * 3 + 2], data.Normals.size());
+			}
+
+			// Flipping the winding order
+			data.Corners.push_back(c[0]);
+			data.Corners.push_back(c[2]);
+			data.Corners.push_back(c[1]);
+			if (facesRead == 12)
+			{
+				data.Corners.push_back(c[0]);
+				data.Corners.push_back(c[3]);
+				data.Corners.push_back(c[2]);
+			}
+		}
+	}
+
+	return true;
+}
+
+template <typename T>
+static bool SameBytes(const std::vector<T>& a, const std::vector<T>& b)
+{
+	return a.size() == b.size() && (a.empty() || memcmp(&a[0], &b[0], sizeof(T) * a.size()) == 0);
+}
+
+static bool SameData(const ObjData& a, const ObjData& b)
+{
+	return
+		SameBytes(a.Positions, b.Positions) &&
+		SameBytes(a.UVs, b.UVs) &&
+		SameBytes(a.Normals, b.Normals) &&
+		SameBytes(a.Corners, b.Corners);
+}
+
+ObjBenchmark ObjLoader::RunBenchmark(const char* objFile, unsigned int threadCount)
+{
+	ObjBenchmark result = {};
+	MappedFile file(objFile);
+	if (!file.IsValid())
+		return result;
+
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	if (threadCount == 0)
+		threadCount = 1;
+	result.FileBytes = file.GetSize();
+	result.ThreadCount = threadCount;
+
+	ObjData reference;
+	auto startTime = std::chrono::high_resolution_clock::now();
+	ParseReference(file.GetData(), file.GetSize(), reference);
+	auto endTime = std::chrono::high_resolution_clock::now();
+	result.ReferenceMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+	result.Triangles = reference.Corners.size() / 3;
+
+	// Compared one at a time, so only two copies are ever in memory
+	ObjData parsed;
+	startTime = std::chrono::high_resolution_clock::now();
+	Parse(file.GetData(), file.GetSize(), parsed, 1);
+	endTime = std::chrono::high_resolution_clock::now();
+	result.SingleThreadMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+	result.Identical = SameData(reference, parsed);
+
+	startTime = std::chrono::high_resolution_clock::now();
+	Parse(file.GetData(), file.GetSize(), parsed, threadCount);
+	endTime = std::chrono::high_resolution_clock::now();
+	result.ParseMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+	result.Identical = result.Identical && SameData(reference, parsed);
+
+	return result;
+}
+
+// Roughly how many bytes each grid cell adds to a synthetic file:
+// its vertex's three lines and one face line
+#define OBJ_SYNTHETIC_BYTES_PER_CELL 200
+
+// Synthetic files are written through a buffer about this big
+#define OBJ_SYNTHETIC_BUFFER_BYTES (1 << 20)
+
+bool ObjLoader::WriteSynthetic(const char* objFile, unsigned long long targetBytes)
+{
+	std::ofstream file(objFile, std::ios::binary);
+	if (!file)
+		return false;
+
+	// Square grid, with one vertex per cell corner
+	unsigned long long cells = targetBytes / OBJ_SYNTHETIC_BYTES_PER_CELL;
+	unsigned int side = 2;
+	while ((unsigned long long)(side - 1) * (side - 1) < cells)
+		side++;
+
+	std::string buffer;
+	buffer.reserve(OBJ_SYNTHETIC_BUFFER_BYTES + 256);
+	auto flush = [&](bool force)
+	{
+		if (buffer.size() < OBJ_SYNTHETIC_BUFFER_BYTES && !force)
+			return;
+		file.write(buffer.data(), buffer.size());
+		buffer.clear();
+	};
+
+	char line[256];
+	for (unsigned int z = 0; z < side; z++)
+	{
+		for (unsigned int x = 0; x < side; x++)
+		{
+			float fx = (float)x * 0.1f;
+			float fz = (float)z * 0.1f;
+			float height = sinf(fx) * cosf(fz * 1.3f);
+			float dx = cosf(fx) * cosf(fz * 1.3f);
+			float dz = -sinf(fx) * sinf(fz * 1.3f) * 1.3f;
+			float length = sqrtf(dx * dx + 1.0f + dz * dz);
+			int count = snprintf(line, sizeof(line),
+				"v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n",
+				fx, height, fz,
+				(float)x / (side - 1), (float)z / (side - 1),
+				-dx / length, 1.0f / length, -dz / length);
+			buffer.append(line, count);
+			flush(false);
+		}
+	}
+
+	// Every face line comes after every vertex, so a relative index
+	// counts back from the end of the whole grid
+	long long vertexCount = (long long)side * side;
+	for (unsigned int z = 0; z + 1 < side; z++)
+	{
+		for (unsigned int x = 0; x + 1 < side; x++)
+		{
+			long long corners[4] = {
+				(long long)z * side + x + 1,
+				(long long)(z + 1) * side + x + 1,
+				(long long)(z + 1) * side + x + 2,
+				(long long)z * side + x + 2 };
+			if (z % 4 == 3)
+			{
+				for (long long& c : corners)
+					c -= vertexCount + 1;
+			}
+
+			int count;
+			if (x % 2 == 0)
+			{
+				count = snprintf(line, sizeof(line),
+					"f %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld\n",
+					corners[0], corners[0], corners[0],
+					corners[1], corners[1], corners[1],
+					corners[2], corners[2], corners[2],
+					corners[3], corners[3], corners[3]);
+			}
+			else
+			{
+				count = snprintf(line, sizeof(line),
+					"f %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld\nf %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld\n",
+					corners[0], corners[0], corners[0],
+					corners[1], corners[1], corners[1],
+					corners[2], corners[2], corners[2],
+					corners[0], corners[0], corners[0],
+					corners[2], corners[2], corners[2],
+					corners[3], corners[3], corners[3]);
+			}
+			buffer.append(line, count);
+			flush(false);
+		}
+	}
+
+	flush(true);
+	file.close();
+	return !file.fail();
+}
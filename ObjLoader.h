@@ -0,0 +1,78 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <stddef.h>
+#include <vector>
+
+// --------------------------------------------------------
+// A single triangle corner from an OBJ file, stored as
+// zero-based indices into the position/uv/normal streams.
+// An index of -1 means the corner didn't specify (or had
+// an invalid reference for) that attribute.
+// --------------------------------------------------------
+struct ObjCorner
+{
+	int Position;
+	int UV;
+	int Normal;
+};
+
+// --------------------------------------------------------
+// Everything read from an OBJ file, already converted to
+// DirectX conventions (left-handed, UVs flipped vertically)
+// --------------------------------------------------------
+struct ObjData
+{
+	std::vector<DirectX::XMFLOAT3> Positions;
+	std::vector<DirectX::XMFLOAT2> UVs;
+	std::vector<DirectX::XMFLOAT3> Normals;
+	std::vector<ObjCorner> Corners;	// Three per triangle, in left-handed winding order
+};
+
+// --------------------------------------------------------
+// Timings of one run of ObjLoader::RunBenchmark.  FileBytes
+// is zero if the file couldn't be read.
+// --------------------------------------------------------
+struct ObjBenchmark
+{
+	size_t FileBytes;
+	size_t Triangles;
+	unsigned int ThreadCount;
+	double ReferenceMs;			// The original getline/sscanf_s loop
+	double SingleThreadMs;		// Parse() on one thread
+	double ParseMs;				// Parse() on ThreadCount threads
+	bool Identical;				// All three gave the same data, byte for byte
+};
+
+// --------------------------------------------------------
+// Memory-mapped, multi-threaded OBJ parser
+//
+// The file is split into newline-aligned chunks which are
+// parsed in parallel and then merged in file order, so the
+// result is identical no matter how many threads are used.
+// --------------------------------------------------------
+class ObjLoader
+{
+public:
+	// A thread count of zero uses every hardware thread
+	static bool Load(const char* objFile, ObjData& data, unsigned int threadCount = 0);
+	static bool Parse(const char* text, size_t length, ObjData& data, unsigned int threadCount = 0);
+
+	// The line-at-a-time loop this replaced, kept to check against.
+	// Like the original, it only reads "v/vt/vn" triangles and quads,
+	// though it isn't limited to 100 characters a line, and resolves
+	// relative and out of range indices the way Parse() does.
+	static bool ParseReference(const char* text, size_t length, ObjData& data);
+
+	// Times the reference loop and Parse() over a whole file, and
+	// checks their results match.  MeshBaker::LoadObj builds its vertices
+	// and indices from ObjData alone, so matching data means matching
+	// buffers.  Needs no device, so it also runs headless.
+	static ObjBenchmark RunBenchmark(const char* objFile, unsigned int threadCount = 0);
+
+	// Writes a wavy grid of roughly the given size to benchmark with:
+	// full "v/vt/vn" corners, mixing quads and triangles, with every
+	// fourth row of faces using relative (negative) indices
+	static bool WriteSynthetic(const char* objFile, unsigned long long targetBytes);
+};
+
@@ -0,0 +1,598 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <float.h>
+#include <fstream>
+#include <math.h>
+#include <random>
+#include <stdlib.h>
+#include <string>
+
+#include "Frustum.h"
+
+using namespace DirectX;
+
+// Corners of a box, as signs on its extents
+static const float cornerSigns[8][3] =
+{
+	{ -1, -1, -1 }, { 1, -1, -1 }, { -1, 1, -1 }, { 1, 1, -1 },
+	{ -1, -1,  1 }, { 1, -1,  1 }, { -1, 1,  1 }, { 1, 1,  1 },
+};
+
+// The 12 triangles of a box, over the corners above
+static const unsigned int boxIndices[36] =
+{
+	0, 2, 1,  1, 2, 3,	// -Z
+	4, 5, 6,  5, 7, 6,	// +Z
+	0, 4, 2,  2, 4, 6,	// -X
+	1, 3, 5,  3, 7, 5,	// +X
+	0, 1, 4,  1, 5, 4,	// -Y
+	2, 6, 3,  3, 6, 7,	// +Y
+};
+
+OcclusionCuller::OcclusionCuller()
+{
+	XMStoreFloat4x4(&viewProjection, XMMatrixIdentity());
+	stats = {};
+
+	for (int level = 0; level < OCCLUSION_LEVELS; level++)
+	{
+		size_t size = (size_t)(OCCLUSION_WIDTH >> level) * (OCCLUSION_HEIGHT >> level);
+		maxDepth[level].resize(size, 1.0f);
+
+		// Level 0 reads its minimums from maxDepth
+		if (level > 0)
+			minDepth[level].resize(size, 1.0f);
+	}
+}
+
+void OcclusionCuller::Begin(FXMMATRIX viewProjection)
+{
+	XMStoreFloat4x4(&this->viewProjection, viewProjection);
+	stats = {};
+	std::fill(maxDepth[0].begin(), maxDepth[0].end(), 1.0f);
+}
+
+void OcclusionCuller::AddOccluderBox(const BoundsAABB& box, FXMMATRIX world)
+{
+	XMFLOAT3 corners[8];
+	for (int i = 0; i < 8; i++)
+	{
+		corners[i] = XMFLOAT3(
+			box.Center.x + box.Extents.x * cornerSigns[i][0],
+			box.Center.y + box.Extents.y * cornerSigns[i][1],
+			box.Center.z + box.Extents.z * cornerSigns[i][2]);
+	}
+	AddOccluderTriangles(corners, boxIndices, 36, world);
+}
+
+// --------------------------------------------------------
+// Both sides of each triangle are drawn, so the winding
+// (and any mirroring in the world matrix) doesn't matter
+// --------------------------------------------------------
+void OcclusionCuller::AddOccluderTriangles(const XMFLOAT3* positions, const unsigned int* indices, size_t indexCount, FXMMATRIX world)
+{
+	XMMATRIX toClip = world * XMLoadFloat4x4(&viewProjection);
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		ClipAndDrawTriangle(
+			XMVector3Transform(XMLoadFloat3(&positions[indices[i]]), toClip),
+			XMVector3Transform(XMLoadFloat3(&positions[indices[i + 1]]), toClip),
+			XMVector3Transform(XMLoadFloat3(&positions[indices[i + 2]]), toClip));
+	}
+	stats.OccludersDrawn++;
+}
+
+// --------------------------------------------------------
+// Each level keeps the nearest and furthest depth of the
+// 2x2 block under each of its pixels
+// --------------------------------------------------------
+void OcclusionCuller::BuildHierarchy()
+{
+	for (int level = 1; level < OCCLUSION_LEVELS; level++)
+	{
+		int width = OCCLUSION_WIDTH >> level;
+		int height = OCCLUSION_HEIGHT >> level;
+		int sourceWidth = width * 2;
+		const float* sourceMin = level == 1 ? maxDepth[0].data() : minDepth[level - 1].data();
+		const float* sourceMax = maxDepth[level - 1].data();
+		float* destMin = minDepth[level].data();
+		float* destMax = maxDepth[level].data();
+
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				int top = (y * 2) * sourceWidth + x * 2;
+				int bottom = top + sourceWidth;
+				destMin[y * width + x] = std::min(
+					std::min(sourceMin[top], sourceMin[top + 1]),
+					std::min(sourceMin[bottom], sourceMin[bottom + 1]));
+				destMax[y * width + x] = std::max(
+					std::max(sourceMax[top], sourceMax[top + 1]),
+					std::max(sourceMax[bottom], sourceMax[bottom + 1]));
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Starts at the finest level where the box covers at most
+// 2x2 pixels, then refines only the blocks that can't be
+// decided there
+// --------------------------------------------------------
+bool OcclusionCuller::IsVisible(const BoundsAABB& box)
+{
+	stats.ObjectsTested++;
+
+	ScreenRect rect;
+	if (!Project(box, &rect))
+		return true;
+
+	int level = 0;
+	while (level < OCCLUSION_LEVELS - 1 &&
+		((rect.MaxX >> level) - (rect.MinX >> level) > 1 || (rect.MaxY >> level) - (rect.MinY >> level) > 1))
+		level++;
+
+	for (int y = rect.MinY >> level; y <= rect.MaxY >> level; y++)
+	{
+		for (int x = rect.MinX >> level; x <= rect.MaxX >> level; x++)
+		{
+			if (!IsOccluded(rect, level, x, y))
+				return true;
+		}
+	}
+
+	stats.ObjectsOccluded++;
+	return false;
+}
+
+bool OcclusionCuller::IsVisibleFullResolution(const BoundsAABB& box)
+{
+	ScreenRect rect;
+	if (!Project(box, &rect))
+		return true;
+
+	for (int y = rect.MinY; y <= rect.MaxY; y++)
+	{
+		for (int x = rect.MinX; x <= rect.MaxX; x++)
+		{
+			if (rect.Nearest <= maxDepth[0][y * OCCLUSION_WIDTH + x])
+				return true;
+		}
+	}
+	return false;
+}
+
+bool OcclusionCuller::SaveDepthImage(const char* path)
+{
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out)
+		return false;
+
+	// 16 bits per pixel, most significant byte first
+	out << "P5\n" << OCCLUSION_WIDTH << " " << OCCLUSION_HEIGHT << "\n65535\n";
+	for (float depth : maxDepth[0])
+	{
+		unsigned int value = (unsigned int)(std::min(std::max(depth, 0.0f), 1.0f) * 65535.0f + 0.5f);
+		char bytes[2] = { (char)(value >> 8), (char)(value & 0xFF) };
+		out.write(bytes, 2);
+	}
+	return out.good();
+}
+
+bool OcclusionCuller::CompareDepthImage(const char* path, unsigned int* pixelsDifferent)
+{
+	std::ifstream in(path, std::ios::binary);
+	std::string magic;
+	unsigned int width = 0, height = 0, maxValue = 0;
+	in >> magic >> width >> height >> maxValue;
+	if (!in || magic != "P5" || width != OCCLUSION_WIDTH || height != OCCLUSION_HEIGHT || maxValue != 65535)
+		return false;
+
+	// A single whitespace character separates the header from the pixels
+	in.get();
+	std::vector<unsigned char> bytes(maxDepth[0].size() * 2);
+	if (!in.read((char*)bytes.data(), bytes.size()))
+		return false;
+
+	*pixelsDifferent = 0;
+	for (size_t i = 0; i < maxDepth[0].size(); i++)
+	{
+		int expected = (bytes[i * 2] << 8) | bytes[i * 2 + 1];
+		int actual = (int)(std::min(std::max(maxDepth[0][i], 0.0f), 1.0f) * 65535.0f + 0.5f);
+		if (abs(actual - expected) > OCCLUSION_REFERENCE_TOLERANCE)
+			(*pixelsDifferent)++;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Takes a triangle in screen space (pixels, with depth in
+// z) and keeps the nearest depth at every pixel whose
+// center it covers.  The edge functions and depth are
+// stepped across each row four pixels at a time.
+// --------------------------------------------------------
+void OcclusionCuller::DrawTriangle(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c)
+{
+	XMFLOAT3 v[3];
+	XMStoreFloat3(&v[0], a);
+	XMStoreFloat3(&v[1], b);
+	XMStoreFloat3(&v[2], c);
+
+	// Wound so that inside is where all the edge functions are positive
+	float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+	if (fabsf(area) < 1e-8f)
+		return;
+	if (area < 0)
+	{
+		std::swap(v[1], v[2]);
+		area = -area;
+	}
+
+	float minX = std::max(std::min(std::min(v[0].x, v[1].x), v[2].x) - 0.5f, 0.0f);
+	float maxX = std::min(std::max(std::max(v[0].x, v[1].x), v[2].x) - 0.5f, OCCLUSION_WIDTH - 1.0f);
+	float minY = std::max(std::min(std::min(v[0].y, v[1].y), v[2].y) - 0.5f, 0.0f);
+	float maxY = std::min(std::max(std::max(v[0].y, v[1].y), v[2].y) - 0.5f, OCCLUSION_HEIGHT - 1.0f);
+	if (minX > maxX || minY > maxY)
+		return;
+
+	// Rows start on a multiple of 4, so they can't run off the end
+	int startX = (int)ceilf(minX) & ~3;
+	int endX = (int)floorf(maxX);
+	int startY = (int)ceilf(minY);
+	int endY = (int)floorf(maxY);
+
+	// E(x, y) = A x + B y + C for the edge from each vertex to the next
+	float edgeA[3], edgeB[3], edgeC[3];
+	for (int e = 0; e < 3; e++)
+	{
+		const XMFLOAT3& from = v[e];
+		const XMFLOAT3& to = v[(e + 1) % 3];
+		edgeA[e] = from.y - to.y;
+		edgeB[e] = to.x - from.x;
+		edgeC[e] = -(edgeA[e] * from.x + edgeB[e] * from.y);
+	}
+
+	float depthX = ((v[1].z - v[0].z) * (v[2].y - v[0].y) - (v[2].z - v[0].z) * (v[1].y - v[0].y)) / area;
+	float depthY = ((v[2].z - v[0].z) * (v[1].x - v[0].x) - (v[1].z - v[0].z) * (v[2].x - v[0].x)) / area;
+	float depthC = v[0].z - depthX * v[0].x - depthY * v[0].y;
+
+	XMVECTOR centers = XMVectorSet(startX + 0.5f, startX + 1.5f, startX + 2.5f, startX + 3.5f);
+	XMVECTOR zero = XMVectorZero();
+	XMVECTOR edgeStep[3];
+	for (int e = 0; e < 3; e++)
+		edgeStep[e] = XMVectorReplicate(edgeA[e] * 4.0f);
+	XMVECTOR depthStep = XMVectorReplicate(depthX * 4.0f);
+
+	for (int y = startY; y <= endY; y++)
+	{
+		float centerY = y + 0.5f;
+		XMVECTOR edge[3];
+		for (int e = 0; e < 3; e++)
+			edge[e] = XMVectorMultiplyAdd(centers, XMVectorReplicate(edgeA[e]), XMVectorReplicate(edgeB[e] * centerY + edgeC[e]));
+		XMVECTOR depth = XMVectorMultiplyAdd(centers, XMVectorReplicate(depthX), XMVectorReplicate(depthY * centerY + depthC));
+
+		float* row = &maxDepth[0][y * OCCLUSION_WIDTH];
+		for (int x = startX; x <= endX; x += 4)
+		{
+			XMVECTOR inside = XMVectorAndInt(
+				XMVectorAndInt(XMVectorGreaterOrEqual(edge[0], zero), XMVectorGreaterOrEqual(edge[1], zero)),
+				XMVectorGreaterOrEqual(edge[2], zero));
+
+			XMVECTOR current = XMLoadFloat4(reinterpret_cast<XMFLOAT4*>(row + x));
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(row + x), XMVectorSelect(current, XMVectorMin(current, depth), inside));
+
+			for (int e = 0; e < 3; e++)
+				edge[e] = XMVectorAdd(edge[e], edgeStep[e]);
+			depth = XMVectorAdd(depth, depthStep);
+		}
+	}
+	stats.TrianglesDrawn++;
+}
+
+// --------------------------------------------------------
+// Clips a clip space triangle to the near plane (z >= 0),
+// which also keeps w positive, then projects what's left
+// to the screen.  Everything else is trimmed by the pixel
+// bounds in DrawTriangle.
+// --------------------------------------------------------
+void OcclusionCuller::ClipAndDrawTriangle(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c)
+{
+	XMVECTOR in[3] = { a, b, c };
+	float distance[3] = { XMVectorGetZ(a), XMVectorGetZ(b), XMVectorGetZ(c) };
+	if (distance[0] < 0 && distance[1] < 0 && distance[2] < 0)
+		return;
+
+	XMVECTOR polygon[4];
+	int count = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		int next = (i + 1) % 3;
+		if (distance[i] >= 0)
+			polygon[count++] = in[i];
+		if ((distance[i] >= 0) != (distance[next] >= 0))
+			polygon[count++] = XMVectorLerp(in[i], in[next], distance[i] / (distance[i] - distance[next]));
+	}
+
+	XMVECTOR scale = XMVectorSet(OCCLUSION_WIDTH * 0.5f, OCCLUSION_HEIGHT * -0.5f, 1.0f, 1.0f);
+	XMVECTOR offset = XMVectorSet(OCCLUSION_WIDTH * 0.5f, OCCLUSION_HEIGHT * 0.5f, 0.0f, 0.0f);
+	for (int i = 0; i < count; i++)
+		polygon[i] = XMVectorMultiplyAdd(XMVectorDivide(polygon[i], XMVectorSplatW(polygon[i])), scale, offset);
+
+	for (int i = 2; i < count; i++)
+		DrawTriangle(polygon[0], polygon[i - 1], polygon[i]);
+}
+
+// --------------------------------------------------------
+// Finds every pixel the box's corners could reach, and its
+// nearest depth.  Returns false for boxes crossing the
+// near plane or entirely off screen (left to the frustum).
+// --------------------------------------------------------
+bool OcclusionCuller::Project(const BoundsAABB& box, ScreenRect* rect)
+{
+	XMMATRIX toClip = XMLoadFloat4x4(&viewProjection);
+	XMVECTOR center = XMLoadFloat3(&box.Center);
+	XMVECTOR extents = XMLoadFloat3(&box.Extents);
+
+	XMVECTOR screenMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR screenMax = XMVectorReplicate(-FLT_MAX);
+	for (int i = 0; i < 8; i++)
+	{
+		XMVECTOR corner = XMVectorMultiplyAdd(extents, XMVectorSet(cornerSigns[i][0], cornerSigns[i][1], cornerSigns[i][2], 0), center);
+		XMVECTOR clip = XMVector3Transform(corner, toClip);
+		if (XMVectorGetZ(clip) < 0)
+			return false;
+
+		XMVECTOR projected = XMVectorDivide(clip, XMVectorSplatW(clip));
+		screenMin = XMVectorMin(screenMin, projected);
+		screenMax = XMVectorMax(screenMax, projected);
+	}
+
+	XMFLOAT3 low, high;
+	XMStoreFloat3(&low, screenMin);
+	XMStoreFloat3(&high, screenMax);
+
+	// Normalized device coordinates to pixels (y flips, so the bottom is the max)
+	float left = (low.x * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+	float right = (high.x * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+	float top = (0.5f - high.y * 0.5f) * OCCLUSION_HEIGHT;
+	float bottom = (0.5f - low.y * 0.5f) * OCCLUSION_HEIGHT;
+	if (right < 0 || left >= OCCLUSION_WIDTH || bottom < 0 || top >= OCCLUSION_HEIGHT)
+		return false;
+
+	rect->MinX = (int)std::max(left, 0.0f);
+	rect->MaxX = (int)std::min(right, OCCLUSION_WIDTH - 1.0f);
+	rect->MinY = (int)std::max(top, 0.0f);
+	rect->MaxY = (int)std::min(bottom, OCCLUSION_HEIGHT - 1.0f);
+	rect->Nearest = low.z;
+	return true;
+}
+
+bool OcclusionCuller::IsOccluded(const ScreenRect& rect, int level, int x, int y)
+{
+	int index = y * (OCCLUSION_WIDTH >> level) + x;
+
+	// Everything drawn here is in front of the box
+	if (rect.Nearest > maxDepth[level][index])
+		return true;
+
+	// Or some of the box is in front of everything drawn here
+	if (level == 0 || rect.Nearest <= minDepth[level][index])
+		return false;
+
+	int child = level - 1;
+	for (int cy = std::max(y * 2, rect.MinY >> child); cy <= std::min(y * 2 + 1, rect.MaxY >> child); cy++)
+	{
+		for (int cx = std::max(x * 2, rect.MinX >> child); cx <= std::min(x * 2 + 1, rect.MaxX >> child); cx++)
+		{
+			if (!IsOccluded(rect, child, cx, cy))
+				return false;
+		}
+	}
+	return true;
+}
+
+// The benchmark's building, which the reference images see too
+#define BENCHMARK_ROOMS				12
+#define BENCHMARK_ROOM_SIZE			10.0f
+#define BENCHMARK_WALL_HEIGHT		3.0f
+#define BENCHMARK_DOOR_WIDTH		2.0f
+#define BENCHMARK_CLUTTER_PER_ROOM	150
+
+// --------------------------------------------------------
+// A grid of rooms (walls with doorways, which are the
+// occluders) with clutter scattered on the floor
+// --------------------------------------------------------
+
+static void BuildBenchmarkScene(std::vector<BoundsAABB>& walls, std::vector<BoundsAABB>& objects)
+{
+	float half = BENCHMARK_ROOMS * BENCHMARK_ROOM_SIZE * 0.5f;
+
+	// Each wall line between rooms is two pieces per room, either side of a door
+	walls.clear();
+	for (int line = 0; line <= BENCHMARK_ROOMS; line++)
+	{
+		float along = -half + line * BENCHMARK_ROOM_SIZE;
+		for (int room = 0; room < BENCHMARK_ROOMS; room++)
+		{
+			float start = -half + room * BENCHMARK_ROOM_SIZE;
+			float pieceLength = (BENCHMARK_ROOM_SIZE - BENCHMARK_DOOR_WIDTH) * 0.5f;
+			for (int piece = 0; piece < 2; piece++)
+			{
+				float middle = start + pieceLength * 0.5f + piece * (pieceLength + BENCHMARK_DOOR_WIDTH);
+				BoundsAABB wall;
+				wall.Center = XMFLOAT3(along, BENCHMARK_WALL_HEIGHT * 0.5f, middle);
+				wall.Extents = XMFLOAT3(0.1f, BENCHMARK_WALL_HEIGHT * 0.5f, pieceLength * 0.5f);
+				walls.push_back(wall);
+
+				// The same, turned 90 degrees
+				wall.Center = XMFLOAT3(middle, BENCHMARK_WALL_HEIGHT * 0.5f, along);
+				wall.Extents = XMFLOAT3(pieceLength * 0.5f, BENCHMARK_WALL_HEIGHT * 0.5f, 0.1f);
+				walls.push_back(wall);
+			}
+		}
+	}
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-half, half);
+	std::uniform_real_distribution<float> size(0.1f, 0.5f);
+	objects.resize(BENCHMARK_ROOMS * BENCHMARK_ROOMS * BENCHMARK_CLUTTER_PER_ROOM);
+	for (auto& o : objects)
+	{
+		o.Extents = XMFLOAT3(size(random), size(random), size(random));
+		o.Center = XMFLOAT3(position(random), o.Extents.y, position(random));
+	}
+}
+
+// --------------------------------------------------------
+// The camera at a frame of a loop through the middle of a
+// row of rooms, looking along it (and swaying a little
+// from side to side) at eye height
+// --------------------------------------------------------
+static XMMATRIX GetBenchmarkViewProjection(unsigned int frame, XMVECTOR* eye)
+{
+	float angle = XM_2PI * frame / OCCLUSION_BENCHMARK_FRAMES;
+	float radius = BENCHMARK_ROOM_SIZE * 3.5f;
+	*eye = XMVectorSet(cosf(angle) * radius, 1.7f, sinf(angle) * radius, 0);
+	float look = angle + XM_PIDIV2 + 0.3f * sinf(angle * 7.0f);
+	XMMATRIX view = XMMatrixLookToLH(*eye, XMVectorSet(cosf(look), 0, sinf(look), 0), XMVectorSet(0, 1, 0, 0));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 0.01f, 100.0f);
+	return view * projection;
+}
+
+// --------------------------------------------------------
+// The nearest walls in view, at most OCCLUSION_MAX_OCCLUDERS
+// of them, sorted to the front of the list.  Returns how
+// many to draw.
+// --------------------------------------------------------
+static size_t ChooseBenchmarkOccluders(
+	const std::vector<BoundsAABB>& walls,
+	const Frustum& frustum,
+	FXMVECTOR eye,
+	std::vector<std::pair<float, unsigned int>>& occluders)
+{
+	occluders.clear();
+	for (unsigned int i = 0; i < walls.size(); i++)
+	{
+		if (!frustum.IntersectsAABB(XMLoadFloat3(&walls[i].Center), XMLoadFloat3(&walls[i].Extents)))
+			continue;
+
+		// Walking right through one would hide everything
+		XMVECTOR offset = XMVectorAbs(eye - XMLoadFloat3(&walls[i].Center));
+		if (XMVector3LessOrEqual(offset, XMLoadFloat3(&walls[i].Extents)))
+			continue;
+
+		float distance = XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&walls[i].Center) - eye));
+		occluders.push_back(std::make_pair(distance, i));
+	}
+	size_t occluderCount = std::min(occluders.size(), (size_t)OCCLUSION_MAX_OCCLUDERS);
+	std::partial_sort(occluders.begin(), occluders.begin() + occluderCount, occluders.end());
+	return occluderCount;
+}
+
+OcclusionBenchmark OcclusionCuller::RunBenchmark()
+{
+	std::vector<BoundsAABB> walls;
+	std::vector<BoundsAABB> objects;
+	BuildBenchmarkScene(walls, objects);
+
+	OcclusionBenchmark result = {};
+	result.Frames = OCCLUSION_BENCHMARK_FRAMES;
+	result.ObjectCount = (unsigned int)objects.size();
+
+	OcclusionCuller culler;
+	std::vector<std::pair<float, unsigned int>> occluders;
+	unsigned int trianglesDrawn = 0;
+	unsigned int tested = 0;
+	unsigned int occluded = 0;
+	double rasterizeMs = 0, hierarchyMs = 0, testMs = 0;
+
+	for (unsigned int frame = 0; frame < OCCLUSION_BENCHMARK_FRAMES; frame++)
+	{
+		XMVECTOR eye;
+		XMMATRIX viewProjection = GetBenchmarkViewProjection(frame, &eye);
+		Frustum frustum;
+		frustum.Extract(viewProjection);
+		size_t occluderCount = ChooseBenchmarkOccluders(walls, frustum, eye, occluders);
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+		culler.Begin(viewProjection);
+		for (size_t i = 0; i < occluderCount; i++)
+			culler.AddOccluderBox(walls[occluders[i].second], XMMatrixIdentity());
+		auto endTime = std::chrono::high_resolution_clock::now();
+		rasterizeMs += std::chrono::duration<double, std::milli>(endTime - startTime).count();
+		trianglesDrawn += culler.GetStats().TrianglesDrawn;
+		result.OccluderCount += (unsigned int)occluderCount;
+
+		startTime = std::chrono::high_resolution_clock::now();
+		culler.BuildHierarchy();
+		endTime = std::chrono::high_resolution_clock::now();
+		hierarchyMs += std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+		std::vector<unsigned int> inFrustum;
+		for (unsigned int i = 0; i < objects.size(); i++)
+		{
+			if (frustum.IntersectsAABB(XMLoadFloat3(&objects[i].Center), XMLoadFloat3(&objects[i].Extents)))
+				inFrustum.push_back(i);
+		}
+
+		std::vector<unsigned char> visible(inFrustum.size());
+		startTime = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < inFrustum.size(); i++)
+			visible[i] = culler.IsVisible(objects[inFrustum[i]]);
+		endTime = std::chrono::high_resolution_clock::now();
+		testMs += std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+		for (size_t i = 0; i < inFrustum.size(); i++)
+		{
+			if ((bool)visible[i] != culler.IsVisibleFullResolution(objects[inFrustum[i]]))
+				result.Differences++;
+			occluded += !visible[i];
+		}
+		tested += (unsigned int)inFrustum.size();
+	}
+
+	result.OccluderCount /= OCCLUSION_BENCHMARK_FRAMES;
+	result.TrianglesPerSecond = rasterizeMs > 0 ? trianglesDrawn / (rasterizeMs / 1000.0) : 0;
+	result.RasterizeMs = rasterizeMs / OCCLUSION_BENCHMARK_FRAMES;
+	result.HierarchyMs = hierarchyMs / OCCLUSION_BENCHMARK_FRAMES;
+	result.TestMs = testMs / OCCLUSION_BENCHMARK_FRAMES;
+	result.CullRate = tested > 0 ? (double)occluded / tested : 0;
+	return result;
+}
+
+std::vector<OcclusionReference> OcclusionCuller::CheckReferenceImages(const char* directory, bool save)
+{
+	std::vector<BoundsAABB> walls;
+	std::vector<BoundsAABB> objects;
+	BuildBenchmarkScene(walls, objects);
+
+	OcclusionCuller culler;
+	std::vector<std::pair<float, unsigned int>> occluders;
+	std::vector<OcclusionReference> results;
+	for (unsigned int frame = 0; frame < OCCLUSION_BENCHMARK_FRAMES; frame += OCCLUSION_REFERENCE_STRIDE)
+	{
+		XMVECTOR eye;
+		XMMATRIX viewProjection = GetBenchmarkViewProjection(frame, &eye);
+		Frustum frustum;
+		frustum.Extract(viewProjection);
+		size_t occluderCount = ChooseBenchmarkOccluders(walls, frustum, eye, occluders);
+
+		culler.Begin(viewProjection);
+		for (size_t i = 0; i < occluderCount; i++)
+			culler.AddOccluderBox(walls[occluders[i].second], XMMatrixIdentity());
+
+		std::string path = std::string(directory) + "/occlusion_" + std::to_string(frame) + ".pgm";
+		OcclusionReference result = {};
+		result.Frame = frame;
+		if (save)
+			result.Found = culler.SaveDepthImage(path.c_str());
+		else
+			result.Found = culler.CompareDepthImage(path.c_str(), &result.PixelsDifferent);
+		result.Matches = result.Found && result.PixelsDifferent <= OCCLUSION_REFERENCE_MAX_PIXELS;
+		results.push_back(result);
+	}
+	return results;
+}
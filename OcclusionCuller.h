@@ -0,0 +1,154 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "Bounds.h"
+
+// Size of the occlusion depth buffer.  Width is a multiple of 4
+// (pixels are shaded four at a time) and both are powers of 2,
+// so each level of the hierarchy is exactly half the last.
+#define OCCLUSION_WIDTH				256
+#define OCCLUSION_HEIGHT			128
+#define OCCLUSION_LEVELS			8		// Down to 2 x 1
+
+// Most occluders drawn in a frame (the biggest on screen go first)
+#define OCCLUSION_MAX_OCCLUDERS		32
+
+// Frames along the benchmark's camera path
+#define OCCLUSION_BENCHMARK_FRAMES	240
+
+// Reference depth images are taken every this many frames along the
+// benchmark's path.  A pixel matches when its depth is within the
+// tolerance (of 65535), and an image when no more than a few pixels
+// (edges landing either side of a pixel center) don't.
+#define OCCLUSION_REFERENCE_STRIDE		48
+#define OCCLUSION_REFERENCE_TOLERANCE	2
+#define OCCLUSION_REFERENCE_MAX_PIXELS	32
+
+// --------------------------------------------------------
+// Results since the last OcclusionCuller::Begin()
+// --------------------------------------------------------
+struct OcclusionStats
+{
+	unsigned int OccludersDrawn;
+	unsigned int TrianglesDrawn;	// After clipping, both sides
+	unsigned int ObjectsTested;
+	unsigned int ObjectsOccluded;
+};
+
+// --------------------------------------------------------
+// Totals of OcclusionCuller::RunBenchmark over the path
+// --------------------------------------------------------
+struct OcclusionBenchmark
+{
+	unsigned int Frames;
+	unsigned int ObjectCount;
+	unsigned int OccluderCount;
+	double TrianglesPerSecond;		// Rasterizing alone
+	double RasterizeMs;				// Everything per frame, averaged
+	double HierarchyMs;
+	double TestMs;
+	double CullRate;				// Of objects in the frustum, the fraction occluded
+	unsigned int Differences;		// Hierarchical tests that disagreed with full resolution ones
+};
+
+// --------------------------------------------------------
+// One pose of OcclusionCuller::CheckReferenceImages
+// --------------------------------------------------------
+struct OcclusionReference
+{
+	unsigned int Frame;				// Along the benchmark's path
+	bool Found;						// The image could be read (or written)
+	unsigned int PixelsDifferent;	// Beyond OCCLUSION_REFERENCE_TOLERANCE
+	bool Matches;
+};
+
+// --------------------------------------------------------
+// Occlusion culling against a small depth buffer drawn on
+// the CPU.  A frame goes:
+//  - Begin() with the camera
+//  - AddOccluder*() for a few big objects, drawn into the
+//    depth buffer four pixels at a time
+//  - BuildHierarchy(), which halves the buffer over and
+//    over, keeping the nearest and furthest depth of each
+//    block
+//  - IsVisible() for each object, which goes down the
+//    hierarchy only where the furthest depth is closer
+//    than the object, but the nearest isn't
+//
+// Occluders have to be inside what they stand for (a box
+// around a sphere would hide things seen past its edge),
+// and pixels count as covered when their center is, so
+// objects only just peeking past an occluder's edge can be
+// culled.  Depth is the usual 0 (near) to 1 (far).
+//
+// Only depends on DirectXMath, so it can be checked without
+// a window or a device (see SaveDepthImage).
+// --------------------------------------------------------
+class OcclusionCuller
+{
+public:
+	OcclusionCuller();
+
+	// Clears the depth buffer for a (row-vector) view-projection matrix
+	void Begin(DirectX::FXMMATRIX viewProjection);
+
+	// Draws the (object space) box, or an indexed triangle list
+	void AddOccluderBox(const BoundsAABB& box, DirectX::FXMMATRIX world);
+	void AddOccluderTriangles(
+		const DirectX::XMFLOAT3* positions,
+		const unsigned int* indices,
+		size_t indexCount,
+		DirectX::FXMMATRIX world);
+
+	void BuildHierarchy();
+
+	// Whether any of the world space box could be in front of the
+	// occluders.  Boxes crossing the near plane are always visible.
+	bool IsVisible(const BoundsAABB& box);
+
+	// The same answer from every full resolution pixel, for checking
+	bool IsVisibleFullResolution(const BoundsAABB& box);
+
+	OcclusionStats GetStats() { return stats; }
+	const float* GetDepth() { return maxDepth[0].data(); }
+
+	// Writes the depth buffer as a binary PGM (near is black), to
+	// compare against reference images
+	bool SaveDepthImage(const char* path);
+
+	// Reads a PGM written by SaveDepthImage and counts the pixels that
+	// differ from the depth buffer by more than the tolerance.  Returns
+	// false if it can't be read or is the wrong size
+	bool CompareDepthImage(const char* path, unsigned int* pixelsDifferent);
+
+	// Flies a camera along a fixed path through a made up building,
+	// timing each part and counting what gets culled
+	static OcclusionBenchmark RunBenchmark();
+
+	// Draws the benchmark's occluders from every OCCLUSION_REFERENCE_STRIDE
+	// frames of its path and compares each depth buffer against the
+	// "occlusion_<frame>.pgm" images in a directory (or saves them there,
+	// to make new references)
+	static std::vector<OcclusionReference> CheckReferenceImages(const char* directory, bool save);
+
+private:
+	DirectX::XMFLOAT4X4 viewProjection;
+	OcclusionStats stats;
+
+	// Level 0 is the depth buffer itself (both are the same there)
+	std::vector<float> minDepth[OCCLUSION_LEVELS];
+	std::vector<float> maxDepth[OCCLUSION_LEVELS];
+
+	struct ScreenRect
+	{
+		int MinX, MinY, MaxX, MaxY;		// Pixels, inclusive
+		float Nearest;
+	};
+
+	void DrawTriangle(DirectX::FXMVECTOR a, DirectX::FXMVECTOR b, DirectX::FXMVECTOR c);
+	void ClipAndDrawTriangle(DirectX::FXMVECTOR a, DirectX::FXMVECTOR b, DirectX::FXMVECTOR c);
+	bool Project(const BoundsAABB& box, ScreenRect* rect);
+	bool IsOccluded(const ScreenRect& rect, int level, int x, int y);
+};
@@ -0,0 +1,144 @@
+#include "RenderQueue.h"
+
+#include <string.h>
+
+// Where each field starts, counting from the least significant bit
+#define RENDER_KEY_DEPTH_SHIFT		0
+#define RENDER_KEY_MESH_SHIFT		(RENDER_KEY_DEPTH_SHIFT + RENDER_KEY_DEPTH_BITS)
+#define RENDER_KEY_MATERIAL_SHIFT	(RENDER_KEY_MESH_SHIFT + RENDER_KEY_MESH_BITS)
+#define RENDER_KEY_SHADER_SHIFT		(RENDER_KEY_MATERIAL_SHIFT + RENDER_KEY_MATERIAL_BITS)
+#define RENDER_KEY_PASS_SHIFT		(RENDER_KEY_SHADER_SHIFT + RENDER_KEY_SHADER_BITS)
+
+static_assert(RENDER_KEY_PASS_SHIFT + RENDER_KEY_PASS_BITS == 64, "Draw key fields should fill 64 bits");
+
+static inline unsigned long long FieldMask(int bits)
+{
+	return (1ull << bits) - 1;
+}
+
+static inline unsigned int GetField(unsigned long long key, int shift, int bits)
+{
+	return (unsigned int)((key >> shift) & FieldMask(bits));
+}
+
+// Hands out the next id, until the last one (which is shared)
+template <typename Map, typename Key>
+static unsigned int FindOrAddId(Map& ids, const Key& key, int bits)
+{
+	auto found = ids.find(key);
+	if (found != ids.end())
+		return found->second;
+
+	unsigned int id = (unsigned int)ids.size();
+	if (id >= FieldMask(bits))
+		return (unsigned int)FieldMask(bits);
+	ids[key] = id;
+	return id;
+}
+
+// A field changed, or is the shared overflow id
+static inline bool FieldChanged(unsigned long long previous, unsigned long long next, int shift, int bits)
+{
+	unsigned int field = GetField(next, shift, bits);
+	return field != GetField(previous, shift, bits) || field == FieldMask(bits);
+}
+
+void RenderQueue::Clear()
+{
+	items.clear();
+	shaderIds.clear();
+	materialIds.clear();
+	meshIds.clear();
+}
+
+unsigned int RenderQueue::GetShaderId(const void* vertexShader, const void* pixelShader)
+{
+	return FindOrAddId(shaderIds, std::make_pair(vertexShader, pixelShader), RENDER_KEY_SHADER_BITS);
+}
+
+unsigned int RenderQueue::GetMaterialId(const void* material)
+{
+	return FindOrAddId(materialIds, material, RENDER_KEY_MATERIAL_BITS);
+}
+
+unsigned int RenderQueue::GetMeshId(const void* mesh)
+{
+	return FindOrAddId(meshIds, mesh, RENDER_KEY_MESH_BITS);
+}
+
+// --------------------------------------------------------
+// Depth goes in as the top bits of the float itself, which
+// sort the same way as the (non-negative) values do, so no
+// range has to be picked
+// --------------------------------------------------------
+void RenderQueue::Add(unsigned int pass, unsigned int shader, unsigned int material, unsigned int mesh, float depth, unsigned int index)
+{
+	if (!(depth > 0.0f))
+		depth = 0.0f;
+	unsigned int depthBits;
+	memcpy(&depthBits, &depth, sizeof(depthBits));
+
+	RenderItem item;
+	item.Key =
+		((unsigned long long)(pass & FieldMask(RENDER_KEY_PASS_BITS)) << RENDER_KEY_PASS_SHIFT) |
+		((unsigned long long)(shader & FieldMask(RENDER_KEY_SHADER_BITS)) << RENDER_KEY_SHADER_SHIFT) |
+		((unsigned long long)(material & FieldMask(RENDER_KEY_MATERIAL_BITS)) << RENDER_KEY_MATERIAL_SHIFT) |
+		((unsigned long long)(mesh & FieldMask(RENDER_KEY_MESH_BITS)) << RENDER_KEY_MESH_SHIFT) |
+		((unsigned long long)(depthBits >> (31 - RENDER_KEY_DEPTH_BITS)) << RENDER_KEY_DEPTH_SHIFT);
+	item.Index = index;
+	items.push_back(item);
+}
+
+void RenderQueue::Sort()
+{
+	const unsigned int buckets = 1 << RENDER_QUEUE_RADIX_BITS;
+	const unsigned long long digitMask = buckets - 1;
+
+	scratch.resize(items.size());
+	for (int shift = 0; shift < 64; shift += RENDER_QUEUE_RADIX_BITS)
+	{
+		size_t counts[buckets] = {};
+		for (const RenderItem& item : items)
+			counts[(item.Key >> shift) & digitMask]++;
+
+		// Every key has the same digit here, so the order stays as it is
+		if (items.empty() || counts[(items[0].Key >> shift) & digitMask] == items.size())
+			continue;
+
+		size_t offset = 0;
+		for (unsigned int b = 0; b < buckets; b++)
+		{
+			size_t count = counts[b];
+			counts[b] = offset;
+			offset += count;
+		}
+		for (const RenderItem& item : items)
+			scratch[counts[(item.Key >> shift) & digitMask]++] = item;
+		items.swap(scratch);
+	}
+}
+
+bool RenderQueue::ShaderChanged(unsigned long long previous, unsigned long long next)
+{
+	return
+		GetField(previous, RENDER_KEY_PASS_SHIFT, RENDER_KEY_PASS_BITS) != GetField(next, RENDER_KEY_PASS_SHIFT, RENDER_KEY_PASS_BITS) ||
+		FieldChanged(previous, next, RENDER_KEY_SHADER_SHIFT, RENDER_KEY_SHADER_BITS);
+}
+
+bool RenderQueue::MaterialChanged(unsigned long long previous, unsigned long long next)
+{
+	return FieldChanged(previous, next, RENDER_KEY_MATERIAL_SHIFT, RENDER_KEY_MATERIAL_BITS);
+}
+
+bool RenderQueue::MeshChanged(unsigned long long previous, unsigned long long next)
+{
+	return FieldChanged(previous, next, RENDER_KEY_MESH_SHIFT, RENDER_KEY_MESH_BITS);
+}
+
+bool RenderQueue::SameState(unsigned long long previous, unsigned long long next)
+{
+	return
+		!ShaderChanged(previous, next) &&
+		!MaterialChanged(previous, next) &&
+		!MeshChanged(previous, next);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+// Widths of a draw key's fields, most significant first.  Sorting
+// by the key groups draws by pass, then shader, then material, then
+// mesh, and goes front to back within each group.
+#define RENDER_KEY_PASS_BITS		4
+#define RENDER_KEY_SHADER_BITS		10
+#define RENDER_KEY_MATERIAL_BITS	16
+#define RENDER_KEY_MESH_BITS		16
+#define RENDER_KEY_DEPTH_BITS		18
+
+// Passes, in the order they're drawn
+#define RENDER_PASS_OPAQUE			0
+
+// Bits sorted on by each pass of the radix sort
+#define RENDER_QUEUE_RADIX_BITS		8
+
+// --------------------------------------------------------
+// Binds and uploads made while drawing, counted by whoever
+// makes them
+// --------------------------------------------------------
+struct RenderStateStats
+{
+	unsigned int ShaderBinds;
+	unsigned int SRVBinds;
+	unsigned int SamplerBinds;
+	unsigned int CBufferUploads;
+	unsigned int Draws;
+	unsigned int Instances;
+};
+
+// --------------------------------------------------------
+// One draw: its key, and which object it draws
+// --------------------------------------------------------
+struct RenderItem
+{
+	unsigned long long Key;
+	unsigned int Index;
+};
+
+// --------------------------------------------------------
+// A frame's draws, sorted by key so that draws sharing
+// state end up next to each other.  Each field only has to
+// be rebound when it differs from the last draw's.
+//
+// Shaders, materials and meshes are given ids the first
+// time they're seen each frame.  Keys are only compared
+// within a frame, so the ids are forgotten by Clear(): a
+// deleted asset's address can't pass its id on to a new
+// one, and only the frame's own assets are ever held.
+// Once a field runs out of ids, anything new shares the
+// last one, which never compares as unchanged (so those
+// draws still bind everything, they just don't sort
+// together).
+// --------------------------------------------------------
+class RenderQueue
+{
+public:
+	// Empties the queue and forgets every id
+	void Clear();
+
+	unsigned int GetShaderId(const void* vertexShader, const void* pixelShader);
+	unsigned int GetMaterialId(const void* material);
+	unsigned int GetMeshId(const void* mesh);
+
+	// Depth is the distance in front of the camera
+	void Add(unsigned int pass, unsigned int shader, unsigned int material, unsigned int mesh, float depth, unsigned int index);
+
+	// Least significant digit first, skipping digits every key shares
+	void Sort();
+	const std::vector<RenderItem>& GetItems() { return items; }
+
+	// Whether a field needs binding again going from one key to the next
+	static bool ShaderChanged(unsigned long long previous, unsigned long long next);
+	static bool MaterialChanged(unsigned long long previous, unsigned long long next);
+	static bool MeshChanged(unsigned long long previous, unsigned long long next);
+
+	// Nothing needs binding between the two, so they could share a draw
+	static bool SameState(unsigned long long previous, unsigned long long next);
+
+private:
+	std::vector<RenderItem> items;
+	std::vector<RenderItem> scratch;
+
+	std::map<std::pair<const void*, const void*>, unsigned int> shaderIds;
+	std::unordered_map<const void*, unsigned int> materialIds;
+	std::unordered_map<const void*, unsigned int> meshIds;
+};
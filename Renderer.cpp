@@ -1,4 +1,6 @@
 #include "Renderer.h"
+#include <algorithm>
+#include <string.h>
 #include "imgui.h"
 #include "imgui_impl_dx11.h"
 
@@ -30,7 +32,21 @@ Renderer::Renderer(
 	lightVS(lightVS),
 	lightPS(lightPS)
 {
-	
+	uploadStats = {};
+	frustumCulling = true;
+	occlusionCulling = true;
+	sortedDraws = true;
+	sortedStats = {};
+	unsortedStats = {};
+	instanceCapacity = 0;
+	instanceCount = 0;
+	instancing = true;
+	lightStats = {};
+}
+
+Renderer::~Renderer()
+{
+	for (auto t : lightTransforms) delete t;
 }
 
 void Renderer::PostResize(
@@ -60,30 +76,19 @@ void Renderer::Render(Camera* camera, Mesh* lightMesh, DirectX::SpriteFont* aria
 		1.0f,
 		0);
 
-	// Draw all of the entities
-	for (auto ge : entities)
-	{
-		// Set the "per frame" data
-		// Note that this should literally be set once PER FRAME, before
-		// the draw loop, but we're currently setting it per entity since 
-		// we are just using whichever shader the current entity has.  
-		// Inefficient!!!
-		SimplePixelShader* ps = ge->GetMaterial()->GetPS();
-		ps->SetData("Lights", (void*)(&lights[0]), sizeof(Light) * lights.size());
-		ps->SetInt("LightCount", lights.size());
-		ps->SetFloat3("CameraPosition", camera->GetTransform()->GetPosition());
-
-		// Set IBL vars
-		ps->SetShaderResourceView("brdfLookUpMap", sky->GetIBLBRDFLookUpTexture());
-		ps->SetShaderResourceView("irradianceIBLMap", sky->GetIBLIrradianceMap());
-		ps->SetShaderResourceView("specularIBLMap", sky->GetIBLConvolvedSpecularMap());
-		ps->SetInt("SpecIBLTotalMipLevels", sky->GetIBLMipLevelCount());
+	// Get the GPU's copy of the matrices up to date
+	UpdateLightTransforms();
+	UploadObjectMatrices();
+	context->VSSetShaderResources(0, 1, objectSRV.GetAddressOf());
+	instanceCount = 0;
 
-		ps->CopyBufferData("perFrame");
-
-		// Draw the entity
-		ge->Draw(context, camera);
-	}
+	// Draw the entities the camera can see
+	CullEntities(camera);
+	Mesh::ResetCullStats();
+	if (sortedDraws)
+		DrawEntitiesSorted(camera);
+	else
+		DrawEntities(camera);
 
 	// Draw the light sources
 	DrawPointLights(camera, lightMesh);
@@ -108,56 +113,511 @@ void Renderer::Render(Camera* camera, Mesh* lightMesh, DirectX::SpriteFont* aria
 	context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthBufferDSV.Get());
 }
 
+// --------------------------------------------------------
+// Fills the visible list: every entity whose world bounds
+// touch the camera's frustum (or all of them, with culling
+// off), less those hidden behind occluders.  Bounds are only
+// recomputed for entities that have moved, but all of them
+// are copied to the culler.
+// --------------------------------------------------------
+void Renderer::CullEntities(Camera* camera)
+{
+	if (culler.GetCount() != entities.size())
+		culler.Resize(entities.size());
+	for (size_t i = 0; i < entities.size(); i++)
+		culler.SetBounds(i, entities[i]->GetWorldSphere(), entities[i]->GetWorldAABB());
+
+	Frustum frustum;
+	if (frustumCulling)
+	{
+		XMFLOAT4X4 view = camera->GetView();
+		XMFLOAT4X4 projection = camera->GetProjection();
+		frustum.Extract(XMLoadFloat4x4(&view) * XMLoadFloat4x4(&projection));
+	}
+	else
+	{
+		// Planes everything is in front of
+		for (int i = 0; i < 6; i++)
+			frustum.Planes[i] = XMFLOAT4(0, 0, 0, 1);
+	}
+	culler.Cull(frustum, visibleEntities);
+
+	if (occlusionCulling)
+		CullOccludedEntities(camera);
+}
+
+// --------------------------------------------------------
+// Draws the occluders of the entities that look biggest
+// (radius over distance) into the occlusion buffer, then
+// drops the visible entities that are entirely behind them
+// --------------------------------------------------------
+void Renderer::CullOccludedEntities(Camera* camera)
+{
+	XMFLOAT4X4 view = camera->GetView();
+	XMFLOAT4X4 projection = camera->GetProjection();
+	occlusion.Begin(XMLoadFloat4x4(&view) * XMLoadFloat4x4(&projection));
+
+	XMFLOAT3 cameraPosition = camera->GetTransform()->GetPosition();
+	XMVECTOR eye = XMLoadFloat3(&cameraPosition);
+	occluders.clear();
+	for (unsigned int index : visibleEntities)
+	{
+		GameEntity* ge = entities[index];
+		if (!ge->HasOccluder())
+			continue;
+
+		// An occluder around the camera would hide everything
+		const BoundsSphere& sphere = ge->GetWorldSphere();
+		float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&sphere.Center) - eye)) - sphere.Radius;
+		if (distance <= 0.0f)
+			continue;
+		occluders.push_back(std::make_pair(-sphere.Radius / distance, index));
+	}
+	size_t occluderCount = std::min(occluders.size(), (size_t)OCCLUSION_MAX_OCCLUDERS);
+	std::partial_sort(occluders.begin(), occluders.begin() + occluderCount, occluders.end());
+
+	for (size_t i = 0; i < occluderCount; i++)
+	{
+		GameEntity* ge = entities[occluders[i].second];
+		XMFLOAT4X4 world = ge->GetTransform()->GetWorldMatrix();
+		occlusion.AddOccluderBox(ge->GetOccluder(), XMLoadFloat4x4(&world));
+	}
+	occlusion.BuildHierarchy();
+
+	size_t kept = 0;
+	for (unsigned int index : visibleEntities)
+	{
+		if (occlusion.IsVisible(entities[index]->GetWorldAABB()))
+			visibleEntities[kept++] = index;
+	}
+	visibleEntities.resize(kept);
+}
+
+// --------------------------------------------------------
+// Draws the visible entities in list order, setting every
+// shader, texture and constant for each one
+// --------------------------------------------------------
+void Renderer::DrawEntities(Camera* camera)
+{
+	instanceSlots.clear();
+	for (unsigned int index : visibleEntities)
+		instanceSlots.push_back(TransformSystem::GetSlot(entities[index]->GetTransform()->GetHandle()));
+	unsigned int firstInstance = UploadInstances();
+
+	RenderStateStats stats = {};
+	for (size_t i = 0; i < visibleEntities.size(); i++)
+	{
+		GameEntity* ge = entities[visibleEntities[i]];
+
+		// Set the "per frame" data
+		// Note that this should literally be set once PER FRAME, before
+		// the draw loop, but we're currently setting it per entity since 
+		// we are just using whichever shader the current entity has.  
+		// Inefficient!!!  (See DrawEntitiesSorted)
+		SimplePixelShader* ps = ge->GetMaterial()->GetPS();
+		ps->SetData("Lights", (void*)(&lights[0]), sizeof(Light) * lights.size());
+		ps->SetInt("LightCount", lights.size());
+		ps->SetFloat3("CameraPosition", camera->GetTransform()->GetPosition());
+
+		// Set IBL vars
+		stats.SRVBinds += ps->SetShaderResourceView("brdfLookUpMap", sky->GetIBLBRDFLookUpTexture());
+		stats.SRVBinds += ps->SetShaderResourceView("irradianceIBLMap", sky->GetIBLIrradianceMap());
+		stats.SRVBinds += ps->SetShaderResourceView("specularIBLMap", sky->GetIBLConvolvedSpecularMap());
+		ps->SetInt("SpecIBLTotalMipLevels", sky->GetIBLMipLevelCount());
+
+		ps->CopyBufferData("perFrame");
+		stats.CBufferUploads++;
+
+		// Draw the entity
+		BindInstances(firstInstance + (unsigned int)i);
+		ge->Draw(context, camera, &stats);
+	}
+	unsortedStats = stats;
+}
+
+// --------------------------------------------------------
+// Draws the visible entities sorted by shader, material,
+// mesh and then depth.  Going down the list, each piece of
+// state is only set when its field of the key changes:
+//  - Shaders: the shaders themselves, the view and
+//    projection, and the lights and IBL textures
+//  - Material: its textures, samplers and constants
+//  - Mesh: how compact positions unpack
+// With instancing on, each run of entities with the same
+// state and LOD is drawn at once; otherwise (or for a run
+// of one) each is drawn on its own, with meshlet culling.
+// --------------------------------------------------------
+void Renderer::DrawEntitiesSorted(Camera* camera)
+{
+	XMFLOAT4X4 view = camera->GetView();
+	XMFLOAT4X4 projection = camera->GetProjection();
+	XMMATRIX viewMatrix = XMLoadFloat4x4(&view);
+
+	renderQueue.Clear();
+	for (unsigned int index : visibleEntities)
+	{
+		GameEntity* ge = entities[index];
+		Material* material = ge->GetMaterial();
+		Mesh* mesh = ge->GetMesh();
+
+		XMVECTOR center = XMLoadFloat3(&ge->GetWorldSphere().Center);
+		float depth = XMVectorGetZ(XMVector3Transform(center, viewMatrix));
+		renderQueue.Add(
+			RENDER_PASS_OPAQUE,
+			renderQueue.GetShaderId(material->GetVSFor(mesh), material->GetPS()),
+			renderQueue.GetMaterialId(material),
+			renderQueue.GetMeshId(mesh),
+			depth,
+			index);
+	}
+	renderQueue.Sort();
+
+	// Instances are in the same order as the draws
+	const std::vector<RenderItem>& items = renderQueue.GetItems();
+	instanceSlots.clear();
+	for (const RenderItem& item : items)
+		instanceSlots.push_back(TransformSystem::GetSlot(entities[item.Index]->GetTransform()->GetHandle()));
+	unsigned int firstInstance = UploadInstances();
+
+	RenderStateStats stats = {};
+	unsigned long long lastKey = 0;
+	bool first = true;
+	size_t i = 0;
+	while (i < items.size())
+	{
+		const RenderItem& item = items[i];
+		GameEntity* ge = entities[item.Index];
+		Material* material = ge->GetMaterial();
+		Mesh* mesh = ge->GetMesh();
+		SimpleVertexShader* vs = material->GetVSFor(mesh);
+		unsigned int lod = ge->GetLOD();
+
+		// Take in the rest of the run this can share a draw with
+		size_t end = i + 1;
+		while (instancing &&
+			end < items.size() &&
+			RenderQueue::SameState(item.Key, items[end].Key) &&
+			entities[items[end].Index]->GetLOD() == lod)
+			end++;
+
+		// A new shader needs everything set again
+		bool newShader = first || RenderQueue::ShaderChanged(lastKey, item.Key);
+		bool newMaterial = newShader || RenderQueue::MaterialChanged(lastKey, item.Key);
+		bool newMesh = newShader || RenderQueue::MeshChanged(lastKey, item.Key);
+		first = false;
+		lastKey = item.Key;
+
+		if (newShader)
+			BindFrameData(vs, material->GetPS(), camera, &stats);
+		if (newMaterial)
+			material->BindMaterial(vs, &stats);
+		if (newMesh && vs->GetBufferInfo("perMesh"))
+		{
+			vs->SetFloat3("positionOffset", mesh->GetPositionOffset());
+			vs->SetFloat3("positionScale", mesh->GetPositionScale());
+			vs->CopyBufferData("perMesh");
+			stats.CBufferUploads++;
+		}
+
+		// Their matrices are already in the object buffer
+		unsigned int count = (unsigned int)(end - i);
+		BindInstances(firstInstance + (unsigned int)i);
+		if (count == 1)
+			stats.Draws += mesh->SetBuffersAndDrawVisible(context, ge->GetTransform()->GetWorldMatrix(), view, projection, lod);
+		else
+		{
+			mesh->SetBuffersAndDrawInstanced(context, count, lod);
+			stats.Draws++;
+		}
+		stats.Instances += count;
+		i = end;
+	}
+	sortedStats = stats;
+}
+
+// --------------------------------------------------------
+// Sets a pair of shaders, along with everything they need
+// that's the same for the whole frame
+// --------------------------------------------------------
+void Renderer::BindFrameData(SimpleVertexShader* vs, SimplePixelShader* ps, Camera* camera, RenderStateStats* stats)
+{
+	vs->SetShader();
+	ps->SetShader();
+	stats->ShaderBinds += 2;
+
+	vs->SetMatrix4x4("view", camera->GetView());
+	vs->SetMatrix4x4("projection", camera->GetProjection());
+	vs->CopyBufferData("perFrame");
+
+	ps->SetData("Lights", (void*)(&lights[0]), sizeof(Light) * lights.size());
+	ps->SetInt("LightCount", lights.size());
+	ps->SetFloat3("CameraPosition", camera->GetTransform()->GetPosition());
+	ps->SetInt("SpecIBLTotalMipLevels", sky->GetIBLMipLevelCount());
+	ps->CopyBufferData("perFrame");
+	stats->CBufferUploads += 2;
+
+	stats->SRVBinds += ps->SetShaderResourceView("brdfLookUpMap", sky->GetIBLBRDFLookUpTexture());
+	stats->SRVBinds += ps->SetShaderResourceView("irradianceIBLMap", sky->GetIBLIrradianceMap());
+	stats->SRVBinds += ps->SetShaderResourceView("specularIBLMap", sky->GetIBLConvolvedSpecularMap());
+}
+
+// --------------------------------------------------------
+// Keeps a transform for each light's gizmo, only touching
+// the ones whose light has actually moved or changed size
+// --------------------------------------------------------
+void Renderer::UpdateLightTransforms()
+{
+	while (lightTransforms.size() < lights.size())
+		lightTransforms.push_back(new Transform());
+
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		// Calc quick scale based on range
+		// (assuming range is between 5 - 10)
+		float scale = lights[i].Range / 10.0f;
+		XMFLOAT3 position = lights[i].Position;
+
+		Transform* t = lightTransforms[i];
+		XMFLOAT3 currentPosition = t->GetPosition();
+		XMFLOAT3 currentScale = t->GetScale();
+		if (currentPosition.x != position.x || currentPosition.y != position.y || currentPosition.z != position.z)
+			t->SetPosition(position.x, position.y, position.z);
+		if (currentScale.x != scale || currentScale.y != scale || currentScale.z != scale)
+			t->SetScale(scale, scale, scale);
+	}
+
+	// Anything changed since Update() still needs its matrices
+	TransformSystem::GetInstance().UpdateWorldMatrices();
+}
+
+// --------------------------------------------------------
+// Copies the matrices of every transform rebuilt since the
+// last frame into the object buffer.  The changed slots are
+// sorted and nearby ones merged, so most frames upload a
+// few small spans (or nothing) rather than every object.
+// --------------------------------------------------------
+void Renderer::UploadObjectMatrices()
+{
+	TransformSystem& ts = TransformSystem::GetInstance();
+	bool complete = ts.TakeChangeJournal(changedTransforms);
+	uploadStats = {};
+
+	// The buffer is indexed by slot, so it has to cover all of them
+	unsigned int slotCount = ts.GetSlotCount();
+	bool uploadAll = false;
+	if (slotCount > objectMatrices.size() || !objectBuffer)
+	{
+		size_t capacity = objectMatrices.empty() ? 1024 : objectMatrices.size();
+		while (capacity < slotCount)
+			capacity *= 2;
+		objectMatrices.resize(capacity);
+
+		D3D11_BUFFER_DESC desc = {};
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		desc.ByteWidth = (unsigned int)(sizeof(ObjectMatrices) * capacity);
+		desc.CPUAccessFlags = 0;
+		desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		desc.StructureByteStride = sizeof(ObjectMatrices);
+		desc.Usage = D3D11_USAGE_DEFAULT;
+
+		D3D11_SUBRESOURCE_DATA data = {};
+		data.pSysMem = &objectMatrices[0];
+
+		objectBuffer.Reset();
+		objectSRV.Reset();
+		device->CreateBuffer(&desc, &data, objectBuffer.GetAddressOf());
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = (unsigned int)capacity;
+		device->CreateShaderResourceView(objectBuffer.Get(), &srvDesc, objectSRV.GetAddressOf());
+		uploadAll = true;
+	}
+
+	// Lost track of what changed, so refresh everything we draw
+	if (!complete)
+	{
+		changedTransforms.clear();
+		for (auto ge : entities)
+			changedTransforms.push_back(ge->GetTransform()->GetHandle());
+		for (auto t : lightTransforms)
+			changedTransforms.push_back(t->GetHandle());
+		uploadAll = true;
+	}
+
+	// Slot order, each once (the journal may have repeats)
+	std::sort(changedTransforms.begin(), changedTransforms.end(), [](TransformHandle a, TransformHandle b) {
+		return TransformSystem::GetSlot(a) < TransformSystem::GetSlot(b);
+	});
+	changedTransforms.erase(std::unique(changedTransforms.begin(), changedTransforms.end()), changedTransforms.end());
+
+	for (auto h : changedTransforms)
+	{
+		// Destroyed since it changed
+		if (!ts.IsValid(h))
+			continue;
+
+		ObjectMatrices& m = objectMatrices[TransformSystem::GetSlot(h)];
+		m.World = ts.GetWorldMatrix(h);
+		m.WorldInverseTranspose = ts.GetWorldInverseTransposeMatrix(h);
+		uploadStats.ObjectsUploaded++;
+	}
+
+	if (uploadAll)
+	{
+		UploadSpan(0, slotCount);
+		return;
+	}
+
+	// Merge changed slots into spans, bridging small gaps
+	size_t i = 0;
+	while (i < changedTransforms.size())
+	{
+		unsigned int begin = TransformSystem::GetSlot(changedTransforms[i]);
+		unsigned int end = begin + 1;
+		for (i++; i < changedTransforms.size(); i++)
+		{
+			unsigned int slot = TransformSystem::GetSlot(changedTransforms[i]);
+			if (slot > end + RENDERER_UPLOAD_MERGE_GAP)
+				break;
+			end = slot + 1;
+		}
+		UploadSpan(begin, end);
+	}
+}
+
+// --------------------------------------------------------
+// Sends objects [begin, end) of the CPU copy to the buffer
+// --------------------------------------------------------
+void Renderer::UploadSpan(unsigned int begin, unsigned int end)
+{
+	if (begin >= end)
+		return;
+
+	D3D11_BOX box = {};
+	box.left = (unsigned int)(begin * sizeof(ObjectMatrices));
+	box.right = (unsigned int)(end * sizeof(ObjectMatrices));
+	box.top = 0;
+	box.bottom = 1;
+	box.front = 0;
+	box.back = 1;
+	context->UpdateSubresource(objectBuffer.Get(), 0, &box, &objectMatrices[begin], 0, 0);
+
+	uploadStats.SpansUploaded++;
+	uploadStats.BytesUploaded += box.right - box.left;
+}
+
+// --------------------------------------------------------
+// Copies instanceSlots to the end of this frame's instance
+// stream, returning where they start.  The first upload of
+// a frame starts the buffer over; later ones are appended
+// without disturbing what earlier draws are reading.
+// --------------------------------------------------------
+unsigned int Renderer::UploadInstances()
+{
+	unsigned int count = (unsigned int)instanceSlots.size();
+	if (count == 0)
+		return instanceCount;
+
+	D3D11_MAP mapType = instanceCount == 0 ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+	if (!instanceBuffer || instanceCount + count > instanceCapacity)
+	{
+		// Big enough for everything so far this frame, so the
+		// next frame fits in one buffer
+		unsigned int capacity = instanceCapacity > 0 ? instanceCapacity : RENDERER_MIN_INSTANCES;
+		while (capacity < instanceCount + count)
+			capacity *= 2;
+
+		D3D11_BUFFER_DESC desc = {};
+		desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		desc.ByteWidth = sizeof(unsigned int) * capacity;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+
+		instanceBuffer.Reset();
+		device->CreateBuffer(&desc, 0, instanceBuffer.GetAddressOf());
+		instanceCapacity = capacity;
+		instanceCount = 0;
+		mapType = D3D11_MAP_WRITE_DISCARD;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	context->Map(instanceBuffer.Get(), 0, mapType, 0, &mapped);
+	memcpy((unsigned int*)mapped.pData + instanceCount, &instanceSlots[0], sizeof(unsigned int) * count);
+	context->Unmap(instanceBuffer.Get(), 0);
+
+	unsigned int first = instanceCount;
+	instanceCount += count;
+	return first;
+}
+
+// --------------------------------------------------------
+// Points input slot 1 at the instance stream, so the next
+// draw's first instance is the given one
+// --------------------------------------------------------
+void Renderer::BindInstances(unsigned int first)
+{
+	UINT stride = sizeof(unsigned int);
+	UINT offset = first * sizeof(unsigned int);
+	context->IASetVertexBuffers(1, 1, instanceBuffer.GetAddressOf(), &stride, &offset);
+}
+
+// --------------------------------------------------------
+// Draws a sphere for each point light, up to a batch of
+// them at a time, with their colors indexed by instance
+// --------------------------------------------------------
 void Renderer::Renderer::DrawPointLights(Camera* camera, Mesh* lightMesh)
 {
+	lightStats = {};
+
+	// Only drawing points, so skip others
+	instanceSlots.clear();
+	lightColors.clear();
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		const Light& light = lights[i];
+		if (light.Type != LIGHT_TYPE_POINT)
+			continue;
+
+		// Its matrices are already in the object buffer
+		instanceSlots.push_back(TransformSystem::GetSlot(lightTransforms[i]->GetHandle()));
+		lightColors.push_back(XMFLOAT4(
+			light.Color.x * light.Intensity,
+			light.Color.y * light.Intensity,
+			light.Color.z * light.Intensity,
+			1.0f));
+	}
+	if (instanceSlots.empty())
+		return;
+	unsigned int firstInstance = UploadInstances();
+
 	// Turn on these shaders
 	lightVS->SetShader();
 	lightPS->SetShader();
+	lightStats.ShaderBinds += 2;
 
 	// Set up vertex shader
 	lightVS->SetMatrix4x4("view", camera->GetView());
 	lightVS->SetMatrix4x4("projection", camera->GetProjection());
+	lightVS->SetFloat3("positionOffset", lightMesh->GetPositionOffset());
+	lightVS->SetFloat3("positionScale", lightMesh->GetPositionScale());
+	lightVS->CopyAllBufferData();
+	lightStats.CBufferUploads += lightVS->GetBufferCount();
 
-	for (int i = 0; i < lights.size(); i++)
+	unsigned int batchSize = instancing ? RENDERER_LIGHT_BATCH : 1;
+	for (size_t first = 0; first < lightColors.size(); first += batchSize)
 	{
-		Light light = lights[i];
-
-		// Only drawing points, so skip others
-		if (light.Type != LIGHT_TYPE_POINT)
-			continue;
-
-		// Calc quick scale based on range
-		// (assuming range is between 5 - 10)
-		float scale = light.Range / 10.0f;
-
-		// Make the transform for this light
-		XMMATRIX rotMat = XMMatrixIdentity();
-		XMMATRIX scaleMat = XMMatrixScaling(scale, scale, scale);
-		XMMATRIX transMat = XMMatrixTranslation(light.Position.x, light.Position.y, light.Position.z);
-		XMMATRIX worldMat = scaleMat * rotMat * transMat;
-
-		XMFLOAT4X4 world;
-		XMFLOAT4X4 worldInvTrans;
-		XMStoreFloat4x4(&world, worldMat);
-		XMStoreFloat4x4(&worldInvTrans, XMMatrixInverse(0, XMMatrixTranspose(worldMat)));
-
-		// Set up the world matrix for this light
-		lightVS->SetMatrix4x4("world", world);
-		lightVS->SetMatrix4x4("worldInverseTranspose", worldInvTrans);
-
-		// Set up the pixel shader data
-		XMFLOAT3 finalColor = light.Color;
-		finalColor.x *= light.Intensity;
-		finalColor.y *= light.Intensity;
-		finalColor.z *= light.Intensity;
-		lightPS->SetFloat3("Color", finalColor);
-
-		// Copy data
-		lightVS->CopyAllBufferData();
+		unsigned int count = (unsigned int)(std::min)((size_t)batchSize, lightColors.size() - first);
+		lightPS->SetData("Colors", &lightColors[first], sizeof(XMFLOAT4) * count);
 		lightPS->CopyAllBufferData();
+		lightStats.CBufferUploads++;
 
-		// Draw
-		lightMesh->SetBuffersAndDraw(context);
+		BindInstances(firstInstance + (unsigned int)first);
+		lightMesh->SetBuffersAndDrawInstanced(context, count);
+		lightStats.Draws++;
+		lightStats.Instances += count;
 	}
 }
 
@@ -7,6 +7,36 @@
 #include "Sky.h"
 #include "GameEntity.h"
 #include "Lights.h"
+#include "Transform.h"
+#include "FrustumCuller.h"
+#include "OcclusionCuller.h"
+#include "RenderQueue.h"
+
+// Changed objects at most this many slots apart are uploaded
+// together, along with the unchanged ones in between
+#define RENDERER_UPLOAD_MERGE_GAP 8
+
+// Smallest the instance stream gets, in transform slots
+#define RENDERER_MIN_INSTANCES 1024
+
+// Most point lights drawn at once - must match MAX_INSTANCES in SolidColorPS
+#define RENDERER_LIGHT_BATCH 128
+
+// One object's matrices in the structured buffer the vertex
+// shaders read - must match ObjectMatrices in the shaders
+struct ObjectMatrices
+{
+	DirectX::XMFLOAT3X4 World;
+	DirectX::XMFLOAT3X4 WorldInverseTranspose;
+};
+
+// What UploadObjectMatrices() sent to the GPU this frame
+struct ObjectUploadStats
+{
+	unsigned int ObjectsUploaded;	// Changed ones, not counting gaps
+	unsigned int SpansUploaded;
+	unsigned int BytesUploaded;
+};
 
 class Renderer
 {
@@ -24,6 +54,7 @@ public:
 		const std::vector<Light>& lights, 
 		SimpleVertexShader* lightVS,
 		SimplePixelShader* lightPS);
+	~Renderer();
 	void PostResize(
 		unsigned int windowWidth,
 		unsigned int windowHeight,
@@ -34,6 +65,34 @@ public:
 		Mesh* lightMesh, 
 		DirectX::SpriteFont* arial, 
 		DirectX::SpriteBatch* spriteBatch);
+
+	ObjectUploadStats GetObjectUploadStats() { return uploadStats; }
+
+	// Skipping entities outside the camera's view (on by default)
+	void SetFrustumCulling(bool enabled) { frustumCulling = enabled; }
+	bool GetFrustumCulling() { return frustumCulling; }
+	FrustumCullStats GetFrustumCullStats() { return culler.GetStats(); }
+
+	// Then skipping the ones hidden behind entities with occluders
+	void SetOcclusionCulling(bool enabled) { occlusionCulling = enabled; }
+	bool GetOcclusionCulling() { return occlusionCulling; }
+	OcclusionStats GetOcclusionStats() { return occlusion.GetStats(); }
+	bool SaveOcclusionDepth(const char* path) { return occlusion.SaveDepthImage(path); }
+
+	// Drawing entities in draw key order, binding only what changed
+	// (on by default), or in list order binding everything each time.
+	// The stats are from the last frame drawn each way.
+	void SetSortedDraws(bool enabled) { sortedDraws = enabled; }
+	bool GetSortedDraws() { return sortedDraws; }
+	RenderStateStats GetSortedDrawStats() { return sortedStats; }
+	RenderStateStats GetUnsortedDrawStats() { return unsortedStats; }
+
+	// Drawing sorted entities that share a mesh, material and LOD as
+	// one instanced draw, and the point lights in batches (on by
+	// default).  Off, everything is drawn one instance at a time.
+	void SetInstancing(bool enabled) { instancing = enabled; }
+	bool GetInstancing() { return instancing; }
+	RenderStateStats GetLightDrawStats() { return lightStats; }
 private:
 	Microsoft::WRL::ComPtr<ID3D11Device> device;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
@@ -48,6 +107,50 @@ private:
 	SimpleVertexShader* lightVS;
 	SimplePixelShader* lightPS;
 
+	// Every object's matrices, indexed by transform slot, on the GPU
+	// and a copy here so spans can be uploaded in one piece
+	Microsoft::WRL::ComPtr<ID3D11Buffer> objectBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> objectSRV;
+	std::vector<ObjectMatrices> objectMatrices;
+	std::vector<TransformHandle> changedTransforms;
+	ObjectUploadStats uploadStats;
+
+	// Where the point lights are drawn
+	std::vector<Transform*> lightTransforms;
+
+	// Entities to draw this frame, by index
+	FrustumCuller culler;
+	std::vector<unsigned int> visibleEntities;
+	bool frustumCulling;
+	OcclusionCuller occlusion;
+	std::vector<std::pair<float, unsigned int>> occluders;
+	bool occlusionCulling;
+
+	RenderQueue renderQueue;
+	bool sortedDraws;
+	RenderStateStats sortedStats;
+	RenderStateStats unsortedStats;
+
+	// Transform slots of everything drawn this frame, in draw order.
+	// Each draw binds it to input slot 1 from its first instance on.
+	Microsoft::WRL::ComPtr<ID3D11Buffer> instanceBuffer;
+	unsigned int instanceCapacity;
+	unsigned int instanceCount;
+	std::vector<unsigned int> instanceSlots;
+	std::vector<DirectX::XMFLOAT4> lightColors;
+	bool instancing;
+	RenderStateStats lightStats;
+
+	void UpdateLightTransforms();
+	void CullEntities(Camera* camera);
+	void CullOccludedEntities(Camera* camera);
+	void DrawEntities(Camera* camera);
+	void DrawEntitiesSorted(Camera* camera);
+	void BindFrameData(SimpleVertexShader* vs, SimplePixelShader* ps, Camera* camera, RenderStateStats* stats);
+	unsigned int UploadInstances();
+	void BindInstances(unsigned int first);
+	void UploadObjectMatrices();
+	void UploadSpan(unsigned int begin, unsigned int end);
 	void DrawPointLights(
 		Camera* camera, 
 		Mesh* lightMesh);
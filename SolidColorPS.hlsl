@@ -1,11 +1,25 @@
-
+// Most instances drawn at once
+// - Must match RENDERER_LIGHT_BATCH in C++
+#define MAX_INSTANCES 128
 
 cbuffer externalData : register(b0)
 {
-	float3 Color;
+	float4 Colors[MAX_INSTANCES];
 }
 
-float4 main() : SV_TARGET
+// Only the instance is used, but everything before it
+// has to be declared to line up with the vertex shader
+struct VertexToPixel
+{
+	float4 screenPosition	: SV_POSITION;
+	float2 uv				: TEXCOORD;
+	float3 normal			: NORMAL;
+	float3 tangent			: TANGENT;
+	float3 worldPos			: POSITION;
+	nointerpolation uint instance : INSTANCE;
+};
+
+float4 main(VertexToPixel input) : SV_TARGET
 {
-	return float4(Color, 1);
+	return float4(Colors[input.instance].rgb, 1);
 }
\ No newline at end of file
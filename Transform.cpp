@@ -2,104 +2,174 @@
 
 using namespace DirectX;
 
+// Handles of the transforms in the current bulk edit
+static std::vector<TransformHandle> bulkHandles;
 
-Transform::Transform()
+static const TransformHandle* GatherHandles(Transform* const* transforms, size_t count)
 {
-	// Start with an identity matrix and basic transform data
-	XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
-	XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixIdentity());
+	bulkHandles.resize(count);
+	for (size_t i = 0; i < count; i++)
+		bulkHandles[i] = transforms[i]->GetHandle();
+	return bulkHandles.data();
+}
 
-	position = XMFLOAT3(0, 0, 0);
-	pitchYawRoll = XMFLOAT3(0, 0, 0);
-	scale = XMFLOAT3(1, 1, 1);
+static const TransformHandle* GatherHandles(Transform* transforms, size_t count)
+{
+	bulkHandles.resize(count);
+	for (size_t i = 0; i < count; i++)
+		bulkHandles[i] = transforms[i].GetHandle();
+	return bulkHandles.data();
+}
 
-	// No need to recalc yet
-	matricesDirty = false;
+Transform::Transform()
+{
+	// Starts at the origin with no rotation and a scale of 1
+	handle = TransformSystem::GetInstance().Create(this);
+}
 
-	parent = NULL;
+Transform::~Transform()
+{
+	TransformSystem::GetInstance().Destroy(handle);
 }
 
 void Transform::MoveAbsolute(float x, float y, float z)
 {
-	position.x += x;
-	position.y += y;
-	position.z += z;
-	matricesDirty = true;
+	XMFLOAT3 position = GetPosition();
+	SetPosition(position.x + x, position.y + y, position.z + z);
 }
 
 void Transform::MoveRelative(float x, float y, float z)
 {
-	// Create a direction vector from the params
-	// and a rotation quaternion
-	XMVECTOR movement = XMVectorSet(x, y, z, 0);
-	XMVECTOR rotQuat = XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
-
-	// Rotate the movement by the quaternion
-	XMVECTOR dir = XMVector3Rotate(movement, rotQuat);
-
-	// Add and store, and invalidate the matrices
+	// Move along the rotated axes
+	const TransformAxes& axes = TransformSystem::GetInstance().GetAxes(handle);
+	XMVECTOR dir =
+		XMLoadFloat3(&axes.Right) * x +
+		XMLoadFloat3(&axes.Up) * y +
+		XMLoadFloat3(&axes.Forward) * z;
+
+	// Add and store
+	XMFLOAT3 position = GetPosition();
 	XMStoreFloat3(&position, XMLoadFloat3(&position) + dir);
-	matricesDirty = true;
+	SetPosition(position.x, position.y, position.z);
 }
 
+// --------------------------------------------------------
+// Pitches and rolls around the transform's own axes, and
+// yaws around the parent's up axis.  That matches adding
+// the angles to the Euler ones whenever there's no roll
+// (a camera looking around), or only one angle changes.
+// --------------------------------------------------------
 void Transform::Rotate(float p, float y, float r)
 {
-	pitchYawRoll.x += p;
-	pitchYawRoll.y += y;
-	pitchYawRoll.z += r;
-	matricesDirty = true;
+	XMFLOAT4 rotation = GetRotation();
+	XMVECTOR local = XMQuaternionRotationRollPitchYaw(p, 0, r);
+	XMVECTOR yaw = XMQuaternionRotationRollPitchYaw(0, y, 0);
+	XMVECTOR combined = XMQuaternionMultiply(XMQuaternionMultiply(local, XMLoadFloat4(&rotation)), yaw);
+
+	XMStoreFloat4(&rotation, combined);
+	SetRotation(rotation);
 }
 
 void Transform::Scale(float x, float y, float z)
 {
-	scale.x *= x;
-	scale.y *= y;
-	scale.z *= z;
-	matricesDirty = true;
+	XMFLOAT3 scale = GetScale();
+	SetScale(scale.x * x, scale.y * y, scale.z * z);
 }
 
 void Transform::SetPosition(float x, float y, float z)
 {
-	position.x = x;
-	position.y = y;
-	position.z = z;
-	matricesDirty = true;
+	TransformSystem::GetInstance().SetPosition(handle, x, y, z);
 }
 
 void Transform::SetRotation(float p, float y, float r)
 {
-	pitchYawRoll.x = p;
-	pitchYawRoll.y = y;
-	pitchYawRoll.z = r;
-	matricesDirty = true;
+	TransformSystem::GetInstance().SetPitchYawRoll(handle, p, y, r);
+}
+
+void Transform::SetRotation(DirectX::XMFLOAT4 quaternion)
+{
+	TransformSystem::GetInstance().SetRotation(handle, quaternion);
 }
 
 void Transform::SetScale(float x, float y, float z)
 {
-	scale.x = x;
-	scale.y = y;
-	scale.z = z;
-	matricesDirty = true;
+	TransformSystem::GetInstance().SetScale(handle, x, y, z);
 }
 
-DirectX::XMFLOAT3 Transform::GetPosition() { return position; }
+void Transform::SetPositions(Transform* const* transforms, const DirectX::XMFLOAT3* positions, size_t count)
+{
+	TransformSystem::GetInstance().SetPositions(GatherHandles(transforms, count), positions, count);
+}
 
-DirectX::XMFLOAT3 Transform::GetPitchYawRoll() { return pitchYawRoll; }
+void Transform::SetPositions(Transform* transforms, const DirectX::XMFLOAT3* positions, size_t count)
+{
+	TransformSystem::GetInstance().SetPositions(GatherHandles(transforms, count), positions, count);
+}
 
-DirectX::XMFLOAT3 Transform::GetScale() { return scale; }
+void Transform::MoveAbsolute(Transform* const* transforms, size_t count, float x, float y, float z)
+{
+	TransformSystem::GetInstance().MoveAbsolute(GatherHandles(transforms, count), count, x, y, z);
+}
 
+void Transform::MoveAbsolute(Transform* transforms, size_t count, float x, float y, float z)
+{
+	TransformSystem::GetInstance().MoveAbsolute(GatherHandles(transforms, count), count, x, y, z);
+}
 
-DirectX::XMFLOAT4X4 Transform::GetWorldMatrix()
+void Transform::Rotate(Transform* const* transforms, size_t count, float p, float y, float r)
 {
-	UpdateMatrices();
+	TransformSystem::GetInstance().Rotate(GatherHandles(transforms, count), count, p, y, r);
+}
 
-	return worldMatrix;
+void Transform::Rotate(Transform* transforms, size_t count, float p, float y, float r)
+{
+	TransformSystem::GetInstance().Rotate(GatherHandles(transforms, count), count, p, y, r);
+}
+
+DirectX::XMFLOAT3 Transform::GetPosition() { return TransformSystem::GetInstance().GetPosition(handle); }
+
+DirectX::XMFLOAT3 Transform::GetPitchYawRoll() { return TransformSystem::GetInstance().GetPitchYawRoll(handle); }
+
+DirectX::XMFLOAT4 Transform::GetRotation() { return TransformSystem::GetInstance().GetRotation(handle); }
+
+DirectX::XMFLOAT3 Transform::GetScale() { return TransformSystem::GetInstance().GetScale(handle); }
+
+DirectX::XMFLOAT3 Transform::GetRight() { return TransformSystem::GetInstance().GetAxes(handle).Right; }
+
+DirectX::XMFLOAT3 Transform::GetUp() { return TransformSystem::GetInstance().GetAxes(handle).Up; }
+
+DirectX::XMFLOAT3 Transform::GetForward() { return TransformSystem::GetInstance().GetAxes(handle).Forward; }
+
+
+DirectX::XMFLOAT4X4 Transform::GetWorldMatrix()
+{
+	XMFLOAT3X4 world = TransformSystem::GetInstance().GetWorldMatrix(handle);
+	XMFLOAT4X4 result;
+	XMStoreFloat4x4(&result, XMLoadFloat3x4(&world));
+	return result;
 }
 
 DirectX::XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix()
 {
-	UpdateMatrices();
-	return worldMatrix;
+	XMFLOAT3X4 normal = TransformSystem::GetInstance().GetWorldInverseTransposeMatrix(handle);
+	XMFLOAT4X4 result;
+	XMStoreFloat4x4(&result, XMLoadFloat3x4(&normal));
+	return result;
+}
+
+DirectX::XMFLOAT3X4 Transform::GetWorldMatrix3x4()
+{
+	return TransformSystem::GetInstance().GetWorldMatrix(handle);
+}
+
+DirectX::XMFLOAT3X4 Transform::GetWorldInverseTransposeMatrix3x4()
+{
+	return TransformSystem::GetInstance().GetWorldInverseTransposeMatrix(handle);
+}
+
+unsigned int Transform::GetWorldVersion()
+{
+	return TransformSystem::GetInstance().GetWorldVersion(handle);
 }
 
 void Transform::AddChild(Transform* child)
@@ -109,64 +179,59 @@ void Transform::AddChild(Transform* child)
 		return;
 
 	// If the new child is already in the list
-	for (int i = 0; i < children.size(); i++) {
-		if (children[i] == child)
-			return;
-	}
-	
-	// Add the new child
-	children.push_back(child);
+	if (child->GetParent() == this)
+		return;
 
 	child->AdjustForParent(true);
 
 	// Set the new child's parent
-	child->parent = this;
-
-	MarkChildTransformDirty();
+	TransformSystem::GetInstance().SetParent(child->handle, handle);
 }
 
 void Transform::RemoveChild(Transform* child)
 {
-	children.erase(children.begin() + IndexOfChild(child));
+	if (child == NULL || child->GetParent() != this)
+		return;
 
 	child->AdjustForParent(false);
-	MarkChildTransformDirty();
+	TransformSystem::GetInstance().SetParent(child->handle, TRANSFORM_NO_PARENT);
 }
 
 void Transform::SetParent(Transform* newParent)
 {
-	// Sets new parent
-	parent = newParent;
-
-	// If the new parent is not null, add *this* Transform to its list of children
-	if (newParent != NULL) {
+	// Adds *this* Transform to the new parent's children (which also
+	// takes it away from the old parent), or just leaves the old parent
+	if (newParent != NULL)
 		newParent->AddChild(this);
-		this->matricesDirty = true;
-	}
-
-	MarkChildTransformDirty();
+	else if (GetParent() != NULL)
+		GetParent()->RemoveChild(this);
 }
 
 Transform* Transform::GetParent()
 {
-	return parent;
+	TransformSystem& system = TransformSystem::GetInstance();
+	TransformHandle parentHandle = system.GetParent(handle);
+	if (parentHandle == TRANSFORM_NO_PARENT)
+		return NULL;
+
+	return system.GetOwner(parentHandle);
 }
 
 Transform* Transform::GetChild(unsigned int index)
 {
-	// Returns null if the index is out of bounds of the children vector
-	if (index < 0 || index >= children.size())
-		return NULL;
-	
-	return children[index];
+	// Returns null if the index is out of bounds of the children
+	TransformSystem& system = TransformSystem::GetInstance();
+	return system.GetOwner(system.GetChild(handle, index));
 }
 
 int Transform::IndexOfChild(Transform* child)
 {
-	// Loops through the child vector and returns the index if one matches
-	for (int i = 0; i < children.size(); i++) {
-		if (children[i] == child)
-			return i;
+	// Loops through the children and returns the index if one matches
+	TransformSystem& system = TransformSystem::GetInstance();
+	int index = 0;
+	for (TransformHandle c = system.GetFirstChild(handle); c != TRANSFORM_NO_NODE; c = system.GetNextSibling(c), index++) {
+		if (c == child->handle)
+			return index;
 	}
 
 	// Otherwise returns -1
@@ -175,54 +240,17 @@ int Transform::IndexOfChild(Transform* child)
 
 unsigned int Transform::GetChildCount()
 {
-	return children.size();
-}
-
-void Transform::UpdateMatrices()
-{
-	// Are the matrices out of date (dirty)?
-	if (matricesDirty)
-	{
-		// Create the three transformation pieces
-		XMMATRIX trans = XMMatrixTranslationFromVector(XMLoadFloat3(&position));
-		XMMATRIX rot = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
-		XMMATRIX sc = XMMatrixScalingFromVector(XMLoadFloat3(&scale));
-
-		// Combine and store the world
-		XMMATRIX wm = sc * rot * trans;
-
-		if (parent != NULL)
-		{
-			DirectX::XMFLOAT4X4 parentVal = parent->GetWorldMatrix();
-			XMMATRIX parentWorldMat = XMLoadFloat4x4(&parentVal);
-			wm = XMMatrixMultiply(wm, parentWorldMat);
-		}
-
-		XMStoreFloat4x4(&worldMatrix, wm);
-
-		// Invert and transpose, too
-		XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixInverse(0, XMMatrixTranspose(wm)));
-
-		// All set
-		matricesDirty = false;
-		MarkChildTransformDirty();
-	}
-}
-
-void Transform::MarkChildTransformDirty()
-{
-	matricesDirty = true;
-	for (auto c : children)
-	{
-		c->MarkChildTransformDirty();
-	}
+	return TransformSystem::GetInstance().GetChildCount(handle);
 }
 
 void Transform::AdjustForParent(bool isBeingAdded)
 {
 	// Ensure there is a parent to be adjusted against
+	Transform* parent = GetParent();
 	if (parent == NULL)
 		return;
+	XMFLOAT3 parentScale = parent->GetScale();
+	XMFLOAT3 parentPosition = parent->GetPosition();
 
 	// Scale ============================
 	// If the child is being added to the parent, 
@@ -230,9 +258,9 @@ void Transform::AdjustForParent(bool isBeingAdded)
 	// if the child is being removed from the parent, 
 	// its scaled needs to be reverted
 	if (isBeingAdded)
-		this->Scale(1 / parent->scale.x, 1 / parent->scale.y, 1 / parent->scale.z);
+		this->Scale(1 / parentScale.x, 1 / parentScale.y, 1 / parentScale.z);
 	else
-		this->Scale(parent->scale.x, parent->scale.y, parent->scale.z);
+		this->Scale(parentScale.x, parentScale.y, parentScale.z);
 
 	// Position ====================
 	// If the child is being added to the parent, 
@@ -240,9 +268,9 @@ void Transform::AdjustForParent(bool isBeingAdded)
 	// if the child is being removed from the parent, 
 	// its parent's position needs to be added
 	if (isBeingAdded)
-		this->MoveRelative(-parent->position.x, -parent->position.y, -parent->position.z);
+		this->MoveRelative(-parentPosition.x, -parentPosition.y, -parentPosition.z);
 	else
-		this->MoveRelative(parent->position.x, parent->position.y, parent->position.z);
+		this->MoveRelative(parentPosition.x, parentPosition.y, parentPosition.z);
 }
 
 void DescaleFromParent(Transform* parent)
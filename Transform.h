@@ -1,12 +1,22 @@
 #pragma once
 
 #include <DirectXMath.h>
-#include <vector>
 
+#include "TransformSystem.h"
+
+// --------------------------------------------------------
+// A handle to one node of the TransformSystem, which holds
+// the actual data and computes the world matrices
+// --------------------------------------------------------
 class Transform
 {
 public:
 	Transform();
+	~Transform();
+
+	// Each handle owns its node
+	Transform(Transform const&) = delete;
+	void operator=(Transform const&) = delete;
 
 	void MoveAbsolute(float x, float y, float z);
 	void MoveRelative(float x, float y, float z);
@@ -15,13 +25,36 @@ public:
 
 	void SetPosition(float x, float y, float z);
 	void SetRotation(float p, float y, float r);
+	void SetRotation(DirectX::XMFLOAT4 quaternion);
 	void SetScale(float x, float y, float z);
 
+	// The same edits for many transforms at once, either an array of
+	// pointers or a contiguous array (see TransformSystem's bulk edits)
+	static void SetPositions(Transform* const* transforms, const DirectX::XMFLOAT3* positions, size_t count);
+	static void SetPositions(Transform* transforms, const DirectX::XMFLOAT3* positions, size_t count);
+	static void MoveAbsolute(Transform* const* transforms, size_t count, float x, float y, float z);
+	static void MoveAbsolute(Transform* transforms, size_t count, float x, float y, float z);
+	static void Rotate(Transform* const* transforms, size_t count, float p, float y, float r);
+	static void Rotate(Transform* transforms, size_t count, float p, float y, float r);
+
 	DirectX::XMFLOAT3 GetPosition();
-	DirectX::XMFLOAT3 GetPitchYawRoll();
+	DirectX::XMFLOAT3 GetPitchYawRoll();	// Worked out from the quaternion
+	DirectX::XMFLOAT4 GetRotation();
 	DirectX::XMFLOAT3 GetScale();
+
+	// The rotated local axes
+	DirectX::XMFLOAT3 GetRight();
+	DirectX::XMFLOAT3 GetUp();
+	DirectX::XMFLOAT3 GetForward();
 	DirectX::XMFLOAT4X4 GetWorldMatrix();
-	DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix();
+	DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix();	// Upper 3x3 only (for normals), no translation
+
+	// Just the first three columns, for shaders
+	DirectX::XMFLOAT3X4 GetWorldMatrix3x4();
+	DirectX::XMFLOAT3X4 GetWorldInverseTransposeMatrix3x4();
+
+	// Changes whenever the world matrix does
+	unsigned int GetWorldVersion();
 
 	void AddChild(Transform* child);
 	void RemoveChild(Transform* child);
@@ -31,24 +64,12 @@ public:
 	int IndexOfChild(Transform* child);
 	unsigned int GetChildCount();
 
-private:
-	// Raw transformation data
-	DirectX::XMFLOAT3 position;
-	DirectX::XMFLOAT3 pitchYawRoll;
-	DirectX::XMFLOAT3 scale;
-
-	// World matrix and inverse transpose of the world matrix
-	bool matricesDirty;
-	DirectX::XMFLOAT4X4 worldMatrix;
-	DirectX::XMFLOAT4X4 worldInverseTransposeMatrix;
+	TransformHandle GetHandle() { return handle; }
 
-	Transform* parent;
-	std::vector<Transform*> children;
-
-	// Helper to update both matrices if necessary
-	void UpdateMatrices();
+private:
+	// This transform's node in the TransformSystem
+	TransformHandle handle;
 
-	void MarkChildTransformDirty();
 	void AdjustForParent(bool isBeingAdded);
 };
 
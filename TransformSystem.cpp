@@ -0,0 +1,1500 @@
+#include "TransformSystem.h"
+
+#include <chrono>
+#include <math.h>
+#include <string.h>
+
+using namespace DirectX;
+
+// Singleton requirement
+TransformSystem* TransformSystem::instance;
+
+// --------------------------------------------------------
+// Rearranges the first from.size() entries so entry i is
+// the one that used to be at from[i]
+// --------------------------------------------------------
+template<typename T>
+static void Reorder(std::vector<T>& data, const std::vector<unsigned int>& from)
+{
+	std::vector<T> sorted(data);
+	for (size_t i = 0; i < from.size(); i++)
+		sorted[i] = data[from[i]];
+	data.swap(sorted);
+}
+
+// Loads four consecutive floats of a component array
+static inline XMVECTOR LoadFour(const std::vector<float>& data, size_t index)
+{
+	return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&data[index]));
+}
+
+// Four nodes' values the fraction t of the way from their previous ones
+static inline XMVECTOR LerpFour(const std::vector<float>& previous, XMVECTOR current, size_t index, XMVECTOR t)
+{
+	return XMVectorLerpV(LoadFour(previous, index), current, t);
+}
+
+// XMQuaternionMultiply(a, b) for four quaternions at once, one
+// component per vector
+static inline void MultiplyFour(
+	XMVECTOR ax, XMVECTOR ay, XMVECTOR az, XMVECTOR aw,
+	XMVECTOR bx, XMVECTOR by, XMVECTOR bz, XMVECTOR bw,
+	XMVECTOR& x, XMVECTOR& y, XMVECTOR& z, XMVECTOR& w)
+{
+	x = bw * ax + bx * aw + by * az - bz * ay;
+	y = bw * ay - bx * az + by * aw + bz * ax;
+	z = bw * az + bx * ay - by * ax + bz * aw;
+	w = bw * aw - bx * ax - by * ay - bz * az;
+}
+
+// Identity values returned for stale handles
+static const TransformAxes identityAxes = { XMFLOAT3(1, 0, 0), XMFLOAT3(0, 1, 0), XMFLOAT3(0, 0, 1) };
+static const XMFLOAT3X4 identity3x4(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0);
+
+TransformSystem::TransformSystem()
+{
+	slotCount = 0;
+	freeSlot = TRANSFORM_NO_NODE;
+	orderDirty = false;
+	localsChanged = false;
+	nextVersion = 1;
+	stepping = false;
+	renderAlpha = 1.0f;
+	changeJournalOverflowed = false;
+
+	frame = 1;
+	frameStats = {};
+	lastFrameStats = {};
+
+	workers = new WorkerPool();
+}
+
+TransformSystem::~TransformSystem()
+{
+	delete workers;
+	for (Node* page : pages)
+		delete[] page;
+}
+
+void TransformSystem::SetThreadCount(unsigned int threadCount)
+{
+	delete workers;
+	workers = new WorkerPool(threadCount);
+}
+
+TransformHandle TransformSystem::Create(Transform* owner)
+{
+	// Reuse the slot of a destroyed node if there is one
+	unsigned int slot = freeSlot;
+	if (slot != TRANSFORM_NO_NODE)
+	{
+		freeSlot = NodeAt(slot).NextSibling;
+	}
+	else
+	{
+		if (slotCount >= TRANSFORM_MAX_NODES)
+			return TRANSFORM_NO_NODE;
+
+		slot = slotCount++;
+		if (slot % TRANSFORM_PAGE_SIZE == 0)
+			pages.push_back(new Node[TRANSFORM_PAGE_SIZE]);
+		NodeAt(slot).Generation = 1;
+	}
+
+	Node& node = NodeAt(slot);
+	node.Parent = TRANSFORM_NO_NODE;
+	node.FirstChild = TRANSFORM_NO_NODE;
+	node.LastChild = TRANSFORM_NO_NODE;
+	node.NextSibling = TRANSFORM_NO_NODE;
+	node.PreviousSibling = TRANSFORM_NO_NODE;
+	node.ChildCount = 0;
+	node.Owner = owner;
+	node.Moving = false;
+
+	// At the end for now, and moved to the first level by the next sort
+	unsigned int dense = (unsigned int)denseToSlot.size();
+	denseToSlot.push_back(slot);
+	node.Dense = dense;
+	ResizeLocals(denseToSlot.size());
+
+	positionX[dense] = positionY[dense] = positionZ[dense] = 0.0f;
+	rotationX[dense] = rotationY[dense] = rotationZ[dense] = 0.0f;
+	rotationW[dense] = 1.0f;
+	axes[dense] = { XMFLOAT3(1, 0, 0), XMFLOAT3(0, 1, 0), XMFLOAT3(0, 0, 1) };
+	scaleX[dense] = scaleY[dense] = scaleZ[dense] = 1.0f;
+	KeepAsPrevious(dense);
+	parents[dense] = -1;
+	versions[dense] = {};
+	MarkChanged(dense);
+	XMStoreFloat3x4(&worldMatrices[dense], XMMatrixIdentity());
+	XMStoreFloat3x4(&normalMatrices[dense], XMMatrixIdentity());
+	orderDirty = true;
+	return HandleOf(slot);
+}
+
+void TransformSystem::Destroy(TransformHandle handle)
+{
+	Node* node = Find(handle);
+	if (!node)
+		return;
+
+	// Any children become roots, where they are now in their parent's space
+	while (node->LastChild != TRANSFORM_NO_NODE)
+		SetParent(HandleOf(node->LastChild), TRANSFORM_NO_PARENT);
+	SetParent(handle, TRANSFORM_NO_PARENT);
+
+	// Fill the hole with the last node (sorted again before the next update)
+	unsigned int dense = node->Dense;
+	unsigned int last = (unsigned int)denseToSlot.size() - 1;
+	if (dense != last)
+	{
+		positionX[dense] = positionX[last];
+		positionY[dense] = positionY[last];
+		positionZ[dense] = positionZ[last];
+		rotationX[dense] = rotationX[last];
+		rotationY[dense] = rotationY[last];
+		rotationZ[dense] = rotationZ[last];
+		rotationW[dense] = rotationW[last];
+		axes[dense] = axes[last];
+		scaleX[dense] = scaleX[last];
+		scaleY[dense] = scaleY[last];
+		scaleZ[dense] = scaleZ[last];
+		previousPositionX[dense] = previousPositionX[last];
+		previousPositionY[dense] = previousPositionY[last];
+		previousPositionZ[dense] = previousPositionZ[last];
+		previousRotationX[dense] = previousRotationX[last];
+		previousRotationY[dense] = previousRotationY[last];
+		previousRotationZ[dense] = previousRotationZ[last];
+		previousRotationW[dense] = previousRotationW[last];
+		previousScaleX[dense] = previousScaleX[last];
+		previousScaleY[dense] = previousScaleY[last];
+		previousScaleZ[dense] = previousScaleZ[last];
+		worldMatrices[dense] = worldMatrices[last];
+		normalMatrices[dense] = normalMatrices[last];
+		versions[dense] = versions[last];
+		denseToSlot[dense] = denseToSlot[last];
+		NodeAt(denseToSlot[dense]).Dense = dense;
+	}
+	denseToSlot.pop_back();
+	ResizeLocals(denseToSlot.size());
+
+	// Old handles to this slot stop matching (0 is skipped when it wraps)
+	node->Generation = (node->Generation + 1) & TRANSFORM_GENERATION_MASK;
+	if (node->Generation == 0)
+		node->Generation = 1;
+	node->Owner = 0;
+	node->Moving = false;
+	node->NextSibling = freeSlot;
+	freeSlot = handle & TRANSFORM_INDEX_MASK;
+	orderDirty = true;
+}
+
+TransformSystem::Node* TransformSystem::Find(TransformHandle handle)
+{
+	unsigned int slot = handle & TRANSFORM_INDEX_MASK;
+	if (slot >= slotCount)
+		return 0;
+
+	Node& node = NodeAt(slot);
+	return node.Generation == handle >> TRANSFORM_INDEX_BITS ? &node : 0;
+}
+
+unsigned int TransformSystem::DenseOf(TransformHandle handle)
+{
+	Node* node = Find(handle);
+	return node ? node->Dense : TRANSFORM_NO_NODE;
+}
+
+DirectX::XMFLOAT3 TransformSystem::GetPosition(TransformHandle handle)
+{
+	unsigned int dense = DenseOf(handle);
+	if (dense == TRANSFORM_NO_NODE)
+		return XMFLOAT3(0, 0, 0);
+	return XMFLOAT3(positionX[dense], positionY[dense], positionZ[dense]);
+}
+
+DirectX::XMFLOAT4 TransformSystem::GetRotation(TransformHandle handle)
+{
+	unsigned int dense = DenseOf(handle);
+	if (dense == TRANSFORM_NO_NODE)
+		return XMFLOAT4(0, 0, 0, 1);
+	return XMFLOAT4(rotationX[dense], rotationY[dense], rotationZ[dense], rotationW[dense]);
+}
+
+// --------------------------------------------------------
+// Angles that XMQuaternionRotationRollPitchYaw would turn
+// back into this rotation (roll, then pitch, then yaw).
+// Straight up or down, the roll is folded into the yaw.
+// --------------------------------------------------------
+DirectX::XMFLOAT3 TransformSystem::GetPitchYawRoll(TransformHandle handle)
+{
+	const TransformAxes& a = GetAxes(handle);
+	float sinPitch = -a.Forward.y;
+	if (sinPitch > 1.0f) sinPitch = 1.0f;
+	if (sinPitch < -1.0f) sinPitch = -1.0f;
+
+	XMFLOAT3 pitchYawRoll;
+	pitchYawRoll.x = asinf(sinPitch);
+	if (fabsf(sinPitch) < 0.9999f)
+	{
+		pitchYawRoll.y = atan2f(a.Forward.x, a.Forward.z);
+		pitchYawRoll.z = atan2f(a.Right.y, a.Up.y);
+	}
+	else
+	{
+		pitchYawRoll.y = atan2f(-a.Right.z, a.Right.x);
+		pitchYawRoll.z = 0.0f;
+	}
+	return pitchYawRoll;
+}
+
+DirectX::XMFLOAT3 TransformSystem::GetScale(TransformHandle handle)
+{
+	unsigned int dense = DenseOf(handle);
+	if (dense == TRANSFORM_NO_NODE)
+		return XMFLOAT3(1, 1, 1);
+	return XMFLOAT3(scaleX[dense], scaleY[dense], scaleZ[dense]);
+}
+
+void TransformSystem::SetPosition(TransformHandle handle, float x, float y, float z)
+{
+	unsigned int dense = DenseOf(handle);
+	if (dense == TRANSFORM_NO_NODE)
+		return;
+	positionX[dense] = x;
+	positionY[dense] = y;
+	positionZ[dense] = z;
+	MarkMoved(dense);
+}
+
+void TransformSystem::SetRotation(TransformHandle handle, DirectX::XMFLOAT4 quaternion)
+{
+	unsigned int dense = DenseOf(handle);
+	if (dense == TRANSFORM_NO_NODE)
+		return;
+	XMVECTOR rotation = XMQuaternionNormalize(XMLoadFloat4(&quaternion));
+	XMStoreFloat4(&quaternion, rotation);
+	rotationX[dense] = quaternion.x;
+	rotationY[dense] = quaternion.y;
+	rotationZ[dense] = quaternion.z;
+	rotationW[dense] = quaternion.w;
+
+	// The rows of the rotation matrix are the rotated axes
+	XMMATRIX rotationMat = XMMatrixRotationQuaternion(rotation);
+	XMStoreFloat3(&axes[dense].Right, rotationMat.r[0]);
+	XMStoreFloat3(&axes[dense].Up, rotationMat.r[1]);
+	XMStoreFloat3(&axes[dense].Forward, rotationMat.r[2]);
+	MarkMoved(dense);
+}
+
+void TransformSystem::SetPitchYawRoll(TransformHandle handle, float p, float y, float r)
+{
+	XMFLOAT4 quaternion;
+	XMStoreFloat4(&quaternion, XMQuaternionRotationRollPitchYaw(p, y, r));
+	SetRotation(handle, quaternion);
+}
+
+void TransformSystem::SetScale(TransformHandle handle, float x, float y, float z)
+{
+	unsigned int dense = DenseOf(handle);
+	if (dense == TRANSFORM_NO_NODE)
+		return;
+	scaleX[dense] = x;
+	scaleY[dense] = y;
+	scaleZ[dense] = z;
+	MarkMoved(dense);
+}
+
+const TransformAxes& TransformSystem::GetAxes(TransformHandle handle)
+{
+	unsigned int dense = DenseOf(handle);
+	return dense == TRANSFORM_NO_NODE ? identityAxes : axes[dense];
+}
+
+void TransformSystem::SetParent(TransformHandle handle, TransformHandle parentHandle)
+{
+	Node* node = Find(handle);
+	if (!node)
+		return;
+
+	unsigned int slot = handle & TRANSFORM_INDEX_MASK;
+	unsigned int parentSlot = TRANSFORM_NO_NODE;
+	if (parentHandle != TRANSFORM_NO_PARENT)
+	{
+		if (!Find(parentHandle))
+			return;
+		parentSlot = parentHandle & TRANSFORM_INDEX_MASK;
+	}
+	if (node->Parent == parentSlot)
+		return;
+
+	// A node can't end up below itself
+	for (unsigned int p = parentSlot; p != TRANSFORM_NO_NODE; p = NodeAt(p).Parent)
+	{
+		if (p == slot)
+			return;
+	}
+
+	Unlink(slot);
+	Link(slot, parentSlot);
+
+	// Needs rebuilding under the new parent
+	MarkChanged(node->Dense);
+	orderDirty = true;
+}
+
+TransformHandle TransformSystem::GetParent(TransformHandle handle)
+{
+	Node* node = Find(handle);
+	if (!node || node->Parent == TRANSFORM_NO_NODE)
+		return TRANSFORM_NO_PARENT;
+	return HandleOf(node->Parent);
+}
+
+unsigned int TransformSystem::GetChildCount(TransformHandle handle)
+{
+	Node* node = Find(handle);
+	return node ? node->ChildCount : 0;
+}
+
+Transform* TransformSystem::GetOwner(TransformHandle handle)
+{
+	Node* node = Find(handle);
+	return node ? node->Owner : 0;
+}
+
+TransformHandle TransformSystem::GetFirstChild(TransformHandle handle)
+{
+	Node* node = Find(handle);
+	if (!node || node->FirstChild == TRANSFORM_NO_NODE)
+		return TRANSFORM_NO_NODE;
+	return HandleOf(node->FirstChild);
+}
+
+TransformHandle TransformSystem::GetNextSibling(TransformHandle handle)
+{
+	Node* node = Find(handle);
+	if (!node || node->NextSibling == TRANSFORM_NO_NODE)
+		return TRANSFORM_NO_NODE;
+	return HandleOf(node->NextSibling);
+}
+
+TransformHandle TransformSystem::GetChild(TransformHandle handle, unsigned int index)
+{
+	Node* node = Find(handle);
+	if (!node || index >= node->ChildCount)
+		return TRANSFORM_NO_NODE;
+
+	unsigned int child = node->FirstChild;
+	for (unsigned int i = 0; i < index; i++)
+		child = NodeAt(child).NextSibling;
+	return HandleOf(child);
+}
+
+// --------------------------------------------------------
+// Takes a node out of its parent's list of children
+// --------------------------------------------------------
+void TransformSystem::Unlink(unsigned int slot)
+{
+	Node& node = NodeAt(slot);
+	if (node.Parent == TRANSFORM_NO_NODE)
+		return;
+
+	Node& parent = NodeAt(node.Parent);
+	if (node.PreviousSibling != TRANSFORM_NO_NODE)
+		NodeAt(node.PreviousSibling).NextSibling = node.NextSibling;
+	else
+		parent.FirstChild = node.NextSibling;
+
+	if (node.NextSibling != TRANSFORM_NO_NODE)
+		NodeAt(node.NextSibling).PreviousSibling = node.PreviousSibling;
+	else
+		parent.LastChild = node.PreviousSibling;
+
+	parent.ChildCount--;
+	node.Parent = TRANSFORM_NO_NODE;
+	node.NextSibling = TRANSFORM_NO_NODE;
+	node.PreviousSibling = TRANSFORM_NO_NODE;
+}
+
+// --------------------------------------------------------
+// Adds a node (not currently anyone's child) to the end of
+// a parent's list of children
+// --------------------------------------------------------
+void TransformSystem::Link(unsigned int slot, unsigned int parentSlot)
+{
+	if (parentSlot == TRANSFORM_NO_NODE)
+		return;
+
+	Node& node = NodeAt(slot);
+	Node& parent = NodeAt(parentSlot);
+	node.Parent = parentSlot;
+	node.PreviousSibling = parent.LastChild;
+	node.NextSibling = TRANSFORM_NO_NODE;
+	if (parent.LastChild != TRANSFORM_NO_NODE)
+		NodeAt(parent.LastChild).NextSibling = slot;
+	else
+		parent.FirstChild = slot;
+	parent.LastChild = slot;
+	parent.ChildCount++;
+}
+
+DirectX::XMFLOAT3X4 TransformSystem::GetWorldMatrix(TransformHandle handle)
+{
+	unsigned int dense = DenseOf(handle);
+	if (dense == TRANSFORM_NO_NODE)
+		return identity3x4;
+
+	UpdateWorldMatrix(handle & TRANSFORM_INDEX_MASK);
+	return worldMatrices[dense];
+}
+
+// --------------------------------------------------------
+// The inverse transpose of the world matrix's upper 3x3,
+// built the first time it's asked for after the world
+// matrix changes.  That's the 3x3's cofactors over its
+// determinant, which holds for any scale or shear a parent
+// passes down, without a general 4x4 inverse.
+// --------------------------------------------------------
+DirectX::XMFLOAT3X4 TransformSystem::GetWorldInverseTransposeMatrix(TransformHandle handle)
+{
+	unsigned int dense = DenseOf(handle);
+	if (dense == TRANSFORM_NO_NODE)
+		return identity3x4;
+
+	UpdateWorldMatrix(handle & TRANSFORM_INDEX_MASK);
+	NodeVersions& node = versions[dense];
+	if (node.NormalUsed == node.World)
+		return normalMatrices[dense];
+
+	XMMATRIX world = XMLoadFloat3x4(&worldMatrices[dense]);
+	XMVECTOR row0 = XMVector3Cross(world.r[1], world.r[2]);
+	XMVECTOR row1 = XMVector3Cross(world.r[2], world.r[0]);
+	XMVECTOR row2 = XMVector3Cross(world.r[0], world.r[1]);
+	XMVECTOR invDeterminant = XMVectorReciprocal(XMVector3Dot(world.r[0], row0));
+
+	XMMATRIX normal(row0 * invDeterminant, row1 * invDeterminant, row2 * invDeterminant, XMVectorSet(0, 0, 0, 1));
+	XMStoreFloat3x4(&normalMatrices[dense], normal);
+	node.NormalUsed = node.World;
+	return normalMatrices[dense];
+}
+
+unsigned int TransformSystem::GetWorldVersion(TransformHandle handle)
+{
+	unsigned int dense = DenseOf(handle);
+	if (dense == TRANSFORM_NO_NODE)
+		return 0;
+
+	UpdateWorldMatrix(handle & TRANSFORM_INDEX_MASK);
+	return versions[dense].World;
+}
+
+// --------------------------------------------------------
+// Starts a simulation step: whatever moved in the last one
+// is where it ended up, and becomes the state this step
+// moves on from
+// --------------------------------------------------------
+void TransformSystem::BeginStep()
+{
+	for (TransformHandle handle : moving)
+	{
+		Node* node = Find(handle);
+		if (!node)
+			continue;
+
+		node->Moving = false;
+		KeepAsPrevious(node->Dense);
+
+		// Last drawn part way along, so needs rebuilding at the end
+		if (renderAlpha < 1.0f)
+			MarkChanged(node->Dense);
+	}
+	moving.clear();
+	stepping = true;
+}
+
+void TransformSystem::SetInterpolation(float alpha)
+{
+	if (alpha == renderAlpha)
+		return;
+
+	// Everything part way between steps is somewhere new
+	renderAlpha = alpha;
+	for (TransformHandle handle : moving)
+	{
+		Node* node = Find(handle);
+		if (node)
+			MarkChanged(node->Dense);
+	}
+}
+
+void TransformSystem::SetPositions(const TransformHandle* handles, const DirectX::XMFLOAT3* positions, size_t count)
+{
+	ResolveBulk(handles, count);
+	RunBulk([&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			unsigned int dense = bulkDense[i];
+			const XMFLOAT3& position = positions[bulkSource[i]];
+			positionX[dense] = position.x;
+			positionY[dense] = position.y;
+			positionZ[dense] = position.z;
+		}
+	});
+}
+
+void TransformSystem::MoveAbsolute(const TransformHandle* handles, size_t count, float x, float y, float z)
+{
+	ResolveBulk(handles, count);
+	RunBulk([&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			unsigned int dense = bulkDense[i];
+			positionX[dense] += x;
+			positionY[dense] += y;
+			positionZ[dense] += z;
+		}
+	});
+}
+
+void TransformSystem::Rotate(const TransformHandle* handles, size_t count, float p, float y, float r)
+{
+	// The same split as Transform::Rotate
+	XMFLOAT4 local;
+	XMFLOAT4 yaw;
+	XMStoreFloat4(&local, XMQuaternionRotationRollPitchYaw(p, 0, r));
+	XMStoreFloat4(&yaw, XMQuaternionRotationRollPitchYaw(0, y, 0));
+
+	ResolveBulk(handles, count);
+	RunBulk([&](size_t begin, size_t end) { RotateRange(begin, end, local, yaw); });
+}
+
+bool TransformSystem::TakeChangeJournal(std::vector<TransformHandle>& handles)
+{
+	handles.swap(changeJournal);
+	changeJournal.clear();
+
+	bool complete = !changeJournalOverflowed;
+	changeJournalOverflowed = false;
+	return complete;
+}
+
+// --------------------------------------------------------
+// Adds to the change journal, giving up on it once it has
+// more entries than there are nodes (if nobody's taking
+// them, or everything's changing anyway)
+// --------------------------------------------------------
+void TransformSystem::RecordChanges(const TransformHandle* handles, size_t count)
+{
+	if (changeJournalOverflowed)
+		return;
+
+	if (changeJournal.size() + count > slotCount)
+	{
+		changeJournalOverflowed = true;
+		changeJournal.clear();
+		return;
+	}
+	changeJournal.insert(changeJournal.end(), handles, handles + count);
+}
+
+void TransformSystem::BeginFrame()
+{
+	lastFrameStats = frameStats;
+	frameStats = {};
+	frame++;
+}
+
+// --------------------------------------------------------
+// Goes through the hierarchy one level at a time.  Nodes
+// in the same level never depend on each other, so each
+// level is split between the worker threads; only the
+// next level has to wait for it.  Every node is computed
+// the same way no matter which thread gets it, so the
+// results don't depend on the number of threads.
+// --------------------------------------------------------
+void TransformSystem::UpdateWorldMatrices()
+{
+	if (!orderDirty && !localsChanged)
+		return;
+
+	if (orderDirty)
+		SortParentsFirst();
+
+	// Everything rebuilt in this pass gets the same version
+	unsigned int version = nextVersion++;
+	unsigned int threadCount = workers->GetThreadCount();
+	for (size_t level = 0; level + 1 < levelStarts.size(); level++)
+	{
+		unsigned int begin = levelStarts[level];
+		unsigned int end = levelStarts[level + 1];
+		unsigned int jobCount = (end - begin) / TRANSFORM_NODES_PER_JOB;
+		if (jobCount > threadCount)
+			jobCount = threadCount;
+
+		if (jobCount <= 1)
+		{
+			jobChanges[0].clear();
+			UpdateRange(begin, end, version, frameStats, jobChanges[0]);
+			RecordChanges(jobChanges[0].data(), jobChanges[0].size());
+			continue;
+		}
+
+		// Each job counts into its own stats
+		TransformStats jobStats[TRANSFORM_MAX_JOBS] = {};
+		if (jobCount > TRANSFORM_MAX_JOBS)
+			jobCount = TRANSFORM_MAX_JOBS;
+		workers->Run(jobCount, [&](unsigned int job)
+		{
+			unsigned int jobBegin = begin + (unsigned int)((unsigned long long)(end - begin) * job / jobCount);
+			unsigned int jobEnd = begin + (unsigned int)((unsigned long long)(end - begin) * (job + 1) / jobCount);
+			jobChanges[job].clear();
+			UpdateRange(jobBegin, jobEnd, version, jobStats[job], jobChanges[job]);
+		});
+
+		for (unsigned int j = 0; j < jobCount; j++)
+		{
+			frameStats.WorldMatricesComputed += jobStats[j].WorldMatricesComputed;
+			frameStats.ComputedMoreThanOnce += jobStats[j].ComputedMoreThanOnce;
+			RecordChanges(jobChanges[j].data(), jobChanges[j].size());
+		}
+	}
+
+	localsChanged = false;
+}
+
+// --------------------------------------------------------
+// Builds the local matrices of four nodes at a time from
+// the component arrays, then
+// puts each out of date node under its parent, which is
+// always earlier in the arrays and so already done.
+// Groups of four that are all up to date are skipped.
+// --------------------------------------------------------
+void TransformSystem::UpdateRange(unsigned int begin, unsigned int end, unsigned int version, TransformStats& stats, std::vector<TransformHandle>& changed)
+{
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR one = XMVectorSplatOne();
+	for (size_t i = begin; i < end; i += 4)
+	{
+		size_t batch = end - i < 4 ? end - i : 4;
+		bool anyOutOfDate = false;
+		for (size_t k = 0; k < batch; k++)
+			anyOutOfDate |= IsOutOfDate((unsigned int)(i + k), parents[i + k]);
+		if (!anyOutOfDate)
+			continue;
+
+		XMVECTOR qx = LoadFour(rotationX, i);
+		XMVECTOR qy = LoadFour(rotationY, i);
+		XMVECTOR qz = LoadFour(rotationZ, i);
+		XMVECTOR qw = LoadFour(rotationW, i);
+		XMVECTOR sx = LoadFour(scaleX, i);
+		XMVECTOR sy = LoadFour(scaleY, i);
+		XMVECTOR sz = LoadFour(scaleZ, i);
+		XMVECTOR tx = LoadFour(positionX, i);
+		XMVECTOR ty = LoadFour(positionY, i);
+		XMVECTOR tz = LoadFour(positionZ, i);
+
+		// Part way from the start of the step (nodes that haven't moved
+		// come out the same)
+		if (renderAlpha < 1.0f)
+		{
+			XMVECTOR t = XMVectorReplicate(renderAlpha);
+			sx = LerpFour(previousScaleX, sx, i, t);
+			sy = LerpFour(previousScaleY, sy, i, t);
+			sz = LerpFour(previousScaleZ, sz, i, t);
+			tx = LerpFour(previousPositionX, tx, i, t);
+			ty = LerpFour(previousPositionY, ty, i, t);
+			tz = LerpFour(previousPositionZ, tz, i, t);
+
+			// Normalized lerp the shorter way round, which is as good as
+			// a slerp over one step's worth of rotation
+			XMVECTOR px = LoadFour(previousRotationX, i);
+			XMVECTOR py = LoadFour(previousRotationY, i);
+			XMVECTOR pz = LoadFour(previousRotationZ, i);
+			XMVECTOR pw = LoadFour(previousRotationW, i);
+			XMVECTOR dot = px * qx + py * qy + pz * qz + pw * qw;
+			XMVECTOR sign = XMVectorSelect(one, XMVectorNegate(one), XMVectorLess(dot, zero));
+			qx = XMVectorLerpV(px * sign, qx, t);
+			qy = XMVectorLerpV(py * sign, qy, t);
+			qz = XMVectorLerpV(pz * sign, qz, t);
+			qw = XMVectorLerpV(pw * sign, qw, t);
+			XMVECTOR invLength = XMVectorReciprocalSqrt(qx * qx + qy * qy + qz * qz + qw * qw);
+			qx *= invLength;
+			qy *= invLength;
+			qz *= invLength;
+			qw *= invLength;
+		}
+
+		// Rotation rows, the same as XMMatrixRotationQuaternion's
+		XMVECTOR x2 = qx + qx;
+		XMVECTOR y2 = qy + qy;
+		XMVECTOR z2 = qz + qz;
+		XMVECTOR xx = qx * x2;
+		XMVECTOR yy = qy * y2;
+		XMVECTOR zz = qz * z2;
+		XMVECTOR xy = qx * y2;
+		XMVECTOR xz = qx * z2;
+		XMVECTOR yz = qy * z2;
+		XMVECTOR wx = qw * x2;
+		XMVECTOR wy = qw * y2;
+		XMVECTOR wz = qw * z2;
+		XMVECTOR m00 = one - (yy + zz);
+		XMVECTOR m01 = xy + wz;
+		XMVECTOR m02 = xz - wy;
+		XMVECTOR m10 = xy - wz;
+		XMVECTOR m11 = one - (xx + zz);
+		XMVECTOR m12 = yz + wx;
+		XMVECTOR m20 = xz + wy;
+		XMVECTOR m21 = yz - wx;
+		XMVECTOR m22 = one - (xx + yy);
+
+		// Local = scale * rotation * translation.  Each matrix here holds one
+		// row for all four nodes, so transposing gives that row of each node
+		XMMATRIX row0 = XMMatrixTranspose(XMMATRIX(m00 * sx, m01 * sx, m02 * sx, zero));
+		XMMATRIX row1 = XMMatrixTranspose(XMMATRIX(m10 * sy, m11 * sy, m12 * sy, zero));
+		XMMATRIX row2 = XMMatrixTranspose(XMMATRIX(m20 * sz, m21 * sz, m22 * sz, zero));
+		XMMATRIX row3 = XMMatrixTranspose(XMMATRIX(tx, ty, tz, one));
+
+		for (size_t k = 0; k < batch; k++)
+		{
+			// Parents earlier in this group are already done
+			int parent = parents[i + k];
+			if (!IsOutOfDate((unsigned int)(i + k), parent))
+				continue;
+
+			XMMATRIX world(row0.r[k], row1.r[k], row2.r[k], row3.r[k]);
+			if (parent >= 0)
+				world = XMMatrixMultiply(world, XMLoadFloat3x4(&worldMatrices[parent]));
+
+			XMStoreFloat3x4(&worldMatrices[i + k], world);
+			RecordCompute((unsigned int)(i + k), parent, version, stats);
+			changed.push_back(HandleOf(denseToSlot[i + k]));
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Finds the nodes for a bulk edit, dropping stale handles
+// --------------------------------------------------------
+void TransformSystem::ResolveBulk(const TransformHandle* handles, size_t count)
+{
+	bulkDense.clear();
+	bulkSource.clear();
+	bulkDense.reserve(count);
+	bulkSource.reserve(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		unsigned int dense = DenseOf(handles[i]);
+		if (dense == TRANSFORM_NO_NODE)
+			continue;
+		bulkDense.push_back(dense);
+		bulkSource.push_back((unsigned int)i);
+	}
+}
+
+// --------------------------------------------------------
+// Runs a bulk edit over the resolved nodes in chunks split
+// between the workers, marking them moved as it goes (the
+// same as MarkMoved, but with one version for all of them).
+// Only the list of moving nodes has to wait until the end.
+// --------------------------------------------------------
+void TransformSystem::RunBulk(const std::function<void(size_t, size_t)>& edit)
+{
+	size_t count = bulkDense.size();
+	if (count == 0)
+		return;
+
+	unsigned int version = nextVersion++;
+	unsigned int jobCount = (unsigned int)((count + TRANSFORM_BULK_JOB_SIZE - 1) / TRANSFORM_BULK_JOB_SIZE);
+	workers->Run(jobCount, [&](unsigned int job)
+	{
+		size_t begin = (size_t)job * TRANSFORM_BULK_JOB_SIZE;
+		size_t end = begin + TRANSFORM_BULK_JOB_SIZE < count ? begin + TRANSFORM_BULK_JOB_SIZE : count;
+		edit(begin, end);
+
+		for (size_t i = begin; i < end; i++)
+		{
+			unsigned int dense = bulkDense[i];
+			versions[dense].Local = version;
+			if (!stepping)
+				KeepAsPrevious(dense);
+		}
+	});
+	localsChanged = true;
+
+	if (stepping)
+	{
+		for (unsigned int dense : bulkDense)
+			AddToMoving(dense);
+	}
+}
+
+// --------------------------------------------------------
+// Rotate() for bulk nodes [begin, end): four at a time,
+// gathered into one vector per component, then the new
+// rotations and their axes scattered back
+// --------------------------------------------------------
+void TransformSystem::RotateRange(size_t begin, size_t end, DirectX::XMFLOAT4 local, DirectX::XMFLOAT4 yaw)
+{
+	const XMVECTOR one = XMVectorSplatOne();
+	const XMVECTOR localX = XMVectorReplicate(local.x);
+	const XMVECTOR localY = XMVectorReplicate(local.y);
+	const XMVECTOR localZ = XMVectorReplicate(local.z);
+	const XMVECTOR localW = XMVectorReplicate(local.w);
+	const XMVECTOR yawX = XMVectorReplicate(yaw.x);
+	const XMVECTOR yawY = XMVectorReplicate(yaw.y);
+	const XMVECTOR yawZ = XMVectorReplicate(yaw.z);
+	const XMVECTOR yawW = XMVectorReplicate(yaw.w);
+
+	for (size_t i = begin; i < end; i += 4)
+	{
+		// A short last group repeats its first node
+		size_t batch = end - i < 4 ? end - i : 4;
+		unsigned int d[4];
+		for (size_t k = 0; k < 4; k++)
+			d[k] = bulkDense[i + (k < batch ? k : 0)];
+
+		XMVECTOR qx = XMVectorSet(rotationX[d[0]], rotationX[d[1]], rotationX[d[2]], rotationX[d[3]]);
+		XMVECTOR qy = XMVectorSet(rotationY[d[0]], rotationY[d[1]], rotationY[d[2]], rotationY[d[3]]);
+		XMVECTOR qz = XMVectorSet(rotationZ[d[0]], rotationZ[d[1]], rotationZ[d[2]], rotationZ[d[3]]);
+		XMVECTOR qw = XMVectorSet(rotationW[d[0]], rotationW[d[1]], rotationW[d[2]], rotationW[d[3]]);
+
+		// Pitch and roll on the inside, yaw on the outside
+		XMVECTOR tx, ty, tz, tw;
+		MultiplyFour(localX, localY, localZ, localW, qx, qy, qz, qw, tx, ty, tz, tw);
+		MultiplyFour(tx, ty, tz, tw, yawX, yawY, yawZ, yawW, qx, qy, qz, qw);
+		XMVECTOR invLength = XMVectorReciprocalSqrt(qx * qx + qy * qy + qz * qz + qw * qw);
+		qx *= invLength;
+		qy *= invLength;
+		qz *= invLength;
+		qw *= invLength;
+
+		// Rotation rows, the same as XMMatrixRotationQuaternion's
+		XMVECTOR x2 = qx + qx;
+		XMVECTOR y2 = qy + qy;
+		XMVECTOR z2 = qz + qz;
+		XMVECTOR xx = qx * x2;
+		XMVECTOR yy = qy * y2;
+		XMVECTOR zz = qz * z2;
+		XMVECTOR xy = qx * y2;
+		XMVECTOR xz = qx * z2;
+		XMVECTOR yz = qy * z2;
+		XMVECTOR wx = qw * x2;
+		XMVECTOR wy = qw * y2;
+		XMVECTOR wz = qw * z2;
+
+		XMFLOAT4 q[4];
+		XMFLOAT4 m[9];
+		XMStoreFloat4(&q[0], qx);
+		XMStoreFloat4(&q[1], qy);
+		XMStoreFloat4(&q[2], qz);
+		XMStoreFloat4(&q[3], qw);
+		XMStoreFloat4(&m[0], one - (yy + zz));
+		XMStoreFloat4(&m[1], xy + wz);
+		XMStoreFloat4(&m[2], xz - wy);
+		XMStoreFloat4(&m[3], xy - wz);
+		XMStoreFloat4(&m[4], one - (xx + zz));
+		XMStoreFloat4(&m[5], yz + wx);
+		XMStoreFloat4(&m[6], xz + wy);
+		XMStoreFloat4(&m[7], yz - wx);
+		XMStoreFloat4(&m[8], one - (xx + yy));
+
+		for (size_t k = 0; k < batch; k++)
+		{
+			unsigned int dense = d[k];
+			rotationX[dense] = (&q[0].x)[k];
+			rotationY[dense] = (&q[1].x)[k];
+			rotationZ[dense] = (&q[2].x)[k];
+			rotationW[dense] = (&q[3].x)[k];
+			axes[dense].Right = XMFLOAT3((&m[0].x)[k], (&m[1].x)[k], (&m[2].x)[k]);
+			axes[dense].Up = XMFLOAT3((&m[3].x)[k], (&m[4].x)[k], (&m[5].x)[k]);
+			axes[dense].Forward = XMFLOAT3((&m[6].x)[k], (&m[7].x)[k], (&m[8].x)[k]);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Sizes the arrays for the given number of nodes: the
+// component arrays with room for a four-wide load starting
+// at any node (the padding at the identity), the rest
+// exactly
+// --------------------------------------------------------
+void TransformSystem::ResizeLocals(size_t count)
+{
+	size_t padded = count + 3;
+	positionX.resize(padded, 0.0f);
+	positionY.resize(padded, 0.0f);
+	positionZ.resize(padded, 0.0f);
+	rotationX.resize(padded, 0.0f);
+	rotationY.resize(padded, 0.0f);
+	rotationZ.resize(padded, 0.0f);
+	rotationW.resize(padded, 1.0f);
+	scaleX.resize(padded, 1.0f);
+	scaleY.resize(padded, 1.0f);
+	scaleZ.resize(padded, 1.0f);
+	previousPositionX.resize(padded, 0.0f);
+	previousPositionY.resize(padded, 0.0f);
+	previousPositionZ.resize(padded, 0.0f);
+	previousRotationX.resize(padded, 0.0f);
+	previousRotationY.resize(padded, 0.0f);
+	previousRotationZ.resize(padded, 0.0f);
+	previousRotationW.resize(padded, 1.0f);
+	previousScaleX.resize(padded, 1.0f);
+	previousScaleY.resize(padded, 1.0f);
+	previousScaleZ.resize(padded, 1.0f);
+
+	axes.resize(count);
+	parents.resize(count, -1);
+	versions.resize(count);
+	worldMatrices.resize(count);
+	normalMatrices.resize(count);
+}
+
+// --------------------------------------------------------
+// Level order: the roots (in their current order), then
+// their children, then their children's children...
+// --------------------------------------------------------
+void TransformSystem::SortParentsFirst()
+{
+	size_t count = denseToSlot.size();
+	std::vector<unsigned int> order;
+	order.reserve(count);
+	for (size_t dense = 0; dense < count; dense++)
+	{
+		if (NodeAt(denseToSlot[dense]).Parent == TRANSFORM_NO_NODE)
+			order.push_back(denseToSlot[dense]);
+	}
+	levelStarts.clear();
+	size_t levelBegin = 0;
+	while (levelBegin < order.size())
+	{
+		// The children of this level are the next level
+		size_t levelEnd = order.size();
+		levelStarts.push_back((unsigned int)levelBegin);
+		for (size_t i = levelBegin; i < levelEnd; i++)
+		{
+			for (unsigned int child = NodeAt(order[i]).FirstChild; child != TRANSFORM_NO_NODE; child = NodeAt(child).NextSibling)
+				order.push_back(child);
+		}
+		levelBegin = levelEnd;
+	}
+	levelStarts.push_back((unsigned int)order.size());
+
+	std::vector<unsigned int> from(count);
+	for (size_t i = 0; i < count; i++)
+		from[i] = NodeAt(order[i]).Dense;
+
+	Reorder(positionX, from);
+	Reorder(positionY, from);
+	Reorder(positionZ, from);
+	Reorder(rotationX, from);
+	Reorder(rotationY, from);
+	Reorder(rotationZ, from);
+	Reorder(rotationW, from);
+	Reorder(axes, from);
+	Reorder(scaleX, from);
+	Reorder(scaleY, from);
+	Reorder(scaleZ, from);
+	Reorder(previousPositionX, from);
+	Reorder(previousPositionY, from);
+	Reorder(previousPositionZ, from);
+	Reorder(previousRotationX, from);
+	Reorder(previousRotationY, from);
+	Reorder(previousRotationZ, from);
+	Reorder(previousRotationW, from);
+	Reorder(previousScaleX, from);
+	Reorder(previousScaleY, from);
+	Reorder(previousScaleZ, from);
+	Reorder(worldMatrices, from);
+	Reorder(normalMatrices, from);
+	Reorder(versions, from);
+
+	denseToSlot.swap(order);
+	for (size_t i = 0; i < count; i++)
+		NodeAt(denseToSlot[i]).Dense = (unsigned int)i;
+	for (size_t i = 0; i < count; i++)
+	{
+		unsigned int parentSlot = NodeAt(denseToSlot[i]).Parent;
+		parents[i] = parentSlot == TRANSFORM_NO_NODE ? -1 : (int)NodeAt(parentSlot).Dense;
+	}
+
+	orderDirty = false;
+}
+
+void TransformSystem::MarkChanged(unsigned int dense)
+{
+	versions[dense].Local = nextVersion++;
+	localsChanged = true;
+}
+
+// --------------------------------------------------------
+// A change to a node's local data: blended in over the
+// step if made during one, otherwise right away
+// --------------------------------------------------------
+void TransformSystem::MarkMoved(unsigned int dense)
+{
+	MarkChanged(dense);
+	if (!stepping)
+	{
+		KeepAsPrevious(dense);
+		return;
+	}
+	AddToMoving(dense);
+}
+
+void TransformSystem::AddToMoving(unsigned int dense)
+{
+	unsigned int slot = denseToSlot[dense];
+	Node& node = NodeAt(slot);
+	if (!node.Moving)
+	{
+		node.Moving = true;
+		moving.push_back(HandleOf(slot));
+	}
+}
+
+void TransformSystem::KeepAsPrevious(unsigned int dense)
+{
+	previousPositionX[dense] = positionX[dense];
+	previousPositionY[dense] = positionY[dense];
+	previousPositionZ[dense] = positionZ[dense];
+	previousRotationX[dense] = rotationX[dense];
+	previousRotationY[dense] = rotationY[dense];
+	previousRotationZ[dense] = rotationZ[dense];
+	previousRotationW[dense] = rotationW[dense];
+	previousScaleX[dense] = scaleX[dense];
+	previousScaleY[dense] = scaleY[dense];
+	previousScaleZ[dense] = scaleZ[dense];
+}
+
+bool TransformSystem::IsOutOfDate(unsigned int dense, int parentDense)
+{
+	const NodeVersions& node = versions[dense];
+	unsigned int parentWorld = parentDense < 0 ? 0 : versions[parentDense].World;
+	return node.LocalUsed != node.Local || node.ParentUsed != parentWorld;
+}
+
+void TransformSystem::RecordCompute(unsigned int dense, int parentDense, unsigned int version, TransformStats& stats)
+{
+	NodeVersions& node = versions[dense];
+	node.World = version;
+	node.LocalUsed = node.Local;
+	node.ParentUsed = parentDense < 0 ? 0 : versions[parentDense].World;
+
+	stats.WorldMatricesComputed++;
+	if (node.Frame == frame)
+		stats.ComputedMoreThanOnce++;
+	node.Frame = frame;
+}
+
+// --------------------------------------------------------
+// Brings one node up to date outside of the frame's pass,
+// along with any out of date ancestors (root first).  Works
+// whether or not the arrays are currently sorted.
+// --------------------------------------------------------
+void TransformSystem::UpdateWorldMatrix(unsigned int slot)
+{
+	if (!localsChanged)
+		return;
+
+	chain.clear();
+	for (unsigned int p = slot; p != TRANSFORM_NO_NODE; p = NodeAt(p).Parent)
+		chain.push_back(p);
+
+	for (size_t c = chain.size(); c-- > 0;)
+	{
+		const Node& node = NodeAt(chain[c]);
+		unsigned int dense = node.Dense;
+		int parentDense = node.Parent == TRANSFORM_NO_NODE ? -1 : (int)NodeAt(node.Parent).Dense;
+		if (!IsOutOfDate(dense, parentDense))
+			continue;
+
+		XMMATRIX world = GetLocalMatrix(dense);
+		if (parentDense >= 0)
+			world = XMMatrixMultiply(world, XMLoadFloat3x4(&worldMatrices[parentDense]));
+
+		XMStoreFloat3x4(&worldMatrices[dense], world);
+		RecordCompute(dense, parentDense, nextVersion++, frameStats);
+
+		TransformHandle handle = HandleOf(chain[c]);
+		RecordChanges(&handle, 1);
+	}
+}
+
+DirectX::XMMATRIX TransformSystem::GetLocalMatrix(unsigned int dense)
+{
+	XMVECTOR position = XMVectorSet(positionX[dense], positionY[dense], positionZ[dense], 0);
+	XMVECTOR rotation = XMVectorSet(rotationX[dense], rotationY[dense], rotationZ[dense], rotationW[dense]);
+	XMVECTOR scale = XMVectorSet(scaleX[dense], scaleY[dense], scaleZ[dense], 0);
+
+	// Part way from the start of the step, as in UpdateRange()
+	if (renderAlpha < 1.0f)
+	{
+		XMVECTOR previousRotation = XMVectorSet(previousRotationX[dense], previousRotationY[dense], previousRotationZ[dense], previousRotationW[dense]);
+		if (XMVectorGetX(XMQuaternionDot(previousRotation, rotation)) < 0.0f)
+			previousRotation = XMVectorNegate(previousRotation);
+
+		position = XMVectorLerp(XMVectorSet(previousPositionX[dense], previousPositionY[dense], previousPositionZ[dense], 0), position, renderAlpha);
+		rotation = XMQuaternionNormalize(XMVectorLerp(previousRotation, rotation, renderAlpha));
+		scale = XMVectorLerp(XMVectorSet(previousScaleX[dense], previousScaleY[dense], previousScaleZ[dense], 0), scale, renderAlpha);
+	}
+
+	XMMATRIX trans = XMMatrixTranslationFromVector(position);
+	XMMATRIX rot = XMMatrixRotationQuaternion(rotation);
+	XMMATRIX sc = XMMatrixScalingFromVector(scale);
+	return sc * rot * trans;
+}
+
+// --------------------------------------------------------
+// One node's world matrix from scratch, by walking up
+// through its parents, with no caching at all
+// --------------------------------------------------------
+DirectX::XMMATRIX TransformSystem::ComputeWorldFromParents(unsigned int slot)
+{
+	XMMATRIX world = GetLocalMatrix(NodeAt(slot).Dense);
+	for (unsigned int p = NodeAt(slot).Parent; p != TRANSFORM_NO_NODE; p = NodeAt(p).Parent)
+		world = XMMatrixMultiply(world, GetLocalMatrix(NodeAt(p).Dense));
+	return world;
+}
+
+// --------------------------------------------------------
+// The Transform class this system replaced, kept as it was
+// to time against.  Every read of a dirty node rebuilds its
+// matrices through its parent's read, inverts them, then
+// marks its whole subtree dirty again (itself included, so
+// the next read rebuilds too).  Only what the benchmark
+// uses is kept, and children are linked without the
+// original's rescaling and moving them under their parent.
+// --------------------------------------------------------
+class OriginalTransform
+{
+public:
+	OriginalTransform()
+	{
+		XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
+		XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixIdentity());
+		position = XMFLOAT3(0, 0, 0);
+		pitchYawRoll = XMFLOAT3(0, 0, 0);
+		scale = XMFLOAT3(1, 1, 1);
+		matricesDirty = false;
+		parent = 0;
+	}
+
+	void SetPosition(float x, float y, float z) { position = XMFLOAT3(x, y, z); matricesDirty = true; }
+	void SetRotation(float p, float y, float r) { pitchYawRoll = XMFLOAT3(p, y, r); matricesDirty = true; }
+	void SetScale(float x, float y, float z) { scale = XMFLOAT3(x, y, z); matricesDirty = true; }
+
+	XMFLOAT4X4 GetWorldMatrix()
+	{
+		UpdateMatrices();
+		return worldMatrix;
+	}
+
+	// Returned the world matrix, not the inverse transpose it computed
+	XMFLOAT4X4 GetWorldInverseTransposeMatrix()
+	{
+		UpdateMatrices();
+		return worldMatrix;
+	}
+
+	void AddChild(OriginalTransform* child)
+	{
+		for (size_t i = 0; i < children.size(); i++)
+		{
+			if (children[i] == child)
+				return;
+		}
+		children.push_back(child);
+		child->parent = this;
+		MarkChildTransformDirty();
+	}
+
+private:
+	XMFLOAT3 position;
+	XMFLOAT3 pitchYawRoll;
+	XMFLOAT3 scale;
+	bool matricesDirty;
+	XMFLOAT4X4 worldMatrix;
+	XMFLOAT4X4 worldInverseTransposeMatrix;
+	OriginalTransform* parent;
+	std::vector<OriginalTransform*> children;
+
+	void UpdateMatrices()
+	{
+		if (matricesDirty)
+		{
+			XMMATRIX trans = XMMatrixTranslationFromVector(XMLoadFloat3(&position));
+			XMMATRIX rot = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
+			XMMATRIX sc = XMMatrixScalingFromVector(XMLoadFloat3(&scale));
+			XMMATRIX wm = sc * rot * trans;
+
+			if (parent != 0)
+			{
+				XMFLOAT4X4 parentVal = parent->GetWorldMatrix();
+				XMMATRIX parentWorldMat = XMLoadFloat4x4(&parentVal);
+				wm = XMMatrixMultiply(wm, parentWorldMat);
+			}
+
+			XMStoreFloat4x4(&worldMatrix, wm);
+			XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixInverse(0, XMMatrixTranspose(wm)));
+
+			matricesDirty = false;
+			MarkChildTransformDirty();
+		}
+	}
+
+	void MarkChildTransformDirty()
+	{
+		matricesDirty = true;
+		for (auto c : children)
+			c->MarkChildTransformDirty();
+	}
+};
+
+// --------------------------------------------------------
+// Fills a separate system with a hierarchy where each node
+// has a few children, sorted and ready to be timed
+// --------------------------------------------------------
+void TransformSystem::BuildBenchmarkHierarchy(TransformSystem& system, unsigned int nodeCount)
+{
+	std::vector<TransformHandle> handles(nodeCount);
+	for (unsigned int i = 0; i < nodeCount; i++)
+	{
+		TransformHandle handle = system.Create(0);
+		handles[i] = handle;
+		system.SetPosition(handle, sinf(i * 0.37f) * 2.0f, cosf(i * 0.71f), sinf(i * 1.13f));
+		system.SetPitchYawRoll(handle, sinf(i * 0.23f), cosf(i * 0.41f), sinf(i * 0.59f));
+		system.SetScale(handle, 1.0f + 0.1f * sinf((float)i), 1.0f, 1.0f + 0.1f * cosf((float)i));
+		if (i > 0)
+			system.SetParent(handle, handles[(i - 1) / TRANSFORM_BENCHMARK_BRANCHING]);
+	}
+
+	// Sort once up front, so only the matrices are timed
+	system.UpdateWorldMatrices();
+}
+
+// --------------------------------------------------------
+// Times the batched update (on one thread) against every
+// node walking up through its parents, and against the
+// original Transform class reading each node's matrices
+// the way Material did (world, then inverse transpose).
+// The original re-dirties the subtree of every parent it
+// reads, so it's quadratic and only gets the first nodes
+// (a hierarchy of its own, built the same way).
+// --------------------------------------------------------
+TransformBenchmark TransformSystem::RunBenchmark(unsigned int nodeCount)
+{
+	TransformSystem system;
+	system.SetThreadCount(1);
+	BuildBenchmarkHierarchy(system, nodeCount);
+	for (unsigned int dense = 0; dense < nodeCount; dense++)
+		system.MarkChanged(dense);
+
+	TransformBenchmark result = {};
+	result.NodeCount = nodeCount;
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+	system.UpdateWorldMatrices();
+	auto endTime = std::chrono::high_resolution_clock::now();
+	result.BatchedMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+	std::vector<XMFLOAT3X4> world(nodeCount);
+	startTime = std::chrono::high_resolution_clock::now();
+	for (unsigned int slot = 0; slot < nodeCount; slot++)
+		XMStoreFloat3x4(&world[slot], system.ComputeWorldFromParents(slot));
+	endTime = std::chrono::high_resolution_clock::now();
+	result.ParentWalkMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+	// The same hierarchy (the first nodes only depend on each other)
+	result.OriginalNodeCount = nodeCount < TRANSFORM_BENCHMARK_ORIGINAL_NODES ? nodeCount : TRANSFORM_BENCHMARK_ORIGINAL_NODES;
+	std::vector<OriginalTransform> original(result.OriginalNodeCount);
+	for (unsigned int i = 0; i < result.OriginalNodeCount; i++)
+	{
+		original[i].SetPosition(sinf(i * 0.37f) * 2.0f, cosf(i * 0.71f), sinf(i * 1.13f));
+		original[i].SetRotation(sinf(i * 0.23f), cosf(i * 0.41f), sinf(i * 0.59f));
+		original[i].SetScale(1.0f + 0.1f * sinf((float)i), 1.0f, 1.0f + 0.1f * cosf((float)i));
+		if (i > 0)
+			original[(i - 1) / TRANSFORM_BENCHMARK_BRANCHING].AddChild(&original[i]);
+	}
+
+	std::vector<XMFLOAT4X4> originalWorld(result.OriginalNodeCount);
+	startTime = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < result.OriginalNodeCount; i++)
+	{
+		originalWorld[i] = original[i].GetWorldMatrix();
+		original[i].GetWorldInverseTransposeMatrix();
+	}
+	endTime = std::chrono::high_resolution_clock::now();
+	result.OriginalMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+	// All three should agree, up to rounding.  Nodes were created in
+	// order into an empty system, so node i is in slot i
+	for (unsigned int slot = 0; slot < nodeCount; slot++)
+	{
+		unsigned int dense = system.NodeAt(slot).Dense;
+		for (int r = 0; r < 3; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				float worldDiff = fabsf(world[slot].m[r][c] - system.worldMatrices[dense].m[r][c]);
+				result.MaxDifference = fmaxf(result.MaxDifference, worldDiff);
+
+				// Row-vector 4x4 against transposed 3x4
+				if (slot < result.OriginalNodeCount)
+				{
+					float originalDiff = fabsf(originalWorld[slot].m[c][r] - system.worldMatrices[dense].m[r][c]);
+					result.MaxDifference = fmaxf(result.MaxDifference, originalDiff);
+				}
+			}
+		}
+	}
+
+	return result;
+}
+
+// --------------------------------------------------------
+// Times full updates of the same hierarchy with more and
+// more threads, checking each against the one thread run
+// --------------------------------------------------------
+std::vector<TransformScaling> TransformSystem::RunScalingBenchmark(unsigned int nodeCount, unsigned int maxThreads)
+{
+	if (maxThreads == 0)
+		maxThreads = std::thread::hardware_concurrency();
+	if (maxThreads == 0)
+		maxThreads = 1;
+
+	TransformSystem system;
+	BuildBenchmarkHierarchy(system, nodeCount);
+
+	std::vector<TransformScaling> results;
+	std::vector<XMFLOAT3X4> oneThreadWorld;
+	for (unsigned int threads = 1; threads <= maxThreads; threads++)
+	{
+		system.SetThreadCount(threads);
+
+		TransformScaling result = {};
+		result.ThreadCount = threads;
+		result.Ms = 1e30;
+		for (int run = 0; run < TRANSFORM_SCALING_RUNS; run++)
+		{
+			for (unsigned int dense = 0; dense < nodeCount; dense++)
+				system.MarkChanged(dense);
+
+			auto startTime = std::chrono::high_resolution_clock::now();
+			system.UpdateWorldMatrices();
+			auto endTime = std::chrono::high_resolution_clock::now();
+
+			double ms = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+			if (ms < result.Ms)
+				result.Ms = ms;
+		}
+
+		if (threads == 1)
+			oneThreadWorld = system.worldMatrices;
+		result.MatchesOneThread = memcmp(oneThreadWorld.data(), system.worldMatrices.data(), sizeof(XMFLOAT3X4) * nodeCount) == 0;
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+// --------------------------------------------------------
+// Applies each kind of edit to every node of three copies
+// of the same unparented nodes: one a call per node, one
+// in bulk on one thread, and one in bulk on every thread
+// --------------------------------------------------------
+TransformBulkBenchmark TransformSystem::RunBulkBenchmark(unsigned int nodeCount)
+{
+	TransformSystem perNode;
+	TransformSystem bulk;
+	TransformSystem threaded;
+	perNode.SetThreadCount(1);
+	bulk.SetThreadCount(1);
+
+	std::vector<TransformHandle> handles(nodeCount);
+	std::vector<XMFLOAT3> positions(nodeCount);
+	for (unsigned int i = 0; i < nodeCount; i++)
+	{
+		// Created the same way, so the handles match
+		TransformSystem* systems[] = { &perNode, &bulk, &threaded };
+		for (TransformSystem* system : systems)
+		{
+			handles[i] = system->Create(0);
+			system->SetPitchYawRoll(handles[i], sinf(i * 0.23f), cosf(i * 0.41f), sinf(i * 0.59f));
+		}
+		positions[i] = XMFLOAT3(sinf(i * 0.37f) * 10.0f, cosf(i * 0.71f) * 10.0f, sinf(i * 1.13f) * 10.0f);
+	}
+
+	TransformBulkBenchmark result = {};
+	result.NodeCount = nodeCount;
+	result.ThreadCount = threaded.GetThreadCount();
+	result.Edits[0].Name = "Set Positions";
+	result.Edits[1].Name = "Move Absolute";
+	result.Edits[2].Name = "Rotate";
+
+	auto time = [](const std::function<void()>& edit)
+	{
+		auto startTime = std::chrono::high_resolution_clock::now();
+		edit();
+		auto endTime = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::milli>(endTime - startTime).count();
+	};
+
+	result.Edits[0].PerNodeMs = time([&]()
+	{
+		for (unsigned int i = 0; i < nodeCount; i++)
+			perNode.SetPosition(handles[i], positions[i].x, positions[i].y, positions[i].z);
+	});
+	result.Edits[0].BulkMs = time([&]() { bulk.SetPositions(handles.data(), positions.data(), nodeCount); });
+	result.Edits[0].ThreadedMs = time([&]() { threaded.SetPositions(handles.data(), positions.data(), nodeCount); });
+
+	result.Edits[1].PerNodeMs = time([&]()
+	{
+		for (unsigned int i = 0; i < nodeCount; i++)
+		{
+			XMFLOAT3 position = perNode.GetPosition(handles[i]);
+			perNode.SetPosition(handles[i], position.x + 0.1f, position.y - 0.2f, position.z + 0.3f);
+		}
+	});
+	result.Edits[1].BulkMs = time([&]() { bulk.MoveAbsolute(handles.data(), nodeCount, 0.1f, -0.2f, 0.3f); });
+	result.Edits[1].ThreadedMs = time([&]() { threaded.MoveAbsolute(handles.data(), nodeCount, 0.1f, -0.2f, 0.3f); });
+
+	result.Edits[2].PerNodeMs = time([&]()
+	{
+		XMVECTOR local = XMQuaternionRotationRollPitchYaw(0.1f, 0, 0.3f);
+		XMVECTOR yaw = XMQuaternionRotationRollPitchYaw(0, 0.2f, 0);
+		for (unsigned int i = 0; i < nodeCount; i++)
+		{
+			XMFLOAT4 rotation = perNode.GetRotation(handles[i]);
+			XMStoreFloat4(&rotation, XMQuaternionMultiply(XMQuaternionMultiply(local, XMLoadFloat4(&rotation)), yaw));
+			perNode.SetRotation(handles[i], rotation);
+		}
+	});
+	result.Edits[2].BulkMs = time([&]() { bulk.Rotate(handles.data(), nodeCount, 0.1f, 0.2f, 0.3f); });
+	result.Edits[2].ThreadedMs = time([&]() { threaded.Rotate(handles.data(), nodeCount, 0.1f, 0.2f, 0.3f); });
+
+	// All three should agree, up to rounding
+	TransformSystem* systems[] = { &bulk, &threaded };
+	for (TransformSystem* system : systems)
+	{
+		for (unsigned int i = 0; i < nodeCount; i++)
+		{
+			XMFLOAT3 p0 = perNode.GetPosition(handles[i]);
+			XMFLOAT3 p1 = system->GetPosition(handles[i]);
+			XMFLOAT4 q0 = perNode.GetRotation(handles[i]);
+			XMFLOAT4 q1 = system->GetRotation(handles[i]);
+			XMFLOAT3 f0 = perNode.GetAxes(handles[i]).Forward;
+			XMFLOAT3 f1 = system->GetAxes(handles[i]).Forward;
+			float differences[] = {
+				p0.x - p1.x, p0.y - p1.y, p0.z - p1.z,
+				q0.x - q1.x, q0.y - q1.y, q0.z - q1.z, q0.w - q1.w,
+				f0.x - f1.x, f0.y - f1.y, f0.z - f1.z };
+			for (float d : differences)
+				result.MaxDifference = fmaxf(result.MaxDifference, fabsf(d));
+		}
+	}
+
+	return result;
+}
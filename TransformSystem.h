@@ -0,0 +1,398 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <functional>
+#include <vector>
+
+#include "WorkerPool.h"
+
+class Transform;
+
+// A node is referred to by a 32-bit handle: the low bits pick its
+// slot in the node pool, the high bits are that slot's generation,
+// which moves on whenever the slot's node is destroyed.  A handle
+// kept after its node is gone stops matching rather than quietly
+// pointing at whatever node reuses the slot.
+typedef unsigned int TransformHandle;
+#define TRANSFORM_INDEX_BITS		20
+#define TRANSFORM_INDEX_MASK		((1u << TRANSFORM_INDEX_BITS) - 1)
+#define TRANSFORM_GENERATION_MASK	(0xFFFFFFFFu >> TRANSFORM_INDEX_BITS)
+
+// The last slot is never used, so no valid handle is all ones
+#define TRANSFORM_MAX_NODES			TRANSFORM_INDEX_MASK
+
+// Marks a missing node: no parent, the end of a list of children,
+// or a node that couldn't be created
+#define TRANSFORM_NO_NODE			0xFFFFFFFF
+#define TRANSFORM_NO_PARENT			TRANSFORM_NO_NODE
+
+// Nodes are allocated this many at a time, and never move
+#define TRANSFORM_PAGE_SIZE			1024
+
+// Nodes in the hierarchy the benchmark builds, and how many
+// children each of its nodes gets
+#define TRANSFORM_BENCHMARK_NODES		100000
+#define TRANSFORM_BENCHMARK_BRANCHING	4
+
+// Nodes the original Transform class is timed on, as its cost grows
+// with the square of the hierarchy's size
+#define TRANSFORM_BENCHMARK_ORIGINAL_NODES	10000
+
+// Nodes in the thread scaling benchmark's hierarchy, and how many
+// updates it times for each thread count (keeping the fastest)
+#define TRANSFORM_SCALING_NODES			200000
+#define TRANSFORM_SCALING_RUNS			5
+
+// Levels of the hierarchy smaller than this many nodes per thread
+// aren't worth splitting up (and no level is split more than
+// TRANSFORM_MAX_JOBS ways)
+#define TRANSFORM_NODES_PER_JOB		2048
+#define TRANSFORM_MAX_JOBS			64
+
+// Bulk edits are split between the workers this many nodes at a time
+#define TRANSFORM_BULK_JOB_SIZE		4096
+
+// Unparented nodes the bulk edit benchmark moves, and how many
+// kinds of edit it times
+#define TRANSFORM_BULK_BENCHMARK_NODES	100000
+#define TRANSFORM_BULK_EDITS			3
+
+// --------------------------------------------------------
+// Timings of one run of TransformSystem::RunBenchmark
+// --------------------------------------------------------
+struct TransformBenchmark
+{
+	unsigned int NodeCount;
+	double BatchedMs;				// One linear pass over the sorted nodes
+	double ParentWalkMs;			// Each node multiplying its way up through its parents
+	unsigned int OriginalNodeCount;	// The first nodes, which OriginalMs covers
+	double OriginalMs;				// The original Transform class reading each node's matrices
+	float MaxDifference;			// Largest difference from the batched results
+};
+
+// --------------------------------------------------------
+// One kind of edit in TransformSystem::RunBulkBenchmark,
+// applied to every node
+// --------------------------------------------------------
+struct TransformBulkTiming
+{
+	const char* Name;
+	double PerNodeMs;			// A call per node, the way Transform does it
+	double BulkMs;				// One bulk call on one thread
+	double ThreadedMs;			// One bulk call split between the workers
+};
+
+struct TransformBulkBenchmark
+{
+	unsigned int NodeCount;
+	unsigned int ThreadCount;
+	TransformBulkTiming Edits[TRANSFORM_BULK_EDITS];
+	float MaxDifference;		// Largest difference from the per node results
+};
+
+// --------------------------------------------------------
+// A node's local axes after its rotation (the rows of its
+// rotation matrix)
+// --------------------------------------------------------
+struct TransformAxes
+{
+	DirectX::XMFLOAT3 Right;
+	DirectX::XMFLOAT3 Up;
+	DirectX::XMFLOAT3 Forward;
+};
+
+// --------------------------------------------------------
+// One thread count of TransformSystem::RunScalingBenchmark
+// --------------------------------------------------------
+struct TransformScaling
+{
+	unsigned int ThreadCount;
+	double Ms;					// Best of several full updates
+	bool MatchesOneThread;		// Bit for bit the same results as 1 thread
+};
+
+// --------------------------------------------------------
+// World matrix work done in one frame.  Each node should
+// be computed at most once a frame, and only if it or one
+// of its ancestors changed.
+// --------------------------------------------------------
+struct TransformStats
+{
+	unsigned int WorldMatricesComputed;
+	unsigned int ComputedMoreThanOnce;	// Nodes computed again in the same frame
+};
+
+// --------------------------------------------------------
+// Owns the data behind every Transform.  Local position,
+// rotation (a unit quaternion) and scale live in separate
+// arrays (one per component), sorted so parents always come before their
+// children, so all world matrices can be computed in a
+// single pass, four nodes at a time.
+//
+// Nodes are referred to by handle, which never changes;
+// their place in the arrays does whenever the hierarchy
+// does.  The hierarchy itself lives in a pool of nodes,
+// each linked to its parent, first and last children and
+// siblings, so moving a node never allocates or searches.
+// Anything given a stale handle does nothing (or returns
+// an identity value).
+//
+// Every change takes a new number from a version counter.
+// A node records which of its own and its parent's versions
+// its world matrix was built from, and is only rebuilt when
+// either has moved on.
+//
+// Updates go one level of the hierarchy at a time, with
+// each level split across a pool of worker threads.
+//
+// For a fixed simulation step, the local data as of the
+// start of the step is kept too, and world matrices can be
+// built part way between the two.
+// --------------------------------------------------------
+class TransformSystem
+{
+#pragma region Singleton
+public:
+	// Gets the one and only instance of this class
+	static TransformSystem& GetInstance()
+	{
+		if (!instance)
+		{
+			instance = new TransformSystem();
+		}
+
+		return *instance;
+	}
+
+	// Remove these functions (C++ 11 version)
+	TransformSystem(TransformSystem const&) = delete;
+	void operator=(TransformSystem const&) = delete;
+
+private:
+	static TransformSystem* instance;
+	TransformSystem();
+#pragma endregion
+
+public:
+	~TransformSystem();
+
+	// Adds a root node at the origin, returning its handle
+	// (TRANSFORM_NO_NODE if the pool is full)
+	TransformHandle Create(Transform* owner);
+	void Destroy(TransformHandle handle);
+	unsigned int GetCount() { return (unsigned int)denseToSlot.size(); }
+
+	// Whether the handle's node still exists
+	bool IsValid(TransformHandle handle) { return Find(handle) != 0; }
+
+	DirectX::XMFLOAT3 GetPosition(TransformHandle handle);
+	DirectX::XMFLOAT4 GetRotation(TransformHandle handle);
+	DirectX::XMFLOAT3 GetScale(TransformHandle handle);
+	void SetPosition(TransformHandle handle, float x, float y, float z);
+	void SetRotation(TransformHandle handle, DirectX::XMFLOAT4 quaternion);
+	void SetScale(TransformHandle handle, float x, float y, float z);
+
+	// Euler angles, for editing: converted to and from the quaternion
+	DirectX::XMFLOAT3 GetPitchYawRoll(TransformHandle handle);
+	void SetPitchYawRoll(TransformHandle handle, float p, float y, float r);
+
+	// Bulk edits: the same as Transform's SetPosition, MoveAbsolute and
+	// Rotate on each node, but done four nodes at a time and split
+	// between the workers.  Each handle should appear at most once;
+	// stale ones are skipped.
+	void SetPositions(const TransformHandle* handles, const DirectX::XMFLOAT3* positions, size_t count);
+	void MoveAbsolute(const TransformHandle* handles, size_t count, float x, float y, float z);
+	void Rotate(const TransformHandle* handles, size_t count, float p, float y, float r);
+
+	// Kept up to date whenever the rotation is set
+	const TransformAxes& GetAxes(TransformHandle handle);
+
+	// Moves the node (and everything below it) under a new parent,
+	// or makes it a root with TRANSFORM_NO_PARENT
+	void SetParent(TransformHandle handle, TransformHandle parentHandle);
+	TransformHandle GetParent(TransformHandle handle);
+	unsigned int GetChildCount(TransformHandle handle);
+	Transform* GetOwner(TransformHandle handle);
+
+	// Children in the order they were added, ending in TRANSFORM_NO_NODE
+	TransformHandle GetFirstChild(TransformHandle handle);
+	TransformHandle GetNextSibling(TransformHandle handle);
+	TransformHandle GetChild(TransformHandle handle, unsigned int index);	// Walks the list
+
+	// Brings the node (and any ancestors) up to date first if needed.
+	// Both are affine, so only the first three columns are kept (as
+	// the rows of a 3x4, the way shaders read them)
+	DirectX::XMFLOAT3X4 GetWorldMatrix(TransformHandle handle);
+	DirectX::XMFLOAT3X4 GetWorldInverseTransposeMatrix(TransformHandle handle);
+
+	// Changes whenever the node's world matrix does
+	unsigned int GetWorldVersion(TransformHandle handle);
+
+	// Hands over every node whose world matrix has been rebuilt since
+	// the last call (in no particular order, possibly more than once).
+	// Returns false if there were too many to keep track of, in which
+	// case anything could have changed.
+	bool TakeChangeJournal(std::vector<TransformHandle>& handles);
+
+	// A handle's slot, which stays the same for the node's lifetime and
+	// is always less than GetSlotCount() (for arrays kept alongside)
+	static unsigned int GetSlot(TransformHandle handle) { return handle & TRANSFORM_INDEX_MASK; }
+	unsigned int GetSlotCount() { return slotCount; }
+
+	// Recomputes every out of date world matrix, once per frame after
+	// everything's moved
+	void UpdateWorldMatrices();
+
+	// Threads sharing UpdateWorldMatrices() (0 for one per core)
+	void SetThreadCount(unsigned int threadCount);
+	unsigned int GetThreadCount() { return workers->GetThreadCount(); }
+
+	// Changes made between BeginStep() and EndStep() are blended in from
+	// the state at BeginStep(), the fraction given to SetInterpolation()
+	// of the way; changes made outside a step show up straight away
+	void BeginStep();
+	void EndStep() { stepping = false; }
+	void SetInterpolation(float alpha);
+
+	// Starts counting a new frame's work, keeping the last frame's
+	void BeginFrame();
+	TransformStats GetFrameStats() { return lastFrameStats; }
+
+	// Times the batched pass against walking up through each node's
+	// parents, and against the original Transform class, on a separate
+	// hierarchy of the given size
+	static TransformBenchmark RunBenchmark(unsigned int nodeCount = TRANSFORM_BENCHMARK_NODES);
+
+	// Times a full update with 1 to maxThreads threads (0 for one per core)
+	static std::vector<TransformScaling> RunScalingBenchmark(unsigned int nodeCount = TRANSFORM_SCALING_NODES, unsigned int maxThreads = 0);
+
+	// Times the bulk edits against a call per node, on one thread and
+	// on all of them
+	static TransformBulkBenchmark RunBulkBenchmark(unsigned int nodeCount = TRANSFORM_BULK_BENCHMARK_NODES);
+
+private:
+	// Local data, by place in the sorted order (padded to a multiple of 4)
+	std::vector<float> positionX;
+	std::vector<float> positionY;
+	std::vector<float> positionZ;
+	std::vector<float> rotationX;
+	std::vector<float> rotationY;
+	std::vector<float> rotationZ;
+	std::vector<float> rotationW;
+	std::vector<float> scaleX;
+	std::vector<float> scaleY;
+	std::vector<float> scaleZ;
+
+	// The same at the start of the current step
+	std::vector<float> previousPositionX;
+	std::vector<float> previousPositionY;
+	std::vector<float> previousPositionZ;
+	std::vector<float> previousRotationX;
+	std::vector<float> previousRotationY;
+	std::vector<float> previousRotationZ;
+	std::vector<float> previousRotationW;
+	std::vector<float> previousScaleX;
+	std::vector<float> previousScaleY;
+	std::vector<float> previousScaleZ;
+
+	// Local axes, also by place in the sorted order
+	std::vector<TransformAxes> axes;
+
+	// Which versions each world matrix was built from
+	struct NodeVersions
+	{
+		unsigned int Local;			// Last change to the local data (or parent)
+		unsigned int World;			// Last time the world matrix changed
+		unsigned int LocalUsed;		// Local the world matrix was built from
+		unsigned int ParentUsed;	// Parent's World it was built from
+		unsigned int Frame;			// Frame it was last built in
+		unsigned int NormalUsed;	// World the normal matrix was built from
+	};
+
+	// Results, also by place in the sorted order
+	std::vector<int> parents;
+	std::vector<NodeVersions> versions;
+	std::vector<DirectX::XMFLOAT3X4> worldMatrices;
+	std::vector<DirectX::XMFLOAT3X4> normalMatrices;	// Only built when asked for
+
+	// Where each level of the hierarchy starts in the sorted order
+	// (with the node count last)
+	std::vector<unsigned int> levelStarts;
+
+	// One node of the hierarchy, in a slot of the pool.  Links
+	// are slots (TRANSFORM_NO_NODE for none).
+	struct Node
+	{
+		unsigned int Generation;		// Matches the handle while the node exists
+		unsigned int Dense;				// Place in the sorted order
+		unsigned int Parent;
+		unsigned int FirstChild;
+		unsigned int LastChild;
+		unsigned int NextSibling;		// Also links the free slots
+		unsigned int PreviousSibling;
+		unsigned int ChildCount;
+		Transform* Owner;
+		bool Moving;					// Changed during the current step
+	};
+
+	// The pool: pages of TRANSFORM_PAGE_SIZE nodes
+	std::vector<Node*> pages;
+	unsigned int slotCount;		// Slots handed out so far
+	unsigned int freeSlot;		// First slot to reuse
+
+	// Slot of each place in the sorted order
+	std::vector<unsigned int> denseToSlot;
+
+	bool orderDirty;		// The hierarchy has changed since the last sort
+	bool localsChanged;		// Something has changed since the last update
+	unsigned int nextVersion;
+
+	// Nodes rebuilt since the last TakeChangeJournal(), and the same
+	// for each job of the current level
+	std::vector<TransformHandle> changeJournal;
+	bool changeJournalOverflowed;
+	std::vector<TransformHandle> jobChanges[TRANSFORM_MAX_JOBS];
+
+	// The nodes of the current bulk edit, and where each one's
+	// handle was in the edit's input
+	std::vector<unsigned int> bulkDense;
+	std::vector<unsigned int> bulkSource;
+
+	// Nodes whose previous and current data differ
+	std::vector<TransformHandle> moving;
+	bool stepping;
+	float renderAlpha;
+
+	unsigned int frame;
+	TransformStats frameStats;
+	TransformStats lastFrameStats;
+	std::vector<unsigned int> chain;
+
+	WorkerPool* workers;
+
+	Node& NodeAt(unsigned int slot) { return pages[slot / TRANSFORM_PAGE_SIZE][slot % TRANSFORM_PAGE_SIZE]; }
+	TransformHandle HandleOf(unsigned int slot) { return (NodeAt(slot).Generation << TRANSFORM_INDEX_BITS) | slot; }
+	Node* Find(TransformHandle handle);
+	unsigned int DenseOf(TransformHandle handle);
+	void Unlink(unsigned int slot);
+	void Link(unsigned int slot, unsigned int parentSlot);
+
+	void ResizeLocals(size_t count);
+	void SortParentsFirst();
+	void MarkChanged(unsigned int dense);
+	void MarkMoved(unsigned int dense);
+	void AddToMoving(unsigned int dense);
+	void KeepAsPrevious(unsigned int dense);
+	bool IsOutOfDate(unsigned int dense, int parentDense);
+	void RecordCompute(unsigned int dense, int parentDense, unsigned int version, TransformStats& stats);
+	void RecordChanges(const TransformHandle* handles, size_t count);
+	void UpdateRange(unsigned int begin, unsigned int end, unsigned int version, TransformStats& stats, std::vector<TransformHandle>& changed);
+	void ResolveBulk(const TransformHandle* handles, size_t count);
+	void RunBulk(const std::function<void(size_t, size_t)>& edit);
+	void RotateRange(size_t begin, size_t end, DirectX::XMFLOAT4 local, DirectX::XMFLOAT4 yaw);
+	static void BuildBenchmarkHierarchy(TransformSystem& system, unsigned int nodeCount);
+	void UpdateWorldMatrix(unsigned int slot);
+	DirectX::XMMATRIX GetLocalMatrix(unsigned int dense);
+	DirectX::XMMATRIX ComputeWorldFromParents(unsigned int slot);
+};
+
@@ -1,12 +1,27 @@
 
-// Constant Buffer for external (C++) data
-cbuffer externalData : register(b0)
+// Every object's matrices, indexed by transform slot (which
+// comes from the per instance stream, so one draw can cover
+// every object sharing a mesh and material)
+// - Must match ObjectMatrices in C++
+struct ObjectMatrices
+{
+	// Affine, so just the first three rows
+	row_major float3x4 world;
+	row_major float3x4 worldInverseTranspose;
+};
+StructuredBuffer<ObjectMatrices> objects : register(t0);
+
+// Constant buffers for external (C++) data, split up by how
+// often they change, so a sorted draw loop only uploads the
+// ones that did
+cbuffer perFrame : register(b0)
 {
-	matrix world;
-	matrix worldInverseTranspose;
 	matrix view;
 	matrix projection;
+};
 
+cbuffer perMaterial : register(b1)
+{
 	float2 uvScale;
 };
 
@@ -17,6 +32,7 @@ struct VertexShaderInput
 	float2 uv			: TEXCOORD;
 	float3 normal		: NORMAL;
 	float3 tangent		: TANGENT;
+	uint objectIndex	: SLOT_PER_INSTANCE;
 };
 
 // Out of the vertex shader (and eventually input to the PS)
@@ -27,30 +43,32 @@ struct VertexToPixel
 	float3 normal			: NORMAL;
 	float3 tangent			: TANGENT;
 	float3 worldPos			: POSITION; // The world position of this vertex
+	nointerpolation uint instance : INSTANCE; // Which instance of the draw this is
 };
 
 // --------------------------------------------------------
 // The entry point (main method) for our vertex shader
 // --------------------------------------------------------
-VertexToPixel main(VertexShaderInput input)
+VertexToPixel main(VertexShaderInput input, uint instanceID : SV_InstanceID)
 {
 	// Set up output
 	VertexToPixel output;
-
-	// Calculate output position
-	matrix worldViewProj = mul(projection, mul(view, world));
-	output.screenPosition = mul(worldViewProj, float4(input.position, 1.0f));
+	ObjectMatrices object = objects[input.objectIndex];
 
 	// Calculate the world position of this vertex (to be used
 	// in the pixel shader when we do point/spot lights)
-	output.worldPos = mul(world, float4(input.position, 1.0f)).xyz;
+	output.worldPos = mul(object.world, float4(input.position, 1.0f));
+
+	// Calculate output position
+	output.screenPosition = mul(projection, mul(view, float4(output.worldPos, 1.0f)));
 
 	// Make sure the normal is in WORLD space, not "local" space
-	output.normal = normalize(mul((float3x3)worldInverseTranspose, input.normal));
-	output.tangent = normalize(mul((float3x3)worldInverseTranspose, input.tangent));
+	output.normal = normalize(mul((float3x3)object.worldInverseTranspose, input.normal));
+	output.tangent = normalize(mul((float3x3)object.worldInverseTranspose, input.tangent));
 
 	// Pass through the uv
 	output.uv = input.uv * uvScale;
+	output.instance = instanceID;
 
 	return output;
 }
\ No newline at end of file
@@ -0,0 +1,95 @@
+
+// Every object's matrices, indexed by transform slot (from
+// the per instance stream, see VertexShader.hlsl)
+// - Must match ObjectMatrices in C++
+struct ObjectMatrices
+{
+	// Affine, so just the first three rows
+	row_major float3x4 world;
+	row_major float3x4 worldInverseTranspose;
+};
+StructuredBuffer<ObjectMatrices> objects : register(t0);
+
+// Constant buffers for external (C++) data, split up by how
+// often they change (see VertexShader.hlsl)
+cbuffer perFrame : register(b0)
+{
+	matrix view;
+	matrix projection;
+};
+
+cbuffer perMaterial : register(b1)
+{
+	float2 uvScale;
+};
+
+// Maps quantized positions back to object space
+cbuffer perMesh : register(b2)
+{
+	float3 positionOffset;
+	float3 positionScale;
+};
+
+// Struct representing a single (packed) vertex worth of data
+// - Must match CompactVertex and its input layout in C++
+struct VertexShaderInput
+{
+	float4 position		: POSITION;	// R16G16B16A16_UNORM: xyz within the bounds, w = handedness
+	float2 uv			: TEXCOORD;	// R16G16_FLOAT
+	float2 normal		: NORMAL;	// R16G16_SNORM, octahedral
+	float2 tangent		: TANGENT;	// R16G16_SNORM, octahedral
+	uint objectIndex	: SLOT_PER_INSTANCE; // R32_UINT, in input slot 1
+};
+
+// Out of the vertex shader (and eventually input to the PS)
+struct VertexToPixel
+{
+	float4 screenPosition	: SV_POSITION;
+	float2 uv				: TEXCOORD;
+	float3 normal			: NORMAL;
+	float3 tangent			: TANGENT;
+	float3 worldPos			: POSITION; // The world position of this vertex
+	nointerpolation uint instance : INSTANCE; // Which instance of the draw this is
+};
+
+// Unfolds an octahedral-encoded unit vector
+float3 OctahedralDecode(float2 e)
+{
+	float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.xy += n.xy >= 0.0f ? -t : t;
+	return normalize(n);
+}
+
+// --------------------------------------------------------
+// The entry point (main method) for our vertex shader
+// --------------------------------------------------------
+VertexToPixel main(VertexShaderInput input, uint instanceID : SV_InstanceID)
+{
+	// Set up output
+	VertexToPixel output;
+	ObjectMatrices object = objects[input.objectIndex];
+
+	// Unpack the vertex.  The handedness in position.w isn't needed
+	// yet, as NormalMapping() derives the bitangent from N and T
+	float3 position = positionOffset + input.position.xyz * positionScale;
+	float3 normal = OctahedralDecode(input.normal);
+	float3 tangent = OctahedralDecode(input.tangent);
+
+	// Calculate the world position of this vertex (to be used
+	// in the pixel shader when we do point/spot lights)
+	output.worldPos = mul(object.world, float4(position, 1.0f));
+
+	// Calculate output position
+	output.screenPosition = mul(projection, mul(view, float4(output.worldPos, 1.0f)));
+
+	// Make sure the normal is in WORLD space, not "local" space
+	output.normal = normalize(mul((float3x3)object.worldInverseTranspose, normal));
+	output.tangent = normalize(mul((float3x3)object.worldInverseTranspose, tangent));
+
+	// Pass through the uv
+	output.uv = input.uv * uvScale;
+	output.instance = instanceID;
+
+	return output;
+}
@@ -0,0 +1,120 @@
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(unsigned int threadCount)
+{
+	currentJob = 0;
+	currentJobCount = 0;
+	generation = 0;
+	nextJob = 0;
+	remainingJobs = 0;
+	busyWorkers = 0;
+	quitting = false;
+
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	if (threadCount == 0)
+		threadCount = 1;
+
+	// This thread is the last one
+	for (unsigned int t = 1; t < threadCount; t++)
+		workers.push_back(std::thread(&WorkerPool::WorkerLoop, this));
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quitting = true;
+	}
+	wake.notify_all();
+
+	for (auto& w : workers)
+		w.join();
+}
+
+void WorkerPool::Run(unsigned int jobCount, const std::function<void(unsigned int)>& job)
+{
+	if (jobCount == 0)
+		return;
+
+	// Nothing to share
+	if (workers.empty() || jobCount == 1)
+	{
+		for (unsigned int j = 0; j < jobCount; j++)
+			job(j);
+		return;
+	}
+
+	{
+		// Workers that woke up late for the last Run() have to be gone
+		// before its counters are reset
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [&] { return busyWorkers == 0; });
+
+		currentJob = &job;
+		currentJobCount = jobCount;
+		nextJob = 0;
+		remainingJobs = jobCount;
+		generation++;
+	}
+	wake.notify_all();
+
+	RunJobs(job, jobCount);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [&] { return remainingJobs == 0; });
+	currentJob = 0;
+}
+
+void WorkerPool::WorkerLoop()
+{
+	unsigned int seenGeneration = 0;
+	for (;;)
+	{
+		const std::function<void(unsigned int)>* job;
+		unsigned int jobCount;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return quitting || generation != seenGeneration; });
+			if (quitting)
+				return;
+
+			seenGeneration = generation;
+			job = currentJob;
+			jobCount = currentJobCount;
+			busyWorkers++;
+		}
+
+		// May find every job already taken
+		if (job)
+			RunJobs(*job, jobCount);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busyWorkers--;
+		}
+		done.notify_all();
+	}
+}
+
+// --------------------------------------------------------
+// Takes jobs until there are none left
+// --------------------------------------------------------
+void WorkerPool::RunJobs(const std::function<void(unsigned int)>& job, unsigned int jobCount)
+{
+	for (;;)
+	{
+		unsigned int j = nextJob.fetch_add(1);
+		if (j >= jobCount)
+			return;
+
+		job(j);
+
+		// The last job wakes up Run()
+		if (remainingJobs.fetch_sub(1) == 1)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			done.notify_all();
+		}
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// A fixed set of threads that stay alive between uses, for
+// work done every frame (starting threads each time would
+// cost more than the work).  The thread calling Run() takes
+// jobs too, so a pool of N threads starts N - 1 of its own.
+// --------------------------------------------------------
+class WorkerPool
+{
+public:
+	// 0 uses one thread per core
+	WorkerPool(unsigned int threadCount = 0);
+	~WorkerPool();
+
+	WorkerPool(WorkerPool const&) = delete;
+	void operator=(WorkerPool const&) = delete;
+
+	unsigned int GetThreadCount() { return (unsigned int)workers.size() + 1; }
+
+	// Calls job(0) through job(jobCount - 1) across the pool, in no
+	// particular order, and returns once they've all finished
+	void Run(unsigned int jobCount, const std::function<void(unsigned int)>& job);
+
+private:
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable wake;		// A new Run() has started (or the pool is closing)
+	std::condition_variable done;		// Jobs or workers have finished
+
+	// The current Run()
+	const std::function<void(unsigned int)>* currentJob;
+	unsigned int currentJobCount;
+	unsigned int generation;
+	std::atomic<unsigned int> nextJob;
+	std::atomic<unsigned int> remainingJobs;
+
+	unsigned int busyWorkers;
+	bool quitting;
+
+	void WorkerLoop();
+	void RunJobs(const std::function<void(unsigned int)>& job, unsigned int jobCount);
+};
+